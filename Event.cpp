@@ -32,11 +32,22 @@
 Event::Event(void)
 {
 	eventType = EVENT_NONE;
+	generation = 0;
+	priority = 0;
+	budget = 0;
+	worst = 0;
+	overruns = 0;
 }
 
 void Event::update(void)
 {
-	unsigned long now = millis();
+	update(millis());
+}
+
+// the same, with the time update() was called at, so a Timer can decide
+// what is due and run it on the same millis()
+void Event::update(unsigned long now)
+{
 	if (now - lastEventTime >= period)
 	{
 		switch (eventType)
@@ -45,6 +56,10 @@ void Event::update(void)
 				(*callback)();
 				break;
 
+			case EVENT_EVERY_CONTEXT:
+				(*contextCallback)(context);
+				break;
+
 			case EVENT_OSCILLATE:
 				pinState = ! pinState;
 				digitalWrite(pin, pinState);
@@ -57,4 +72,42 @@ void Event::update(void)
 	{
 		eventType = EVENT_NONE;
 	}
+}
+
+MicroEvent::MicroEvent(void)
+{
+	eventType = EVENT_NONE;
+	generation = 0;
+	late = 0;
+	missed = 0;
+}
+
+// runs the callback if the deadline has come; true if it did
+bool MicroEvent::update(uint32_t now)
+{
+	int32_t behind = (int32_t)(now - deadline);
+
+	if (behind < 0)
+	{
+		return false;
+	}
+
+	(*callback)();
+
+	if ((uint32_t)behind > late)
+	{
+		late = ((uint32_t)behind > 0xFFFF) ? 0xFFFF : (uint16_t)behind;
+	}
+
+	// a whole period or more behind: the samples in between are dropped
+	// rather than run back to back, and the deadline starts over from now
+	if ((uint32_t)behind >= period)
+	{
+		uint32_t dropped = (uint32_t)behind / period;
+
+		missed = ((uint32_t)missed + dropped > 0xFFFF) ? 0xFFFF : (uint16_t)(missed + dropped);
+		deadline = now;
+	}
+	deadline += period;
+	return true;
 }
@@ -28,6 +28,7 @@
 #define EVENT_NONE 0
 #define EVENT_EVERY 1
 #define EVENT_OSCILLATE 2
+#define EVENT_EVERY_CONTEXT 3
 
 class Event
 {
@@ -35,14 +36,54 @@ class Event
 public:
   Event(void);
   void update(void);
+  void update(unsigned long now);
   int8_t eventType;
   unsigned long period;
   int repeatCount;
   uint8_t pin;
   uint8_t pinState;
-  void (*callback)(void);
+  // an EVENT_EVERY calls callback, an EVENT_EVERY_CONTEXT calls
+  // contextCallback with context; only one is ever set
+  union
+  {
+    void (*callback)(void);
+    void (*contextCallback)(void *context);
+  };
+  void *context;
   unsigned long lastEventTime;
   int count;
+  uint16_t generation;
+  // the class update() runs it in (TIMER_PRIORITY_* in Timer.h), and its
+  // time budget and what it has taken, in microseconds
+  uint8_t priority;
+  uint16_t budget;
+  uint16_t worst;
+  uint16_t overruns;
+};
+
+// An every() on micros() rather than millis(), for sampling an input at a
+// kHz or two (Timer::everyMicros() in Timer.h).  It keeps its deadline,
+// which moves on by the period each time it runs, so the samples keep to
+// the period however late each run is.  All of its time arithmetic is on
+// uint32_t, as micros() is on the Uno: the difference of two times read
+// as signed is right across the wrap of micros() (every 71.6 minutes),
+// for periods up to 2^31 us.  No 64 bit math, and no division unless a
+// whole period has been missed.
+class MicroEvent
+{
+
+public:
+  MicroEvent(void);
+  bool update(uint32_t now);
+  int8_t eventType;
+  void (*callback)(void);
+  uint32_t period;
+  uint32_t deadline;
+  uint16_t generation;
+  // the latest it has run after its deadline, in microseconds, and the
+  // samples dropped because a whole period had gone by
+  uint16_t late;
+  uint16_t missed;
 };
 
 #endif
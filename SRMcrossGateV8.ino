@@ -16,9 +16,22 @@
 #include "SRMcrossGate_types.h"
 #include "SRMcrossGate_UpDownControl.h"
 #include "SRMcrossGate_Utils.h"
+#include "SRMcrossGate_Power.h"
+#include "SRMcrossGate_BlackBox.h"
+#include "SRMcrossGate_History.h"
+#include "SRMcrossGate_Stats.h"
+#include "SRMcrossGate_Stack.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Trace.h"
+#include "SRMcrossGate_Controller.h"
+#include "SRMcrossGate_Sequences.h"
 
 Timer gCrossingGateTimer;
 int giMainLoopEventTimerID;
+extern bool gbIdleSleepAllowed;
+
+// the Arduino IDE generates this prototype for us, the host builds need it spelled out
+void CrossingSignalMain();
 
 // ***************************************************
 //
@@ -31,37 +44,64 @@ int giMainLoopEventTimerID;
 // ****************************************************
 void setup()
 {
+  int iHistoryFlushTimerID;
+  int iStatsFlushTimerID;
+  
   // have to initialize the serial port if we want to use if for debug
   Serial.begin(9600);
   
+  // the state machine starts out initializing the gate
+  CrossingStateReset();
+  
+  // if we came out of a reset (rather than a power cycle), print what we were doing before it
+  BlackBoxDumpAndReset();
+  
   // Setup the Arduino pins for input and output.  
   // Then set their initial state
   pinMode(kPinAddrGateTrackSensor, INPUT);
   
   pinMode(kPinAddrGateBellControl, OUTPUT);
-  digitalWrite(kPinAddrGateBellControl, kWarningBellOff);
+  GatePinWrite(kPinAddrGateBellControl, kWarningBellOff);
   
   pinMode(kPinAddrGateLightsControlLeft, OUTPUT);
-  digitalWrite(kPinAddrGateLightsControlLeft, kWarningLightsOff);
+  GatePinWrite(kPinAddrGateLightsControlLeft, kWarningLightsOff);
   
   pinMode(kPinAddrGateLightsControlRight, OUTPUT);
-  digitalWrite(kPinAddrGateLightsControlRight, kWarningLightsOff);
+  GatePinWrite(kPinAddrGateLightsControlRight, kWarningLightsOff);
   
   pinMode(kPinAddrGateArmControlMotorPower, OUTPUT);
-  digitalWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
+  GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
   
   pinMode(kPinAddrGateArmControlMotorDirection, OUTPUT);
-  digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
+  GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
   
   pinMode(kPinAddrGateStatusLED, OUTPUT);
-  digitalWrite(kPinAddrGateStatusLED, kStatusLEDoff);
+  GatePinWrite(kPinAddrGateStatusLED, kStatusLEDoff);
   
   // We are going to start the main loop event.
   // Each time this timer kicks, we are going to check the state of the track, and take 
-  // whatever action as needed.
-  giMainLoopEventTimerID = gCrossingGateTimer.every(250, CrossingSignalMain);
+  // whatever action as needed.  Event driven, it only kicks when a state's deadline
+  // comes or the track sensor changes (SRMcrossGate_Controller.h).
+  giMainLoopEventTimerID = ControllerBegin();
+  gCrossingGateTimer.setBudget(giMainLoopEventTimerID, kMainLoopBudget);
+  
+  // The crossing history is kept in the EEPROM.  The state machine only queues the
+  // events, this timer writes them out.  It is housekeeping, so it waits while the
+  // flashers or the main loop are running late.
+  HistoryBegin();
+  iHistoryFlushTimerID = gCrossingGateTimer.every(1000, HistoryFlush);
+  gCrossingGateTimer.setPriority(iHistoryFlushTimerID, TIMER_PRIORITY_HOUSEKEEPING);
+  gCrossingGateTimer.setBudget(iHistoryFlushTimerID, kHistoryFlushBudget);
+  
+  // The closure statistics are kept after the history, and written out the same way.
+  StatsBegin();
+  iStatsFlushTimerID = gCrossingGateTimer.every(1000, StatsFlush);
+  gCrossingGateTimer.setPriority(iStatsFlushTimerID, TIMER_PRIORITY_HOUSEKEEPING);
+  gCrossingGateTimer.setBudget(iStatsFlushTimerID, kStatsFlushBudget);
   
   Serial.println("Crossing Guard Controller - Ver 1.08");
+  Serial.print(F("Profile: "));
+  Serial.println(CrossingProfile::kName);
   
 }  //endof setup()
 
@@ -72,13 +112,31 @@ void setup()
 // This is the main Arduino function that is called once setup()
 // has finished.   We are using this loop to kick off our
 // timer.  The timers provide us with a pseudo 
-// operating system.
+// operating system.  When the crossing is idle, we sleep
+// between timer ticks instead of spinning.
 //
 // ****************************************************
 void loop()
 {
     gCrossingGateTimer.update();
     
+    // the raw sensor level, for host/ReplaySensorTrace.cpp, when kRecordSensorTrace is set
+    RecordSensorTrace();
+    
+    // each track sensor edge queues a run of the event driven controller
+    ControllerPoll();
+    
+    ProcessSerialCommand();
+    
+    // one byte compare, it reports the first time the stack gets close to the heap
+    StackCheck();
+    
+    // we do not want to go to sleep while the history is still streaming out
+    if (HistoryDumpPoll() == false)
+    {
+        IdleSleepIfAllowed();
+    }
+    
 }  //endof loop()
 
 // *****************************************************************************************
@@ -87,45 +145,49 @@ void loop()
 //
 // The main loop of the crossing guard program is actually a state machine.   
 // Each time the timer goes off, this function is called.   All the state variables are 
-// listed as static, such that their previous values are maintained. 
+// kept in gCrossingState, such that their previous values are maintained. 
 //
 // ****************************************************************************************
 void CrossingSignalMain()
 {
   int iTrackState;
   
-  static bool bMotorOnFlag  = false;
-  static bool bMotorOffFlag = false;
-  static bool bMotorDirectionFlag = false;
+  // the state machine variables, these live in gCrossingState (SRMcrossGate_State.h)
+  bool &bMotorOnFlag = gCrossingState.bMotorOnFlag;
+  bool &bMotorDirectionFlag = gCrossingState.bMotorDirectionFlag;
   
-  static bool bGateState = kGateInTheUpPosition;
+  bool &bGateState = gCrossingState.bGateState;
   
-  static int iWarningLightTimerRightID = 0;
-  static int iWarningLightTimerLeftID = 0;
+  int &iWarningLightTimerRightID = gCrossingState.iWarningLightTimerRightID;
+  int &iWarningLightTimerLeftID = gCrossingState.iWarningLightTimerLeftID;
   
-  static int iTrackOcupationState = kInitializing;
-  static int iGateInitializationState = kGateInitalize_LightsBellsAndDirection;
-  static int iWarningLightRightTimerID = 0; 
-  static int iWarningLightLeftTimerID = 0;
+  int &iTrackOcupationState = gCrossingState.iTrackOcupationState;
+  int &iGateInitializationState = gCrossingState.iGateInitializationState;
+  int &iWarningLightRightTimerID = gCrossingState.iWarningLightRightTimerID;
+  int &iWarningLightLeftTimerID = gCrossingState.iWarningLightLeftTimerID;
   
-  static int iGateMovingDown_State = kGateMovingDown_State_LightsAndBells;
-  static int iGateMovingUp_State = kGateMovingUp_State_Debouce; 
+  int &iGateMovingDown_State = gCrossingState.iGateMovingDown_State;
+  int &iGateMovingUp_State = gCrossingState.iGateMovingUp_State;
   
-  static unsigned long ulGateDownEventStartTime = 0;
-  static unsigned long ulGateDownEventTotalElapsedTime = 0;
-  static unsigned long ulGateDownEventElapsedStartTime = 0;
-  static unsigned long ulGateDownEventTimeSpentInSequence = 0;
+  unsigned long &ulGateDownEventStartTime = gCrossingState.ulGateDownEventStartTime;
+  unsigned long &ulGateDownEventTotalElapsedTime = gCrossingState.ulGateDownEventTotalElapsedTime;
+  unsigned long &ulGateDownEventElapsedStartTime = gCrossingState.ulGateDownEventElapsedStartTime;
+  unsigned long &ulGateDownEventTimeSpentInSequence = gCrossingState.ulGateDownEventTimeSpentInSequence;
   
-  static unsigned long ulGateUpEventStartTime = 0;
-  static unsigned long ulGateUpEventTimeSpentInSequence = 0;
-  static unsigned long ulGateInitializeStartTime = 0;
+  unsigned long &ulGateUpEventStartTime = gCrossingState.ulGateUpEventStartTime;
+  unsigned long &ulGateUpEventTimeSpentInSequence = gCrossingState.ulGateUpEventTimeSpentInSequence;
+  unsigned long &ulGateInitializeStartTime = gCrossingState.ulGateInitializeStartTime;
 
-  static bool bMotorRunning = false;
-  static unsigned long ulMotorRunningTotalSeconds = 0;
+  bool &bMotorRunning = gCrossingState.bMotorRunning;
+  unsigned long &ulMotorRunningTotalSeconds = gCrossingState.ulMotorRunningTotalSeconds;
 
-  static unsigned long ulGateDownStateDelayBeforeGateUpEventStartTime = 0;
+  unsigned long &ulGateDownStateDelayBeforeGateUpEventStartTime = gCrossingState.ulGateDownStateDelayBeforeGateUpEventStartTime;
   
-  static bool bDutyCycleExceededFlag = false;
+  bool &bDutyCycleExceededFlag = gCrossingState.bDutyCycleExceededFlag;
+
+  // only the gate up, track vacant state is allowed to put us to sleep
+  gbIdleSleepAllowed = false;
+  gCrossingState.ulControllerRuns++;
 
   // we do not want to read the track state if we are initializing the gates (to the up position)
   if (iTrackOcupationState != kInitializing)
@@ -190,7 +252,7 @@ void CrossingSignalMain()
               default:
                   
                   InitializeTheGateTurnOffUpMotor(iWarningLightRightTimerID, iWarningLightLeftTimerID, &bMotorRunning, &ulMotorRunningTotalSeconds);  
-                  iTrackOcupationState = kTrackVacant;
+                  SetState(iTrackOcupationState, kTrackVacant);
                   break;
           
           }  // iGateInitializationState
@@ -235,56 +297,7 @@ void CrossingSignalMain()
               // The Track is occupied, but in this case the gate is in the up postion, and we need to bring it down.
               case kGateInTheUpPosition:  
               {                
-                  switch (iGateMovingDown_State)
-                  {
-                   
-                      case kGateMovingDown_State_LightsAndBells:
-                      
-                          GateDownLightsBellsAndMotorDirectionState(ulGateDownEventStartTime, 
-                                                                    //&ulGateDownEventTimeSpentInSequence, 
-                                                                    &ulGateUpEventTimeSpentInSequence, 
-                                                                    &iGateMovingDown_State, 
-                                                                    &iWarningLightTimerRightID, 
-                                                                    &iWarningLightTimerLeftID);
-                          break;
-                       
-                      case kGateMovingDown_State_LightsAndBellsDelay:
-                      
-                           GateDownWarningLightsAndBellDelayState(&iGateMovingDown_State); 
-                           break;
-                       
-                      case kGateMovingDown_State_MotorOn:
-                      
-                          GateDownMotorOnState(ulGateDownEventStartTime, 
-                                               &bMotorOnFlag, 
-                                               &iGateMovingDown_State,
-                                               &bMotorRunning,
-                                               &ulMotorRunningTotalSeconds,
-                                               &bDutyCycleExceededFlag);
-                          break;
-                      
-                     case kGateMovingDown_State_MotorOnDelay:
-                     
-                          GateDownMotorOnDelay(&iGateMovingDown_State);
-                      
-                          break;
-                      
-                      case kGateMovingDown_State_MotorOff:
-                      default:
-                      
-                          GateDownMotorOffState(ulGateDownEventStartTime, 
-                                                &bMotorOnFlag, 
-                                                &bMotorOffFlag, 
-                                                &iGateMovingDown_State, 
-                                                &bGateState,
-                                                &bMotorRunning, 
-                                                &ulMotorRunningTotalSeconds,
-                                                &ulGateDownStateDelayBeforeGateUpEventStartTime,
-                                                &bDutyCycleExceededFlag);
-                                                
-                          break;
-                          
-                  } // iGateMovingDown_State 
+                  GateDownSequence();
                   
                   break;
               
@@ -312,7 +325,7 @@ void CrossingSignalMain()
               // All we are going to do is keep count of the number of seconds the gate is up.
               case kGateInTheUpPosition:
               {
-                  GateUpInactiveState();
+                  GateUpInactiveState(ulMotorRunningTotalSeconds);
                   break; 
               }  
             
@@ -321,58 +334,7 @@ void CrossingSignalMain()
               // We need to transistion everything to off.
               case kGateInDownPosition:
               {
-                  switch (iGateMovingUp_State)
-                  {
-                      case kGateMovingUp_State_Debouce:
-                      
-                          GateUpDebouceState(&ulGateUpEventTimeSpentInSequence, 
-                                             &ulGateUpEventStartTime, 
-                                             &iGateMovingUp_State);
-                          break;
-                          
-                      case kGateMovingUp_State_MotorDirection:
-                      
-                          GateUpMotorDirectionState(&ulGateUpEventStartTime, 
-                                                    &bMotorDirectionFlag,
-                                                    &iGateMovingUp_State);
-                          break;
-                          
-                      case kGateMovingUp_State_MotorDirectionDelay:
-                      
-                          GateUpMotorDirectionDelayState(&iGateMovingUp_State);
-                          break;
-                          
-                          
-                      case kGateMovingUp_State_MotorOn:
-                      
-                          GateUpMotorOnState(&ulGateUpEventStartTime, 
-                                             &bMotorOnFlag, 
-                                             &iGateMovingUp_State,
-                                             &bMotorRunning); 
-                           break;
-                          
-                     case kGateMovingUp_State_MotorOnDelay:
-                     
-                          GateUpMotorOnDelayState(&iGateMovingUp_State);
-                          break;
-
-                      case kGateMovingUp_State_MotorOff:
-                      default:
-                      
-                         GateUpMotorOffState(&ulGateUpEventStartTime, 
-                                             &iWarningLightTimerRightID,
-                                             &iWarningLightTimerLeftID,
-                                             &bGateState,
-                                             &ulGateDownEventStartTime,
-                                             &bMotorDirectionFlag,
-                                             &bMotorOnFlag,
-                                             &iGateMovingUp_State,
-                                             &bMotorRunning,
-                                             &ulMotorRunningTotalSeconds,
-                                             &bDutyCycleExceededFlag);
-                          break;
-                          
-                  }  // iGateMovingUp_State
+                  GateUpSequence();
                   
                   break;
                  
@@ -384,6 +346,22 @@ void CrossingSignalMain()
   
   } // iTrackOcupationState  
   
+  // a sensor change that is still being debounced needs the next tick, so we stay awake for it
+  if ((gbIdleSleepAllowed == true) && (digitalRead(kPinAddrGateTrackSensor) != iTrackState))
+  {
+      gbIdleSleepAllowed = false;
+  }
+  
+  // record any change of state in the black box, the sub state depends on which sequence we are in
+  BlackBoxRecordState(iTrackOcupationState, 
+                      bGateState,
+                      (iTrackOcupationState == kInitializing)   ? iGateInitializationState :
+                      (iTrackOcupationState == kTrackOccupied)  ? iGateMovingDown_State : iGateMovingUp_State,
+                      (digitalRead(kPinAddrGateTrackSensor) ? kBlackBoxFlagSensor : 0) |
+                      (bMotorRunning          ? kBlackBoxFlagMotorRunning : 0) |
+                      (bMotorDirectionFlag    ? kBlackBoxFlagMotorDirection : 0) |
+                      (bDutyCycleExceededFlag ? kBlackBoxFlagDutyCycle : 0));
+  
 }  //endof CrossingSignalMain()
 
 
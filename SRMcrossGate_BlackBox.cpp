@@ -0,0 +1,108 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_BlackBox.h"
+
+const uint16_t kBlackBoxMagic = 0xB10C;
+
+// The black box lives in the .noinit section, such that the C startup code does
+// not clear it.  Its contents survive a watchdog (or any other) reset, but not a power cycle.
+#if defined(__AVR__)
+BlackBox_t gBlackBox __attribute__ ((section (".noinit")));
+#else
+BlackBox_t gBlackBox;
+#endif
+
+// ***************************************************
+//
+// BlackBoxDumpAndReset()
+//
+// This function is called from setup().  If the black box survived
+// the reset, we print out its contents and then start a new recording.
+//
+// ****************************************************
+void BlackBoxDumpAndReset(void)
+{
+    uint8_t uiIndex;
+    uint8_t i;
+
+    // after a power cycle the ram is random, so make sure the ring looks sane before we trust it
+    if ((gBlackBox.uiMagic == kBlackBoxMagic) &&
+        (gBlackBox.uiHead < kBlackBoxRecordCount) &&
+        (gBlackBox.uiCount <= kBlackBoxRecordCount))
+    {
+        Serial.print(F("Black Box Records: "));
+        Serial.println(gBlackBox.uiCount);
+
+        // start with the oldest record
+        uiIndex = (gBlackBox.uiHead - gBlackBox.uiCount) & (kBlackBoxRecordCount - 1);
+
+        for (i = 0; i < gBlackBox.uiCount; i++)
+        {
+            BlackBoxRecord_t *pRecord = &gBlackBox.records[uiIndex];
+
+            Serial.print(F("BB +"));
+            Serial.print(pRecord->uiTimeDelta);
+            Serial.print(F(" "));
+            Serial.print(pRecord->uiPreviousState, HEX);
+            Serial.print(F(">"));
+            Serial.print(pRecord->uiState, HEX);
+            Serial.print(F(" F"));
+            Serial.println(pRecord->uiFlags, HEX);
+
+            uiIndex = (uiIndex + 1) & (kBlackBoxRecordCount - 1);
+        }
+    }
+
+    // start a new recording
+    gBlackBox.uiMagic = kBlackBoxMagic;
+    gBlackBox.uiHead = 0;
+    gBlackBox.uiCount = 0;
+    gBlackBox.uiLastState = 0;
+    gBlackBox.uiLastFlags = 0;
+    gBlackBox.ulLastTime = millis();
+
+}  //endof BlackBoxDumpAndReset()
+
+// ***************************************************
+//
+// BlackBoxRecordTransition()
+//
+// This function adds one record to the black box ring.
+//
+// ****************************************************
+void BlackBoxRecordTransition(uint8_t uiState, uint8_t uiFlags)
+{
+    unsigned long ulNow = millis();
+    unsigned long ulTimeDelta = ulNow - gBlackBox.ulLastTime;
+    BlackBoxRecord_t *pRecord = &gBlackBox.records[gBlackBox.uiHead];
+
+    // anything longer than ~65 seconds is just recorded as the maximum
+    pRecord->uiTimeDelta = (ulTimeDelta > 0xFFFF) ? 0xFFFF : (uint16_t)ulTimeDelta;
+    pRecord->uiPreviousState = gBlackBox.uiLastState;
+    pRecord->uiState = uiState;
+    pRecord->uiFlags = uiFlags;
+
+    gBlackBox.uiHead = (gBlackBox.uiHead + 1) & (kBlackBoxRecordCount - 1);
+    if (gBlackBox.uiCount < kBlackBoxRecordCount)
+    {
+        gBlackBox.uiCount++;
+    }
+
+    gBlackBox.uiLastState = uiState;
+    gBlackBox.uiLastFlags = uiFlags;
+    gBlackBox.ulLastTime = ulNow;
+
+}  //endof BlackBoxRecordTransition()
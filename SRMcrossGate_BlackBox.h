@@ -0,0 +1,91 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_BlackBox_h
+#define SRMcrossGate_BlackBox_h
+
+#include <inttypes.h>
+
+// the number of transitions we keep, this must be a power of two
+const uint8_t kBlackBoxRecordCount = 32;
+
+const uint8_t kBlackBoxFlagSensor         = 0x01;
+const uint8_t kBlackBoxFlagMotorRunning   = 0x02;
+const uint8_t kBlackBoxFlagMotorDirection = 0x04;
+const uint8_t kBlackBoxFlagDutyCycle      = 0x08;
+
+// One state transition.  The state bytes hold the track state (bits 0-1),
+// the gate state (bit 2) and the sub state of the sequence we are in (bits 3-5).
+typedef struct
+{
+    uint16_t uiTimeDelta;
+    uint8_t  uiPreviousState;
+    uint8_t  uiState;
+    uint8_t  uiFlags;
+} BlackBoxRecord_t;
+
+typedef struct
+{
+    uint16_t uiMagic;
+    uint8_t  uiHead;
+    uint8_t  uiCount;
+    uint8_t  uiLastState;
+    uint8_t  uiLastFlags;
+    unsigned long ulLastTime;
+    BlackBoxRecord_t records[kBlackBoxRecordCount];
+} BlackBox_t;
+
+extern BlackBox_t gBlackBox;
+
+// ***************************************************
+//
+// BlackBoxDumpAndReset()
+//
+// This function is called from setup().  If the black box survived
+// the reset, we print out its contents and then start a new recording.
+//
+// ****************************************************
+void BlackBoxDumpAndReset(void);
+
+// ***************************************************
+//
+// BlackBoxRecordTransition()
+//
+// This function adds one record to the black box ring.
+//
+// ****************************************************
+void BlackBoxRecordTransition(uint8_t uiState, uint8_t uiFlags);
+
+// ***************************************************
+//
+// BlackBoxRecordState()
+//
+// This function is called at the end of every pass through the state machine.
+// It packs the state, and only records it when something has changed.
+// The raw sensor bit is not part of that: chatter on the sensor would fill
+// the ring with records the debounced track state does not follow.  It is
+// kept in each record that is written for something else.
+//
+// ****************************************************
+inline void BlackBoxRecordState(int iTrackOcupationState, bool bGateState, int iSubState, uint8_t uiFlags)
+{
+    uint8_t uiState = (uint8_t)((iTrackOcupationState & 0x03) | (bGateState << 2) | ((iSubState & 0x07) << 3));
+
+    if ((uiState != gBlackBox.uiLastState) ||
+        ((uiFlags & ~kBlackBoxFlagSensor) != (gBlackBox.uiLastFlags & ~kBlackBoxFlagSensor)))
+    {
+        BlackBoxRecordTransition(uiState, uiFlags);
+    }
+}
+
+#endif
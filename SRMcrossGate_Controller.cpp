@@ -0,0 +1,211 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_Controller.h"
+#include "SRMcrossGate_State.h"
+
+extern Timer gCrossingGateTimer;
+extern bool gbIdleSleepAllowed;
+
+void CrossingSignalMain();
+
+bool gbControllerEventDriven = true;
+
+static void ControllerWake(void);
+
+// ***************************************************
+//
+// ControllerArm()
+//
+// Points the wake up Timer event at the earliest deadline, or stops it if
+// there is none.  The event is periodic, and restarted rather than started
+// again each time, so it keeps its slot and its budget.
+//
+// ****************************************************
+static void ControllerArm(void)
+{
+    int &iTimerID = gCrossingState.iControllerTimerID;
+    unsigned long ulNow = millis();
+    unsigned long ulDelay = 0;
+    bool bWaiting = false;
+    uint8_t i;
+
+    for (i = 0; i < kControllerEventTypes; i++)
+    {
+        if (gCrossingState.uiControllerWaiting & (1 << i))
+        {
+            long lRemaining = (long)(gCrossingState.ulControllerDeadline[i] - ulNow);
+            unsigned long ulRemaining = (lRemaining > 0) ? (unsigned long)lRemaining : 0;
+
+            if ((bWaiting == false) || (ulRemaining < ulDelay))
+            {
+                ulDelay = ulRemaining;
+            }
+            bWaiting = true;
+        }
+    }
+
+    if (bWaiting == false)
+    {
+        if (gCrossingGateTimer.isRunning(iTimerID))
+        {
+            gCrossingGateTimer.stop(iTimerID);
+        }
+        iTimerID = 0;
+    }
+    else if (gCrossingGateTimer.restart(iTimerID, ulDelay) == false)
+    {
+        iTimerID = gCrossingGateTimer.every(ulDelay, ControllerWake);
+        gCrossingGateTimer.setBudget(iTimerID, kMainLoopBudget);
+    }
+
+}  //endof ControllerArm()
+
+// ***************************************************
+//
+// ControllerRun()
+//
+// One run of the state machine for whatever is queued.  The deadlines
+// are all registered again by the states as they run.
+//
+// ****************************************************
+static void ControllerRun(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < kControllerEventTypes; i++)
+    {
+        if (gCrossingState.uiControllerPending & (1 << i))
+        {
+            gCrossingState.ulControllerEvents[i]++;
+        }
+    }
+    gCrossingState.uiControllerPending = 0;
+    gCrossingState.uiControllerWaiting = 0;
+
+    CrossingSignalMain();
+
+    // a state that has just been entered, or moved on, has not said what it waits for
+    if (((gCrossingState.uiControllerWaiting & ((1 << kControllerEvent_Deadline) | (1 << kControllerEvent_DutyRecovered))) == 0) &&
+        (gbIdleSleepAllowed == false))
+    {
+        ControllerWaitUntil(kControllerEvent_Deadline, millis() + kControllerStepTime);
+        gCrossingState.ulControllerSteps++;
+    }
+
+}  //endof ControllerRun()
+
+// ***************************************************
+//
+// ControllerWake()
+//
+// The Timer callback.  Queues the events whose time has come, and runs
+// the state machine for them.
+//
+// ****************************************************
+static void ControllerWake(void)
+{
+    unsigned long ulNow = millis();
+    uint8_t i;
+
+    for (i = 0; i < kControllerEventTypes; i++)
+    {
+        if ((gCrossingState.uiControllerWaiting & (1 << i)) && ((long)(gCrossingState.ulControllerDeadline[i] - ulNow) <= 0))
+        {
+            gCrossingState.uiControllerWaiting &= ~(1 << i);
+            gCrossingState.uiControllerPending |= (1 << i);
+        }
+    }
+
+    if (gCrossingState.uiControllerPending != 0)
+    {
+        ControllerRun();
+    }
+
+    ControllerArm();
+
+}  //endof ControllerWake()
+
+int ControllerBegin(void)
+{
+    if (gbControllerEventDriven == false)
+    {
+        return gCrossingGateTimer.every(kControllerStepTime, CrossingSignalMain);
+    }
+
+    // the first run starts the gate initializing, as the first tick did
+    gCrossingState.iControllerSensorLevel = digitalRead(kPinAddrGateTrackSensor);
+    ControllerWaitUntil(kControllerEvent_Deadline, millis() + kControllerStepTime);
+    ControllerArm();
+
+    return gCrossingState.iControllerTimerID;
+
+}  //endof ControllerBegin()
+
+void ControllerPoll(void)
+{
+    int &iLevel = gCrossingState.iControllerSensorLevel;
+    int iSensor;
+
+    if (gbControllerEventDriven == false)
+    {
+        return;
+    }
+
+    iSensor = digitalRead(kPinAddrGateTrackSensor);
+    if (iSensor == iLevel)
+    {
+        return;
+    }
+    iLevel = iSensor;
+
+    // run on the next update(), rather than from here, so it keeps its Timer class and budget
+    ControllerWaitUntil(kControllerEvent_SensorEdge, millis());
+    ControllerArm();
+
+}  //endof ControllerPoll()
+
+void ControllerWaitUntil(uint8_t uiEvent, unsigned long ulTime)
+{
+    uint8_t uiBit = (1 << uiEvent);
+
+    if (((gCrossingState.uiControllerWaiting & uiBit) == 0) ||
+        ((long)(ulTime - gCrossingState.ulControllerDeadline[uiEvent]) < 0))
+    {
+        gCrossingState.ulControllerDeadline[uiEvent] = ulTime;
+        gCrossingState.uiControllerWaiting |= uiBit;
+    }
+
+}  //endof ControllerWaitUntil()
+
+void ControllerReport(void)
+{
+    Serial.print(F("Controller: "));
+    Serial.println(gbControllerEventDriven ? F("Event Driven") : F("Tick"));
+    Serial.print(F("Controller Runs: "));
+    Serial.print(gCrossingState.ulControllerRuns);
+    Serial.print(F(", Sensor Edges "));
+    Serial.print(gCrossingState.ulControllerEvents[kControllerEvent_SensorEdge]);
+    Serial.print(F(", Sensor Changes "));
+    Serial.print(gCrossingState.ulControllerEvents[kControllerEvent_SensorChange]);
+    Serial.print(F(", Deadlines "));
+    Serial.print(gCrossingState.ulControllerEvents[kControllerEvent_Deadline]);
+    Serial.print(F(" (Steps "));
+    Serial.print(gCrossingState.ulControllerSteps);
+    Serial.print(F("), Duty Recovered "));
+    Serial.println(gCrossingState.ulControllerEvents[kControllerEvent_DutyRecovered]);
+
+}  //endof ControllerReport()
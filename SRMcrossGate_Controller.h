@@ -0,0 +1,103 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Controller_h
+#define SRMcrossGate_Controller_h
+
+#include <inttypes.h>
+
+// ***************************************************
+//
+// The controller's events.
+//
+// CrossingSignalMain() used to run on a 250 ms tick, whether or not anything
+// could have changed.  Event driven, it only runs when one of these is
+// queued:
+//
+//   SensorEdge     - the track sensor pin has changed (loop() watches it).
+//                    The run starts the debounce, and while a train is on
+//                    the sensor it holds the gate down from this moment.
+//   SensorChange   - the track sensor has held a new level for the debounce
+//                    time (ReadTrackSensorAndDebouce() asks for it)
+//   Deadline       - the time a state is waiting for has come
+//   DutyRecovered  - the motor has cooled back down to no run time at all
+//
+// Each state registers the deadline it waits on with ControllerWaitUntil().
+// A state that registers nothing (one that has just been entered, or has
+// just moved on) is run again a step later, the old tick, so the sequences
+// keep their pacing.  Once the crossing is idle nothing is registered and
+// nothing runs until the next sensor edge.
+//
+// The queue holds each event type at most once, as a bit; one run of
+// CrossingSignalMain() takes care of all of them, as it reads the world
+// for itself.
+//
+// On the Uno this costs 47 bytes of SRAM: 46 in gCrossingState (the
+// deadlines, 16, and the counters the E command prints, 24) and
+// gbControllerEventDriven.  ControllerReport() prints from flash.
+//
+// ****************************************************
+const uint8_t kControllerEvent_SensorEdge = 0;
+const uint8_t kControllerEvent_SensorChange = 1;
+const uint8_t kControllerEvent_Deadline = 2;
+const uint8_t kControllerEvent_DutyRecovered = 3;
+const uint8_t kControllerEventTypes = 4;
+
+// the old tick, for a state that has registered nothing
+const unsigned long kControllerStepTime = 250;
+
+// set to false for the 250 ms tick (the host tools compare the two)
+extern bool gbControllerEventDriven;
+
+// ***************************************************
+//
+// ControllerBegin()
+//
+// This function is called from setup().  It starts the 250 ms tick, or the
+// first run of the event driven controller.  Either way the handle of the
+// Timer event that runs CrossingSignalMain() is returned.
+//
+// ****************************************************
+int ControllerBegin(void);
+
+// ***************************************************
+//
+// ControllerPoll()
+//
+// This function is called from loop().  It watches the track sensor, and
+// queues a SensorEdge on each change.
+//
+// ****************************************************
+void ControllerPoll(void);
+
+// ***************************************************
+//
+// ControllerWaitUntil()
+//
+// Called by the states during a run of CrossingSignalMain(): the event is
+// queued at ulTime.  Only the earliest time for each event type is kept.
+//
+// ****************************************************
+void ControllerWaitUntil(uint8_t uiEvent, unsigned long ulTime);
+
+// ***************************************************
+//
+// ControllerReport()
+//
+// This function is called by the E serial command.  It prints the runs of
+// CrossingSignalMain() so far, and the events that caused them.
+//
+// ****************************************************
+void ControllerReport(void);
+
+#endif
@@ -0,0 +1,87 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Coroutine_h
+#define SRMcrossGate_Coroutine_h
+
+#include "Arduino.h"
+#include "SRMcrossGate_Controller.h"
+#include "SRMcrossGate_State.h"
+
+// ***************************************************
+//
+// Stackless coroutines
+//
+// A sequence (lower the gate, raise it) is written as one function that
+// reads top to bottom, and waits with CO_AWAIT_MS() or CO_AWAIT_SENSOR().
+// A wait returns from the function, and the next call picks up at the
+// wait, by way of a switch on the resume point.  Nothing is kept on the
+// stack across a wait, so the resume point (an int, 2 bytes on the Uno)
+// and a wait's start time are all a sequence needs.  It is the same on
+// the Uno and the host, as it is only a switch.
+//
+// Each wait is named by a step, a case label that is unique within the
+// function.  Step 0 is the start, and the end goes back to it.  The steps
+// are whatever the rest of the program already calls the sequence's
+// states, so anything that reads or resets the state keeps working, and
+// each is set with SetState(), so the trace sees the sequence move.
+//
+// As it is a switch, a coroutine can not have a switch of its own around
+// a wait, and its locals do not live across one.  The wait's start time
+// has to be kept outside the function (gCrossingState).
+//
+// ****************************************************
+// going on into a wait's case label is meant (-Wimplicit-fallthrough, GCC 7 on)
+#if defined(__GNUC__) && (__GNUC__ >= 7)
+#define CO_FALLTHROUGH                              __attribute__((fallthrough))
+#else
+#define CO_FALLTHROUGH
+#endif
+
+#define CO_BEGIN(iStep)                             switch (iStep) { case 0:
+
+#define CO_END(iStep)                               } SetState((iStep), 0); return
+
+// come back on the next call
+#define CO_YIELD(iStep, kStep)                      do { SetState((iStep), (kStep)); return; case (kStep):; } while (0)
+
+// come back on each call, until the condition holds
+#define CO_AWAIT(iStep, kStep, bCondition)          do { SetState((iStep), (kStep)); CO_FALLTHROUGH; case (kStep): if (!(bCondition)) return; } while (0)
+
+// wait ulDelay ms from here; the controller is told when to come back
+#define CO_AWAIT_MS(iStep, kStep, ulStart, ulDelay) do { (ulStart) = millis(); CO_AWAIT(iStep, kStep, CoroutineWaitOver((ulStart), (ulDelay))); } while (0)
+
+// wait for the next call that finds the (debounced) track kTrackOccupied or kTrackVacant
+#define CO_AWAIT_SENSOR(iStep, kStep, iTrack)       do { CO_YIELD(iStep, kStep); if (gCrossingState.iTrackOcupationState != (iTrack)) return; } while (0)
+
+// ***************************************************
+//
+// CoroutineWaitOver()
+//
+// True once ulDelay ms have gone by since ulStart.  Until then the deadline
+// is registered with the controller, such that it comes back in time.
+//
+// ****************************************************
+inline bool CoroutineWaitOver(unsigned long ulStart, unsigned long ulDelay)
+{
+    if ((millis() - ulStart) >= ulDelay)
+    {
+        return true;
+    }
+
+    ControllerWaitUntil(kControllerEvent_Deadline, ulStart + ulDelay);
+    return false;
+
+}  //endof CoroutineWaitOver()
+
+#endif
@@ -0,0 +1,462 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include <EEPROM.h>
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_History.h"
+#include "SRMcrossGate_State.h"
+
+const int kHistoryDumpBytesPerLine = 16;
+
+// the history variables live in gCrossingState (SRMcrossGate_State.h)
+
+// events waiting to be written to the EEPROM
+static HistoryQueueEntry_t (&gHistoryQueue)[kHistoryQueueSize] = gCrossingState.HistoryQueue;
+static uint8_t &giHistoryQueueCount = gCrossingState.uiHistoryQueueCount;
+static unsigned int &guiHistoryDroppedCount = gCrossingState.uiHistoryDroppedCount;
+
+// where the next record goes
+static int &giHistoryBlock = gCrossingState.iHistoryBlock;
+static int &giHistoryWriteOffset = gCrossingState.iHistoryWriteOffset;
+static uint8_t &giHistorySequence = gCrossingState.uiHistorySequence;
+static unsigned long &gulHistoryLastTime = gCrossingState.ulHistoryLastTime;
+
+// the millis() gulHistoryLastTime stands for; the deltas are taken from it,
+// such that they are right across the 49.7 day wrap of millis()
+static unsigned long &gulHistoryLastMillis = gCrossingState.ulHistoryLastMillis;
+
+static unsigned long &gulHistoryOccupancyStartTime = gCrossingState.ulHistoryOccupancyStartTime;
+
+// dump in progress (-1 when idle)
+static int &giHistoryDumpOffset = gCrossingState.iHistoryDumpOffset;
+
+// ***************************************************
+//
+// HistoryBlockAddress()
+//
+// Returns the EEPROM address of the start of a block.
+//
+// ****************************************************
+static int HistoryBlockAddress(int iBlock)
+{
+    return kHistoryEepromStart + kHistorySignatureSize + (iBlock * kHistoryBlockSize);
+}
+
+// ***************************************************
+//
+// HistoryVarintSize()
+//
+// Returns the number of bytes a value takes as a varint (7 bits per byte).
+//
+// ****************************************************
+static int HistoryVarintSize(unsigned long ulValue)
+{
+    int iSize = 1;
+
+    while (ulValue >= 0x80)
+    {
+        ulValue >>= 7;
+        iSize++;
+    }
+
+    return iSize;
+}
+
+// ***************************************************
+//
+// HistoryWriteVarint()
+//
+// Writes a varint to the EEPROM, and returns the address after it.
+//
+// ****************************************************
+static int HistoryWriteVarint(int iAddress, unsigned long ulValue)
+{
+    while (ulValue >= 0x80)
+    {
+        EEPROM.update(iAddress++, (uint8_t)(ulValue | 0x80));
+        ulValue >>= 7;
+    }
+    EEPROM.update(iAddress++, (uint8_t)ulValue);
+
+    return iAddress;
+}
+
+// ***************************************************
+//
+// HistorySkipVarint()
+//
+// Steps over a varint in the EEPROM.  Returns false if the varint runs
+// past the end of the block.
+//
+// ****************************************************
+static bool HistorySkipVarint(int *piAddress, int iEnd)
+{
+    while (*piAddress < iEnd)
+    {
+        if ((EEPROM.read((*piAddress)++) & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ***************************************************
+//
+// HistoryFindWriteOffset()
+//
+// Walks the records in a block, and returns the offset of the end marker.
+// If the block is damaged, we return the block size, such that the next
+// record goes into a new block.
+//
+// ****************************************************
+static int HistoryFindWriteOffset(int iBlock)
+{
+    int iAddress = HistoryBlockAddress(iBlock) + 1;
+    int iEnd = HistoryBlockAddress(iBlock) + kHistoryBlockSize;
+    uint8_t uiTag;
+
+    // step over the uptime the block was opened at
+    if (HistorySkipVarint(&iAddress, iEnd) == false)
+    {
+        return kHistoryBlockSize;
+    }
+
+    while (iAddress < iEnd)
+    {
+        uiTag = EEPROM.read(iAddress);
+
+        if (uiTag == kHistoryBlockErased)
+        {
+            break;
+        }
+
+        if ((uiTag == 0) || (uiTag > kHistoryEvent_Last))
+        {
+            return kHistoryBlockSize;
+        }
+
+        iAddress++;
+
+        if ((uiTag != kHistoryEvent_Boot) && (HistorySkipVarint(&iAddress, iEnd) == false))
+        {
+            return kHistoryBlockSize;
+        }
+
+        if ((uiTag != kHistoryEvent_Boot) && (uiTag != kHistoryEvent_OccupancyStart) && (HistorySkipVarint(&iAddress, iEnd) == false))
+        {
+            return kHistoryBlockSize;
+        }
+    }
+
+    return iAddress - HistoryBlockAddress(iBlock);
+}
+
+// ***************************************************
+//
+// HistoryBegin()
+//
+// This function is called from setup().  It finds the newest block in the
+// EEPROM ring (formatting the EEPROM if needed), and records the boot.
+//
+// ****************************************************
+void HistoryBegin(void)
+{
+    int iBlock;
+    uint8_t uiSequence;
+    uint8_t uiNextSequence;
+
+    // if this EEPROM has never held our history, mark every block as erased
+    if ((EEPROM.read(kHistoryEepromStart) != kHistorySignature0) ||
+        (EEPROM.read(kHistoryEepromStart + 1) != kHistorySignature1))
+    {
+        for (iBlock = 0; iBlock < kHistoryBlockCount; iBlock++)
+        {
+            EEPROM.update(HistoryBlockAddress(iBlock), kHistoryBlockErased);
+        }
+
+        EEPROM.update(kHistoryEepromStart, kHistorySignature0);
+        EEPROM.update(kHistoryEepromStart + 1, kHistorySignature1);
+
+        Serial.println(F("History: Formatted"));
+    }
+
+    // The blocks are numbered in sequence, the newest one is the one
+    // that is not followed by the next sequence number.
+    for (iBlock = 0; iBlock < kHistoryBlockCount; iBlock++)
+    {
+        uiSequence = EEPROM.read(HistoryBlockAddress(iBlock));
+
+        if (uiSequence == kHistoryBlockErased)
+        {
+            continue;
+        }
+
+        uiNextSequence = EEPROM.read(HistoryBlockAddress((iBlock + 1) % kHistoryBlockCount));
+
+        if (uiNextSequence != ((uiSequence + 1) % kHistorySequenceModulus))
+        {
+            giHistoryBlock = iBlock;
+            giHistorySequence = uiSequence;
+            giHistoryWriteOffset = HistoryFindWriteOffset(iBlock);
+            break;
+        }
+    }
+
+    // the uptime starts over
+    gulHistoryLastTime = 0;
+    gulHistoryLastMillis = millis();
+
+    gHistoryQueue[0].uiEvent = kHistoryEvent_Boot;
+    gHistoryQueue[0].ulTime = millis();
+    gHistoryQueue[0].ulValue = 0;
+    giHistoryQueueCount = 1;
+
+}  //endof HistoryBegin()
+
+// ***************************************************
+//
+// HistoryQueueEvent()
+//
+// Adds an event to the ram queue.  If the queue is full, the event is
+// counted and dropped.
+//
+// ****************************************************
+static void HistoryQueueEvent(uint8_t uiEvent, unsigned long ulValue)
+{
+    if (giHistoryQueueCount >= kHistoryQueueSize)
+    {
+        guiHistoryDroppedCount++;
+        return;
+    }
+
+    gHistoryQueue[giHistoryQueueCount].uiEvent = uiEvent;
+    gHistoryQueue[giHistoryQueueCount].ulTime = millis();
+    gHistoryQueue[giHistoryQueueCount].ulValue = ulValue;
+    giHistoryQueueCount++;
+}
+
+// ***************************************************
+//
+// HistoryRecord...()
+//
+// These functions are called from the state machine.  They only queue the
+// event in ram, the EEPROM writes are done later by HistoryFlush().
+//
+// ****************************************************
+void HistoryRecordOccupancyStart(void)
+{
+    gulHistoryOccupancyStartTime = millis();
+    HistoryQueueEvent(kHistoryEvent_OccupancyStart, 0);
+}
+
+void HistoryRecordOccupancyEnd(void)
+{
+    HistoryQueueEvent(kHistoryEvent_OccupancyEnd, (millis() - gulHistoryOccupancyStartTime) / kOneSecond);
+}
+
+void HistoryRecordGateDown(void)
+{
+    HistoryQueueEvent(kHistoryEvent_GateDown, (millis() - gulHistoryOccupancyStartTime) / 100);
+}
+
+void HistoryRecordMotorRun(unsigned long ulMotorRunTime)
+{
+    HistoryQueueEvent(kHistoryEvent_MotorRun, ulMotorRunTime / 100);
+}
+
+void HistoryRecordDutyCycleTrip(unsigned long ulMotorRunningTotalSeconds)
+{
+    HistoryQueueEvent(kHistoryEvent_DutyCycleTrip, ulMotorRunningTotalSeconds / 100);
+}
+
+// ***************************************************
+//
+// HistoryFlush()
+//
+// This function is called from a timer.  It writes any queued events to
+// the EEPROM.  Each EEPROM byte takes about 3.3ms to write, so we keep
+// this out of the state machine.
+//
+// ****************************************************
+void HistoryFlush(void)
+{
+    HistoryQueueEntry_t *pEntry = &gHistoryQueue[0];
+    unsigned long ulDelta;
+    unsigned long ulOpenTime = gulHistoryLastTime;
+    bool bOpenBlock;
+    int iSize;
+    int iAddress;
+    uint8_t i;
+
+    if (giHistoryQueueCount == 0)
+    {
+        return;
+    }
+
+    // work out how many bytes the record needs; the difference is a
+    // uint32_t, as millis() is on the Uno, so it wraps on the host too
+    ulDelta = (uint32_t)(pEntry->ulTime - gulHistoryLastMillis) / kOneSecond;
+    iSize = 1;
+    if (pEntry->uiEvent != kHistoryEvent_Boot)
+    {
+        iSize += HistoryVarintSize(ulDelta);
+    }
+    if ((pEntry->uiEvent != kHistoryEvent_Boot) && (pEntry->uiEvent != kHistoryEvent_OccupancyStart))
+    {
+        iSize += HistoryVarintSize(pEntry->ulValue);
+    }
+
+    // If it does not fit, open the next block (this overwrites the oldest
+    // one).  It is marked erased first, and its sequence number is only
+    // written once the record and end marker are in.
+    bOpenBlock = ((giHistoryWriteOffset + iSize) > kHistoryBlockSize);
+    if (bOpenBlock == true)
+    {
+        giHistoryBlock = (giHistoryBlock + 1) % kHistoryBlockCount;
+        giHistorySequence = (giHistorySequence + 1) % kHistorySequenceModulus;
+
+        EEPROM.update(HistoryBlockAddress(giHistoryBlock), kHistoryBlockErased);
+        giHistoryWriteOffset = 1 + HistoryVarintSize(gulHistoryLastTime);
+    }
+
+    // write the record
+    iAddress = HistoryBlockAddress(giHistoryBlock) + giHistoryWriteOffset;
+    EEPROM.update(iAddress++, pEntry->uiEvent);
+
+    if (pEntry->uiEvent == kHistoryEvent_Boot)
+    {
+        gulHistoryLastTime = 0;
+        gulHistoryLastMillis = pEntry->ulTime;
+    }
+    else
+    {
+        // the part of a second left over counts towards the next delta
+        iAddress = HistoryWriteVarint(iAddress, ulDelta);
+        gulHistoryLastTime += ulDelta;
+        gulHistoryLastMillis += ulDelta * kOneSecond;
+
+        if (pEntry->uiEvent != kHistoryEvent_OccupancyStart)
+        {
+            iAddress = HistoryWriteVarint(iAddress, pEntry->ulValue);
+        }
+    }
+
+    giHistoryWriteOffset = iAddress - HistoryBlockAddress(giHistoryBlock);
+
+    // mark the end of the records, unless the block is full
+    if (giHistoryWriteOffset < kHistoryBlockSize)
+    {
+        EEPROM.update(iAddress, kHistoryBlockErased);
+    }
+
+    // a new block's header goes in last, the sequence number after the uptime it was opened at
+    if (bOpenBlock == true)
+    {
+        iAddress = HistoryBlockAddress(giHistoryBlock);
+        HistoryWriteVarint(iAddress + 1, ulOpenTime);
+        EEPROM.update(iAddress, giHistorySequence);
+    }
+
+    // remove the entry from the queue
+    for (i = 1; i < giHistoryQueueCount; i++)
+    {
+        gHistoryQueue[i - 1] = gHistoryQueue[i];
+    }
+    giHistoryQueueCount--;
+
+}  //endof HistoryFlush()
+
+// ***************************************************
+//
+// HistoryPending()
+//
+// Returns true while there are queued events waiting for HistoryFlush().
+//
+// ****************************************************
+bool HistoryPending(void)
+{
+    return (giHistoryQueueCount != 0);
+
+}  //endof HistoryPending()
+
+// ***************************************************
+//
+// HistoryDump()
+//
+// This function starts a dump of the raw history EEPROM over the serial
+// port, as "HX" lines of hex.  host/HistoryDecode.cpp turns it back into events.
+//
+// ****************************************************
+void HistoryDump(void)
+{
+    Serial.println(F("History Dump Start"));
+    giHistoryDumpOffset = 0;
+
+}  //endof HistoryDump()
+
+// ***************************************************
+//
+// HistoryDumpPoll()
+//
+// This function is called from loop().  While a dump is running, it prints
+// the next line whenever there is room in the serial transmit buffer, such
+// that the dump never holds up the timers.  It returns true until the dump
+// is finished.
+//
+// ****************************************************
+bool HistoryDumpPoll(void)
+{
+    const int kHistoryDumpSize = kHistorySignatureSize + (kHistoryBlockCount * kHistoryBlockSize);
+    uint8_t uiByte;
+    int i;
+
+    if (giHistoryDumpOffset < 0)
+    {
+        return false;
+    }
+
+    // "HX " + two characters per byte + end of line
+    if (Serial.availableForWrite() < (3 + (2 * kHistoryDumpBytesPerLine) + 2))
+    {
+        return true;
+    }
+
+    if (giHistoryDumpOffset >= kHistoryDumpSize)
+    {
+        Serial.print(F("History Dropped: "));
+        Serial.println(guiHistoryDroppedCount);
+        Serial.println(F("History Dump End"));
+
+        giHistoryDumpOffset = -1;
+        return false;
+    }
+
+    Serial.print(F("HX "));
+    for (i = 0; (i < kHistoryDumpBytesPerLine) && (giHistoryDumpOffset < kHistoryDumpSize); i++)
+    {
+        uiByte = EEPROM.read(kHistoryEepromStart + giHistoryDumpOffset++);
+
+        if (uiByte < 0x10)
+        {
+            Serial.print(F("0"));
+        }
+        Serial.print(uiByte, HEX);
+    }
+    Serial.println();
+
+    return true;
+
+}  //endof HistoryDumpPoll()
@@ -0,0 +1,131 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_History_h
+#define SRMcrossGate_History_h
+
+#include <inttypes.h>
+
+// ***************************************************
+//
+// EEPROM history layout
+//
+// The history is kept as a ring of blocks.  Each block starts with a sequence
+// number (0..254, 0xFF means the block is erased) and a varint with the
+// uptime in seconds when the block was opened.  After that come the records:
+//
+//     tag byte (event type), varint delta seconds, varint value
+//
+// The boot record is just the tag, and resets the uptime to zero.  The
+// occupancy start record has no value.  The records in a block end at a
+// 0xFF tag, or at the end of the block.  Opening a new block overwrites the
+// oldest one, so every EEPROM cell is written about as often as any other.
+// A new block is marked erased while its records go in, and gets its
+// sequence number last, so a block cut short by a power loss is skipped
+// rather than read with the old block's records under it.
+//
+// ****************************************************
+const int kHistoryEepromStart = 0;
+const uint8_t kHistorySignature0 = 0x5A;
+const uint8_t kHistorySignature1 = 0xC1;
+const int kHistorySignatureSize = 2;
+const int kHistoryBlockSize = 64;
+const int kHistoryBlockCount = 15;
+const uint8_t kHistoryBlockErased = 0xFF;
+const uint8_t kHistorySequenceModulus = 255;
+
+const uint8_t kHistoryEvent_Boot = 1;
+const uint8_t kHistoryEvent_OccupancyStart = 2;
+const uint8_t kHistoryEvent_OccupancyEnd = 3;       // value is the occupancy time, seconds
+const uint8_t kHistoryEvent_GateDown = 4;           // value is the occupancy to gate down time, 1/10 seconds
+const uint8_t kHistoryEvent_MotorRun = 5;           // value is the motor run time, 1/10 seconds
+const uint8_t kHistoryEvent_DutyCycleTrip = 6;      // value is the total motor run time, 1/10 seconds
+const uint8_t kHistoryEvent_Last = 6;
+
+// events waiting to be written to the EEPROM, the queue is kept in gCrossingState
+const uint8_t kHistoryQueueSize = 6;
+
+typedef struct
+{
+    uint8_t uiEvent;
+    unsigned long ulTime;       // millis() when it happened
+    unsigned long ulValue;
+} HistoryQueueEntry_t;
+
+// ***************************************************
+//
+// HistoryBegin()
+//
+// This function is called from setup().  It finds the newest block in the
+// EEPROM ring (formatting the EEPROM if needed), and records the boot.
+//
+// ****************************************************
+void HistoryBegin(void);
+
+// ***************************************************
+//
+// HistoryRecord...()
+//
+// These functions are called from the state machine.  They only queue the
+// event in ram, the EEPROM writes are done later by HistoryFlush().
+//
+// ****************************************************
+void HistoryRecordOccupancyStart(void);
+void HistoryRecordOccupancyEnd(void);
+void HistoryRecordGateDown(void);
+void HistoryRecordMotorRun(unsigned long ulMotorRunTime);
+void HistoryRecordDutyCycleTrip(unsigned long ulMotorRunningTotalSeconds);
+
+// ***************************************************
+//
+// HistoryFlush()
+//
+// This function is called from a timer.  It writes any queued events to
+// the EEPROM.  Each EEPROM byte takes about 3.3ms to write, so we keep
+// this out of the state machine.
+//
+// ****************************************************
+void HistoryFlush(void);
+
+// ***************************************************
+//
+// HistoryPending()
+//
+// Returns true while there are queued events waiting for HistoryFlush().
+//
+// ****************************************************
+bool HistoryPending(void);
+
+// ***************************************************
+//
+// HistoryDump()
+//
+// This function starts a dump of the raw history EEPROM over the serial
+// port, as "HX" lines of hex.  host/HistoryDecode.cpp turns it back into events.
+//
+// ****************************************************
+void HistoryDump(void);
+
+// ***************************************************
+//
+// HistoryDumpPoll()
+//
+// This function is called from loop().  While a dump is running, it prints
+// the next line whenever there is room in the serial transmit buffer, such
+// that the dump never holds up the timers.  It returns true until the dump
+// is finished.
+//
+// ****************************************************
+bool HistoryDumpPoll(void);
+
+#endif
@@ -0,0 +1,189 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_Power.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Controller.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// this is the millisecond counter kept by the arduino core (wiring.c).  Timer 0 is
+// stopped while we are powered down, so we have to move it along ourselves.
+extern volatile unsigned long timer0_millis;
+
+extern Timer gCrossingGateTimer;
+#endif
+
+// set by GateUpInactiveState() when the crossing has nothing left to do
+bool gbIdleSleepAllowed = false;
+
+// the interrupt flags are cleared before every sleep, the wake time lives in gCrossingState
+static volatile bool gbIdleWokeByWatchdog = false;
+static volatile bool gbIdleWokeByPinChange = false;
+static unsigned long &gulIdleSensorWakeTime = gCrossingState.ulIdleSensorWakeTime;
+static unsigned long &gulIdleSerialWakeTime = gCrossingState.ulIdleSerialWakeTime;
+
+#if defined(__AVR__)
+
+// ***************************************************
+//
+// WDT_vect / PCINT2_vect
+//
+// The interrupts only have to wake the processor up.  We record which
+// one did it, such that we can correct the millisecond count.
+//
+// ****************************************************
+ISR(WDT_vect)
+{
+    gbIdleWokeByWatchdog = true;
+}
+
+ISR(PCINT2_vect)
+{
+    gbIdleWokeByPinChange = true;
+}
+
+#endif
+
+// ***************************************************
+//
+// IdleSleepIfAllowed()
+//
+// This function is called from loop().  If the crossing is idle (track vacant,
+// gate up and the motor duty cycle fully cooled down) the processor is put
+// into power-down sleep.  It wakes on a track sensor pin change, or on the
+// watchdog tick, which keeps the main loop timer moving.  It also wakes on
+// the serial receive pin, but the USART is stopped, so that character is
+// lost; we then stay awake for kIdleSerialWakeTime, such that the command
+// can be sent again.
+//
+// ****************************************************
+void IdleSleepIfAllowed(void)
+{
+#if defined(__AVR__)
+    // a microsecond event has to be polled on time, which it would not be from power-down
+    if ((gbIdleSleepAllowed == false) || gCrossingGateTimer.microsRunning())
+    {
+        return;
+    }
+
+    // a character woke us, keep the USART running until the command has had time to come again
+    if (gulIdleSerialWakeTime != 0)
+    {
+        if ((millis() - gulIdleSerialWakeTime) < kIdleSerialWakeTime)
+        {
+            return;
+        }
+        gulIdleSerialWakeTime = 0;
+    }
+
+    // let the debug messages drain, the USART clock stops when we power down
+    Serial.flush();
+
+    cli();
+
+    // The track sensor is on port D (the profile check sees to that), and pin n
+    // there is PCINT16 + n, bit n of PCMSK2: pin 2, PD2 / PCINT18, on the standard
+    // profile.  A pin change interrupt is asynchronous, so it will wake us out of power-down.  We also wake on the
+    // serial receive pin (PD0 / PCINT16), such that a maintenance command gets through.
+    // The first character is lost, so the command has to be sent twice (see above).
+    const uint8_t uiWakeMask = _BV(kPinAddrGateTrackSensor) | _BV(PCINT16);
+
+    PCIFR  = _BV(PCIF2);
+    PCMSK2 |= uiWakeMask;
+    PCICR  |= _BV(PCIE2);
+
+    // if the sensor is already showing a train (or is bouncing), stay awake and let
+    // the main loop debounce it.
+    if (digitalRead(kPinAddrGateTrackSensor) == kTrackOccupied)
+    {
+        PCMSK2 &= ~uiWakeMask;
+        sei();
+        return;
+    }
+
+    gbIdleWokeByWatchdog = false;
+    gbIdleWokeByPinChange = false;
+    gulIdleSensorWakeTime = 0;
+
+    // set the watchdog to interrupt (not reset) us every 250ms, the same rate as the main loop
+    MCUSR &= ~_BV(WDRF);
+    WDTCSR = _BV(WDCE) | _BV(WDE);
+    WDTCSR = _BV(WDIE) | _BV(WDP2);
+    wdt_reset();
+
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sleep_bod_disable();
+    sei();
+    sleep_cpu();
+
+    // we are awake again
+    sleep_disable();
+    wdt_disable();
+    PCMSK2 &= ~uiWakeMask;
+
+    if (gbIdleWokeByWatchdog == true)
+    {
+        // timer 0 was stopped, so account for the time we spent sleeping.
+        cli();
+        timer0_millis += kIdleSleepWatchdogTickTime;
+        sei();
+    }
+    else if ((gbIdleWokeByPinChange == true) && (digitalRead(kPinAddrGateTrackSensor) == kTrackOccupied))
+    {
+        gulIdleSensorWakeTime = millis();
+    }
+    else if (gbIdleWokeByPinChange == true)
+    {
+        // the serial receive pin, or a sensor blip that is already gone
+        gulIdleSerialWakeTime = millis();
+    }
+
+    // the main loop has to look at the world again before we go back to sleep.  The event
+    // driven controller only looks when something has changed, and a train is the only
+    // thing that can, so until then we may go straight back to sleep.
+    if ((gbControllerEventDriven == false) || (digitalRead(kPinAddrGateTrackSensor) == kTrackOccupied))
+    {
+        gbIdleSleepAllowed = false;
+    }
+#endif
+
+}  //endof IdleSleepIfAllowed()
+
+// ***************************************************
+//
+// IdleSleepReportWakeLatency()
+//
+// This function is called when the warning lights are turned on.  If the
+// processor was woken up by the track sensor, we print how long it took
+// from the wake up to the lights coming on.
+//
+// ****************************************************
+void IdleSleepReportWakeLatency(void)
+{
+    if (gulIdleSensorWakeTime != 0)
+    {
+        Serial.print(F("Wake To Lights (ms): "));
+        Serial.println(millis() - gulIdleSensorWakeTime);
+
+        gulIdleSensorWakeTime = 0;
+    }
+
+}  //endof IdleSleepReportWakeLatency()
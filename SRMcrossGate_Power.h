@@ -0,0 +1,43 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Power_h
+#define SRMcrossGate_Power_h
+
+// ***************************************************
+//
+// IdleSleepIfAllowed()
+//
+// This function is called from loop().  If the crossing is idle (track vacant,
+// gate up and the motor duty cycle fully cooled down) the processor is put
+// into power-down sleep.  It wakes on a track sensor pin change, or on the
+// watchdog tick, which keeps the main loop timer moving.  It also wakes on
+// the serial receive pin, but the USART is stopped, so that character is
+// lost; we then stay awake for kIdleSerialWakeTime, such that the command
+// can be sent again.
+//
+// ****************************************************
+void IdleSleepIfAllowed(void);
+
+// ***************************************************
+//
+// IdleSleepReportWakeLatency()
+//
+// This function is called when the warning lights are turned on.  If the
+// processor was woken up by the track sensor, we print how long it took
+// from the wake up to the lights coming on.
+//
+// ****************************************************
+void IdleSleepReportWakeLatency(void);
+
+#endif
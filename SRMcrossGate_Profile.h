@@ -0,0 +1,153 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Profile_h
+#define SRMcrossGate_Profile_h
+
+#include <inttypes.h>
+
+// ***************************************************
+//
+// Crossing hardware profiles
+//
+// Each crossing has its own gate arm, relay board and wiring.  A profile
+// holds all of that as constants: the timings, the level each relay is
+// driven to for on (or up), and the Uno pin of each signal.  One profile
+// is picked when the image is built:
+//
+//     -DSRM_PROFILE=StandardGateProfile     (the default)
+//
+// SRMcrossGate_types.h and SRMcrossGate_Timing.h take their constants
+// from it, under the names the program has always used, so every pin
+// number and level is still a constant the compiler folds in.  The README
+// builds one image per profile.
+//
+// To add a crossing, copy a profile and change what differs.
+// CrossingProfileCheck<> below refuses a profile that can not work.
+//
+// ****************************************************
+
+// the museum's crossing, as first built
+struct StandardGateProfile
+{
+    static constexpr const char *kName = "Standard";
+
+    // lights and bells before the gate arm starts down
+    static constexpr unsigned long kGateWarningLeadTime = 3000;
+
+    // how long the motor runs to lower or raise the gate arm
+    static constexpr unsigned long kGateMotorRunTime = 13000;
+
+    // how long the gate stays down after the track is clear
+    static constexpr unsigned long kMaxGateDownTimelimitReached = 20000;
+
+    // how long the track sensor has to hold a new level before we believe it
+    static constexpr unsigned long kTrackSensorDebounceTime = 500;
+
+    // the motor run time (less the cooling time) that locks the motor out
+    static constexpr unsigned long kMaxDutyCycleLimitReached = 80000;
+
+    // the relay board switches the bell and lights on with a low level
+    static constexpr bool kWarningBellOn = 0;
+    static constexpr bool kWarningLightsOn = 0;
+    static constexpr bool kGateArmControlMotorOn = 1;
+    static constexpr bool kGateArmControlMotorUp = 1;
+    static constexpr bool kStatusLEDon = 1;
+
+    static constexpr int kPinAddrGateBellControl = 12;
+    static constexpr int kPinAddrGateLightsControlRight = 11;
+    static constexpr int kPinAddrGateLightsControlLeft = 10;
+    static constexpr int kPinAddrGateArmControlMotorDirection = 9;
+    static constexpr int kPinAddrGateArmControlMotorPower = 8;
+    static constexpr int kPinAddrGateStatusLED = 3;
+    static constexpr int kPinAddrGateTrackSensor = 2;
+};
+
+// a heavier arm, on a relay board that switches on with a high level, and
+// the direction relay wired the other way round
+struct ActiveHighGateProfile
+{
+    static constexpr const char *kName = "Active High";
+
+    static constexpr unsigned long kGateWarningLeadTime = 4000;
+    static constexpr unsigned long kGateMotorRunTime = 15000;
+    static constexpr unsigned long kMaxGateDownTimelimitReached = 20000;
+    static constexpr unsigned long kTrackSensorDebounceTime = 500;
+    static constexpr unsigned long kMaxDutyCycleLimitReached = 90000;
+
+    static constexpr bool kWarningBellOn = 1;
+    static constexpr bool kWarningLightsOn = 1;
+    static constexpr bool kGateArmControlMotorOn = 1;
+    static constexpr bool kGateArmControlMotorUp = 0;
+    static constexpr bool kStatusLEDon = 1;
+
+    static constexpr int kPinAddrGateBellControl = 7;
+    static constexpr int kPinAddrGateLightsControlRight = 6;
+    static constexpr int kPinAddrGateLightsControlLeft = 5;
+    static constexpr int kPinAddrGateArmControlMotorDirection = 9;
+    static constexpr int kPinAddrGateArmControlMotorPower = 8;
+    static constexpr int kPinAddrGateStatusLED = 13;
+    static constexpr int kPinAddrGateTrackSensor = 4;
+};
+
+// ***************************************************
+//
+// CrossingProfileCheck<>
+//
+// The checks a profile has to pass, all of them at compile time:
+//
+//   - the pins are all different, and none is a serial pin (0, 1) or
+//     past A5 (19)
+//   - the track sensor is on port D (pins 2 to 7), the pin change
+//     interrupt that wakes us from idle sleep (SRMcrossGate_Power.cpp)
+//   - the timings are not zero, and the sensor debounce is shorter than
+//     the time the gate stays down
+//
+// ****************************************************
+constexpr int ProfileBitCount(unsigned long ulBits)
+{
+    return (ulBits == 0) ? 0 : (int)(ulBits & 1) + ProfileBitCount(ulBits >> 1);
+}
+
+template <class Profile>
+struct CrossingProfileCheck
+{
+    static constexpr unsigned long kPinBits =
+        (1UL << Profile::kPinAddrGateBellControl) | (1UL << Profile::kPinAddrGateLightsControlRight) |
+        (1UL << Profile::kPinAddrGateLightsControlLeft) | (1UL << Profile::kPinAddrGateArmControlMotorDirection) |
+        (1UL << Profile::kPinAddrGateArmControlMotorPower) | (1UL << Profile::kPinAddrGateStatusLED) |
+        (1UL << Profile::kPinAddrGateTrackSensor);
+
+    static_assert(ProfileBitCount(kPinBits) == 7, "a profile has two signals on the same pin");
+    static_assert((kPinBits & 0xFFF00003UL) == 0, "a profile pin is a serial pin, or not on the Uno");
+    static_assert((Profile::kPinAddrGateTrackSensor >= 2) && (Profile::kPinAddrGateTrackSensor <= 7),
+                  "the track sensor has to be on port D (pins 2 to 7) to wake us from idle sleep");
+    static_assert((Profile::kGateWarningLeadTime > 0) && (Profile::kGateMotorRunTime > 0) &&
+                  (Profile::kMaxDutyCycleLimitReached > 0), "a profile timing is zero");
+    static_assert(Profile::kTrackSensorDebounceTime < Profile::kMaxGateDownTimelimitReached,
+                  "the sensor debounce is longer than the gate stays down");
+
+    static constexpr bool kPassed = true;
+};
+
+// every profile is checked in every build, not only the one picked
+static_assert(CrossingProfileCheck<StandardGateProfile>::kPassed, "StandardGateProfile");
+static_assert(CrossingProfileCheck<ActiveHighGateProfile>::kPassed, "ActiveHighGateProfile");
+
+#ifndef SRM_PROFILE
+#define SRM_PROFILE StandardGateProfile
+#endif
+
+typedef SRM_PROFILE CrossingProfile;
+
+#endif
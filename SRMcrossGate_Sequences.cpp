@@ -0,0 +1,296 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_UpDownControl.h"
+#include "SRMcrossGate_Utils.h"
+#include "SRMcrossGate_Power.h"
+#include "SRMcrossGate_History.h"
+#include "SRMcrossGate_Stats.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Trace.h"
+#include "SRMcrossGate_Sequences.h"
+#include "SRMcrossGate_Coroutine.h"
+
+#if !defined(GATE_COROUTINES)
+
+void GateDownSequence(void)
+{
+    int &iGateMovingDown_State = gCrossingState.iGateMovingDown_State;
+
+    switch (iGateMovingDown_State)
+    {
+        case kGateMovingDown_State_LightsAndBells:
+
+            GateDownLightsBellsAndMotorDirectionState(gCrossingState.ulGateDownEventStartTime,
+                                                      //&gCrossingState.ulGateDownEventTimeSpentInSequence,
+                                                      &gCrossingState.ulGateUpEventTimeSpentInSequence,
+                                                      &iGateMovingDown_State,
+                                                      &gCrossingState.iWarningLightTimerRightID,
+                                                      &gCrossingState.iWarningLightTimerLeftID);
+            break;
+
+        case kGateMovingDown_State_LightsAndBellsDelay:
+
+            GateDownWarningLightsAndBellDelayState(&iGateMovingDown_State);
+            break;
+
+        case kGateMovingDown_State_MotorOn:
+
+            GateDownMotorOnState(gCrossingState.ulGateDownEventStartTime,
+                                 &gCrossingState.bMotorOnFlag,
+                                 &iGateMovingDown_State,
+                                 &gCrossingState.bMotorRunning,
+                                 &gCrossingState.ulMotorRunningTotalSeconds,
+                                 &gCrossingState.bDutyCycleExceededFlag);
+            break;
+
+        case kGateMovingDown_State_MotorOnDelay:
+
+            GateDownMotorOnDelay(&iGateMovingDown_State);
+            break;
+
+        case kGateMovingDown_State_MotorOff:
+        default:
+
+            GateDownMotorOffState(gCrossingState.ulGateDownEventStartTime,
+                                  &gCrossingState.bMotorOnFlag,
+                                  &gCrossingState.bMotorOffFlag,
+                                  &iGateMovingDown_State,
+                                  &gCrossingState.bGateState,
+                                  &gCrossingState.bMotorRunning,
+                                  &gCrossingState.ulMotorRunningTotalSeconds,
+                                  &gCrossingState.ulGateDownStateDelayBeforeGateUpEventStartTime,
+                                  &gCrossingState.bDutyCycleExceededFlag);
+            break;
+
+    }  // iGateMovingDown_State
+
+}  //endof GateDownSequence()
+
+void GateUpSequence(void)
+{
+    int &iGateMovingUp_State = gCrossingState.iGateMovingUp_State;
+
+    switch (iGateMovingUp_State)
+    {
+        case kGateMovingUp_State_Debouce:
+
+            GateUpDebouceState(&gCrossingState.ulGateUpEventTimeSpentInSequence,
+                               &gCrossingState.ulGateUpEventStartTime,
+                               &iGateMovingUp_State);
+            break;
+
+        case kGateMovingUp_State_MotorDirection:
+
+            GateUpMotorDirectionState(&gCrossingState.ulGateUpEventStartTime,
+                                      &gCrossingState.bMotorDirectionFlag,
+                                      &iGateMovingUp_State);
+            break;
+
+        case kGateMovingUp_State_MotorDirectionDelay:
+
+            GateUpMotorDirectionDelayState(&iGateMovingUp_State);
+            break;
+
+        case kGateMovingUp_State_MotorOn:
+
+            GateUpMotorOnState(&gCrossingState.ulGateUpEventStartTime,
+                               &gCrossingState.bMotorOnFlag,
+                               &iGateMovingUp_State,
+                               &gCrossingState.bMotorRunning);
+            break;
+
+        case kGateMovingUp_State_MotorOnDelay:
+
+            GateUpMotorOnDelayState(&iGateMovingUp_State);
+            break;
+
+        case kGateMovingUp_State_MotorOff:
+        default:
+
+            GateUpMotorOffState(&gCrossingState.ulGateUpEventStartTime,
+                                &gCrossingState.iWarningLightTimerRightID,
+                                &gCrossingState.iWarningLightTimerLeftID,
+                                &gCrossingState.bGateState,
+                                &gCrossingState.ulGateDownEventStartTime,
+                                &gCrossingState.bMotorDirectionFlag,
+                                &gCrossingState.bMotorOnFlag,
+                                &iGateMovingUp_State,
+                                &gCrossingState.bMotorRunning,
+                                &gCrossingState.ulMotorRunningTotalSeconds,
+                                &gCrossingState.bDutyCycleExceededFlag);
+            break;
+
+    }  // iGateMovingUp_State
+
+}  //endof GateUpSequence()
+
+#else
+
+// ***************************************************
+//
+// GateDownSequence(), the coroutine
+//
+// Each wait is labelled with the hand-written state it stands in for,
+// and each CO_YIELD() is a run the hand-written states took to move on,
+// such that the two builds drive the pins on the same runs.
+//
+// ****************************************************
+void GateDownSequence(void)
+{
+    int &iStep = gCrossingState.iGateMovingDown_State;
+    unsigned long &ulWaitStart = gCrossingState.ulGateDownWaitStartTime;
+    bool &bDutyCycleExceededFlag = gCrossingState.bDutyCycleExceededFlag;
+
+    CO_BEGIN(iStep);
+
+    // the lights and bell are only started the once
+    if ((gCrossingState.iWarningLightTimerLeftID != 0) || (gCrossingState.iWarningLightTimerRightID != 0))
+    {
+        return;
+    }
+
+    // start the flashing lights, we will use two timers for this
+    gCrossingState.iWarningLightTimerRightID = WarningLightTimerStart(kPinAddrGateLightsControlRight, 500, HIGH, -1);
+    gCrossingState.iWarningLightTimerLeftID = WarningLightTimerStart(kPinAddrGateLightsControlLeft, 500, LOW, -1);
+    GatePinWrite(kPinAddrGateBellControl, kWarningBellOn);
+
+    Serial.println(F("Lights & Bells: On"));
+    IdleSleepReportWakeLatency();
+    StatsRecordLightsOn();
+
+    // the direction relay is in position before the motor gets power
+    GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
+    Serial.println(F("Motor Direction: Down"));
+
+    // since we are closing the gate, let's reset the count of the number of seconds the gate has been open
+    gCrossingState.ulGateUpEventTimeSpentInSequence = 0;
+
+    CO_AWAIT_MS(iStep, kGateMovingDown_State_LightsAndBellsDelay, ulWaitStart, kGateWarningLeadTime);
+    CO_YIELD(iStep, kGateMovingDown_State_MotorOn);
+
+    // only run if the motor duty cycle is within limits.
+    if (gCrossingState.ulMotorRunningTotalSeconds < kMaxDutyCycleLimitReached)
+    {
+        GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
+        GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
+
+        if (gCrossingState.bMotorOnFlag == false)
+        {
+            Serial.println(F("Motor: On"));
+
+            gCrossingState.ulMotorRunningStartTimeThisEvent = millis();
+            gCrossingState.bMotorOnFlag = true;
+            gCrossingState.bMotorRunning = true;
+        }
+    }
+    else
+    {
+        // if we have exceeded the motor duty cycle, then we will not turn on the motor.
+        if (bDutyCycleExceededFlag == false)
+        {
+            Serial.print(F("Motor Max Duty Cycle, Ignoring Motor On Cmd: "));
+            Serial.println(gCrossingState.ulMotorRunningTotalSeconds);
+            HistoryRecordDutyCycleTrip(gCrossingState.ulMotorRunningTotalSeconds);
+        }
+
+        bDutyCycleExceededFlag = true;
+    }
+
+    // the flag is only set just above, and is cleared again once the gate is back up
+    CO_AWAIT_MS(iStep, kGateMovingDown_State_MotorOnDelay, ulWaitStart, bDutyCycleExceededFlag ? kSevenSeconds : kGateMotorRunTime);
+    CO_YIELD(iStep, kGateMovingDown_State_MotorOff);
+
+    GateDownMotorOffState(gCrossingState.ulGateDownEventStartTime,
+                          &gCrossingState.bMotorOnFlag,
+                          &gCrossingState.bMotorOffFlag,
+                          &iStep,
+                          &gCrossingState.bGateState,
+                          &gCrossingState.bMotorRunning,
+                          &gCrossingState.ulMotorRunningTotalSeconds,
+                          &gCrossingState.ulGateDownStateDelayBeforeGateUpEventStartTime,
+                          &bDutyCycleExceededFlag);
+
+    CO_END(iStep);
+
+}  //endof GateDownSequence()
+
+// ***************************************************
+//
+// GateUpSequence(), the coroutine
+//
+// ****************************************************
+void GateUpSequence(void)
+{
+    int &iStep = gCrossingState.iGateMovingUp_State;
+    unsigned long &ulWaitStart = gCrossingState.ulGateUpWaitStartTime;
+
+    CO_BEGIN(iStep);
+
+    // the first run that finds the track vacant
+    if (gCrossingState.ulGateUpEventTimeSpentInSequence == 0)
+    {
+        gCrossingState.ulGateUpEventStartTime = millis();
+        gCrossingState.ulGateUpEventTimeSpentInSequence += 1;
+
+        Serial.println(F("Track is Vacant!"));
+    }
+
+    // and a second one, back to back, before anything moves
+    CO_AWAIT_SENSOR(iStep, kGateMovingUp_State_MotorDirection, kTrackVacant);
+
+    GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp);
+    if (gCrossingState.bMotorDirectionFlag == false)
+    {
+        Serial.println(F("Motor Direction: Up"));
+        gCrossingState.bMotorDirectionFlag = true;
+    }
+
+    CO_AWAIT_MS(iStep, kGateMovingUp_State_MotorDirectionDelay, ulWaitStart, kOneSecond);
+    CO_YIELD(iStep, kGateMovingUp_State_MotorOn);
+
+    GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp);
+    GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
+    if (gCrossingState.bMotorOnFlag == false)
+    {
+        Serial.println(F("Motor: On"));
+
+        gCrossingState.ulMotorRunningStartTimeThisEvent = millis();
+        gCrossingState.bMotorOnFlag = true;
+    }
+    gCrossingState.bMotorRunning = true;
+
+    // GateDownInactiveState() starts us at this wait, the motor off, once the duty cycle has been exceeded
+    CO_AWAIT_MS(iStep, kGateMovingUp_State_MotorOnDelay, ulWaitStart, gCrossingState.bDutyCycleExceededFlag ? kTwentySeconds : kGateMotorRunTime);
+    CO_YIELD(iStep, kGateMovingUp_State_MotorOff);
+
+    GateUpMotorOffState(&gCrossingState.ulGateUpEventStartTime,
+                        &gCrossingState.iWarningLightTimerRightID,
+                        &gCrossingState.iWarningLightTimerLeftID,
+                        &gCrossingState.bGateState,
+                        &gCrossingState.ulGateDownEventStartTime,
+                        &gCrossingState.bMotorDirectionFlag,
+                        &gCrossingState.bMotorOnFlag,
+                        &iStep,
+                        &gCrossingState.bMotorRunning,
+                        &gCrossingState.ulMotorRunningTotalSeconds,
+                        &gCrossingState.bDutyCycleExceededFlag);
+
+    CO_END(iStep);
+
+}  //endof GateUpSequence()
+
+#endif
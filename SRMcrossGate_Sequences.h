@@ -0,0 +1,56 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Sequences_h
+#define SRMcrossGate_Sequences_h
+
+// ***************************************************
+//
+// The gate sequences
+//
+// Lowering the gate (lights and bell, the warning lead time, the motor run,
+// motor off) and raising it again are each a sequence of steps, one step
+// a run of CrossingSignalMain().  There are two builds of them:
+//
+//   - the hand-written states: a switch on iGateMovingDown_State or
+//     iGateMovingUp_State, and a function for each state, the waits
+//     included (SRMcrossGate_UpDownControl.cpp)
+//   - with -DGATE_COROUTINES, each sequence as one stackless coroutine
+//     (SRMcrossGate_Coroutine.h) that reads top to bottom
+//
+// Both keep their step in iGateMovingDown_State and iGateMovingUp_State,
+// with the same values, and drive the pins the same way on the same runs.
+//
+// ****************************************************
+
+// ***************************************************
+//
+// GateDownSequence()
+//
+// Called on each run while the track is occupied and the gate is up.  It
+// takes the gate down, and leaves the step back at the start once it is.
+//
+// ****************************************************
+void GateDownSequence(void);
+
+// ***************************************************
+//
+// GateUpSequence()
+//
+// Called on each run while the track is vacant and the gate is down.  It
+// takes the gate up, and leaves the step back at the start once it is.
+//
+// ****************************************************
+void GateUpSequence(void);
+
+#endif
@@ -0,0 +1,161 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_Stack.h"
+
+#if defined(__AVR__)
+
+// these come from the linker script and avr-libc's malloc
+extern uint8_t __data_start;
+extern uint8_t __heap_start;
+extern uint8_t *__brkval;
+
+// the low stack warning is only printed once
+static bool gbStackLowReported = false;
+
+// ***************************************************
+//
+// StackPaint()
+//
+// This runs in .init1, before the stack pointer is set up and before
+// .data and .bss are filled in, so it cannot be C: there is no zero
+// register yet and nothing may be pushed.  It paints from the end of .bss
+// (_end) to the top of the SRAM (__stack).
+//
+// ****************************************************
+void StackPaint(void) __attribute__ ((naked)) __attribute__ ((used)) __attribute__ ((section (".init1")));
+
+void StackPaint(void)
+{
+    __asm volatile ("    ldi r30, lo8(_end)\n"
+                    "    ldi r31, hi8(_end)\n"
+                    "    ldi r24, %0\n"
+                    "    ldi r25, hi8(__stack)\n"
+                    "    rjmp 2f\n"
+                    "1:  st Z+, r24\n"
+                    "2:  cpi r30, lo8(__stack)\n"
+                    "    cpc r31, r25\n"
+                    "    brlo 1b\n"
+                    "    breq 1b\n"
+                    :
+                    : "i" (kStackPaintByte));
+}
+
+// the first byte past the heap (or past .bss, with no heap)
+static uint8_t *StackHeapEnd(void)
+{
+    return (__brkval != 0) ? __brkval : &__heap_start;
+}
+
+#endif
+
+// ***************************************************
+//
+// StackFreeNow()
+//
+// The bytes between the top of the heap and the stack pointer, right now.
+//
+// ****************************************************
+uint16_t StackFreeNow(void)
+{
+#if defined(__AVR__)
+    uint8_t uiHere;
+
+    return (uint16_t)(&uiHere - StackHeapEnd());
+#else
+    return 0;
+#endif
+}
+
+// ***************************************************
+//
+// StackNeverUsed()
+//
+// The high water scan: counts the paint left above the heap.  The stack
+// never reaches into the painted bytes below its deepest point, so the
+// first byte that is not paint ends the count.
+//
+// ****************************************************
+uint16_t StackNeverUsed(void)
+{
+#if defined(__AVR__)
+    const uint8_t *p = StackHeapEnd();
+    const uint8_t *pEnd = (const uint8_t *)(RAMEND + 1);
+    uint16_t uiCount = 0;
+
+    while ((p < pEnd) && (*p == kStackPaintByte))
+    {
+        p++;
+        uiCount++;
+    }
+
+    return uiCount;
+#else
+    return 0;
+#endif
+}
+
+// ***************************************************
+//
+// StackCheck()
+//
+// This function is called from loop().  It only looks at the one painted
+// byte kStackLowWarning above the heap; the first time the stack has
+// reached it, the report is printed with a warning.
+//
+// ****************************************************
+void StackCheck(void)
+{
+#if defined(__AVR__)
+    if ((gbStackLowReported == false) && (StackHeapEnd()[kStackLowWarning - 1] != kStackPaintByte))
+    {
+        StackReport();
+    }
+#endif
+}
+
+// ***************************************************
+//
+// StackReport()
+//
+// This function is called by the S serial command, and by StackCheck().
+//
+// ****************************************************
+void StackReport(void)
+{
+#if defined(__AVR__)
+    uint16_t uiNeverUsed = StackNeverUsed();
+    uint16_t uiHeapEnd = (uint16_t)StackHeapEnd();
+
+    Serial.print(F("Stack: Static "));
+    Serial.print((uint16_t)&__heap_start - (uint16_t)&__data_start);
+    Serial.print(F(", Heap "));
+    Serial.print(uiHeapEnd - (uint16_t)&__heap_start);
+    Serial.print(F(", Free Now "));
+    Serial.print(StackFreeNow());
+    Serial.print(F(", Never Used "));
+    Serial.print(uiNeverUsed);
+    Serial.print(F(", Max Used "));
+    Serial.println((uint16_t)(RAMEND + 1) - uiHeapEnd - uiNeverUsed);
+
+    if (uiNeverUsed < kStackLowWarning)
+    {
+        Serial.println(F("Stack: Warning, Low"));
+        gbStackLowReported = true;
+    }
+#else
+    Serial.println(F("Stack: Not Painted On This Build"));
+#endif
+}
@@ -0,0 +1,83 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Stack_h
+#define SRMcrossGate_Stack_h
+
+#include <inttypes.h>
+
+// ***************************************************
+//
+// SRAM layout (ATmega328P, 2048 bytes)
+//
+//     .data and .bss | heap (grows up) ... free ... stack (grows down) | RAMEND
+//
+// Before the C startup code runs, StackPaint() fills everything from the
+// end of .bss to the top of the SRAM with kStackPaintByte.  The stack
+// writes over the paint as it grows, so the paint that is left above the
+// heap is the stack space that has never been used since the reset.  The
+// sketch does not use the heap, but the report counts it in case a
+// library does.
+//
+// On the host build nothing is painted, and the report says so.  Use
+// host/StackDepth.cpp to see which state path goes deepest.
+//
+// ****************************************************
+const uint8_t kStackPaintByte = 0xC5;
+
+// below this many never used bytes, the report warns
+const uint16_t kStackLowWarning = 128;
+
+// ***************************************************
+//
+// StackFreeNow()
+//
+// The bytes between the top of the heap and the stack pointer, right now.
+//
+// ****************************************************
+uint16_t StackFreeNow(void);
+
+// ***************************************************
+//
+// StackNeverUsed()
+//
+// The high water scan: counts the paint left above the heap.  It reads
+// the unused part of the SRAM once, a few hundred microseconds, so it is
+// only done for the report.
+//
+// ****************************************************
+uint16_t StackNeverUsed(void);
+
+// ***************************************************
+//
+// StackCheck()
+//
+// This function is called from loop().  It only looks at the one painted
+// byte kStackLowWarning above the heap; the first time the stack has
+// reached it, the report is printed with a warning.
+//
+// ****************************************************
+void StackCheck(void);
+
+// ***************************************************
+//
+// StackReport()
+//
+// This function is called by the S serial command.  It prints the static
+// data and heap sizes, the stack bytes free now, never used and at most
+// used since the reset.
+//
+// ****************************************************
+void StackReport(void);
+
+#endif
@@ -0,0 +1,53 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include <string.h>
+#include "Arduino.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+
+extern bool gbIdleSleepAllowed;
+
+CrossingState_t gCrossingState;
+
+// ***************************************************
+//
+// CrossingStateReset()
+//
+// This function is called from setup().  It puts the state machine back to
+// its power on state: initializing, with the gate assumed to be up.
+//
+// ****************************************************
+void CrossingStateReset(void)
+{
+    // almost everything starts out as zero (false, kInitializing, the first sub state)
+    memset(&gCrossingState, 0, sizeof(gCrossingState));
+
+    // the trace, cleared with the rest, starts with where each machine is
+    SetState(gCrossingState.bGateState, kGateInTheUpPosition);
+    SetState(gCrossingState.iTrackOcupationState, kInitializing);
+    SetState(gCrossingState.iGateInitializationState, kGateInitalize_LightsBellsAndDirection);
+    SetState(gCrossingState.iGateMovingDown_State, kGateMovingDown_State_LightsAndBells);
+    SetState(gCrossingState.iGateMovingUp_State, kGateMovingUp_State_Debouce);
+    gCrossingState.iPreviousTrackOcupationState = kTrackVacant;
+    gCrossingState.iPreviousSensorLevel = -1;
+
+    // HistoryBegin() moves these on to the newest block, if there is one
+    gCrossingState.iHistoryBlock = kHistoryBlockCount - 1;
+    gCrossingState.iHistoryWriteOffset = kHistoryBlockSize;
+    gCrossingState.uiHistorySequence = kHistorySequenceModulus - 1;
+    gCrossingState.iHistoryDumpOffset = -1;
+
+    gbIdleSleepAllowed = false;
+
+}  //endof CrossingStateReset()
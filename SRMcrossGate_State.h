@@ -0,0 +1,173 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_State_h
+#define SRMcrossGate_State_h
+
+#include "SRMcrossGate_History.h"
+#include "SRMcrossGate_Stats.h"
+#include "SRMcrossGate_Controller.h"
+#include "SRMcrossGate_Trace.h"
+
+// ***************************************************
+//
+// CrossingState_t
+//
+// All of the controller's variables that have to live from one timer
+// tick to the next (the Timer, the black box and the EEPROM aside).  They used to be statics spread over the functions that
+// use them; keeping them in one place means setup() can put them back to
+// their power on values, and the host tools can reset (or copy) the whole
+// controller at once.
+//
+// ****************************************************
+typedef struct
+{
+    // CrossingSignalMain()
+    bool bMotorOnFlag;
+    bool bMotorOffFlag;
+    bool bMotorDirectionFlag;
+    bool bGateState;
+    bool bMotorRunning;
+    bool bDutyCycleExceededFlag;
+
+    int iWarningLightTimerRightID;
+    int iWarningLightTimerLeftID;
+    int iTrackOcupationState;
+    int iGateInitializationState;
+    int iWarningLightRightTimerID;
+    int iWarningLightLeftTimerID;
+    int iGateMovingDown_State;
+    int iGateMovingUp_State;
+
+    unsigned long ulGateDownEventStartTime;
+    unsigned long ulGateDownEventTotalElapsedTime;
+    unsigned long ulGateDownEventElapsedStartTime;
+    unsigned long ulGateDownEventTimeSpentInSequence;
+    unsigned long ulGateUpEventStartTime;
+    unsigned long ulGateUpEventTimeSpentInSequence;
+    unsigned long ulGateInitializeStartTime;
+    unsigned long ulMotorRunningTotalSeconds;
+    unsigned long ulGateDownStateDelayBeforeGateUpEventStartTime;
+
+    // ReadTrackSensorAndDebouce()
+    int iPreviousTrackOcupationState;
+    int iPreviousSensorLevel;
+    unsigned long ulSensorChangeStartTime;
+
+    // MotorDutyCycleCalcuate()
+    unsigned long ulDutyCyclePreviousTimeStamp;
+    unsigned long ulDutyCyclePrintOutCount;
+
+    // SRMcrossGate_UpDownControl.cpp
+    bool bInitializePrintFlag;
+    unsigned long ulInitializeDelayStartTime;
+    unsigned long ulGateDownInactivePrintOutCount;
+    unsigned long ulMotorRunningTotalSecondsThisEvent;
+    unsigned long ulMotorRunningStartTimeThisEvent;
+#if defined(GATE_COROUTINES)
+    // SRMcrossGate_Sequences.cpp, the start of the wait each sequence is in
+    unsigned long ulGateDownWaitStartTime;
+    unsigned long ulGateUpWaitStartTime;
+#else
+    unsigned long ulGateDownStateDelayTime;
+    unsigned long ulGateUpStateDelayTime;
+    unsigned long ulGateUpStateDelayTimeEventStart;
+#endif
+
+    // SRMcrossGate_History.cpp
+    HistoryQueueEntry_t HistoryQueue[kHistoryQueueSize];
+    uint8_t uiHistoryQueueCount;
+    unsigned int uiHistoryDroppedCount;
+    int iHistoryBlock;
+    int iHistoryWriteOffset;
+    uint8_t uiHistorySequence;
+    unsigned long ulHistoryLastTime;
+    unsigned long ulHistoryLastMillis;
+    unsigned long ulHistoryOccupancyStartTime;
+    int iHistoryDumpOffset;
+
+    // SRMcrossGate_Stats.cpp
+    uint8_t StatsCounts[kStatsTimes][kStatsBuckets];
+    uint8_t uiStatsDirty;
+    bool bStatsClosureOpen;
+    bool bStatsWarningPending;
+    bool bStatsOccupied;
+    unsigned long ulStatsLightsOnTime;
+    unsigned long ulStatsOccupancyStartTime;
+    unsigned long ulStatsMotorRunTime;
+
+    // SRMcrossGate_Power.cpp
+    unsigned long ulIdleSensorWakeTime;
+    unsigned long ulIdleSerialWakeTime;
+
+    // SRMcrossGate_Controller.cpp
+    int iControllerTimerID;
+    int iControllerSensorLevel;
+    uint8_t uiControllerPending;
+    uint8_t uiControllerWaiting;
+    unsigned long ulControllerDeadline[kControllerEventTypes];
+    unsigned long ulControllerRuns;
+    unsigned long ulControllerSteps;
+    unsigned long ulControllerEvents[kControllerEventTypes];
+
+#if defined(SRM_TRACE)
+    // SRMcrossGate_Trace.cpp, what the trace sink holds
+    TraceData_t TraceData;
+#endif
+} CrossingState_t;
+
+extern CrossingState_t gCrossingState;
+
+// ***************************************************
+//
+// SetState()
+//
+// Every change of one of the five state machines (iTrackOcupationState,
+// iGateInitializationState, bGateState, iGateMovingDown_State and
+// iGateMovingUp_State) is made here, such that the trace sees each one
+// as it happens (SRMcrossGate_Trace.h).  The machine is told by the
+// variable's address.  Without SRM_TRACE this is the assignment alone.
+//
+// ****************************************************
+inline uint8_t TraceMachine(const void *pState)
+{
+    return (pState == &gCrossingState.iTrackOcupationState)     ? kTraceMachine_Track :
+           (pState == &gCrossingState.iGateInitializationState) ? kTraceMachine_Initialize :
+           (pState == &gCrossingState.bGateState)               ? kTraceMachine_Gate :
+           (pState == &gCrossingState.iGateMovingDown_State)    ? kTraceMachine_Down :
+           (pState == &gCrossingState.iGateMovingUp_State)      ? kTraceMachine_Up : kTraceMachines;
+}
+
+inline void SetState(int &iState, int iNewState)
+{
+    CrossingTrace::state(TraceMachine(&iState), (uint8_t)iState, (uint8_t)iNewState);
+    iState = iNewState;
+}
+
+inline void SetState(bool &bState, bool bNewState)
+{
+    CrossingTrace::state(TraceMachine(&bState), (uint8_t)bState, (uint8_t)bNewState);
+    bState = bNewState;
+}
+
+// ***************************************************
+//
+// CrossingStateReset()
+//
+// This function is called from setup().  It puts the state machine back to
+// its power on state: initializing, with the gate assumed to be up.
+//
+// ****************************************************
+void CrossingStateReset(void);
+
+#endif
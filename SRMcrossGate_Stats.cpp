@@ -0,0 +1,436 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include <EEPROM.h>
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_Stats.h"
+#include "SRMcrossGate_State.h"
+
+// the statistics variables live in gCrossingState (SRMcrossGate_State.h)
+static uint8_t (&gStatsCounts)[kStatsTimes][kStatsBuckets] = gCrossingState.StatsCounts;
+static uint8_t &guiStatsDirty = gCrossingState.uiStatsDirty;
+
+// ***************************************************
+//
+// The bucket bounds
+//
+// A time is counted in the first bucket whose bound it is below, or in
+// the last bucket.  The bounds are bytes, in units of 2^shift ms:
+//
+//     warning   - 64 ms, 64 ms apart over the half second after the
+//                 profile's warning lead time
+//     closure   - 2 s, from 30 s to 6 minutes
+//     occupancy - 2 s, from 10 s to 6 minutes
+//     motor     - 256 ms, 256 ms apart around the profile's run time down
+//                 and up, the first bucket a closure that never ran the motor
+//
+// They come from the profile, not SRMcrossGate_Timing.h, such that they
+// stay the same when the host sweep moves the timings.
+//
+// ****************************************************
+constexpr uint8_t StatsUnits(unsigned long ulTime, uint8_t uiShift)
+{
+    return ((ulTime >> uiShift) > 255) ? 255 : (uint8_t)(ulTime >> uiShift);
+}
+
+constexpr bool StatsBoundsRising(const uint8_t *pBounds, int iCount)
+{
+    return (iCount < 2) || ((pBounds[0] < pBounds[1]) && StatsBoundsRising(pBounds + 1, iCount - 1));
+}
+
+const uint8_t kStatsShift_Warning = 6;
+const uint8_t kStatsShift_Closure = 11;
+const uint8_t kStatsShift_Occupancy = 11;
+const uint8_t kStatsShift_Motor = 8;
+
+const unsigned long kStatsLead = CrossingProfile::kGateWarningLeadTime;
+const unsigned long kStatsMotor = 2 * CrossingProfile::kGateMotorRunTime;
+
+static const uint8_t kStatsShift[kStatsTimes] PROGMEM =
+{
+    kStatsShift_Warning, kStatsShift_Closure, kStatsShift_Occupancy, kStatsShift_Motor
+};
+
+static constexpr uint8_t kStatsBounds[kStatsTimes][kStatsBuckets - 1] PROGMEM =
+{
+    {
+        StatsUnits(kStatsLead / 2, kStatsShift_Warning),         StatsUnits(kStatsLead * 3 / 4, kStatsShift_Warning),
+        StatsUnits(kStatsLead - 128, kStatsShift_Warning),       StatsUnits(kStatsLead - 64, kStatsShift_Warning),
+        StatsUnits(kStatsLead, kStatsShift_Warning),             StatsUnits(kStatsLead + 64, kStatsShift_Warning),
+        StatsUnits(kStatsLead + 128, kStatsShift_Warning),       StatsUnits(kStatsLead + 192, kStatsShift_Warning),
+        StatsUnits(kStatsLead + 256, kStatsShift_Warning),       StatsUnits(kStatsLead + 320, kStatsShift_Warning),
+        StatsUnits(kStatsLead + 384, kStatsShift_Warning),       StatsUnits(kStatsLead + 512, kStatsShift_Warning),
+        StatsUnits(kStatsLead * 5 / 4, kStatsShift_Warning)
+    },
+    {
+        StatsUnits(30000, kStatsShift_Closure),  StatsUnits(45000, kStatsShift_Closure),  StatsUnits(50000, kStatsShift_Closure),
+        StatsUnits(55000, kStatsShift_Closure),  StatsUnits(60000, kStatsShift_Closure),  StatsUnits(70000, kStatsShift_Closure),
+        StatsUnits(80000, kStatsShift_Closure),  StatsUnits(90000, kStatsShift_Closure),  StatsUnits(120000, kStatsShift_Closure),
+        StatsUnits(150000, kStatsShift_Closure), StatsUnits(180000, kStatsShift_Closure), StatsUnits(240000, kStatsShift_Closure),
+        StatsUnits(360000, kStatsShift_Closure)
+    },
+    {
+        StatsUnits(10000, kStatsShift_Occupancy),  StatsUnits(20000, kStatsShift_Occupancy),  StatsUnits(30000, kStatsShift_Occupancy),
+        StatsUnits(40000, kStatsShift_Occupancy),  StatsUnits(50000, kStatsShift_Occupancy),  StatsUnits(60000, kStatsShift_Occupancy),
+        StatsUnits(75000, kStatsShift_Occupancy),  StatsUnits(90000, kStatsShift_Occupancy),  StatsUnits(120000, kStatsShift_Occupancy),
+        StatsUnits(150000, kStatsShift_Occupancy), StatsUnits(180000, kStatsShift_Occupancy), StatsUnits(240000, kStatsShift_Occupancy),
+        StatsUnits(360000, kStatsShift_Occupancy)
+    },
+    {
+        StatsUnits(256, kStatsShift_Motor),                StatsUnits(kStatsMotor / 2, kStatsShift_Motor),
+        StatsUnits(kStatsMotor * 3 / 4, kStatsShift_Motor), StatsUnits(kStatsMotor - 1024, kStatsShift_Motor),
+        StatsUnits(kStatsMotor - 512, kStatsShift_Motor),  StatsUnits(kStatsMotor - 256, kStatsShift_Motor),
+        StatsUnits(kStatsMotor, kStatsShift_Motor),        StatsUnits(kStatsMotor + 256, kStatsShift_Motor),
+        StatsUnits(kStatsMotor + 512, kStatsShift_Motor),  StatsUnits(kStatsMotor + 768, kStatsShift_Motor),
+        StatsUnits(kStatsMotor + 1024, kStatsShift_Motor), StatsUnits(kStatsMotor + 2048, kStatsShift_Motor),
+        StatsUnits(kStatsMotor * 5 / 4, kStatsShift_Motor)
+    }
+};
+
+// a profile whose times are too short or too long for the bytes gets here
+static_assert(StatsBoundsRising(kStatsBounds[kStatsTime_Warning], kStatsBuckets - 1), "the warning lead time does not fit the statistics buckets");
+static_assert(StatsBoundsRising(kStatsBounds[kStatsTime_Motor], kStatsBuckets - 1), "the motor run time does not fit the statistics buckets");
+
+// the names are kept in flash, as the report's other strings are
+static const char kStatsName_Warning[] PROGMEM = "Warning";
+static const char kStatsName_Closure[] PROGMEM = "Closure";
+static const char kStatsName_Occupancy[] PROGMEM = "Occupancy";
+static const char kStatsName_Motor[] PROGMEM = "Motor";
+
+static const char *const kStatsNames[kStatsTimes] PROGMEM =
+{
+    kStatsName_Warning, kStatsName_Closure, kStatsName_Occupancy, kStatsName_Motor
+};
+
+// ***************************************************
+//
+// StatsRowAddress()
+//
+// Returns the EEPROM address of the counts of one time.
+//
+// ****************************************************
+static int StatsRowAddress(uint8_t uiStat)
+{
+    return kStatsEepromStart + kStatsSignatureSize + (uiStat * kStatsBuckets);
+}
+
+// ***************************************************
+//
+// StatsBegin()
+//
+// This function is called from setup().  It reads the counts back from the
+// EEPROM, or starts them over if the EEPROM has never held them.
+//
+// ****************************************************
+void StatsBegin(void)
+{
+    uint8_t uiStat;
+    uint8_t uiBucket;
+
+    // the counts are cleared with the rest of gCrossingState, write them out before the signature
+    if ((EEPROM.read(kStatsEepromStart) != kStatsSignature0) ||
+        (EEPROM.read(kStatsEepromStart + 1) != kStatsSignature1))
+    {
+        for (uiStat = 0; uiStat < kStatsTimes; uiStat++)
+        {
+            for (uiBucket = 0; uiBucket < kStatsBuckets; uiBucket++)
+            {
+                EEPROM.update(StatsRowAddress(uiStat) + uiBucket, 0);
+            }
+        }
+
+        EEPROM.update(kStatsEepromStart, kStatsSignature0);
+        EEPROM.update(kStatsEepromStart + 1, kStatsSignature1);
+
+        Serial.println(F("Stats: Formatted"));
+        return;
+    }
+
+    for (uiStat = 0; uiStat < kStatsTimes; uiStat++)
+    {
+        for (uiBucket = 0; uiBucket < kStatsBuckets; uiBucket++)
+        {
+            gStatsCounts[uiStat][uiBucket] = EEPROM.read(StatsRowAddress(uiStat) + uiBucket);
+        }
+    }
+
+}  //endof StatsBegin()
+
+// ***************************************************
+//
+// StatsRecord()
+//
+// Counts one time, in ms.  A binary search of the bounds finds the
+// bucket, four compares for fourteen buckets.
+//
+// ****************************************************
+static void StatsRecord(uint8_t uiStat, unsigned long ulTime)
+{
+    const uint8_t *pBounds = kStatsBounds[uiStat];
+    uint8_t *pCounts = gStatsCounts[uiStat];
+    unsigned long ulUnits = ulTime >> pgm_read_byte(&kStatsShift[uiStat]);
+    uint8_t uiUnits = (ulUnits > 255) ? 255 : (uint8_t)ulUnits;
+    uint8_t uiLow = 0;
+    uint8_t uiHigh = kStatsBuckets - 1;
+    uint8_t uiMiddle;
+
+    while (uiLow < uiHigh)
+    {
+        uiMiddle = (uiLow + uiHigh) / 2;
+
+        if (uiUnits < pgm_read_byte(&pBounds[uiMiddle]))
+        {
+            uiHigh = uiMiddle;
+        }
+        else
+        {
+            uiLow = uiMiddle + 1;
+        }
+    }
+
+    // the oldest closures fade out, and the percentiles hold their shape
+    if (++pCounts[uiLow] == 255)
+    {
+        for (uiMiddle = 0; uiMiddle < kStatsBuckets; uiMiddle++)
+        {
+            pCounts[uiMiddle] /= 2;
+        }
+    }
+
+    guiStatsDirty |= (uint8_t)(1 << uiStat);
+}
+
+// ***************************************************
+//
+// StatsRecord...()
+//
+// These functions are called from the state machine, next to the
+// HistoryRecord...() calls.  They only count in ram, the EEPROM writes are
+// done later by StatsFlush().
+//
+// ****************************************************
+void StatsRecordLightsOn(void)
+{
+    gCrossingState.bStatsClosureOpen = true;
+    gCrossingState.bStatsWarningPending = true;
+    gCrossingState.ulStatsLightsOnTime = millis();
+    gCrossingState.ulStatsMotorRunTime = 0;
+}
+
+void StatsRecordMotorRun(unsigned long ulMotorRunTime)
+{
+    if (gCrossingState.bStatsClosureOpen == false)
+    {
+        return;
+    }
+
+    gCrossingState.ulStatsMotorRunTime += ulMotorRunTime;
+
+    // the first run of a closure is the gate going down, it started this long ago
+    if (gCrossingState.bStatsWarningPending == true)
+    {
+        StatsRecord(kStatsTime_Warning, (millis() - ulMotorRunTime) - gCrossingState.ulStatsLightsOnTime);
+        gCrossingState.bStatsWarningPending = false;
+    }
+}
+
+void StatsRecordLightsOff(void)
+{
+    if (gCrossingState.bStatsClosureOpen == false)
+    {
+        return;
+    }
+
+    StatsRecord(kStatsTime_Closure, millis() - gCrossingState.ulStatsLightsOnTime);
+    StatsRecord(kStatsTime_Motor, gCrossingState.ulStatsMotorRunTime);
+
+    gCrossingState.bStatsClosureOpen = false;
+    gCrossingState.bStatsWarningPending = false;
+}
+
+void StatsRecordOccupancyStart(void)
+{
+    gCrossingState.bStatsOccupied = true;
+    gCrossingState.ulStatsOccupancyStartTime = millis();
+}
+
+void StatsRecordOccupancyEnd(void)
+{
+    if (gCrossingState.bStatsOccupied == false)
+    {
+        return;
+    }
+
+    StatsRecord(kStatsTime_Occupancy, millis() - gCrossingState.ulStatsOccupancyStartTime);
+    gCrossingState.bStatsOccupied = false;
+}
+
+// ***************************************************
+//
+// StatsFlush()
+//
+// This function is called from a timer.  It writes one changed row of
+// counts to the EEPROM.  EEPROM.update() only writes the bytes that have
+// changed, usually the one count, all fourteen after a halving.
+//
+// ****************************************************
+void StatsFlush(void)
+{
+    uint8_t uiStat;
+    uint8_t uiBucket;
+
+    for (uiStat = 0; uiStat < kStatsTimes; uiStat++)
+    {
+        if ((guiStatsDirty & (1 << uiStat)) != 0)
+        {
+            break;
+        }
+    }
+
+    if (uiStat == kStatsTimes)
+    {
+        return;
+    }
+
+    for (uiBucket = 0; uiBucket < kStatsBuckets; uiBucket++)
+    {
+        EEPROM.update(StatsRowAddress(uiStat) + uiBucket, gStatsCounts[uiStat][uiBucket]);
+    }
+
+    guiStatsDirty &= (uint8_t)~(1 << uiStat);
+
+}  //endof StatsFlush()
+
+// ***************************************************
+//
+// StatsPending()
+//
+// Returns true while there are counts waiting for StatsFlush().
+//
+// ****************************************************
+bool StatsPending(void)
+{
+    return (guiStatsDirty != 0);
+
+}  //endof StatsPending()
+
+// ***************************************************
+//
+// StatsPercentile()
+//
+// Returns the time, in ms, below which uiPercent of the counted times
+// fall.  The times in a bucket are taken as spread evenly over it.  In the
+// last bucket there is no upper bound, so *pbPast is set and its lower
+// bound is returned.
+//
+// ****************************************************
+static unsigned long StatsPercentile(uint8_t uiStat, unsigned int uiTotal, uint8_t uiPercent, bool *pbPast)
+{
+    uint8_t uiShift = pgm_read_byte(&kStatsShift[uiStat]);
+    unsigned long ulRank = (((unsigned long)uiTotal * uiPercent) + 99) / 100;
+    unsigned int uiBelow = 0;
+    unsigned long ulLow;
+    unsigned long ulHigh;
+    uint8_t uiCount;
+    uint8_t uiBucket;
+
+    for (uiBucket = 0; uiBucket < (kStatsBuckets - 1); uiBucket++)
+    {
+        uiCount = gStatsCounts[uiStat][uiBucket];
+
+        if ((uiBelow + uiCount) >= ulRank)
+        {
+            break;
+        }
+
+        uiBelow += uiCount;
+    }
+
+    ulLow = (uiBucket == 0) ? 0 : ((unsigned long)pgm_read_byte(&kStatsBounds[uiStat][uiBucket - 1]) << uiShift);
+
+    *pbPast = (uiBucket == (kStatsBuckets - 1));
+    if (*pbPast == true)
+    {
+        return ulLow;
+    }
+
+    ulHigh = (unsigned long)pgm_read_byte(&kStatsBounds[uiStat][uiBucket]) << uiShift;
+    uiCount = gStatsCounts[uiStat][uiBucket];
+
+    return ulLow + ((ulHigh - ulLow) * ((2 * (ulRank - uiBelow)) - 1)) / (2UL * uiCount);
+}
+
+// ***************************************************
+//
+// StatsPrintSeconds()
+//
+// Prints a time in ms as seconds, to a tenth.
+//
+// ****************************************************
+static void StatsPrintSeconds(unsigned long ulTime, bool bPast)
+{
+    unsigned long ulTenths = (ulTime + 50) / 100;
+
+    if (bPast == true)
+    {
+        Serial.print(F(">"));
+    }
+    Serial.print(ulTenths / 10);
+    Serial.print(F("."));
+    Serial.print(ulTenths % 10);
+}
+
+// ***************************************************
+//
+// StatsReport()
+//
+// Prints the count, p50, p95 and p99 of each time, in seconds.  A
+// percentile past the last bucket bound is printed as ">" that bound.
+//
+// ****************************************************
+void StatsReport(void)
+{
+    const uint8_t kPercents[] = { 50, 95, 99 };
+    unsigned int uiTotal;
+    bool bPast = false;
+    uint8_t uiStat;
+    uint8_t i;
+
+    for (uiStat = 0; uiStat < kStatsTimes; uiStat++)
+    {
+        uiTotal = 0;
+        for (i = 0; i < kStatsBuckets; i++)
+        {
+            uiTotal += gStatsCounts[uiStat][i];
+        }
+
+        Serial.print(F("Stats "));
+        Serial.print((const __FlashStringHelper *)pgm_read_ptr(&kStatsNames[uiStat]));
+        Serial.print(F(": n "));
+        Serial.print(uiTotal);
+
+        if (uiTotal != 0)
+        {
+            for (i = 0; i < sizeof(kPercents); i++)
+            {
+                Serial.print(F(", p"));
+                Serial.print(kPercents[i]);
+                Serial.print(F(" "));
+                StatsPrintSeconds(StatsPercentile(uiStat, uiTotal, kPercents[i], &bPast), bPast);
+            }
+        }
+        Serial.println();
+    }
+
+}  //endof StatsReport()
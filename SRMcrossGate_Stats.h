@@ -0,0 +1,116 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Stats_h
+#define SRMcrossGate_Stats_h
+
+#include <inttypes.h>
+#include "SRMcrossGate_History.h"
+
+// ***************************************************
+//
+// Closure statistics
+//
+// The p50, p95 and p99 of four times, over every closure since the
+// statistics were started:
+//
+//     warning   - lights and bell on, to the motor starting down
+//     closure   - lights and bell on, to lights and bell off
+//     occupancy - the track occupied, to the gate let go (as the history)
+//     motor     - the motor run time of a closure, down and up
+//
+// There is no room to keep the times themselves, so each is counted in one
+// of kStatsBuckets buckets.  The bucket bounds (SRMcrossGate_Stats.cpp) are
+// closest together around the times the crossing profile expects, and a
+// percentile is read back from the counts, placed within its bucket.
+// Counting a time is a shift, four compares and an increment.  When a
+// count reaches 255, every count of that time is halved, so the oldest
+// closures fade out and the newest count the most.
+//
+// The counts are kept in the EEPROM, after the history ring, and written
+// out by StatsFlush() a row at a time.  Most closures change one byte of
+// each row.
+//
+// ****************************************************
+const uint8_t kStatsTime_Warning = 0;
+const uint8_t kStatsTime_Closure = 1;
+const uint8_t kStatsTime_Occupancy = 2;
+const uint8_t kStatsTime_Motor = 3;
+const uint8_t kStatsTimes = 4;
+
+const uint8_t kStatsBuckets = 14;
+
+const int kStatsEepromStart = kHistoryEepromStart + kHistorySignatureSize + (kHistoryBlockCount * kHistoryBlockSize);
+const uint8_t kStatsSignature0 = 0x5A;
+const uint8_t kStatsSignature1 = 0xC2;
+const int kStatsSignatureSize = 2;
+const int kStatsEepromSize = kStatsSignatureSize + (kStatsTimes * kStatsBuckets);
+
+// the Uno has 1K of EEPROM
+static_assert((kStatsEepromStart + kStatsEepromSize) <= 1024, "the statistics do not fit after the history");
+
+// ***************************************************
+//
+// StatsBegin()
+//
+// This function is called from setup().  It reads the counts back from the
+// EEPROM, or starts them over if the EEPROM has never held them.
+//
+// ****************************************************
+void StatsBegin(void);
+
+// ***************************************************
+//
+// StatsRecord...()
+//
+// These functions are called from the state machine, next to the
+// HistoryRecord...() calls.  They only count in ram, the EEPROM writes are
+// done later by StatsFlush().
+//
+// ****************************************************
+void StatsRecordLightsOn(void);
+void StatsRecordMotorRun(unsigned long ulMotorRunTime);
+void StatsRecordLightsOff(void);
+void StatsRecordOccupancyStart(void);
+void StatsRecordOccupancyEnd(void);
+
+// ***************************************************
+//
+// StatsFlush()
+//
+// This function is called from a timer.  It writes one changed row of
+// counts to the EEPROM.
+//
+// ****************************************************
+void StatsFlush(void);
+
+// ***************************************************
+//
+// StatsPending()
+//
+// Returns true while there are counts waiting for StatsFlush().
+//
+// ****************************************************
+bool StatsPending(void);
+
+// ***************************************************
+//
+// StatsReport()
+//
+// Prints the count, p50, p95 and p99 of each time, in seconds.  A
+// percentile past the last bucket bound is printed as ">" that bound.
+//
+// ****************************************************
+void StatsReport(void);
+
+#endif
@@ -0,0 +1,54 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Timing_h
+#define SRMcrossGate_Timing_h
+
+#include "SRMcrossGate_Profile.h"
+
+// ***************************************************
+//
+// The crossing's timing.
+//
+// The values are the crossing profile's (SRMcrossGate_Profile.h).
+// host/SweepTiming.cpp tries other values against recorded traffic, and
+// writes the ones it picked out as a profile, to add beside the others.
+//
+// On the Uno each one is a constant.  The host sweep builds with
+// SRM_TUNABLE_TIMING, which makes them variables it can set between runs.
+//
+// ****************************************************
+#ifndef SRM_TIMING
+#ifdef SRM_TUNABLE_TIMING
+#define SRM_TIMING(name, value) extern unsigned long name
+#else
+#define SRM_TIMING(name, value) const unsigned long name = value
+#endif
+#endif
+
+// lights and bells before the gate arm starts down
+SRM_TIMING(kGateWarningLeadTime, CrossingProfile::kGateWarningLeadTime);
+
+// how long the motor runs to lower or raise the gate arm
+SRM_TIMING(kGateMotorRunTime, CrossingProfile::kGateMotorRunTime);
+
+// how long the gate stays down after the track is clear
+SRM_TIMING(kMaxGateDownTimelimitReached, CrossingProfile::kMaxGateDownTimelimitReached);
+
+// how long the track sensor has to hold a new level before we believe it
+SRM_TIMING(kTrackSensorDebounceTime, CrossingProfile::kTrackSensorDebounceTime);
+
+// the motor run time (less the cooling time) that locks the motor out
+SRM_TIMING(kMaxDutyCycleLimitReached, CrossingProfile::kMaxDutyCycleLimitReached);
+
+#endif
@@ -0,0 +1,224 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Trace.h"
+
+// nothing here is built into the release image
+#if defined(SRM_TRACE)
+
+// the names, in flash; TraceName() reads one back for Serial.print()
+static const char kTraceMachineName_Track[] PROGMEM = "Track";
+static const char kTraceMachineName_Initialize[] PROGMEM = "Initialize";
+static const char kTraceMachineName_Gate[] PROGMEM = "Gate";
+static const char kTraceMachineName_Down[] PROGMEM = "Down";
+static const char kTraceMachineName_Up[] PROGMEM = "Up";
+
+static const char *const kTraceMachineNames[kTraceMachines] PROGMEM =
+{
+    kTraceMachineName_Track, kTraceMachineName_Initialize, kTraceMachineName_Gate, kTraceMachineName_Down, kTraceMachineName_Up
+};
+
+static const char kTracePointName_Exit[] PROGMEM = "exit";
+static const char kTracePointName_Enter[] PROGMEM = "enter";
+static const char kTracePointName_Pin[] PROGMEM = "pin";
+static const char kTracePointName_Timer[] PROGMEM = "timer";
+
+static const char *const kTracePointNames[kTracePoints] PROGMEM =
+{
+    kTracePointName_Exit, kTracePointName_Enter, kTracePointName_Pin, kTracePointName_Timer
+};
+
+static inline const __FlashStringHelper *TraceName(const char *const *ppszName)
+{
+    return (const __FlashStringHelper *)pgm_read_ptr(ppszName);
+}
+
+// ***************************************************
+//
+// TimerTrace::dispatch()
+//
+// The Timer's hook (Timer.h), handed on to the sink.
+//
+// ****************************************************
+void TimerTrace::dispatch(uint8_t slot, int8_t eventType, uint8_t pin, uint8_t pinState)
+{
+    CrossingTrace::timerDispatch(slot, eventType, pin, pinState);
+}
+
+// ***************************************************
+//
+// TraceCounters
+//
+// ****************************************************
+// counts stop at the top rather than wrap back to zero
+static void TraceCount(uint16_t *puiCount)
+{
+    if (*puiCount != 0xFFFF)
+    {
+        (*puiCount)++;
+    }
+}
+
+void TraceCounters::point(uint8_t uiPoint, uint8_t uiId, uint8_t uiValue)
+{
+    TraceCounters::Data_t &counts = gCrossingState.TraceData.Counters;
+
+    switch (uiPoint)
+    {
+        case kTracePoint_StateEnter:
+
+            if ((uiId < kTraceMachines) && (uiValue < kTraceStates))
+            {
+                TraceCount(&counts.uiEntries[uiId][uiValue]);
+            }
+            break;
+
+        case kTracePoint_PinWrite:
+
+            if (uiId < kTracePins)
+            {
+                TraceCount(&counts.uiPinWrites[uiId]);
+            }
+            break;
+
+        case kTracePoint_TimerDispatch:
+
+            if (uiId < MAX_NUMBER_OF_EVENTS)
+            {
+                TraceCount(&counts.uiDispatches[uiId]);
+            }
+            break;
+
+        default:
+
+            // every exit has its enter, which is counted
+            break;
+    }
+}
+
+// ***************************************************
+//
+// TraceCounters::report()
+//
+// One line for each machine, the times each state was entered; one for the
+// pins written, and one for the Timer slots run:
+//
+//     Trace Down: 0 12, 1 12, 2 12, 3 12, 4 12, 5 12
+//     Trace Pins: 3 24, 8 48, 9 48, 10 1630, 11 1630, 12 24
+//     Trace Timer: 0 86400, 1 1630, 2 1630
+//
+// ****************************************************
+static void TraceCountsPrint(const __FlashStringHelper *pszName, const uint16_t *puiCounts, uint8_t uiCount)
+{
+    bool bFirst = true;
+
+    Serial.print(F("Trace "));
+    Serial.print(pszName);
+    Serial.print(F(":"));
+    for (uint8_t i = 0; i < uiCount; i++)
+    {
+        if (puiCounts[i] == 0)
+        {
+            continue;
+        }
+        Serial.print(bFirst ? F(" ") : F(", "));
+        Serial.print(i);
+        Serial.print(F(" "));
+        Serial.print(puiCounts[i]);
+        bFirst = false;
+    }
+    Serial.println();
+}
+
+void TraceCounters::report(void)
+{
+    const TraceCounters::Data_t &counts = gCrossingState.TraceData.Counters;
+
+    for (uint8_t i = 0; i < kTraceMachines; i++)
+    {
+        TraceCountsPrint(TraceName(&kTraceMachineNames[i]), counts.uiEntries[i], kTraceStates);
+    }
+    TraceCountsPrint(F("Pins"), counts.uiPinWrites, kTracePins);
+    TraceCountsPrint(F("Timer"), counts.uiDispatches, MAX_NUMBER_OF_EVENTS);
+}
+
+// ***************************************************
+//
+// TraceRing
+//
+// ****************************************************
+void TraceRing::point(uint8_t uiPoint, uint8_t uiId, uint8_t uiValue)
+{
+    TraceRing::Data_t &ring = gCrossingState.TraceData.Ring;
+    TraceRing::Point_t *pPoint = &ring.Points[ring.uiNext];
+
+    pPoint->uiTime = (uint16_t)millis();
+    pPoint->uiPoint = uiPoint;
+    pPoint->uiId = uiId;
+    pPoint->uiValue = uiValue;
+
+    if (++ring.uiNext == kTraceRingSize)
+    {
+        ring.uiNext = 0;
+        ring.bFull = true;
+    }
+}
+
+// ***************************************************
+//
+// TraceRing::report()
+//
+// The points held, oldest first, one a line:
+//
+//     Trace 41235 enter Down 3
+//     Trace 41235 pin 8 1
+//     Trace 41480 timer 1 1
+//
+// ****************************************************
+void TraceRing::report(void)
+{
+    const TraceRing::Data_t &ring = gCrossingState.TraceData.Ring;
+    uint8_t uiIndex = ring.bFull ? ring.uiNext : 0;
+    uint8_t uiCount = ring.bFull ? kTraceRingSize : ring.uiNext;
+
+    for (uint8_t i = 0; i < uiCount; i++)
+    {
+        const TraceRing::Point_t *pPoint = &ring.Points[uiIndex];
+
+        Serial.print(F("Trace "));
+        Serial.print(pPoint->uiTime);
+        Serial.print(F(" "));
+        Serial.print(TraceName(&kTracePointNames[pPoint->uiPoint]));
+        Serial.print(F(" "));
+        if (pPoint->uiPoint <= kTracePoint_StateEnter)
+        {
+            Serial.print(TraceName(&kTraceMachineNames[pPoint->uiId]));
+        }
+        else
+        {
+            Serial.print(pPoint->uiId);
+        }
+        Serial.print(F(" "));
+        Serial.println(pPoint->uiValue);
+
+        if (++uiIndex == kTraceRingSize)
+        {
+            uiIndex = 0;
+        }
+    }
+}
+
+#endif
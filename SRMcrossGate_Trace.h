@@ -0,0 +1,206 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// Author: C. Hardt
+// Date: 10/21/13
+//
+// ****************************************************
+
+#ifndef SRMcrossGate_Trace_h
+#define SRMcrossGate_Trace_h
+
+#include <inttypes.h>
+#include "Arduino.h"
+#include "Timer.h"
+
+// ***************************************************
+//
+// Tracing
+//
+// The controller has a trace point at:
+//
+//   - every state left and entered, of each of the state machines below,
+//     as SetState() (SRMcrossGate_State.h) makes the change; a state that
+//     is left in the same run it was entered is seen too
+//   - every write of a kPinAddr* pin, GatePinWrite() standing in for
+//     digitalWrite()
+//   - every event the Timer runs (TimerTrace in Timer.h), the flasher
+//     toggles included
+//
+// Where the points go is a policy, the sink, picked when the image is built:
+//
+//     -DSRM_TRACE=TraceCounters   counts of each point
+//     -DSRM_TRACE=TraceRing       the last kTraceRingSize points, in ram
+//     -DSRM_TRACE=TraceVcd        a VCD file (host builds, host/TraceVcd.cpp)
+//
+// The X serial command prints what the sink holds.  A sink is a class with
+// static point() and report() functions, and a Data_t of what it keeps.
+// That lives in gCrossingState (TraceData), such that it is reset, saved
+// and restored with the rest of the controller.  Without SRM_TRACE the sink is
+// TraceOff, for which CrossingTracer<> is empty: each trace point is a call
+// to an empty inline function, GatePinWrite() is digitalWrite(), and the
+// release image is the same, byte for byte, as one without the trace
+// points (see host/TraceBench.cpp).
+//
+// ****************************************************
+const uint8_t kTracePoint_StateExit = 0;      // id is the machine, value the state left
+const uint8_t kTracePoint_StateEnter = 1;     // id is the machine, value the state entered
+const uint8_t kTracePoint_PinWrite = 2;       // id is the pin, value the level
+const uint8_t kTracePoint_TimerDispatch = 3;  // id is the Timer slot, value the EVENT_* type
+const uint8_t kTracePoints = 4;
+
+const uint8_t kTraceMachine_Track = 0;        // iTrackOcupationState
+const uint8_t kTraceMachine_Initialize = 1;   // iGateInitializationState
+const uint8_t kTraceMachine_Gate = 2;         // bGateState
+const uint8_t kTraceMachine_Down = 3;         // iGateMovingDown_State
+const uint8_t kTraceMachine_Up = 4;           // iGateMovingUp_State
+const uint8_t kTraceMachines = 5;
+
+// the most states a machine has (SRMcrossGate_types.h), and the Uno's pins
+const uint8_t kTraceStates = 6;
+const uint8_t kTracePins = 20;
+
+const uint8_t kTraceRingSize = 32;
+
+// the release build, no trace at all
+struct TraceOff
+{
+};
+
+// counts of each point: state entries per machine and state, writes per pin, runs per Timer slot
+struct TraceCounters
+{
+    typedef struct
+    {
+        uint16_t uiEntries[kTraceMachines][kTraceStates];
+        uint16_t uiPinWrites[kTracePins];
+        uint16_t uiDispatches[MAX_NUMBER_OF_EVENTS];
+    } Data_t;
+
+    static void point(uint8_t uiPoint, uint8_t uiId, uint8_t uiValue);
+    static void report(void);
+};
+
+// the last kTraceRingSize points, with the low 16 bits of millis()
+struct TraceRing
+{
+    typedef struct
+    {
+        uint16_t uiTime;
+        uint8_t uiPoint;
+        uint8_t uiId;
+        uint8_t uiValue;
+    } Point_t;
+
+    typedef struct
+    {
+        Point_t Points[kTraceRingSize];
+        uint8_t uiNext;
+        bool bFull;
+    } Data_t;
+
+    static void point(uint8_t uiPoint, uint8_t uiId, uint8_t uiValue);
+    static void report(void);
+};
+
+// host builds only: each machine, pin and Timer slot a signal in a VCD file (host/TraceVcd.cpp)
+struct TraceVcd
+{
+    // the times each Timer slot has run; the file itself is not part of the controller
+    typedef struct
+    {
+        unsigned long ulRuns[MAX_NUMBER_OF_EVENTS];
+    } Data_t;
+
+    static bool open(const char *pszPath);
+    static void close(void);
+    static void point(uint8_t uiPoint, uint8_t uiId, uint8_t uiValue);
+    static void report(void);
+};
+
+// what the sinks keep; a build has the one sink, so they share the space
+typedef union
+{
+    TraceCounters::Data_t Counters;
+    TraceRing::Data_t Ring;
+    TraceVcd::Data_t Vcd;
+} TraceData_t;
+
+// ***************************************************
+//
+// CrossingTracer<Sink>
+//
+// Turns what the controller does into trace points for the sink.
+//
+// ****************************************************
+template <class Sink>
+struct CrossingTracer
+{
+    static inline void pinWrite(uint8_t uiPin, uint8_t uiValue)
+    {
+        Sink::point(kTracePoint_PinWrite, uiPin, uiValue);
+    }
+
+    static inline void timerDispatch(uint8_t uiSlot, int8_t iEventType, uint8_t uiPin, uint8_t uiPinState)
+    {
+        Sink::point(kTracePoint_TimerDispatch, uiSlot, (uint8_t)iEventType);
+
+        // the flashers write their pins inside the Timer
+        if (iEventType == EVENT_OSCILLATE)
+        {
+            Sink::point(kTracePoint_PinWrite, uiPin, uiPinState);
+        }
+    }
+
+    // a machine put back in the state it is in has not moved
+    static inline void state(uint8_t uiMachine, uint8_t uiFrom, uint8_t uiTo)
+    {
+        if ((uiMachine < kTraceMachines) && (uiTo != uiFrom))
+        {
+            Sink::point(kTracePoint_StateExit, uiMachine, uiFrom);
+            Sink::point(kTracePoint_StateEnter, uiMachine, uiTo);
+        }
+    }
+
+    static void report(void)
+    {
+        Sink::report();
+    }
+};
+
+template <>
+struct CrossingTracer<TraceOff>
+{
+    static inline void pinWrite(uint8_t, uint8_t) {}
+    static inline void timerDispatch(uint8_t, int8_t, uint8_t, uint8_t) {}
+    static inline void state(uint8_t, uint8_t, uint8_t) {}
+    static inline void report(void) {}
+};
+
+// SRM_TRACE itself is left undefined in the release build, as Timer.h
+// looks at it to decide whether TimerTrace is ours to define
+#if defined(SRM_TRACE)
+typedef CrossingTracer<SRM_TRACE> CrossingTrace;
+#else
+typedef CrossingTracer<TraceOff> CrossingTrace;
+#endif
+
+// ***************************************************
+//
+// GatePinWrite()
+//
+// digitalWrite() of one of the kPinAddr* pins, with its trace point.
+//
+// ****************************************************
+inline void GatePinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    CrossingTrace::pinWrite(uiPin, uiValue);
+    digitalWrite(uiPin, uiValue);
+}
+
+#endif
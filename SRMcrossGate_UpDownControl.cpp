@@ -16,21 +16,31 @@
 #include "SRMcrossGate_types.h"
 #include "SRMcrossGate_UpDownControl.h"
 #include "SRMcrossGate_Utils.h"
+#include "SRMcrossGate_Power.h"
+#include "SRMcrossGate_History.h"
+#include "SRMcrossGate_Stats.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Trace.h"
+#include "SRMcrossGate_Controller.h"
 
 extern Timer gCrossingGateTimer;
+extern bool gbIdleSleepAllowed;
 
-static unsigned long ulMotorRunningTotalSecondsThisEvent = 0;
-static unsigned long ulMotorRunningStartTimeThisEvent = 0;
+// these live in gCrossingState, such that they are reset along with the rest of the state machine
+static unsigned long &ulMotorRunningTotalSecondsThisEvent = gCrossingState.ulMotorRunningTotalSecondsThisEvent;
+static unsigned long &ulMotorRunningStartTimeThisEvent = gCrossingState.ulMotorRunningStartTimeThisEvent;
 static unsigned long ulMotorRunningTotalSeconds = 0;
 
-static unsigned long gulGateDownStateDelayTime = 0;
+#if !defined(GATE_COROUTINES)
+static unsigned long &gulGateDownStateDelayTime = gCrossingState.ulGateDownStateDelayTime;
 static unsigned long gulGateDownStateDelayTimeEventStart = 0;
 
-static unsigned long gulGateUpStateDelayTime = 0;
-static unsigned long gulGateUpStateDelayTimeEventStart = 0;
+static unsigned long &gulGateUpStateDelayTime = gCrossingState.ulGateUpStateDelayTime;
+static unsigned long &gulGateUpStateDelayTimeEventStart = gCrossingState.ulGateUpStateDelayTimeEventStart;
 
 static int giGateDownStateAfterDelay = kGateMovingDown_State_LightsAndBells;
 static int giGateUpStateAfterDelay = kGateMovingUp_State_Debouce;
+#endif
 
 // ***************************************************
 //
@@ -50,13 +60,13 @@ void InitializeTheGateTurnOnLightsBellsAndUpRelay(int *piWarningLightTimerRightI
      *piWarningLightTimerLeftID = WarningLightTimerStart(kPinAddrGateLightsControlLeft, 500, LOW, -1);
                          
      // Turn on the signal warning bell
-     digitalWrite(kPinAddrGateBellControl, kWarningBellOn);
+     GatePinWrite(kPinAddrGateBellControl, kWarningBellOn);
         
      // Before we turn on power to the motor, we want to make sure we set the direction of the motor 
-     digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp);
+     GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp);
 
      // change the state before we exit
-     *piInitializationState = kGateInitalize_MotorDirectionDelay;
+     SetState(*piInitializationState, kGateInitalize_MotorDirectionDelay);
         
      return;
         
@@ -74,7 +84,7 @@ void InitializeTheGateTurnOnLightsBellsAndUpRelay(int *piWarningLightTimerRightI
 void InitializeMotorDirectionDelayState(int *piGateDownState)
                                     
 {
-    static unsigned long ulDelayStartTime = 0;
+    unsigned long &ulDelayStartTime = gCrossingState.ulInitializeDelayStartTime;
     unsigned long ulTimeSpentInSequence;
     
     // we want to record/save our start time and will use it later to calculate elapsed time.
@@ -89,9 +99,13 @@ void InitializeMotorDirectionDelayState(int *piGateDownState)
     // We do not want to advance to the next state until we have spent the perscribed time in our delay.
     if (ulTimeSpentInSequence >= kOneSecond)
     {
-        *piGateDownState = kGateInitalize_MotorOn;
+        SetState(*piGateDownState, kGateInitalize_MotorOn);
         ulDelayStartTime = 0;
     }
+    else
+    {
+        ControllerWaitUntil(kControllerEvent_Deadline, ulDelayStartTime + kOneSecond);
+    }
  
     return;  
   
@@ -107,11 +121,11 @@ void InitializeMotorDirectionDelayState(int *piGateDownState)
 // ****************************************************
 void InitializeTheGateTurnOnUpMotor(unsigned long ulStartTime, int *piInitializationState, bool *pbMotorRunning)
 {
-     static bool bPrintFlag = false;
+     bool &bPrintFlag = gCrossingState.bInitializePrintFlag;
      unsigned long ulGateEventElapsedTime;
   
      // Turn on the motor 
-     digitalWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
+     GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
 
      // calculate the elapsed time.
      ulGateEventElapsedTime = millis() - ulStartTime;  
@@ -119,8 +133,12 @@ void InitializeTheGateTurnOnUpMotor(unsigned long ulStartTime, int *piInitializa
      // We have to allow the gate time to rise back up.  Once we hit the target, change state
      if (ulGateEventElapsedTime >= kTenSeconds) 
      {
-        *piInitializationState = kGateInitalize_MotorOff; 
+        SetState(*piInitializationState, kGateInitalize_MotorOff); 
      }  
+     else
+     {
+        ControllerWaitUntil(kControllerEvent_Deadline, ulStartTime + kTenSeconds);
+     }
 
      // we only want print this message one.
      if (bPrintFlag = false)
@@ -153,24 +171,26 @@ void InitializeTheGateTurnOffUpMotor(int iWarningLightTimerRightID, int iWarning
       gCrossingGateTimer.stop(iWarningLightTimerRightID);
       gCrossingGateTimer.stop(iWarningLightTimerLeftID);
       
-      // clear the timer IDs, such that they are never used again
+      // clear the timer IDs, 0 is never a Timer handle so a stray stop() is refused
       iWarningLightTimerRightID = 0;
       iWarningLightTimerLeftID  = 0;
       
       // While we just stopped the lights, we need to make sure they are in the off state
-      digitalWrite(kPinAddrGateLightsControlLeft, kWarningLightsOff);
-      digitalWrite(kPinAddrGateLightsControlRight, kWarningLightsOff);
+      GatePinWrite(kPinAddrGateLightsControlLeft, kWarningLightsOff);
+      GatePinWrite(kPinAddrGateLightsControlRight, kWarningLightsOff);
       
       // Shut off the warning bell
-      digitalWrite(kPinAddrGateBellControl, kWarningBellOff);
+      GatePinWrite(kPinAddrGateBellControl, kWarningBellOff);
       
-      // this turns OFF power to the gate are motor
-      digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);  
-      digitalWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
+      // this turns OFF power to the gate are motor.  The power has to go first, if the direction
+      // relay drops out while the motor still has power, it is driven the other way.
+      GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
+      GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);  
   
       // log the total motor run time.  We need this, as the motor has a 10% duty cycle
       ulMotorRunningTotalSecondsThisEvent = millis() - ulMotorRunningStartTimeThisEvent; 
       *pulMotorRunningTotalSeconds = *pulMotorRunningTotalSeconds + ulMotorRunningTotalSecondsThisEvent;
+      HistoryRecordMotorRun(ulMotorRunningTotalSecondsThisEvent);
   
       Serial.println("Gate Is Up");
   
@@ -198,7 +218,7 @@ void GateDownInactiveState(          int *piTrackOcupationState,
                            unsigned long *pulGateDownStateDelayBeforeGateUpEventStartTime,
                                     bool *pbDutyCycleExceededFlag)
 {
-      static unsigned long ulPrintOutCount = 0;
+      unsigned long &ulPrintOutCount = gCrossingState.ulGateDownInactivePrintOutCount;
   
       // need to convert the CPU clock time into a down gate reference time 
       *pulGateDownEventTotalElapsedTime = millis() - *pulGateDownStateDelayBeforeGateUpEventStartTime;
@@ -207,15 +227,22 @@ void GateDownInactiveState(          int *piTrackOcupationState,
       // sequence and just reset the state machine.
       if (*pbDutyCycleExceededFlag == true)
       {
-          *piTrackOcupationState = kTrackVacant;
+          SetState(*piTrackOcupationState, kTrackVacant);
+          HistoryRecordOccupancyEnd();
+          StatsRecordOccupancyEnd();
           *pulGateDownEventTotalElapsedTime = 0;
           *pulGateDownEventElapsedStartTime = 0;
           
-          *piGateUpState = kGateMovingUp_State_MotorOnDelay;
+          SetState(*piGateUpState, kGateMovingUp_State_MotorOnDelay);
           
+#if defined(GATE_COROUTINES)
+          // the up sequence's wait runs twenty seconds while this flag is set (SRMcrossGate_Sequences.cpp)
+          gCrossingState.ulGateUpWaitStartTime = millis();
+#else
           gulGateUpStateDelayTime = kTwentySeconds;
           gulGateUpStateDelayTimeEventStart = millis();
           giGateUpStateAfterDelay = kGateMovingUp_State_MotorOff;
+#endif
           
       }  
       
@@ -225,7 +252,9 @@ void GateDownInactiveState(          int *piTrackOcupationState,
       {
           //Serial.print("Max elapsed Time Reached: ");
           //Serial.println(*pulGateDownEventTotalElapsedTime); 
-          *piTrackOcupationState = kTrackVacant;
+          SetState(*piTrackOcupationState, kTrackVacant);
+          HistoryRecordOccupancyEnd();
+          StatsRecordOccupancyEnd();
           *pulGateDownEventTotalElapsedTime = 0;
           *pulGateDownEventElapsedStartTime  = 0;
       }
@@ -236,12 +265,17 @@ void GateDownInactiveState(          int *piTrackOcupationState,
                Serial.print("Time Remaining Before Gate Lift: ");
                Serial.println(kMaxGateDownTimelimitReached - *pulGateDownEventTotalElapsedTime);
            }    
+           
+           // a train still on the sensor pushes this out again, each time we look
+           ControllerWaitUntil(kControllerEvent_Deadline, *pulGateDownStateDelayBeforeGateUpEventStartTime + kMaxGateDownTimelimitReached);
       }  
   
     return;  
   
 }  // endof  GateDownInactiveState() 
 
+#if !defined(GATE_COROUTINES)
+
 // ***************************************************
 //
 // GateDownLightsBellsAndMotorDirectionState()
@@ -270,13 +304,15 @@ void GateDownLightsBellsAndMotorDirectionState(unsigned long ulGateDownEventStar
        *piWarningLightTimerLeftID = WarningLightTimerStart(kPinAddrGateLightsControlLeft, 500, LOW, -1);
        
        // Turn on the signal warning bell
-       digitalWrite(kPinAddrGateBellControl, kWarningBellOn);
+       GatePinWrite(kPinAddrGateBellControl, kWarningBellOn);
       
        Serial.println("Lights & Bells: On");
+       IdleSleepReportWakeLatency();
+       StatsRecordLightsOn();
       
        // At this point in the sequence we want to setup the motor direction.
        // Such that when we apply power to the motor, the direction control relay is already in position
-       digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
+       GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
        
        Serial.println("Motor Direction: Down");
       
@@ -284,7 +320,7 @@ void GateDownLightsBellsAndMotorDirectionState(unsigned long ulGateDownEventStar
        *pulGateUpEventTimeSpentInSequence = 0;
        
        // advance to the next state
-       *piGateDownState = kGateMovingDown_State_LightsAndBellsDelay;
+       SetState(*piGateDownState, kGateMovingDown_State_LightsAndBellsDelay);
        
        // setup our delay and state after the delay
        gulGateUpStateDelayTimeEventStart = millis();
@@ -311,10 +347,14 @@ void GateDownWarningLightsAndBellDelayState(int *piGateDownState)
     ulGateDownEventTimeSpentInSequence = millis() - gulGateUpStateDelayTimeEventStart;
     
     // We do not want to advance to the next state until we have spent the perscribed time in our delay.
-    if (ulGateDownEventTimeSpentInSequence >= kThreeSeconds)
+    if (ulGateDownEventTimeSpentInSequence >= kGateWarningLeadTime)
     {
         //Serial.println("Down Delay Max Time Reached"); 
-        *piGateDownState = kGateMovingDown_State_MotorOn;
+        SetState(*piGateDownState, kGateMovingDown_State_MotorOn);
+    }
+    else
+    {
+        ControllerWaitUntil(kControllerEvent_Deadline, gulGateUpStateDelayTimeEventStart + kGateWarningLeadTime);
     }
  
     return;  
@@ -342,8 +382,8 @@ void GateDownMotorOnState(unsigned long ulGateDownEventStartTime,
     { 
         // We are going to set the direction of the gate (up or down) and turn on the motor
         // However we already set the direction when we turn the lights on.  
-        digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
-        digitalWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
+        GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
+        GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
        
         // We only want to print this message once
         if(*pbMotorOnFlag == false)
@@ -356,7 +396,7 @@ void GateDownMotorOnState(unsigned long ulGateDownEventStartTime,
             *pbMotorRunning = true;
         }
     
-        gulGateDownStateDelayTime = kThirteenSeconds;
+        gulGateDownStateDelayTime = kGateMotorRunTime;
         gulGateUpStateDelayTimeEventStart = millis();
     
     }
@@ -367,6 +407,7 @@ void GateDownMotorOnState(unsigned long ulGateDownEventStartTime,
          {
              Serial.print("Motor Max Duty Cycle, Ignoring Motor On Cmd: ");
              Serial.println(*pulMotorRunningTotalSeconds); 
+             HistoryRecordDutyCycleTrip(*pulMotorRunningTotalSeconds);
          }
          
          *pbDutyCycleExceededFlag = true;
@@ -376,7 +417,7 @@ void GateDownMotorOnState(unsigned long ulGateDownEventStartTime,
     }  
 
     // setup the next state 
-    *piGateDownState = kGateMovingDown_State_MotorOnDelay;
+    SetState(*piGateDownState, kGateMovingDown_State_MotorOnDelay);
  
     return;  
   
@@ -402,13 +443,19 @@ void GateDownMotorOnDelay(int *piGateDownState)
     if (ulGateDownEventTimeSpentInSequence >= gulGateDownStateDelayTime)
     {
         //Serial.println("Down Delay Max Time Reached"); 
-        *piGateDownState = kGateMovingDown_State_MotorOff;
+        SetState(*piGateDownState, kGateMovingDown_State_MotorOff);
+    }
+    else
+    {
+        ControllerWaitUntil(kControllerEvent_Deadline, gulGateUpStateDelayTimeEventStart + gulGateDownStateDelayTime);
     }
  
     return;  
   
 }  // endof  GateDownMotorOnDelay() 
 
+#endif
+
 // ***************************************************
 //
 // GateDownMotorOffState()
@@ -439,10 +486,11 @@ void GateDownMotorOffState(unsigned long ulGateDownEventStartTime,
     }
     
     // Shut off the gate motor
-    digitalWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
-    digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
+    GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
+    GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);
     
-    *pbGateState = kGateInDownPosition;
+    SetState(*pbGateState, kGateInDownPosition);
+    HistoryRecordGateDown();
     *pbMotorOnFlag = false;
     *pbMotorOffFlag = false;
     
@@ -452,12 +500,14 @@ void GateDownMotorOffState(unsigned long ulGateDownEventStartTime,
         // log the total motor run time.  We need this, as the motor has a 10% duty cycle
         ulMotorRunningTotalSecondsThisEvent = millis() - ulMotorRunningStartTimeThisEvent; 
         *pulMotorRunningTotalSeconds = *pulMotorRunningTotalSeconds + ulMotorRunningTotalSecondsThisEvent;
+        HistoryRecordMotorRun(ulMotorRunningTotalSecondsThisEvent);
+        StatsRecordMotorRun(ulMotorRunningTotalSecondsThisEvent);
         
         *pbDutyCycleExceededFlag == false;
     }
         
     // reset the state machine to the default state
-    *piGateDownState = kGateMovingDown_State_LightsAndBells;
+    SetState(*piGateDownState, kGateMovingDown_State_LightsAndBells);
      
     // set the flag that the motor is not running
     *pbMotorRunning = false;
@@ -475,13 +525,25 @@ void GateDownMotorOffState(unsigned long ulGateDownEventStartTime,
 //
 // This function is called whenever the gate is up, and the track is 
 // vacant.  We use it to keep track of the motor on duty cycle.
+// Once the motor has fully cooled down and the history and statistics have
+// been written out, there is nothing left for us to do until the next train, so we
+// allow the processor to go to sleep.
 //
 // ****************************************************
-void GateUpInactiveState(void)
+void GateUpInactiveState(unsigned long ulMotorRunningTotalSeconds)
 {
+    gbIdleSleepAllowed = (ulMotorRunningTotalSeconds == 0) && (HistoryPending() == false) && (StatsPending() == false);
+    
+    // MotorDutyCycleCalcuate() takes a second of run time off for every 10 ms the motor is off
+    if (ulMotorRunningTotalSeconds != 0)
+    {
+        ControllerWaitUntil(kControllerEvent_DutyRecovered, millis() + ulMotorRunningTotalSeconds * 10);
+    }
  
 }  // GateUpInactiveState()
 
+#if !defined(GATE_COROUTINES)
+
 // ***************************************************
 //
 // GateUpDebouceState()
@@ -510,7 +572,7 @@ void GateUpDebouceState(unsigned long *pulGateUpEventTimeSpentInSequence,
       }
  
     // reset the state machine to the default state
-    *piGateUpState = kGateMovingUp_State_MotorDirection;
+    SetState(*piGateUpState, kGateMovingUp_State_MotorDirection);
      
     return;  
   
@@ -529,7 +591,7 @@ void GateUpMotorDirectionState(unsigned long *pulGateUpEventStartTime,
                                          int *piGateUpState)
 {
     // Before we turn on power to the motor, we want to make sure we set the direction of the motor 
-    digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp);
+    GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp);
         
     // we only want to print the Motor direction once
     if (*pbMotorDirectionFlag == false)
@@ -539,7 +601,7 @@ void GateUpMotorDirectionState(unsigned long *pulGateUpEventStartTime,
     }       
     
     // setup our next state
-    *piGateUpState = kGateMovingUp_State_MotorDirectionDelay;
+    SetState(*piGateUpState, kGateMovingUp_State_MotorDirectionDelay);
     
     // since we need to delay, setup the delay, and the state after the delay
     gulGateUpStateDelayTimeEventStart = millis();
@@ -567,8 +629,12 @@ void GateUpMotorDirectionDelayState(int *piGateUpState)
     if (ulGateUpEventTimeSpentInSequence >= kOneSecond)
     {
         //Serial.println("Motor Direction Delay Complete");
-        *piGateUpState = kGateMovingUp_State_MotorOn;  
+        SetState(*piGateUpState, kGateMovingUp_State_MotorOn);  
     }  
+    else
+    {
+        ControllerWaitUntil(kControllerEvent_Deadline, gulGateUpStateDelayTimeEventStart + kOneSecond);
+    }
  
     return;  
   
@@ -590,8 +656,8 @@ void GateUpMotorOnState(unsigned long *pulGateUpEventStartTime,
 {
  
     // this turns power ON to the UP gate motor 
-    digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp); 
-    digitalWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
+    GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorUp); 
+    GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOn);
     
     // we only want to print the Motor direction once
     if (*pbMotorOnFlag == false)
@@ -608,10 +674,10 @@ void GateUpMotorOnState(unsigned long *pulGateUpEventStartTime,
     *pbMotorRunning = true;
 
     // setup our next state
-    *piGateUpState = kGateMovingUp_State_MotorOnDelay;
+    SetState(*piGateUpState, kGateMovingUp_State_MotorOnDelay);
     
     // since we need to delay, setup the delay, and the state after the delay
-    gulGateUpStateDelayTime = kThirteenSeconds;
+    gulGateUpStateDelayTime = kGateMotorRunTime;
     gulGateUpStateDelayTimeEventStart = millis();
  
     return;  
@@ -636,14 +702,20 @@ void GateUpMotorOnDelayState(int *piGateUpState)
     // We need to allow time for the gate to be raised.
     if (ulGateUpEventTimeSpentInSequence >= gulGateUpStateDelayTime)
     {
-        *piGateUpState = kGateMovingUp_State_MotorOff;  
+        SetState(*piGateUpState, kGateMovingUp_State_MotorOff);  
     }  
+    else
+    {
+        ControllerWaitUntil(kControllerEvent_Deadline, gulGateUpStateDelayTimeEventStart + gulGateUpStateDelayTime);
+    }
  
     return;  
   
 }  // endof  GateUpMotorOnDelayState() 
 
 
+#endif
+
 // ***************************************************
 //
 // GateUpMotorOffState()
@@ -672,20 +744,21 @@ void GateUpMotorOffState(unsigned long *pulGateUpEventStartTime,
         gCrossingGateTimer.stop(*piWarningLightTimerRightID);
         gCrossingGateTimer.stop(*piWarningLightTimerLeftID);
         
-        // clear the timer IDs, such that they are never used again
+        // clear the timer IDs, 0 is never a Timer handle so a stray stop() is refused
         *piWarningLightTimerRightID = 0;
         *piWarningLightTimerLeftID  = 0;
         
         // While we just stopped the lights, we need to make sure they are in the off state
-        digitalWrite(kPinAddrGateLightsControlLeft, kWarningLightsOff);
-        digitalWrite(kPinAddrGateLightsControlRight, kWarningLightsOff);
+        GatePinWrite(kPinAddrGateLightsControlLeft, kWarningLightsOff);
+        GatePinWrite(kPinAddrGateLightsControlRight, kWarningLightsOff);
         
         // Shut off the warning bell
-        digitalWrite(kPinAddrGateBellControl, kWarningBellOff);
+        GatePinWrite(kPinAddrGateBellControl, kWarningBellOff);
         
-        // this turns OFF power to the gate are motor
-        digitalWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);  
-        digitalWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
+        // this turns OFF power to the gate are motor.  The power has to go first, if the direction
+        // relay drops out while the motor still has power, it is driven the other way.
+        GatePinWrite(kPinAddrGateArmControlMotorPower, kGateArmControlMotorOff);
+        GatePinWrite(kPinAddrGateArmControlMotorDirection, kGateArmControlMotorDown);  
          
         Serial.println("Motor: Off");
         Serial.println("Bell/Lights: Off");
@@ -701,6 +774,8 @@ void GateUpMotorOffState(unsigned long *pulGateUpEventStartTime,
             // log the total motor run time.  We need this, as the motor has a 10% duty cycle
             ulMotorRunningTotalSecondsThisEvent = millis() - ulMotorRunningStartTimeThisEvent; 
             *pulMotorRunningTotalSeconds = *pulMotorRunningTotalSeconds + ulMotorRunningTotalSecondsThisEvent;
+            HistoryRecordMotorRun(ulMotorRunningTotalSecondsThisEvent);
+            StatsRecordMotorRun(ulMotorRunningTotalSecondsThisEvent);
         
             Serial.print("Total Motor Run Time: ");
             Serial.println(*pulMotorRunningTotalSeconds); 
@@ -711,15 +786,18 @@ void GateUpMotorOffState(unsigned long *pulGateUpEventStartTime,
           
         }  
         
+        // the lights and bell are off, the closure is over
+        StatsRecordLightsOff();
+        
         // set the flag that the motor is not running
         *pbMotorRunning = false;
 
     } 
     
-    *pbGateState = kGateInTheUpPosition;
+    SetState(*pbGateState, kGateInTheUpPosition);
     
     // reset the state machine to the default state
-    *piGateUpState = kGateMovingUp_State_Debouce;
+    SetState(*piGateUpState, kGateMovingUp_State_Debouce);
 
     return;  
   
@@ -147,9 +147,11 @@ void GateDownMotorOffState(unsigned long ulGateDownEventStartTime,
 //
 // This function is called whenever the gate is up, and the track is 
 // vacant.  We use it to keep track of the motor on duty cycle.
+// Once the motor has fully cooled down, there is nothing left for us to do
+// until the next train, so we allow the processor to go to sleep.
 //
 // ****************************************************
-void GateUpInactiveState(void);
+void GateUpInactiveState(unsigned long ulMotorRunningTotalSeconds);
 
 // ***************************************************
 //
@@ -16,6 +16,12 @@
 #include "SRMcrossGate_types.h"
 #include "SRMcrossGate_UpDownControl.h"
 #include "SRMcrossGate_Utils.h"
+#include "SRMcrossGate_History.h"
+#include "SRMcrossGate_Stats.h"
+#include "SRMcrossGate_Stack.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Trace.h"
+#include "SRMcrossGate_Controller.h"
 
 extern Timer gCrossingGateTimer;
 extern bool  bMotorRunning;
@@ -36,9 +42,9 @@ extern unsigned long giGateUpStateAfterDelay;
 int ReadTrackSensorAndDebouce()
 {
     int iCurrentTrackOcupationState;
-    static int iPreviousTrackOcupationState = kTrackVacant;
-    static unsigned long ulSensorChangeStartTime = 0;
-    static unsigned long ulElapsedTime = 0;
+    int &iPreviousTrackOcupationState = gCrossingState.iPreviousTrackOcupationState;
+    unsigned long &ulSensorChangeStartTime = gCrossingState.ulSensorChangeStartTime;
+    unsigned long ulElapsedTime = 0;
   
     // read in the track state (is it Occupided or Vacant)
     iCurrentTrackOcupationState = digitalRead(kPinAddrGateTrackSensor);
@@ -58,9 +64,14 @@ int ReadTrackSensorAndDebouce()
          
          // calculate the elapsed time (current time - start time)
          ulElapsedTime = millis() - ulSensorChangeStartTime;
-         if (ulElapsedTime >= 500)
+         if (ulElapsedTime >= kTrackSensorDebounceTime)
          {
               iPreviousTrackOcupationState = iCurrentTrackOcupationState;
+
+              // the next change starts its own debounce.  On the 250 ms tick the next
+              // poll always cleared this, but an event driven run may not come until
+              // the sensor has moved again.
+              ulSensorChangeStartTime = 0;
               //Serial.print("tate Change -- Debouce Completed - ");
               //Serial.println(millis()); 
               
@@ -68,17 +79,18 @@ int ReadTrackSensorAndDebouce()
               if (iCurrentTrackOcupationState == kTrackOccupied)
               {
                  Serial.println("Detected");
-                 digitalWrite(kPinAddrGateStatusLED, kStatusLEDon);
+                 GatePinWrite(kPinAddrGateStatusLED, kStatusLEDon);
               }
               else
               {
                  Serial.println("Cleared");
-                 digitalWrite(kPinAddrGateStatusLED, kStatusLEDoff);
+                 GatePinWrite(kPinAddrGateStatusLED, kStatusLEDoff);
               }
          }
          else
          {
               iCurrentTrackOcupationState = iPreviousTrackOcupationState;
+              ControllerWaitUntil(kControllerEvent_SensorChange, ulSensorChangeStartTime + kTrackSensorDebounceTime);
          }  
          
     }
@@ -94,6 +106,39 @@ int ReadTrackSensorAndDebouce()
         
 }  //endof ReadTrackSensorAndDebouce()
 
+// ***************************************************
+//
+// RecordSensorTrace()
+//
+// This function is called on every pass of loop().  When kRecordSensorTrace
+// is set, it prints each change of the raw track sensor level, such that we
+// can replay it later.  The debounce only looks at the sensor when the
+// controller runs, which would round the times to its runs and miss chatter
+// between them.
+//
+// ****************************************************
+void RecordSensorTrace()
+{
+    int &iPreviousSensorLevel = gCrossingState.iPreviousSensorLevel;
+    int iSensorLevel;
+
+    if (kRecordSensorTrace == false)
+    {
+        return;
+    }
+
+    iSensorLevel = digitalRead(kPinAddrGateTrackSensor);
+    if (iSensorLevel != iPreviousSensorLevel)
+    {
+        Serial.print(F("TS "));
+        Serial.print(millis());
+        Serial.print(F(" "));
+        Serial.println(iSensorLevel);
+        iPreviousSensorLevel = iSensorLevel;
+    }
+
+}  //endof RecordSensorTrace()
+
 // *****************************************************************************************
 //
 // ResetStateMachineIfNeeded()
@@ -131,10 +176,14 @@ void ResetStateMachineIfNeeded(int *piTrackState,
         // we need to reset the state machine.
         if (*piTrackOcupationState == kTrackVacant)
         {
-            *piTrackOcupationState = kTrackOccupied;
+            SetState(*piTrackOcupationState, kTrackOccupied);
+            HistoryRecordOccupancyStart();
+            StatsRecordOccupancyStart();
               
-            // if we were raising the gate, we need to reset the motor duty cycle counter  
-            if ((*pbGateState == kGateInDownPosition) && (*piGateUpState == kGateMovingUp_State_MotorOnDelay))
+            // if we were raising the gate, we need to reset the motor duty cycle counter.  The motor
+            // is still running in the MotorOff state, it is only switched off on the next tick.
+            if ((*pbGateState == kGateInDownPosition) && 
+                ((*piGateUpState == kGateMovingUp_State_MotorOnDelay) || (*piGateUpState == kGateMovingUp_State_MotorOff)))
             {
                 // we are going to reset the motor duty cylce timer, as we need to close the gate
                 if ((*pulMotorRunningTotalSeconds > kMaxDutyCycleLimitReached) && (*pbDutyCycleExceededFlag != true))
@@ -158,9 +207,9 @@ void ResetStateMachineIfNeeded(int *piTrackState,
                                     pbDutyCycleExceededFlag);
                   
                 // reset the state machine, such that we start over.  
-                *pbGateState = kGateInTheUpPosition;
-                *piGateDownState = kGateMovingDown_State_LightsAndBells;
-                *piGateUpState = kGateMovingUp_State_Debouce;
+                SetState(*pbGateState, kGateInTheUpPosition);
+                SetState(*piGateDownState, kGateMovingDown_State_LightsAndBells);
+                SetState(*piGateUpState, kGateMovingUp_State_Debouce);
                 
                 *pulGateDownEventStartTime = 0;
                 *pulGateDownEventTotalElapsedTime = 0;
@@ -216,6 +265,11 @@ int WarningLightTimerStart(uint8_t uiArduinoPin, unsigned long ulTimerPeriod, ui
           Serial.println(uiArduinoPin);
             
      }
+     else
+     {
+          // the flashers are in the safety class already, this only sets what they may take
+          gCrossingGateTimer.setBudget(iTimerIDnumber, kWarningLightBudget);
+     }
         
      return iTimerIDnumber;
         
@@ -232,10 +286,10 @@ int WarningLightTimerStart(uint8_t uiArduinoPin, unsigned long ulTimerPeriod, ui
 // ****************************************************
 void MotorDutyCycleCalcuate(bool *pbMotorRunning, unsigned long *pulMotorRunningTotalSeconds)
 {
-    static unsigned long ulPreviousTimeStamp = 0;
-    static unsigned long ulCurrentTimeStamp = 0;
+    unsigned long &ulPreviousTimeStamp = gCrossingState.ulDutyCyclePreviousTimeStamp;
+    unsigned long ulCurrentTimeStamp = 0;
     unsigned long ulTimeDifference = 0;
-    static unsigned long ulPrintOutCount = 0;
+    unsigned long &ulPrintOutCount = gCrossingState.ulDutyCyclePrintOutCount;
     unsigned long ulPreviousMotorRunningSeconds = 0;
   
     ulPreviousMotorRunningSeconds = *pulMotorRunningTotalSeconds;
@@ -250,7 +304,8 @@ void MotorDutyCycleCalcuate(bool *pbMotorRunning, unsigned long *pulMotorRunning
         {
             *pulMotorRunningTotalSeconds = *pulMotorRunningTotalSeconds - ulTimeDifference / 10;
             
-            if (ulPrintOutCount++ % 5 == 0)
+            // runs can be closer together than 10 ms now, and then nothing has cooled
+            if ((ulPreviousMotorRunningSeconds != *pulMotorRunningTotalSeconds) && (ulPrintOutCount++ % 5 == 0))
             { 
                 Serial.print("Motor Cooling Down, Remaining Seconds: ");
                 Serial.println(*pulMotorRunningTotalSeconds / ((ulPreviousMotorRunningSeconds - *pulMotorRunningTotalSeconds) * 4));
@@ -266,4 +321,81 @@ void MotorDutyCycleCalcuate(bool *pbMotorRunning, unsigned long *pulMotorRunning
     ulPreviousTimeStamp = ulCurrentTimeStamp;
 
 } // MotorDutyCycleCalcuate()
+
+// ***************************************************
+//
+// ProcessSerialCommand()
+//
+// This function is called from loop().  It checks the serial port for
+// a maintenance command:
+//
+//     H - dump the EEPROM history
+//     S - print the stack and SRAM use
+//     T - print the Timer classes, budgets, worst times and overruns
+//     E - print the controller's runs and the events behind them
+//     P - print the p50, p95 and p99 of the closure times
+//     X - print the trace (trace builds only, SRMcrossGate_Trace.h)
+//
+// While the crossing is idle the processor is powered down, and the
+// character that wakes it is lost, so send the command again within
+// kIdleSerialWakeTime (SRMcrossGate_Power.cpp).
+//
+// ****************************************************
+void ProcessSerialCommand(void)
+{
+    int iCommand;
+
+    if (Serial.available() == 0)
+    {
+        return;
+    }
+
+    iCommand = Serial.read();
+
+    switch (iCommand)
+    {
+        case 'H':
+        case 'h':
+
+            HistoryDump();
+            break;
+
+        case 'S':
+        case 's':
+
+            StackReport();
+            break;
+
+        case 'T':
+        case 't':
+
+            gCrossingGateTimer.printBudgets();
+            break;
+
+        case 'E':
+        case 'e':
+
+            ControllerReport();
+            break;
+
+        case 'P':
+        case 'p':
+
+            StatsReport();
+            break;
+
+#if defined(SRM_TRACE)
+        case 'X':
+        case 'x':
+
+            CrossingTrace::report();
+            break;
+#endif
+
+        default:
+
+            break;
+    }
+
+}  // ProcessSerialCommand()
       
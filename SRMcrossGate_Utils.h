@@ -25,6 +25,17 @@
 // ****************************************************
 int ReadTrackSensorAndDebouce();
 
+// ***************************************************
+//
+// RecordSensorTrace()
+//
+// This function prints each change of the raw track sensor level, as a
+// "TS <millis> <level>" line, when kRecordSensorTrace is set.  It is
+// called on every pass of loop().
+//
+// ****************************************************
+void RecordSensorTrace();
+
 // *****************************************************************************************
 //
 // ResetStateMachineIfNeeded()
@@ -74,4 +85,25 @@ int WarningLightTimerStart(uint8_t uiArduinoPin, unsigned long ulTimerPeriod, ui
 // ****************************************************
 void MotorDutyCycleCalcuate(bool *pbMotorRunning, unsigned long *pulMotorRunningTotalSeconds);
 
+// ***************************************************
+//
+// ProcessSerialCommand()
+//
+// This function is called from loop().  It checks the serial port for
+// a maintenance command:
+//
+//     H - dump the EEPROM history
+//     S - print the stack and SRAM use
+//     T - print the Timer classes, budgets, worst times and overruns
+//     E - print the controller's runs and the events behind them
+//     P - print the p50, p95 and p99 of the closure times
+//     X - print the trace (trace builds only, SRMcrossGate_Trace.h)
+//
+// While the crossing is idle the processor is powered down, and the
+// character that wakes it is lost, so send the command again within
+// kIdleSerialWakeTime (SRMcrossGate_Power.cpp).
+//
+// ****************************************************
+void ProcessSerialCommand(void);
+
 #endif
@@ -14,6 +14,9 @@
 #ifndef SRMcrossGate_Types_h
 #define SRMcrossGate_Types_h
 
+#include "SRMcrossGate_Profile.h"
+#include "SRMcrossGate_Timing.h"
+
 const bool kGateInDownPosition = 1;
 const bool kGateInTheUpPosition = 0;
 
@@ -46,17 +49,18 @@ const int kGateMovingUp_State_MotorOn = 3;
 const int kGateMovingUp_State_MotorOnDelay = 4;
 const int kGateMovingUp_State_MotorOff = 5;
 
-const int kPinAddrGateBellControl = 12;
-const int kPinAddrGateLightsControlRight = 11;
-const int kPinAddrGateLightsControlLeft = 10;
-const int kPinAddrGateArmControlMotorDirection = 9;
-const int kPinAddrGateArmControlMotorPower = 8;
-const int kPinAddrGateStatusLED = 3;
-const int kPinAddrGateTrackSensor = 2;
+// the pins, and the levels below, are the crossing profile's (SRMcrossGate_Profile.h)
+const int kPinAddrGateBellControl = CrossingProfile::kPinAddrGateBellControl;
+const int kPinAddrGateLightsControlRight = CrossingProfile::kPinAddrGateLightsControlRight;
+const int kPinAddrGateLightsControlLeft = CrossingProfile::kPinAddrGateLightsControlLeft;
+const int kPinAddrGateArmControlMotorDirection = CrossingProfile::kPinAddrGateArmControlMotorDirection;
+const int kPinAddrGateArmControlMotorPower = CrossingProfile::kPinAddrGateArmControlMotorPower;
+const int kPinAddrGateStatusLED = CrossingProfile::kPinAddrGateStatusLED;
+const int kPinAddrGateTrackSensor = CrossingProfile::kPinAddrGateTrackSensor;
 
 //const unsigned long kMaxTrackOccupiedFaultCount = 20000;
 //const unsigned long kMinTimeTrackMustBeVacantToClearFault = 20000;
-const unsigned long kMaxGateDownTimelimitReached = 20000;
+// the gate down time limit and the motor duty cycle limit are in SRMcrossGate_Timing.h
 
 const unsigned long kZeroSeconds = 0;
 const unsigned long kOneSecond = 1000;
@@ -70,22 +74,40 @@ const unsigned long kTwentySeconds = 20000;
 const unsigned long kThirtySeconds = 30000;
 
 
-const bool kWarningBellOn = 0;
-const bool kWarningBellOff = 1;
+const bool kWarningBellOn = CrossingProfile::kWarningBellOn;
+const bool kWarningBellOff = !kWarningBellOn;
+
+const bool kWarningLightsOn = CrossingProfile::kWarningLightsOn;
+const bool kWarningLightsOff = !kWarningLightsOn;
+
+const bool kGateArmControlMotorOn = CrossingProfile::kGateArmControlMotorOn;
+const bool kGateArmControlMotorOff = !kGateArmControlMotorOn;
+
+const bool kGateArmControlMotorUp = CrossingProfile::kGateArmControlMotorUp;
+const bool kGateArmControlMotorDown = !kGateArmControlMotorUp;
 
-const bool kWarningLightsOn = 0;
-const bool kWarningLightsOff = 1;
+const bool kStatusLEDon = CrossingProfile::kStatusLEDon;
+const bool kStatusLEDoff = !kStatusLEDon;
 
-const bool kGateArmControlMotorOn = 1;
-const bool kGateArmControlMotorOff = 0;
+// When set, every change of the raw track sensor level is printed as a "TS <millis> <level>"
+// line.  A serial capture of these lines can be replayed with host/ReplaySensorTrace.cpp.
+const bool kRecordSensorTrace = false;
 
-const bool kGateArmControlMotorUp = 1;
-const bool kGateArmControlMotorDown = 0;
+// when the crossing is idle, the watchdog wakes us up at the same rate as the main loop timer
+const unsigned long kIdleSleepWatchdogTickTime = 250;
 
-const bool kStatusLEDon = 1;
-const bool kStatusLEDoff = 0;
+// a wake on the serial receive pin loses the character, we stay awake this long for it to be sent again
+const unsigned long kIdleSerialWakeTime = 5000;
 
-const unsigned long kMaxDutyCycleLimitReached = 80000;
+// The Timer budgets, in microseconds (see Timer.h).  A line of serial output is
+// about a millisecond at 9600 baud once the transmit buffer is full, so the main
+// loop's budget covers a state change message or two.  The history flush writes
+// one record, up to a dozen EEPROM bytes at 3.3 ms each, and the statistics flush
+// one row of counts, fourteen bytes after a halving.
+const unsigned int kMainLoopBudget = 4000;
+const unsigned int kHistoryFlushBudget = 40000;
+const unsigned int kStatsFlushBudget = 50000;
+const unsigned int kWarningLightBudget = 200;
 
 #endif
 
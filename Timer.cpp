@@ -29,43 +29,206 @@
 
 #include "Timer.h"
 
+// the microsecond events, which the Timer and the timing wheel both keep
+TimerMicros::TimerMicros(void)
+{
+	_running = 0;
+}
+
+TimerHandle TimerMicros::every(unsigned long period, void (*callback)(void))
+{
+	int8_t i;
+
+	if (period == 0)
+	{
+		return -1;
+	}
+	for (i = 0; i < TIMER_MICRO_EVENTS; i++)
+	{
+		if (_events[i].eventType == EVENT_NONE)
+		{
+			break;
+		}
+	}
+	if (i == TIMER_MICRO_EVENTS) return -1;
+
+	_events[i].eventType = EVENT_EVERY;
+	_events[i].callback = callback;
+	_events[i].period = (uint32_t)period;
+	_events[i].deadline = (uint32_t)micros() + (uint32_t)period;
+	_events[i].late = 0;
+	_events[i].missed = 0;
+	_events[i].generation++;
+	if (_events[i].generation >= TIMER_MICRO_GENERATION_LIMIT)
+	{
+		_events[i].generation = 1;
+	}
+	_running++;
+	return (TimerHandle)((_events[i].generation << TIMER_MICRO_SLOT_BITS) | i);
+}
+
+bool TimerMicros::stop(TimerHandle handle)
+{
+	int8_t i = slotOf(handle);
+
+	if (i == -1)
+	{
+		Serial.print(F("Timer Stop Error: "));
+		Serial.println(handle);
+		return false;
+	}
+	_events[i].eventType = EVENT_NONE;
+	_running--;
+	return true;
+}
+
+bool TimerMicros::isRunning(TimerHandle handle)
+{
+	return slotOf(handle) != -1;
+}
+
+// runs each event whose deadline has come, against one micros()
+void TimerMicros::update(void)
+{
+	uint32_t now = (uint32_t)micros();
+
+	for (int8_t i = 0; i < TIMER_MICRO_EVENTS; i++)
+	{
+		if (_events[i].eventType != EVENT_NONE)
+		{
+			_events[i].update(now);
+		}
+	}
+}
+
+// in whole milliseconds, rounded down, as the Timer's own are
+unsigned long TimerMicros::timeToNextEvent(void)
+{
+	uint32_t now = (uint32_t)micros();
+	unsigned long next = TIMER_NO_EVENT;
+
+	for (int8_t i = 0; i < TIMER_MICRO_EVENTS; i++)
+	{
+		if (_events[i].eventType != EVENT_NONE)
+		{
+			int32_t remaining = (int32_t)(_events[i].deadline - now);
+			unsigned long ms = (remaining <= 0) ? 0 : (unsigned long)remaining / 1000UL;
+
+			if (ms < next)
+			{
+				next = ms;
+			}
+		}
+	}
+	return next;
+}
+
+void TimerMicros::printBudgets(void)
+{
+	for (int8_t i = 0; i < TIMER_MICRO_EVENTS; i++)
+	{
+		if (_events[i].eventType != EVENT_NONE)
+		{
+			Serial.print(F("Timer Micros "));
+			Serial.print(i);
+			Serial.print(F(": Period "));
+			Serial.print(_events[i].period);
+			Serial.print(F(", Late "));
+			Serial.print(_events[i].late);
+			Serial.print(F(", Missed "));
+			Serial.println(_events[i].missed);
+		}
+	}
+}
+
+int8_t TimerMicros::slotOf(TimerHandle handle)
+{
+	int8_t i = (int8_t)(handle & TIMER_MICRO_SLOT_MASK);
+
+	if (handle <= 0 || i >= TIMER_MICRO_EVENTS ||
+	    _events[i].generation != (uint16_t)(handle >> TIMER_MICRO_SLOT_BITS) ||
+	    _events[i].eventType == EVENT_NONE)
+	{
+		return -1;
+	}
+	return i;
+}
+
+// with TIMER_WHEEL set, TimerWheel.h is the Timer
+#if !defined(TIMER_WHEEL)
+
 Timer::Timer(void)
 {
+	_uiDeferrals = 0;
 }
 
-int8_t Timer::every(unsigned long period, void (*callback)(), int repeatCount)
+TimerHandle Timer::every(unsigned long period, void (*callback)(), int repeatCount)
 {
 	int8_t i = findFreeEventIndex();
 	if (i == -1) return -1;
 
-        Serial.print("Timer Start: ");
+        Serial.print(F("Timer Start: "));
         Serial.println(i);
 
 	_events[i].eventType = EVENT_EVERY;
+	_events[i].priority = TIMER_PRIORITY_CONTROL;
 	_events[i].period = period;
 	_events[i].repeatCount = repeatCount;
 	_events[i].callback = callback;
+	_events[i].context = 0;
 	_events[i].lastEventTime = millis();
 	_events[i].count = 0;
-	return i;
+	return claim(i);
+}
+
+// the same, with a context pointer handed to the callback each time, so
+// one callback can serve several objects (see TimerMember in Timer.h)
+TimerHandle Timer::every(unsigned long period, void (*callback)(void *), void *context, int repeatCount)
+{
+	int8_t i = findFreeEventIndex();
+	if (i == -1) return -1;
+
+        Serial.print(F("Timer Start: "));
+        Serial.println(i);
+
+	_events[i].eventType = EVENT_EVERY_CONTEXT;
+	_events[i].priority = TIMER_PRIORITY_CONTROL;
+	_events[i].period = period;
+	_events[i].repeatCount = repeatCount;
+	_events[i].contextCallback = callback;
+	_events[i].context = context;
+	_events[i].lastEventTime = millis();
+	_events[i].count = 0;
+	return claim(i);
+}
+
+TimerHandle Timer::every(unsigned long period, void (*callback)(void *), void *context)
+{
+	return every(period, callback, context, -1);
+}
+
+TimerHandle Timer::after(unsigned long period, void (*callback)(void *), void *context)
+{
+	return every(period, callback, context, 1);
 }
 
-int8_t Timer::every(unsigned long period, void (*callback)())
+TimerHandle Timer::every(unsigned long period, void (*callback)())
 {
 	return every(period, callback, -1); // - means forever
 }
 
-int8_t Timer::after(unsigned long period, void (*callback)())
+TimerHandle Timer::after(unsigned long period, void (*callback)())
 {
 	return every(period, callback, 1);
 }
 
-int8_t Timer::oscillate(uint8_t pin, unsigned long period, uint8_t startingValue, int repeatCount)
+TimerHandle Timer::oscillate(uint8_t pin, unsigned long period, uint8_t startingValue, int repeatCount)
 {
 	int8_t i = findFreeEventIndex();
 	if (i == -1) return -1;
 
 	_events[i].eventType = EVENT_OSCILLATE;
+	_events[i].priority = TIMER_PRIORITY_SAFETY;
 	_events[i].pin = pin;
 	_events[i].period = period;
 	_events[i].pinState = startingValue;
@@ -73,45 +236,335 @@ int8_t Timer::oscillate(uint8_t pin, unsigned long period, uint8_t startingValue
 	_events[i].repeatCount = repeatCount * 2; // full cycles not transitions
 	_events[i].lastEventTime = millis();
 	_events[i].count = 0;
-	return i;
+	return claim(i);
 }
 
-int8_t Timer::oscillate(uint8_t pin, unsigned long period, uint8_t startingValue)
+TimerHandle Timer::oscillate(uint8_t pin, unsigned long period, uint8_t startingValue)
 {
 	return oscillate(pin, period, startingValue, -1); // forever
 }
 
-int8_t Timer::pulse(uint8_t pin, unsigned long period, uint8_t startingValue)
+TimerHandle Timer::pulse(uint8_t pin, unsigned long period, uint8_t startingValue)
 {
 	return oscillate(pin, period, startingValue, 1); // once
 }
 
-void Timer::stop(int8_t id)
+// stops the event, if the handle is still its own.  A stale or made up
+// handle (an old slot number, 0, -1) is reported and leaves every event
+// alone, so it can never stop the slot's new owner.
+bool Timer::stop(TimerHandle handle)
 {
-       //Serial.print("Timer: ");
-       //Serial.print(id);
-       //Serial.print(" Was: ");
-       //Serial.println(_events[id].eventType);
-       
+       int8_t i = slotOf(handle);
+
        // verify that the timer was in use, if not print an error
-       if (_events[id].eventType == EVENT_NONE)
+       if (i == -1)
        {
-           Serial.print("Timer Stop Error: ");
-           Serial.println(id);
+           Serial.print(F("Timer Stop Error: "));
+           Serial.println(handle);
+           return false;
        }  
-       _events[id].eventType = EVENT_NONE;
+       _events[i].eventType = EVENT_NONE;
+       return true;
         
 }
 
+bool Timer::isRunning(TimerHandle handle)
+{
+	return slotOf(handle) != -1;
+}
+
+// starts the event's period over from now, with a new period.  From the
+// event's own callback too, which is how a periodic event can be aimed at
+// a different time each time round.
+bool Timer::restart(TimerHandle handle, unsigned long period)
+{
+	int8_t i = slotOf(handle);
+
+	if (i == -1)
+	{
+		return false;
+	}
+	_events[i].period = period;
+	_events[i].lastEventTime = millis();
+	return true;
+}
+
+// moves the event to another class (TIMER_PRIORITY_* in Timer.h)
+bool Timer::setPriority(TimerHandle handle, uint8_t priority)
+{
+	int8_t i = slotOf(handle);
+
+	if (i == -1 || priority >= TIMER_PRIORITY_CLASSES)
+	{
+		return false;
+	}
+	_events[i].priority = priority;
+	return true;
+}
+
+// the time the callback should take, in microseconds (0 for no budget)
+bool Timer::setBudget(TimerHandle handle, unsigned int budget)
+{
+	int8_t i = slotOf(handle);
+
+	if (i == -1)
+	{
+		return false;
+	}
+	_events[i].budget = budget;
+	return true;
+}
+
+// for the T serial command: each running event's class, budget, longest
+// run and overruns, and how often housekeeping has been put off
+void Timer::printBudgets(void)
+{
+	for (int8_t i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+	{
+		if (_events[i].eventType != EVENT_NONE)
+		{
+			Serial.print(F("Timer "));
+			Serial.print(i);
+			Serial.print(F(": Class "));
+			Serial.print(_events[i].priority);
+			Serial.print(F(", Budget "));
+			Serial.print(_events[i].budget);
+			Serial.print(F(", Worst "));
+			Serial.print(_events[i].worst);
+			Serial.print(F(", Overruns "));
+			Serial.println(_events[i].overruns);
+		}
+	}
+	_micros.printBudgets();
+	Serial.print(F("Timer Deferrals: "));
+	Serial.println(_uiDeferrals);
+}
+
+// ***************************************************
+//
+// update()
+//
+// Runs what is due class by class, safety first (see Timer.h), each
+// class in slot order.  Everything is judged due against the same
+// millis(), so an event a callback starts is not run until the next call.
+//
+// ****************************************************
 void Timer::update(void)
 {
+	unsigned long now = millis();
+	bool bLate = false;
+
+	_micros.poll();
+
+	for (uint8_t priority = 0; priority < TIMER_PRIORITY_CLASSES; priority++)
+	{
+		for (int8_t i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+		{
+			Event *e = &_events[i];
+
+			if (e->eventType == EVENT_NONE || e->priority != priority)
+			{
+				continue;
+			}
+
+			if (now - e->lastEventTime < e->period)
+			{
+				// not due, this only retires a finished event
+				e->update(now);
+			}
+			else if (priority == TIMER_PRIORITY_HOUSEKEEPING)
+			{
+				if (deferHousekeeping(e, now, bLate))
+				{
+					_uiDeferrals++;
+				}
+				else
+				{
+					dispatch(e, now);
+				}
+			}
+			else
+			{
+				if (now - e->lastEventTime - e->period > TIMER_LATE_MS)
+				{
+					bLate = true;
+				}
+				if (dispatch(e, now))
+				{
+					bLate = true;
+				}
+			}
+		}
+	}
+}
+
+// returns the number of milliseconds until the next event is due,
+// or TIMER_NO_EVENT if nothing is running
+unsigned long Timer::timeToNextEvent(void)
+{
+	unsigned long now = millis();
+	unsigned long next = _micros.timeToNextEvent();
+
 	for (int8_t i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
 	{
 		if (_events[i].eventType != EVENT_NONE)
 		{
-			_events[i].update();
+			unsigned long elapsed = now - _events[i].lastEventTime;
+			unsigned long remaining = (elapsed >= _events[i].period) ? 0 : (_events[i].period - elapsed);
+
+			if (remaining < next)
+			{
+				next = remaining;
+			}
 		}
 	}
+	return next;
+}
+
+// returns the number of milliseconds until the event is due, or
+// TIMER_NO_EVENT if it is not running
+unsigned long Timer::timeToEvent(TimerHandle handle)
+{
+	return timeToSlot(slotOf(handle));
+}
+
+// the same for whatever is in a slot, for the host runtimes that arm a
+// timer per slot
+unsigned long Timer::timeToSlot(int8_t slot)
+{
+	unsigned long elapsed;
+
+	if (slot < 0 || slot >= MAX_NUMBER_OF_EVENTS || _events[slot].eventType == EVENT_NONE)
+	{
+		return TIMER_NO_EVENT;
+	}
+
+	elapsed = millis() - _events[slot].lastEventTime;
+	return (elapsed >= _events[slot].period) ? 0 : (_events[slot].period - elapsed);
+}
+
+// moves every event on past the deadlines it has missed, as if update()
+// had been called on time.  The callbacks are not called, so this is only
+// for skipping over time in which they would have had nothing to do.
+void Timer::skipMissed(void)
+{
+	unsigned long now = millis();
+
+	for (int8_t i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+	{
+		if (_events[i].eventType != EVENT_NONE && _events[i].period > 0 && now - _events[i].lastEventTime > _events[i].period)
+		{
+			unsigned long skipped = (now - _events[i].lastEventTime - 1) / _events[i].period;
+
+			if (_events[i].repeatCount > -1 && skipped > (unsigned long)(_events[i].repeatCount - _events[i].count))
+			{
+				skipped = _events[i].repeatCount - _events[i].count;
+			}
+			if (_events[i].eventType == EVENT_OSCILLATE && (skipped & 1))
+			{
+				_events[i].pinState = ! _events[i].pinState;
+				digitalWrite(_events[i].pin, _events[i].pinState);
+			}
+			_events[i].lastEventTime += skipped * _events[i].period;
+			_events[i].count += skipped;
+			if (_events[i].repeatCount > -1 && _events[i].count >= _events[i].repeatCount)
+			{
+				_events[i].eventType = EVENT_NONE;
+			}
+		}
+	}
+}
+
+// runs a due event, timing it against its budget; true if it ran over.
+// The microsecond events due by then go first, and are not counted in it.
+bool Timer::dispatch(Event *e, unsigned long now)
+{
+	unsigned long start;
+	unsigned long elapsed;
+	int8_t eventType = e->eventType;
+
+	_micros.poll();
+	start = micros();
+
+	e->update(now);
+	elapsed = micros() - start;
+	TimerTrace::dispatch((uint8_t)(e - _events), eventType, e->pin, e->pinState);
+
+	if (elapsed > 0xFFFF)
+	{
+		elapsed = 0xFFFF;
+	}
+	if (elapsed > e->worst)
+	{
+		e->worst = (uint16_t)elapsed;
+	}
+	if (e->budget != 0 && elapsed > e->budget)
+	{
+		if (e->overruns != 0xFFFF)
+		{
+			e->overruns++;
+		}
+		return true;
+	}
+	return false;
+}
+
+// true if a due housekeeping event should wait: the control work in this
+// update() was late, or the next safety or control deadline comes before
+// the event's budget would be spent.  Not past TIMER_MAX_DEFER_MS, though.
+bool Timer::deferHousekeeping(Event *e, unsigned long now, bool bLate)
+{
+	if (now - e->lastEventTime - e->period >= TIMER_MAX_DEFER_MS)
+	{
+		return false;
+	}
+	if (bLate)
+	{
+		return true;
+	}
+
+	for (int8_t i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+	{
+		if (_events[i].eventType != EVENT_NONE && _events[i].priority < TIMER_PRIORITY_HOUSEKEEPING)
+		{
+			unsigned long elapsed = now - _events[i].lastEventTime;
+			unsigned long remaining = (elapsed >= _events[i].period) ? 0 : (_events[i].period - elapsed);
+
+			if (remaining < (e->budget + 999UL) / 1000UL)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// hands out slot i under its next generation, with nothing measured yet
+TimerHandle Timer::claim(int8_t i)
+{
+	_events[i].budget = 0;
+	_events[i].worst = 0;
+	_events[i].overruns = 0;
+	_events[i].generation++;
+	if (_events[i].generation >= TIMER_GENERATION_LIMIT)
+	{
+		_events[i].generation = 1;
+	}
+	return (TimerHandle)((_events[i].generation << TIMER_SLOT_BITS) | i);
+}
+
+// the slot of a running event, or -1 if the handle is not (or no longer) one
+int8_t Timer::slotOf(TimerHandle handle)
+{
+	int8_t i = (int8_t)(handle & TIMER_SLOT_MASK);
+
+	if (handle <= 0 || i >= MAX_NUMBER_OF_EVENTS ||
+	    _events[i].generation != (uint16_t)(handle >> TIMER_SLOT_BITS) ||
+	    _events[i].eventType == EVENT_NONE)
+	{
+		return -1;
+	}
+	return i;
 }
 
 int8_t Timer::findFreeEventIndex(void)
@@ -124,4 +577,6 @@ int8_t Timer::findFreeEventIndex(void)
 		}
 	}
 	return -1;
-}
+}
+
+#endif
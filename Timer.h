@@ -26,27 +26,236 @@
 #include <inttypes.h>
 #include "Event.h"
 
+#define TIMER_NO_EVENT 0xFFFFFFFFUL
+
+// A handle is the event's slot (low 4 bits) and the slot's generation,
+// which moves on each time the slot is handed out.  So a handle to an
+// event that has finished, or been stopped, no longer matches once the
+// slot is reused, and is checked in constant time.  The generation is
+// never 0, so neither is a handle: 0 is safe to keep for "no timer", and
+// -1 is returned when there is no free slot.
+typedef int16_t TimerHandle;
+
+// ***************************************************
+//
+// TimerMember()
+//
+// Calls a member function on the object the event carries as its context.
+// The member is a template argument, so each one gets its own small
+// function that calls it directly: no heap, no virtual call, and one
+// indirect call per event, as for a plain callback.
+//
+//     gTimer.every<Crossing, &Crossing::tick>(250, &crossing);
+//
+// ****************************************************
+template <class T, void (T::*Method)(void)>
+void TimerMember(void *context)
+{
+  (static_cast<T *>(context)->*Method)();
+}
+
+// ***************************************************
+//
+// Priority classes
+//
+// update() runs the events that are due class by class: the safety
+// outputs (the flashers, which oscillate() starts in this class), then
+// control (every() and after()), then housekeeping.  So a slow control
+// callback cannot hold up a flasher toggle due in the same update().
+//
+// Each callback is timed against its budget (setBudget(), microseconds,
+// 0 for none); running over counts an overrun.  A housekeeping event is
+// put off to a later update() while the control work is behind: when a
+// safety or control event in this update() ran more than TIMER_LATE_MS
+// after its deadline or over its budget, or when the next one is due
+// before the housekeeping event's budget would be spent.  It is never
+// put off more than TIMER_MAX_DEFER_MS past its own deadline.  (On the
+// host micros() only moves with the virtual millis(), so the callbacks
+// take no time there; the budgets mean something on the board.)
+//
+// ****************************************************
+#define TIMER_PRIORITY_SAFETY 0
+#define TIMER_PRIORITY_CONTROL 1
+#define TIMER_PRIORITY_HOUSEKEEPING 2
+#define TIMER_PRIORITY_CLASSES 3
+
+#define TIMER_LATE_MS 2
+#define TIMER_MAX_DEFER_MS 1000
+
+// ***************************************************
+//
+// TimerTrace
+//
+// Told of each event update() runs, after it has run and been timed:
+// its slot, what it was (EVENT_* in Event.h), and for an oscillate() the
+// pin and the level it was just set to.  Only the crossing's trace builds
+// (-DSRM_TRACE, see SRMcrossGate_Trace.h) define it; otherwise the call is
+// to an empty inline function, and compiles to nothing.
+//
+// ****************************************************
+#if defined(SRM_TRACE)
+struct TimerTrace
+{
+  static void dispatch(uint8_t slot, int8_t eventType, uint8_t pin, uint8_t pinState);
+};
+#else
+struct TimerTrace
+{
+  static inline void dispatch(uint8_t, int8_t, uint8_t, uint8_t) {}
+};
+#endif
+
+// ***************************************************
+//
+// Microsecond events
+//
+// everyMicros() runs a callback each period microseconds, on micros()
+// (MicroEvent in Event.h), for sampling an input at a kHz or two.  There
+// are TIMER_MICRO_EVENTS of them, apart from the millisecond slots, and
+// their handles are their own: stop one with stopMicros().
+//
+// They are polled, not run from an interrupt: at the start of update(),
+// and before each millisecond event it runs, so one is late by at most the
+// longest single callback (or the rest of loop()) in front of it.  The
+// dispatch jitter of a 500 us sampler beside the crossing's events, with
+// a loop() pass of 100 us, as host/MicroBench.cpp measures it:
+//
+//     p50 40 us, p99 80 us
+//     worst 49.6 ms with every callback taking its whole budget, behind
+//     the 50 ms kStatsFlushBudget
+//     worst 3.9 ms when the flushes have nothing to write, behind the
+//     4 ms kMainLoopBudget of the controller tick
+//
+// A sample that is a whole period late is dropped, not run twice.  Each
+// event keeps the latest it has run and the samples it dropped, and the T
+// serial command prints them.  While one is running the loop must not
+// sleep (SRMcrossGate_Power.cpp sees to that), and timeToNextEvent() is 0
+// if one is due within the millisecond.
+//
+// ****************************************************
+#ifndef TIMER_MICRO_EVENTS
+#define TIMER_MICRO_EVENTS 2
+#endif
+
+#define TIMER_MICRO_SLOT_BITS 3
+#define TIMER_MICRO_SLOT_MASK 0x07
+#define TIMER_MICRO_GENERATION_LIMIT 0x1000
+
+class TimerMicros
+{
+
+public:
+  TimerMicros(void);
+
+  TimerHandle every(unsigned long period, void (*callback)(void));
+  bool stop(TimerHandle handle);
+  bool isRunning(TimerHandle handle);
+  void update(void);
+  unsigned long timeToNextEvent(void);
+  void printBudgets(void);
+
+  // the fast path when nothing is running, one byte compare
+  inline void poll(void)
+  {
+    if (_running != 0)
+    {
+      update();
+    }
+  }
+
+  inline bool running(void)
+  {
+    return _running != 0;
+  }
+
+protected:
+  MicroEvent _events[TIMER_MICRO_EVENTS];
+  uint8_t _running;
+  int8_t slotOf(TimerHandle handle);
+
+};
+
+static_assert(TIMER_MICRO_EVENTS <= (1 << TIMER_MICRO_SLOT_BITS), "too many microsecond events for their handles");
+
+#if defined(TIMER_WHEEL)
+
+// the timing wheel (TimerWheel.h) stands in for the Timer
+#ifndef TIMER_WHEEL_EVENTS
+#define TIMER_WHEEL_EVENTS 16
+#endif
+#ifndef TIMER_WHEEL_BUCKETS
+#define TIMER_WHEEL_BUCKETS 64
+#endif
+
+#define MAX_NUMBER_OF_EVENTS TIMER_WHEEL_EVENTS
+
+#include "TimerWheel.h"
+
+typedef TimerWheel<TIMER_WHEEL_EVENTS, TIMER_WHEEL_BUCKETS, TimerTrace> Timer;
+
+#else
+
 #define MAX_NUMBER_OF_EVENTS 10
 
+#define TIMER_SLOT_BITS 4
+#define TIMER_SLOT_MASK 0x0F
+#define TIMER_GENERATION_LIMIT 0x0800
+
 class Timer
 {
 
 public:
   Timer(void);
 
-  int8_t every(unsigned long period, void (*callback)(void));
-  int8_t every(unsigned long period, void (*callback)(void), int repeatCount);
-  int8_t after(unsigned long duration, void (*callback)(void));
-  int8_t oscillate(uint8_t pin, unsigned long period, uint8_t startingValue);
-  int8_t oscillate(uint8_t pin, unsigned long period, uint8_t startingValue, int repeatCount);
-  int8_t pulse(uint8_t pin, unsigned long period, uint8_t startingValue);
-  void stop(int8_t id);
+  TimerHandle every(unsigned long period, void (*callback)(void));
+  TimerHandle every(unsigned long period, void (*callback)(void), int repeatCount);
+  TimerHandle after(unsigned long duration, void (*callback)(void));
+  TimerHandle every(unsigned long period, void (*callback)(void *), void *context);
+  TimerHandle every(unsigned long period, void (*callback)(void *), void *context, int repeatCount);
+  TimerHandle after(unsigned long duration, void (*callback)(void *), void *context);
+  TimerHandle oscillate(uint8_t pin, unsigned long period, uint8_t startingValue);
+  TimerHandle oscillate(uint8_t pin, unsigned long period, uint8_t startingValue, int repeatCount);
+  TimerHandle pulse(uint8_t pin, unsigned long period, uint8_t startingValue);
+  bool stop(TimerHandle handle);
+  bool isRunning(TimerHandle handle);
+  bool restart(TimerHandle handle, unsigned long period);
+  bool setPriority(TimerHandle handle, uint8_t priority);
+  bool setBudget(TimerHandle handle, unsigned int budget);
+  void printBudgets(void);
   void update(void);
+  unsigned long timeToNextEvent(void);
+  unsigned long timeToEvent(TimerHandle handle);
+  unsigned long timeToSlot(int8_t slot);
+  void skipMissed(void);
+
+  TimerHandle everyMicros(unsigned long period, void (*callback)(void)) { return _micros.every(period, callback); }
+  bool stopMicros(TimerHandle handle) { return _micros.stop(handle); }
+  bool microsRunning(void) { return _micros.running(); }
+
+  template <class T, void (T::*Method)(void)>
+  TimerHandle every(unsigned long period, T *object)
+  {
+    return every(period, &TimerMember<T, Method>, object, -1);
+  }
+
+  template <class T, void (T::*Method)(void)>
+  TimerHandle after(unsigned long duration, T *object)
+  {
+    return every(duration, &TimerMember<T, Method>, object, 1);
+  }
 
 protected:
   Event _events[MAX_NUMBER_OF_EVENTS];
+  TimerMicros _micros;
+  uint16_t _uiDeferrals;
   int8_t findFreeEventIndex(void);
+  bool deferHousekeeping(Event *e, unsigned long now, bool bLate);
+  bool dispatch(Event *e, unsigned long now);
+  TimerHandle claim(int8_t i);
+  int8_t slotOf(TimerHandle handle);
 
 };
 
+#endif
+
 #endif
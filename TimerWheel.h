@@ -0,0 +1,738 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// TimerWheel - a Timer for hundreds of events
+//
+// The same API as Timer (every, after, oscillate, pulse, stop, the
+// handles and the context callbacks), on a hashed timing wheel rather
+// than an array that update() walks.  The events hang in kBuckets lists,
+// by their deadline in milliseconds modulo kBuckets, doubly linked, so
+// starting an event, stopping it and firing it are all O(1).  update()
+// only looks at the buckets for the milliseconds that have gone by since
+// the last call, and in them only at the events that are due or are a
+// whole turn of the wheel (or more) away.
+//
+// An event fires the way a Timer event does: when its period has gone by,
+// and its next deadline is a period after the update() that fired it.  So
+// the sketch behaves the same on either; only the order in which events
+// due in the same update() fire can differ (a Timer fires them by class,
+// then slot, the wheel by deadline, then class).  The priority classes,
+// budgets and housekeeping deferral are as in Timer.h; each bucket is kept
+// in class order, so linking an event walks past the bucket's events of
+// the classes above its own (the flashers, for the control events).
+//
+// Build the sketch with TIMER_WHEEL defined to use it as the Timer,
+// with TIMER_WHEEL_EVENTS slots and TIMER_WHEEL_BUCKETS buckets.
+//
+// SRAM on the Uno (pointers and int 2 bytes, unsigned long 4, no padding):
+//
+//     each slot     32 bytes (34 with more than 254 slots)
+//     each bucket   1 byte (2 with more than 254 slots)
+//     the rest      9 bytes (11 with more than 254 slots)
+//     microsecond   17 bytes each (TIMER_MICRO_EVENTS, 2), and 1
+//
+//     slots  buckets   bytes
+//        10       32     396    (a Timer's 10 slots are 317)
+//        16       64     620
+//        32       64    1132
+//        48      128    1708    (most of the Uno's 2048)
+//
+// host/TimerBench.cpp prints the same table from the sizes below, next to
+// the time per update() for 10 to 1000 live events.
+//
+// ****************************************************
+
+// Timer.h includes this file when TIMER_WHEEL is set, after the handle
+// and callback types it shares, so it has to come in first from here.
+#include "Timer.h"
+
+#ifndef TimerWheel_h
+#define TimerWheel_h
+
+#include <inttypes.h>
+
+// For Arduino 1.0 and earlier
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "Event.h"
+
+// the bits an index up to N needs
+template <unsigned int N>
+struct TimerWheelBits
+{
+  enum { value = 1 + TimerWheelBits<N / 2>::value };
+};
+
+template <>
+struct TimerWheelBits<0>
+{
+  enum { value = 0 };
+};
+
+// one byte list links while they fit
+template <bool bSmall>
+struct TimerWheelIndexType
+{
+  typedef uint8_t type;
+};
+
+template <>
+struct TimerWheelIndexType<false>
+{
+  typedef uint16_t type;
+};
+
+// Trace is told of each event that fires, as TimerTrace (Timer.h) is by a Timer
+template <uint16_t kEvents, uint16_t kBuckets, class Trace = TimerTrace>
+class TimerWheel
+{
+
+public:
+  typedef typename TimerWheelIndexType<(kEvents < 255)>::type Index;
+
+  // the slot in the low bits of a handle, the generation above
+  enum
+  {
+    kSlotBits = TimerWheelBits<kEvents - 1>::value,
+    kGenerationLimit = 1 << (15 - kSlotBits),
+    kNone = kEvents,
+    kPendingBucket = kBuckets,
+    kUnlinked = kBuckets + 1
+  };
+
+  static_assert((kBuckets & (kBuckets - 1)) == 0, "the bucket count has to be a power of two");
+  static_assert(kSlotBits <= 12, "too many slots for the generation to mean anything");
+  static_assert(kBuckets < 65534, "the bucket count has to fit the bucket field");
+
+  struct Entry
+  {
+    unsigned long deadline;
+    unsigned long period;
+    int repeatCount;
+    int count;
+    union
+    {
+      void (*callback)(void);
+      void (*contextCallback)(void *context);
+    };
+    void *context;
+    uint16_t generation;
+    uint16_t bucket;
+    Index next;
+    Index prev;
+    uint8_t eventType;
+    uint8_t pin;
+    uint8_t pinState;
+    uint8_t priority;
+    uint16_t budget;
+    uint16_t worst;
+    uint16_t overruns;
+  };
+
+  TimerWheel(void)
+  {
+    for (uint16_t b = 0; b < kBuckets; b++)
+    {
+      _buckets[b] = kNone;
+    }
+    for (uint16_t i = 0; i < kEvents; i++)
+    {
+      _entries[i].eventType = EVENT_NONE;
+      _entries[i].generation = 0;
+      _entries[i].bucket = kUnlinked;
+      _entries[i].next = (i + 1 < kEvents) ? (Index)(i + 1) : (Index)kNone;
+    }
+    _free = 0;
+    _pending = kNone;
+    _ulCurrent = 0;
+    _uiDeferrals = 0;
+    _bLate = false;
+  }
+
+  TimerHandle every(unsigned long period, void (*callback)(void))
+  {
+    return every(period, callback, -1);
+  }
+
+  TimerHandle every(unsigned long period, void (*callback)(void), int repeatCount)
+  {
+    Index i = allocate();
+    if (i == kNone) return -1;
+
+    Serial.print(F("Timer Start: "));
+    Serial.println((int)i);
+
+    _entries[i].eventType = EVENT_EVERY;
+    _entries[i].priority = TIMER_PRIORITY_CONTROL;
+    _entries[i].callback = callback;
+    _entries[i].context = 0;
+    return start(i, period, repeatCount);
+  }
+
+  TimerHandle after(unsigned long duration, void (*callback)(void))
+  {
+    return every(duration, callback, 1);
+  }
+
+  TimerHandle every(unsigned long period, void (*callback)(void *), void *context)
+  {
+    return every(period, callback, context, -1);
+  }
+
+  TimerHandle every(unsigned long period, void (*callback)(void *), void *context, int repeatCount)
+  {
+    Index i = allocate();
+    if (i == kNone) return -1;
+
+    Serial.print(F("Timer Start: "));
+    Serial.println((int)i);
+
+    _entries[i].eventType = EVENT_EVERY_CONTEXT;
+    _entries[i].priority = TIMER_PRIORITY_CONTROL;
+    _entries[i].contextCallback = callback;
+    _entries[i].context = context;
+    return start(i, period, repeatCount);
+  }
+
+  TimerHandle after(unsigned long duration, void (*callback)(void *), void *context)
+  {
+    return every(duration, callback, context, 1);
+  }
+
+  TimerHandle oscillate(uint8_t pin, unsigned long period, uint8_t startingValue)
+  {
+    return oscillate(pin, period, startingValue, -1);
+  }
+
+  TimerHandle oscillate(uint8_t pin, unsigned long period, uint8_t startingValue, int repeatCount)
+  {
+    Index i = allocate();
+    if (i == kNone) return -1;
+
+    _entries[i].eventType = EVENT_OSCILLATE;
+    _entries[i].priority = TIMER_PRIORITY_SAFETY;
+    _entries[i].pin = pin;
+    _entries[i].pinState = startingValue;
+    digitalWrite(pin, startingValue);
+    return start(i, period, repeatCount * 2); // full cycles not transitions
+  }
+
+  TimerHandle pulse(uint8_t pin, unsigned long period, uint8_t startingValue)
+  {
+    return oscillate(pin, period, startingValue, 1);
+  }
+
+  template <class T, void (T::*Method)(void)>
+  TimerHandle every(unsigned long period, T *object)
+  {
+    return every(period, &TimerMember<T, Method>, object, -1);
+  }
+
+  template <class T, void (T::*Method)(void)>
+  TimerHandle after(unsigned long duration, T *object)
+  {
+    return every(duration, &TimerMember<T, Method>, object, 1);
+  }
+
+  bool stop(TimerHandle handle)
+  {
+    int i = slotOf(handle);
+
+    if (i == -1)
+    {
+      Serial.print(F("Timer Stop Error: "));
+      Serial.println(handle);
+      return false;
+    }
+
+    unlink((Index)i);
+    release((Index)i);
+    return true;
+  }
+
+  bool isRunning(TimerHandle handle)
+  {
+    return slotOf(handle) != -1;
+  }
+
+  bool setPriority(TimerHandle handle, uint8_t priority)
+  {
+    int i = slotOf(handle);
+
+    if (i == -1 || priority >= TIMER_PRIORITY_CLASSES)
+    {
+      return false;
+    }
+
+    // back into its bucket at its new place in the class order
+    _entries[i].priority = priority;
+    relink((Index)i);
+    return true;
+  }
+
+  bool restart(TimerHandle handle, unsigned long period)
+  {
+    int i = slotOf(handle);
+
+    if (i == -1)
+    {
+      return false;
+    }
+
+    _entries[i].period = period;
+    _entries[i].deadline = millis() + period;
+    relink((Index)i);
+    return true;
+  }
+
+  bool setBudget(TimerHandle handle, unsigned int budget)
+  {
+    int i = slotOf(handle);
+
+    if (i == -1)
+    {
+      return false;
+    }
+    _entries[i].budget = budget;
+    return true;
+  }
+
+  void printBudgets(void)
+  {
+    for (uint16_t i = 0; i < kEvents; i++)
+    {
+      if (_entries[i].eventType != EVENT_NONE)
+      {
+        Serial.print(F("Timer "));
+        Serial.print((int)i);
+        Serial.print(F(": Class "));
+        Serial.print(_entries[i].priority);
+        Serial.print(F(", Budget "));
+        Serial.print(_entries[i].budget);
+        Serial.print(F(", Worst "));
+        Serial.print(_entries[i].worst);
+        Serial.print(F(", Overruns "));
+        Serial.println(_entries[i].overruns);
+      }
+    }
+    _micros.printBudgets();
+    Serial.print(F("Timer Deferrals: "));
+    Serial.println(_uiDeferrals);
+  }
+
+  // ***************************************************
+  //
+  // update()
+  //
+  // Walks the buckets of the milliseconds since the last call.  After a
+  // gap of a whole turn or more, each bucket is walked once, and everything
+  // that is due fires once, as a Timer would.
+  //
+  // ****************************************************
+  void update(void)
+  {
+    unsigned long now = millis();
+    unsigned long ticks = now - _ulCurrent;
+
+    if (ticks > kBuckets)
+    {
+      ticks = kBuckets;
+    }
+
+    _micros.poll();
+    _bLate = false;
+    while (ticks-- > 0)
+    {
+      _ulCurrent++;
+      expire((uint16_t)(_ulCurrent & (kBuckets - 1)), now);
+    }
+    _ulCurrent = now;
+  }
+
+  // O(slots), for the host runtimes that sleep until the next deadline
+  unsigned long timeToNextEvent(void)
+  {
+    unsigned long next = _micros.timeToNextEvent();
+
+    for (uint16_t i = 0; i < kEvents; i++)
+    {
+      unsigned long remaining = timeToSlot(i);
+
+      if (remaining < next)
+      {
+        next = remaining;
+      }
+    }
+    return next;
+  }
+
+  unsigned long timeToEvent(TimerHandle handle)
+  {
+    int i = slotOf(handle);
+
+    return (i == -1) ? TIMER_NO_EVENT : timeToSlot(i);
+  }
+
+  unsigned long timeToSlot(int slot)
+  {
+    unsigned long now = millis();
+
+    if (slot < 0 || slot >= kEvents || _entries[slot].eventType == EVENT_NONE)
+    {
+      return TIMER_NO_EVENT;
+    }
+    return ((long)(_entries[slot].deadline - now) <= 0) ? 0 : (_entries[slot].deadline - now);
+  }
+
+  // ***************************************************
+  //
+  // skipMissed()
+  //
+  // Moves every event past the deadlines it has missed, as Timer does.
+  // Afterwards nothing is overdue, so the wheel can jump to now without
+  // walking the gap.
+  //
+  // ****************************************************
+  void skipMissed(void)
+  {
+    unsigned long now = millis();
+
+    _ulCurrent = now - 1;
+    for (uint16_t i = 0; i < kEvents; i++)
+    {
+      Entry *e = &_entries[i];
+      unsigned long last = e->deadline - e->period;
+
+      if (e->eventType == EVENT_NONE)
+      {
+        continue;
+      }
+
+      if (e->period > 0 && now - last > e->period)
+      {
+        unsigned long skipped = (now - last - 1) / e->period;
+
+        if (e->repeatCount > -1 && skipped > (unsigned long)(e->repeatCount - e->count))
+        {
+          skipped = e->repeatCount - e->count;
+        }
+        if (e->eventType == EVENT_OSCILLATE && (skipped & 1))
+        {
+          e->pinState = ! e->pinState;
+          digitalWrite(e->pin, e->pinState);
+        }
+        e->count += skipped;
+        unlink((Index)i);
+        if (e->repeatCount > -1 && e->count >= e->repeatCount)
+        {
+          release((Index)i);
+        }
+        else
+        {
+          e->deadline = last + (skipped + 1) * e->period;
+          link((Index)i, _ulCurrent);
+        }
+      }
+      else if ((long)(e->deadline - now) < 0)
+      {
+        // a period of 0, still waiting in the bucket after the old position
+        unlink((Index)i);
+        link((Index)i, _ulCurrent);
+      }
+    }
+  }
+
+  TimerHandle everyMicros(unsigned long period, void (*callback)(void)) { return _micros.every(period, callback); }
+  bool stopMicros(TimerHandle handle) { return _micros.stop(handle); }
+  bool microsRunning(void) { return _micros.running(); }
+
+protected:
+  Entry _entries[kEvents];
+  TimerMicros _micros;
+  Index _buckets[kBuckets];
+  Index _free;
+  Index _pending;
+  unsigned long _ulCurrent;
+  uint16_t _uiDeferrals;
+  bool _bLate;
+
+  Index allocate(void)
+  {
+    Index i = _free;
+
+    if (i != kNone)
+    {
+      _free = _entries[i].next;
+    }
+    return i;
+  }
+
+  void release(Index i)
+  {
+    _entries[i].eventType = EVENT_NONE;
+    _entries[i].bucket = kUnlinked;
+    _entries[i].next = _free;
+    _free = i;
+  }
+
+  TimerHandle start(Index i, unsigned long period, int repeatCount)
+  {
+    Entry *e = &_entries[i];
+
+    e->period = period;
+    e->repeatCount = repeatCount;
+    e->count = 0;
+    e->budget = 0;
+    e->worst = 0;
+    e->overruns = 0;
+    e->deadline = millis() + period;
+    link(i, _ulCurrent);
+
+    e->generation++;
+    if (e->generation >= kGenerationLimit)
+    {
+      e->generation = 1;
+    }
+    return (TimerHandle)((e->generation << kSlotBits) | i);
+  }
+
+  int slotOf(TimerHandle handle)
+  {
+    int i = handle & ((1 << kSlotBits) - 1);
+
+    if (handle <= 0 || i >= kEvents ||
+        _entries[i].generation != (uint16_t)(handle >> kSlotBits) ||
+        _entries[i].eventType == EVENT_NONE)
+    {
+      return -1;
+    }
+    return i;
+  }
+
+  Index *head(uint16_t bucket)
+  {
+    return (bucket == kPendingBucket) ? &_pending : &_buckets[bucket];
+  }
+
+  // a deadline no later than after goes in the bucket for after + 1, the
+  // next one the wheel looks at (after is where the wheel is, or the
+  // update() that fired the event, which an event only fires in once).
+  // It goes in front of its own class, after the classes above it.
+  void link(Index i, unsigned long after)
+  {
+    Entry *e = &_entries[i];
+    unsigned long when = ((long)(e->deadline - after) <= 0) ? after + 1 : e->deadline;
+    Index *pHead;
+    Index prev = kNone;
+    Index next;
+
+    e->bucket = (uint16_t)(when & (kBuckets - 1));
+    pHead = head(e->bucket);
+    next = *pHead;
+    while (next != kNone && _entries[next].priority < e->priority)
+    {
+      prev = next;
+      next = _entries[next].next;
+    }
+
+    e->prev = prev;
+    e->next = next;
+    if (next != kNone)
+    {
+      _entries[next].prev = i;
+    }
+    if (prev != kNone)
+    {
+      _entries[prev].next = i;
+    }
+    else
+    {
+      *pHead = i;
+    }
+  }
+
+  // as Timer::deferHousekeeping()
+  bool deferHousekeeping(Entry *e, unsigned long now)
+  {
+    if (now - e->deadline >= TIMER_MAX_DEFER_MS)
+    {
+      return false;
+    }
+    if (_bLate)
+    {
+      return true;
+    }
+
+    for (uint16_t i = 0; i < kEvents; i++)
+    {
+      if (_entries[i].eventType != EVENT_NONE && _entries[i].priority < TIMER_PRIORITY_HOUSEKEEPING)
+      {
+        unsigned long remaining = ((long)(_entries[i].deadline - now) <= 0) ? 0 : (_entries[i].deadline - now);
+
+        if (remaining < (e->budget + 999UL) / 1000UL)
+        {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // after a change to the deadline or the class.  An event on the pending
+  // list is linked again by expire() anyway, as is one that is firing
+  // (its own callback changed it), once the callback is done.
+  void relink(Index i)
+  {
+    if (_entries[i].bucket < kBuckets)
+    {
+      unlink(i);
+      link(i, _ulCurrent);
+    }
+  }
+
+  void unlink(Index i)
+  {
+    Entry *e = &_entries[i];
+
+    if (e->bucket == kUnlinked)
+    {
+      return;
+    }
+
+    if (e->prev != kNone)
+    {
+      _entries[e->prev].next = e->next;
+    }
+    else
+    {
+      *head(e->bucket) = e->next;
+    }
+    if (e->next != kNone)
+    {
+      _entries[e->next].prev = e->prev;
+    }
+    e->bucket = kUnlinked;
+  }
+
+  // ***************************************************
+  //
+  // expire()
+  //
+  // The bucket is moved to the pending list first, so the callbacks can
+  // start and stop events (even the ones still to be looked at) while it
+  // is walked.
+  //
+  // ****************************************************
+  void expire(uint16_t bucket, unsigned long now)
+  {
+    _pending = _buckets[bucket];
+    _buckets[bucket] = kNone;
+    for (Index i = _pending; i != kNone; i = _entries[i].next)
+    {
+      _entries[i].bucket = kPendingBucket;
+    }
+
+    while (_pending != kNone)
+    {
+      Index i = _pending;
+      Entry *e = &_entries[i];
+      uint16_t generation = e->generation;
+      unsigned long start;
+      unsigned long elapsed;
+      uint8_t eventType;
+
+      unlink(i);
+      if ((long)(e->deadline - now) > 0)
+      {
+        // a turn or more away
+        link(i, _ulCurrent);
+        continue;
+      }
+
+      if (e->priority == TIMER_PRIORITY_HOUSEKEEPING)
+      {
+        if (deferHousekeeping(e, now))
+        {
+          // looked at again in the next update()
+          _uiDeferrals++;
+          link(i, now);
+          continue;
+        }
+      }
+      else if (now - e->deadline > TIMER_LATE_MS)
+      {
+        _bLate = true;
+      }
+
+      // the microsecond events due by then go first, outside its time
+      _micros.poll();
+      eventType = e->eventType;
+      start = micros();
+      switch (e->eventType)
+      {
+        case EVENT_EVERY:
+          (*e->callback)();
+          break;
+
+        case EVENT_EVERY_CONTEXT:
+          (*e->contextCallback)(e->context);
+          break;
+
+        case EVENT_OSCILLATE:
+          e->pinState = ! e->pinState;
+          digitalWrite(e->pin, e->pinState);
+          break;
+      }
+
+      elapsed = micros() - start;
+      Trace::dispatch((uint8_t)i, (int8_t)eventType, e->pin, e->pinState);
+      if (elapsed > 0xFFFF)
+      {
+        elapsed = 0xFFFF;
+      }
+
+      // the callback may have stopped its own event, and even started a new one in the slot
+      if (e->generation == generation)
+      {
+        if (elapsed > e->worst)
+        {
+          e->worst = (uint16_t)elapsed;
+        }
+        if (e->budget != 0 && elapsed > e->budget)
+        {
+          if (e->overruns != 0xFFFF)
+          {
+            e->overruns++;
+          }
+          if (e->priority != TIMER_PRIORITY_HOUSEKEEPING)
+          {
+            _bLate = true;
+          }
+        }
+      }
+      if (e->eventType == EVENT_NONE || e->generation != generation)
+      {
+        continue;
+      }
+
+      e->count++;
+      if (e->repeatCount > -1 && e->count >= e->repeatCount)
+      {
+        release(i);
+      }
+      else
+      {
+        e->deadline = now + e->period;
+        link(i, now);
+      }
+    }
+  }
+
+};
+
+#endif
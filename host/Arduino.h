@@ -0,0 +1,126 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// Host build of the Arduino API.
+//
+// This lets the controller sources build with the native compiler for the
+// simulation tools in this directory.  Time is virtual: millis() only moves
+// when a tool calls HostSetMillis(), or HostSetMicros() to the microsecond.  Pin levels are kept in ram, and a tool
+// can watch the output pins through a write hook.
+//
+// ****************************************************
+
+#ifndef Host_Arduino_h
+#define Host_Arduino_h
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+
+// program memory is ordinary memory here (avr/pgmspace.h on the Uno)
+#define PROGMEM
+#define pgm_read_byte(pAddress) (*(const uint8_t *)(pAddress))
+#define pgm_read_ptr(pAddress) (*(const void *const *)(pAddress))
+
+// a string F() leaves in flash (WString.h on the Uno), printed by the __FlashStringHelper overloads
+class __FlashStringHelper;
+#define F(pszText) (reinterpret_cast<const __FlashStringHelper *>(pszText))
+
+const uint8_t kHostPinCount = 20;
+
+typedef struct
+{
+    unsigned long ulMillis;
+    unsigned long ulMicros;     // past ulMillis, 0 to 999
+    uint8_t uiPinLevel[kHostPinCount];
+    uint8_t uiPinMode[kHostPinCount];
+} HostArduinoState_t;
+
+extern HostArduinoState_t gHostArduino;
+
+unsigned long millis(void);
+unsigned long micros(void);
+void pinMode(uint8_t uiPin, uint8_t uiMode);
+void digitalWrite(uint8_t uiPin, uint8_t uiValue);
+int digitalRead(uint8_t uiPin);
+
+// ***************************************************
+//
+// Host controls
+//
+// HostReset()           - all pins low, time back to zero
+// HostSetMillis()       - move the virtual clock
+// HostSetMicros()       - the same, to the microsecond
+// HostSetPinLevel()     - drive an input pin (the track sensor)
+// HostSetPinWriteHook() - called on every digitalWrite() that changes a pin
+//
+// ****************************************************
+void HostReset(void);
+void HostSetMillis(unsigned long ulMillis);
+void HostSetMicros(unsigned long ulMicros);
+void HostSetPinLevel(uint8_t uiPin, uint8_t uiValue);
+void HostSetPinWriteHook(void (*pHook)(uint8_t uiPin, uint8_t uiValue));
+
+// ***************************************************
+//
+// HostSerial
+//
+// The part of HardwareSerial the controller uses.  Output goes to a
+// FILE (or nowhere, which is the default, and the fastest).  When
+// timestamps are on, each line starts with the virtual time.
+//
+// ****************************************************
+class HostSerial
+{
+public:
+  HostSerial(void);
+  void begin(unsigned long ulBaud);
+  void setOutput(FILE *pFile, bool bTimestamp);
+  int available(void);
+  int read(void);
+  int availableForWrite(void);
+  void flush(void);
+  void queueInput(const char *pszInput);
+
+  void print(const char *pszText);
+  void print(const __FlashStringHelper *pszText);
+  void print(char cValue);
+  void print(unsigned char uiValue, int iBase = DEC);
+  void print(int iValue, int iBase = DEC);
+  void print(unsigned int uiValue, int iBase = DEC);
+  void print(long lValue, int iBase = DEC);
+  void print(unsigned long ulValue, int iBase = DEC);
+  void println(void);
+  void println(const char *pszText);
+  void println(const __FlashStringHelper *pszText);
+  void println(char cValue);
+  void println(unsigned char uiValue, int iBase = DEC);
+  void println(int iValue, int iBase = DEC);
+  void println(unsigned int uiValue, int iBase = DEC);
+  void println(long lValue, int iBase = DEC);
+  void println(unsigned long ulValue, int iBase = DEC);
+
+protected:
+  void write(const char *pszText);
+  FILE *_pOutput;
+  bool _bTimestamp;
+  bool _bLineStart;
+  char _szInput[64];
+  uint8_t _uiInputHead;
+  uint8_t _uiInputCount;
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,481 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// AvrProfile - host tool
+//
+// Runs the real Uno image (built with avr-gcc) under simavr, an
+// instruction level ATmega328P simulator, and counts AVR cycles.  The
+// host builds time the C++ on a PC, which says little about what a tick
+// costs on a 16 MHz AVR.
+//
+// Not yet run: it has only been compiled against copies of simavr 1.7's
+// declarations, never against simavr itself with a real image.  Until it
+// has been, and its figures checked against avr-size and the S command,
+// nothing it prints should be quoted; nothing in this tree quotes it.
+//
+// The track sensor is driven from a trace ("TS <millis> <level>" lines,
+// see host/traces), and the serial output is thrown away, or echoed with
+// -s.  At the end it prints:
+//
+//   - flash and static SRAM use, from the ELF, against the Uno's budget
+//   - the deepest the stack went, and the SRAM left between it and .bss
+//   - calls, mean and worst cycles of each watched function, including
+//     what it calls (CrossingSignalMain, Timer::update, the Print and
+//     HardwareSerial write paths, and any -f function)
+//   - the worst tick, against the 250 ms main tick
+//   - a flat profile: the cycles spent in each function itself, awake
+//
+// A call is counted from the cycle the PC reaches the function to the
+// instruction that pops its return address (the stack pointer goes back
+// above where it was on entry), so a function reached by a jump rather
+// than a call (a tail call) is not counted.
+//
+// Build the image with arduino-cli (the directory must be named after the
+// sketch), then the profiler against simavr (1.7 or later, for the ELF
+// symbol table):
+//
+//     arduino-cli compile --fqbn arduino:avr:uno --output-dir /tmp/SRMcrossGateV8 .
+//     g++ -std=gnu++11 -O2 -I. host/AvrProfile.cpp -lsimavr -lelf -o avrprofile
+//
+//     ./avrprofile [-t seconds] [-f function] [-s] /tmp/SRMcrossGateV8/SRMcrossGateV8.ino.elf [trace.txt]
+//
+// ****************************************************
+
+#include <cxxabi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+#include "SRMcrossGate_types.h"
+
+const unsigned long kCpuFrequency = 16000000UL;
+const unsigned long kCyclesPerMs = kCpuFrequency / 1000UL;
+const unsigned long kMainTickTime = 250;
+const uint32_t kUnoFlashSize = 32256;   // 32 KB less the 512 byte boot loader
+const uint32_t kUnoSramSize = 2048;
+const uint16_t kSramStart = 0x100;
+const uint16_t kRamEnd = 0x8FF;
+const uint32_t kDataSpaceOffset = 0x800000;
+
+static const char *gpszDefaultWatch[] =
+{
+    "CrossingSignalMain",
+    "Timer::update",
+    "HistoryFlush",
+    "Print::println",
+    "Print::write",
+    "HardwareSerial::write",
+};
+
+struct AvrFunction_t
+{
+    uint32_t ulStart;
+    uint32_t ulEnd;
+    std::string name;
+    bool bWatched;
+    unsigned long long ullSelfCycles;
+    unsigned long long ullCalls;
+    unsigned long long ullCallCycles;
+    unsigned long long ullWorstCycles;
+};
+
+struct AvrCall_t
+{
+    int iFunction;
+    uint16_t uiEntrySp;
+    avr_cycle_count_t ullStart;
+};
+
+struct TraceEdge_t
+{
+    unsigned long ulTime;
+    int iLevel;
+};
+
+static std::vector<AvrFunction_t> gFunctions;
+static bool gbEchoSerial = false;
+
+static bool CompareStart(const AvrFunction_t &a, const AvrFunction_t &b)
+{
+    return a.ulStart < b.ulStart;
+}
+
+// "Timer::update()" from "_ZN5Timer6updateEv", the name as written
+static std::string Demangle(const char *pszSymbol)
+{
+    int iStatus = 0;
+    char *pszName = abi::__cxa_demangle(pszSymbol, NULL, NULL, &iStatus);
+    std::string name((iStatus == 0) ? pszName : pszSymbol);
+
+    free(pszName);
+    return name;
+}
+
+// the name without its parameters, so "Print::println" watches every overload
+static std::string BareName(const std::string &name)
+{
+    size_t uiParen = name.find('(');
+
+    return (uiParen == std::string::npos) ? name : name.substr(0, uiParen);
+}
+
+// ***************************************************
+//
+// LoadFunctions()
+//
+// Takes the functions (flash symbols with a size) out of the ELF, sorted
+// by address so the PC can be looked up.
+//
+// ****************************************************
+static void LoadFunctions(const elf_firmware_t *pFirmware, const std::vector<std::string> &watch)
+{
+    for (uint32_t i = 0; i < pFirmware->symbolcount; i++)
+    {
+        const avr_symbol_t *pSymbol = pFirmware->symbol[i];
+        AvrFunction_t function;
+
+        if ((pSymbol->addr >= kDataSpaceOffset) || (pSymbol->size == 0))
+        {
+            continue;
+        }
+
+        function.ulStart = pSymbol->addr;
+        function.ulEnd = pSymbol->addr + pSymbol->size;
+        function.name = Demangle(pSymbol->symbol);
+        function.bWatched = std::find(watch.begin(), watch.end(), BareName(function.name)) != watch.end();
+        function.ullSelfCycles = 0;
+        function.ullCalls = 0;
+        function.ullCallCycles = 0;
+        function.ullWorstCycles = 0;
+        gFunctions.push_back(function);
+    }
+
+    std::sort(gFunctions.begin(), gFunctions.end(), CompareStart);
+}
+
+static int FindFunction(uint32_t ulPc)
+{
+    int iLow = 0;
+    int iHigh = (int)gFunctions.size() - 1;
+
+    while (iLow <= iHigh)
+    {
+        int iMid = (iLow + iHigh) / 2;
+
+        if (ulPc < gFunctions[iMid].ulStart)
+        {
+            iHigh = iMid - 1;
+        }
+        else if (ulPc >= gFunctions[iMid].ulEnd)
+        {
+            iLow = iMid + 1;
+        }
+        else
+        {
+            return iMid;
+        }
+    }
+
+    return -1;
+}
+
+static bool ReadTrace(const char *pszPath, std::vector<TraceEdge_t> *pEdges)
+{
+    FILE *pFile = fopen(pszPath, "r");
+    char szLine[128];
+
+    if (pFile == NULL)
+    {
+        perror(pszPath);
+        return false;
+    }
+
+    while (fgets(szLine, sizeof(szLine), pFile) != NULL)
+    {
+        TraceEdge_t edge;
+
+        if (sscanf(szLine, "TS %lu %d", &edge.ulTime, &edge.iLevel) == 2)
+        {
+            pEdges->push_back(edge);
+        }
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+static void SerialOutput(struct avr_irq_t *pIrq, uint32_t ulValue, void *pParam)
+{
+    (void)pIrq;
+    (void)pParam;
+
+    if (gbEchoSerial)
+    {
+        putchar((int)ulValue);
+    }
+}
+
+static uint16_t StackPointer(avr_t *pAvr)
+{
+    return (uint16_t)(pAvr->data[R_SPL] | (pAvr->data[R_SPH] << 8));
+}
+
+// Arduino digital pins 0-7 are port D, 8-13 port B, and A0-A5 (14-19) port C
+static avr_irq_t *PinIrq(avr_t *pAvr, int iPin)
+{
+    if (iPin < 8)
+    {
+        return avr_io_getirq(pAvr, AVR_IOCTL_IOPORT_GETIRQ('D'), iPin);
+    }
+    if (iPin < 14)
+    {
+        return avr_io_getirq(pAvr, AVR_IOCTL_IOPORT_GETIRQ('B'), iPin - 8);
+    }
+    return avr_io_getirq(pAvr, AVR_IOCTL_IOPORT_GETIRQ('C'), iPin - 14);
+}
+
+static double CyclesToUs(unsigned long long ullCycles)
+{
+    return ullCycles * 1e6 / kCpuFrequency;
+}
+
+int main(int argc, char *argv[])
+{
+    elf_firmware_t firmware;
+    std::vector<std::string> watch(gpszDefaultWatch, gpszDefaultWatch + sizeof(gpszDefaultWatch) / sizeof(gpszDefaultWatch[0]));
+    std::vector<TraceEdge_t> edges;
+    std::vector<AvrCall_t> calls;
+    std::vector<int> order;
+    const char *pszElf = NULL;
+    const char *pszTrace = NULL;
+    unsigned long ulRunTime = 0;
+    unsigned long long ullEndCycle;
+    unsigned long long ullAwakeCycles = 0;
+    unsigned long long ullSleepCycles = 0;
+    unsigned long long ullUnknownCycles = 0;
+    uint16_t uiLowestSp = kRamEnd;
+    uint32_t ulStaticSram;
+    uint32_t ulFlags = 0;
+    size_t uiNextEdge = 0;
+    int iTick = -1;
+    avr_irq_t *pSensorIrq;
+    avr_t *pAvr;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+        {
+            ulRunTime = strtoul(argv[++i], NULL, 0) * 1000UL;
+        }
+        else if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc))
+        {
+            watch.push_back(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            gbEchoSerial = true;
+        }
+        else if (pszElf == NULL)
+        {
+            pszElf = argv[i];
+        }
+        else
+        {
+            pszTrace = argv[i];
+        }
+    }
+
+    if (pszElf == NULL)
+    {
+        fprintf(stderr, "usage: avrprofile [-t seconds] [-f function] [-s] image.elf [trace.txt]\n");
+        return 2;
+    }
+
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(pszElf, &firmware) != 0)
+    {
+        fprintf(stderr, "avrprofile: cannot read %s\n", pszElf);
+        return 2;
+    }
+
+    // an Arduino build has no .mmcu section, so say what the Uno is
+    if (firmware.mmcu[0] == '\0')
+    {
+        strcpy(firmware.mmcu, "atmega328p");
+    }
+    if (firmware.frequency == 0)
+    {
+        firmware.frequency = kCpuFrequency;
+    }
+
+    pAvr = avr_make_mcu_by_name(firmware.mmcu);
+    if (pAvr == NULL)
+    {
+        fprintf(stderr, "avrprofile: simavr does not know %s\n", firmware.mmcu);
+        return 2;
+    }
+    avr_init(pAvr);
+    avr_load_firmware(pAvr, &firmware);
+
+    LoadFunctions(&firmware, watch);
+    for (i = 0; i < (int)gFunctions.size(); i++)
+    {
+        iTick = ((iTick < 0) && (BareName(gFunctions[i].name) == "CrossingSignalMain")) ? i : iTick;
+    }
+
+    if ((pszTrace != NULL) && !ReadTrace(pszTrace, &edges))
+    {
+        return 2;
+    }
+    if (ulRunTime == 0)
+    {
+        ulRunTime = (edges.empty() ? 0 : edges.back().ulTime) + 60000UL;
+    }
+    ullEndCycle = (unsigned long long)ulRunTime * kCyclesPerMs;
+
+    // the serial output goes to SerialOutput() rather than simavr's own printing
+    avr_ioctl(pAvr, AVR_IOCTL_UART_GET_FLAGS('0'), &ulFlags);
+    ulFlags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(pAvr, AVR_IOCTL_UART_SET_FLAGS('0'), &ulFlags);
+    avr_irq_register_notify(avr_io_getirq(pAvr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), SerialOutput, NULL);
+
+    pSensorIrq = PinIrq(pAvr, kPinAddrGateTrackSensor);
+    avr_raise_irq(pSensorIrq, 0);
+
+    while (pAvr->cycle < ullEndCycle)
+    {
+        avr_cycle_count_t ullBefore = pAvr->cycle;
+        uint32_t ulPc = pAvr->pc;
+        int iFunction = FindFunction(ulPc);
+        int iState;
+        uint16_t uiSp;
+
+        while ((uiNextEdge < edges.size()) && (edges[uiNextEdge].ulTime * (unsigned long long)kCyclesPerMs <= pAvr->cycle))
+        {
+            avr_raise_irq(pSensorIrq, edges[uiNextEdge].iLevel ? 1 : 0);
+            uiNextEdge++;
+        }
+
+        iState = avr_run(pAvr);
+        if ((iState == cpu_Done) || (iState == cpu_Crashed))
+        {
+            fprintf(stderr, "avrprofile: the simulation stopped (%s) at %lu ms\n",
+                    (iState == cpu_Done) ? "done" : "crashed", (unsigned long)(pAvr->cycle / kCyclesPerMs));
+            break;
+        }
+
+        // the cycles the instruction took, or the time asleep
+        if (pAvr->state == cpu_Sleeping)
+        {
+            ullSleepCycles += pAvr->cycle - ullBefore;
+        }
+        else
+        {
+            ullAwakeCycles += pAvr->cycle - ullBefore;
+            if (iFunction >= 0)
+            {
+                gFunctions[iFunction].ullSelfCycles += pAvr->cycle - ullBefore;
+            }
+            else
+            {
+                ullUnknownCycles += pAvr->cycle - ullBefore;
+            }
+        }
+
+        uiSp = StackPointer(pAvr);
+        uiLowestSp = (uiSp < uiLowestSp) ? uiSp : uiLowestSp;
+
+        // the calls that have returned
+        while (!calls.empty() && (uiSp > calls.back().uiEntrySp))
+        {
+            AvrFunction_t &function = gFunctions[calls.back().iFunction];
+            unsigned long long ullCycles = pAvr->cycle - calls.back().ullStart;
+
+            function.ullCalls++;
+            function.ullCallCycles += ullCycles;
+            function.ullWorstCycles = (ullCycles > function.ullWorstCycles) ? ullCycles : function.ullWorstCycles;
+            calls.pop_back();
+        }
+
+        // a call into a watched function
+        if (pAvr->pc != ulPc)
+        {
+            int iCalled = FindFunction(pAvr->pc);
+
+            if ((iCalled >= 0) && gFunctions[iCalled].bWatched && (gFunctions[iCalled].ulStart == pAvr->pc))
+            {
+                AvrCall_t call;
+
+                call.iFunction = iCalled;
+                call.uiEntrySp = uiSp;
+                call.ullStart = pAvr->cycle;
+                calls.push_back(call);
+            }
+        }
+    }
+
+    ulStaticSram = firmware.datasize + firmware.bsssize;
+
+    printf("image            : %s (%s at %lu MHz)\n", pszElf, firmware.mmcu, (unsigned long)(firmware.frequency / 1000000UL));
+    printf("flash            : %5lu of %lu bytes (%.0f%%)\n", (unsigned long)firmware.flashsize, (unsigned long)kUnoFlashSize,
+           firmware.flashsize * 100.0 / kUnoFlashSize);
+    printf("sram, static     : %5lu of %lu bytes (%.0f%%)\n", (unsigned long)ulStaticSram, (unsigned long)kUnoSramSize,
+           ulStaticSram * 100.0 / kUnoSramSize);
+    printf("stack, deepest   : %5u bytes, %d bytes left above .bss\n", (unsigned)(kRamEnd - uiLowestSp),
+           (int)uiLowestSp - (int)(kSramStart + ulStaticSram));
+    printf("simulated        : %.1f s, %.1f%% of it awake\n", pAvr->cycle / (double)kCpuFrequency,
+           (ullAwakeCycles + ullSleepCycles > 0) ? (ullAwakeCycles * 100.0 / (ullAwakeCycles + ullSleepCycles)) : 0.0);
+
+    printf("\n%-44s %9s %10s %10s %10s\n", "function (with what it calls)", "calls", "mean", "worst", "worst us");
+    for (i = 0; i < (int)gFunctions.size(); i++)
+    {
+        const AvrFunction_t &function = gFunctions[i];
+
+        if (function.bWatched)
+        {
+            printf("%-44.44s %9llu %10.0f %10llu %10.1f\n", function.name.c_str(), function.ullCalls,
+                   (function.ullCalls > 0) ? ((double)function.ullCallCycles / function.ullCalls) : 0.0,
+                   function.ullWorstCycles, CyclesToUs(function.ullWorstCycles));
+        }
+    }
+
+    if ((iTick >= 0) && (gFunctions[iTick].ullCalls > 0))
+    {
+        printf("\nworst tick       : %llu cycles, %.1f us, %.3f%% of the %lu ms tick\n", gFunctions[iTick].ullWorstCycles,
+               CyclesToUs(gFunctions[iTick].ullWorstCycles), CyclesToUs(gFunctions[iTick].ullWorstCycles) / (kMainTickTime * 10.0),
+               kMainTickTime);
+    }
+
+    // the flat profile, the biggest first
+    for (i = 0; i < (int)gFunctions.size(); i++)
+    {
+        if (gFunctions[i].ullSelfCycles > 0)
+        {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [](int a, int b) { return gFunctions[a].ullSelfCycles > gFunctions[b].ullSelfCycles; });
+
+    printf("\nflat profile, cycles awake in the function itself\n");
+    for (i = 0; (i < (int)order.size()) && (i < 20); i++)
+    {
+        const AvrFunction_t &function = gFunctions[order[i]];
+
+        printf("  %5.1f%%  %12llu  %s\n", function.ullSelfCycles * 100.0 / ullAwakeCycles, function.ullSelfCycles, function.name.c_str());
+    }
+    if (ullUnknownCycles > 0)
+    {
+        printf("  %5.1f%%  %12llu  (no symbol)\n", ullUnknownCycles * 100.0 / ullAwakeCycles, ullUnknownCycles);
+    }
+
+    avr_terminate(pAvr);
+    return 0;
+}
@@ -0,0 +1,33 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// Host build of the Arduino EEPROM library, backed by ram.
+// It starts out erased (0xFF), like a new part.
+//
+// ****************************************************
+
+#ifndef Host_EEPROM_h
+#define Host_EEPROM_h
+
+#include <inttypes.h>
+#include <string.h>
+
+const int kHostEepromSize = 1024;
+
+class HostEEPROM
+{
+public:
+  HostEEPROM(void) { erase(); }
+  uint8_t read(int iAddress) { return _uiData[iAddress]; }
+  void write(int iAddress, uint8_t uiValue) { _uiData[iAddress] = uiValue; }
+  void update(int iAddress, uint8_t uiValue) { if (_uiData[iAddress] != uiValue) _uiData[iAddress] = uiValue; }
+  void erase(void) { memset(_uiData, 0xFF, sizeof(_uiData)); }
+  int length(void) { return kHostEepromSize; }
+
+  uint8_t _uiData[kHostEepromSize];
+};
+
+extern HostEEPROM EEPROM;
+
+#endif
@@ -0,0 +1,307 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// EventBench - host tool
+//
+// Runs the same days of simulated traffic (the SimBench trains) with the
+// controller on its old 250 ms tick, and event driven
+// (SRMcrossGate_Controller.h).  It reports how many times a day
+// CrossingSignalMain() ran each way, what caused the event driven runs,
+// and the latency from the sensor edge that brings a train in to the
+// warning lights starting.
+//
+// Then it runs the same days again with sensor chatter, pulses shorter
+// than kTrackSensorDebounceTime, where the controller is quiet: just after
+// the debounce has taken a change, and between the trains.  None of them
+// may start the warning lights or change the debounced track state (the
+// status LED), and the latency of the trains must be as it was without
+// them.  The exit status is 1 if one did.
+//
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/SimVcd.cpp host/EventBench.cpp -o eventbench
+//
+//     ./eventbench [trains per day] [-d days]
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SimKernel.h"
+
+const unsigned long kOneDay = 24UL * 60UL * 60UL * 1000UL;
+
+// the flasher changes a light every 500 ms, so a gap longer than this is a new warning
+const unsigned long kLightsQuietTime = 1000UL;
+
+typedef struct
+{
+    unsigned long ulRuns;
+    unsigned long ulSteps;
+    unsigned long ulEvents[kControllerEventTypes];
+    unsigned long ulTrains;
+    unsigned long ulStatusChanges;
+    unsigned long ulLatencyMin;
+    unsigned long ulLatencyMax;
+    unsigned long long ullLatencySum;
+} EventResult_t;
+
+static EventResult_t gResult;
+static unsigned long gulSensorEdgeTime;
+static bool gbSensorEdgeSeen;
+static bool gbInputSeen;
+static unsigned long gulLastLightsTime;
+static bool gbLightsSeen;
+
+static void NoteInput(uint8_t uiPin, uint8_t uiLevel)
+{
+    gbInputSeen = true;
+
+    // the last edge to occupied before the lights come on is the one the debounce qualified
+    if ((uiPin == kPinAddrGateTrackSensor) && (uiLevel == kTrackOccupied))
+    {
+        gulSensorEdgeTime = millis();
+        gbSensorEdgeSeen = true;
+    }
+}
+
+static void NotePinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    unsigned long ulNow = millis();
+    (void)uiValue;
+
+    // the status LED follows the debounced track state; power on turns it off
+    if ((uiPin == kPinAddrGateStatusLED) && gbInputSeen)
+    {
+        gResult.ulStatusChanges++;
+        return;
+    }
+
+    if ((uiPin != kPinAddrGateLightsControlLeft) && (uiPin != kPinAddrGateLightsControlRight))
+    {
+        return;
+    }
+
+    // the lamp test at power on has no train behind it
+    if (gbSensorEdgeSeen && ((gbLightsSeen == false) || (ulNow - gulLastLightsTime > kLightsQuietTime)))
+    {
+        unsigned long ulLatency = ulNow - gulSensorEdgeTime;
+
+        if ((gResult.ulTrains == 0) || (ulLatency < gResult.ulLatencyMin))
+        {
+            gResult.ulLatencyMin = ulLatency;
+        }
+        if (ulLatency > gResult.ulLatencyMax)
+        {
+            gResult.ulLatencyMax = ulLatency;
+        }
+        gResult.ullLatencySum += ulLatency;
+        gResult.ulTrains++;
+        gbSensorEdgeSeen = false;
+    }
+    gbLightsSeen = true;
+    gulLastLightsTime = ulNow;
+}
+
+// ***************************************************
+//
+// ScheduleDayOfTrains()
+//
+// The same trains as SimBench: a little sensor chatter as each one
+// arrives and leaves.  The same seed gives the same days.  With bChatter,
+// the sensor also drops out for a second while each train is in, and comes
+// back with a 200 ms bounce; it bounces for 150 ms after each train has
+// been cleared; and a minute after there are pulses of 100 to 450 ms, 5 s
+// apart.  Each dropout is two more debounced changes.
+//
+// ****************************************************
+static void ScheduleDayOfTrains(SimKernel *pKernel, int iTrains, int iDays, unsigned int uiSeed, bool bChatter)
+{
+    unsigned long ulTime = 60000UL;
+    unsigned long ulGap = kOneDay / (iTrains + 1);
+
+    iTrains *= iDays;
+
+    srand(uiSeed);
+
+    for (int i = 0; i < iTrains; i++)
+    {
+        unsigned long ulArrive = ulTime + (rand() % (ulGap / 2));
+        unsigned long ulLeave = ulArrive + 30000UL + (rand() % 120000UL);
+
+        for (int iBounce = 0; iBounce < 3; iBounce++)
+        {
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL, kPinAddrGateTrackSensor, HIGH);
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL + 60UL, kPinAddrGateTrackSensor, LOW);
+        }
+        pKernel->scheduleInput(ulArrive + 600UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave, kPinAddrGateTrackSensor, LOW);
+        pKernel->scheduleInput(ulLeave + 200UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave + 300UL, kPinAddrGateTrackSensor, LOW);
+
+        if (bChatter)
+        {
+            pKernel->scheduleInput(ulArrive + 20000UL, kPinAddrGateTrackSensor, LOW);
+            pKernel->scheduleInput(ulArrive + 21000UL, kPinAddrGateTrackSensor, HIGH);
+            pKernel->scheduleInput(ulArrive + 21200UL, kPinAddrGateTrackSensor, LOW);
+            pKernel->scheduleInput(ulArrive + 21350UL, kPinAddrGateTrackSensor, HIGH);
+
+            pKernel->scheduleInput(ulLeave + 1100UL, kPinAddrGateTrackSensor, HIGH);
+            pKernel->scheduleInput(ulLeave + 1250UL, kPinAddrGateTrackSensor, LOW);
+
+            // so long as they are over before the next train can come
+            for (unsigned long ulPulse = 100UL; ulPulse < kTrackSensorDebounceTime; ulPulse += 50UL)
+            {
+                unsigned long ulStart = ulLeave + 60000UL + (ulPulse / 50UL) * 5000UL;
+
+                if (ulStart + ulPulse + kTrackSensorDebounceTime >= ulTime + ulGap)
+                {
+                    break;
+                }
+
+                pKernel->scheduleInput(ulStart, kPinAddrGateTrackSensor, HIGH);
+                pKernel->scheduleInput(ulStart + ulPulse, kPinAddrGateTrackSensor, LOW);
+            }
+        }
+
+        ulTime += ulGap;
+    }
+}
+
+// ***************************************************
+//
+// RunDays()
+//
+// The controller keeps its state in statics, so each run is made in a
+// child process, such that both start from power on.
+//
+// ****************************************************
+static EventResult_t RunDays(bool bEventDriven, bool bChatter, int iTrains, int iDays)
+{
+    EventResult_t result;
+    int fds[2];
+    pid_t pid;
+
+    memset(&result, 0, sizeof(result));
+
+    if (pipe(fds) != 0)
+    {
+        perror("pipe");
+        exit(2);
+    }
+
+    pid = fork();
+    if (pid == 0)
+    {
+        SimKernel kernel;
+
+        close(fds[0]);
+        gbControllerEventDriven = bEventDriven;
+        HostSetPinWriteHook(NotePinWrite);
+        kernel.reset();
+        kernel.setInputHook(NoteInput);
+        ScheduleDayOfTrains(&kernel, iTrains, iDays, 1, bChatter);
+
+        kernel.boot();
+        kernel.runUntil(kOneDay * iDays);
+
+        gResult.ulRuns = gCrossingState.ulControllerRuns;
+        gResult.ulSteps = gCrossingState.ulControllerSteps;
+        memcpy(gResult.ulEvents, gCrossingState.ulControllerEvents, sizeof(gResult.ulEvents));
+        if (write(fds[1], &gResult, sizeof(gResult)) != (ssize_t)sizeof(gResult))
+        {
+            _exit(2);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    if ((pid < 0) || (read(fds[0], &result, sizeof(result)) != (ssize_t)sizeof(result)))
+    {
+        fprintf(stderr, "eventbench: the run failed\n");
+        exit(2);
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+
+    return result;
+}
+
+static void PrintResult(const char *pszName, const EventResult_t *pResult, int iDays)
+{
+    printf("  %-22s: %8lu runs a day   latency %4lu / %6.1f / %4lu ms (min/mean/max, %lu trains, %lu track changes)\n",
+           pszName, pResult->ulRuns / iDays, pResult->ulLatencyMin,
+           (pResult->ulTrains > 0) ? (double)pResult->ullLatencySum / pResult->ulTrains : 0.0,
+           pResult->ulLatencyMax, pResult->ulTrains, pResult->ulStatusChanges);
+}
+
+// the chatter must not have been taken for a train, nor moved the debounced state
+static bool SameTrains(const char *pszName, const EventResult_t *pChatter, const EventResult_t *pQuiet)
+{
+    if ((pChatter->ulTrains == pQuiet->ulTrains) && (pChatter->ulStatusChanges == pQuiet->ulStatusChanges + 2 * pQuiet->ulTrains) &&
+        (pChatter->ulLatencyMin == pQuiet->ulLatencyMin) && (pChatter->ulLatencyMax == pQuiet->ulLatencyMax))
+    {
+        return true;
+    }
+
+    printf("  %s: the chatter got through the debounce\n", pszName);
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int iTrains = 24;
+    int iDays = 1;
+    EventResult_t tick;
+    EventResult_t event;
+    EventResult_t tickChatter;
+    EventResult_t eventChatter;
+    bool bPass;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+        {
+            iDays = atoi(argv[++i]);
+        }
+        else
+        {
+            iTrains = atoi(argv[i]);
+        }
+    }
+
+    if (iDays < 1)
+    {
+        iDays = 1;
+    }
+
+    tick = RunDays(false, false, iTrains, iDays);
+    event = RunDays(true, false, iTrains, iDays);
+    tickChatter = RunDays(false, true, iTrains, iDays);
+    eventChatter = RunDays(true, true, iTrains, iDays);
+
+    printf("%d day%s, %d trains a day\n", iDays, (iDays == 1) ? "" : "s", iTrains);
+    PrintResult("250 ms tick", &tick, iDays);
+    PrintResult("event driven", &event, iDays);
+    printf("  event driven runs a day: sensor edges %lu, sensor changes %lu, deadlines %lu (steps %lu), duty recovered %lu\n",
+           event.ulEvents[kControllerEvent_SensorEdge] / iDays, event.ulEvents[kControllerEvent_SensorChange] / iDays,
+           event.ulEvents[kControllerEvent_Deadline] / iDays, event.ulSteps / iDays,
+           event.ulEvents[kControllerEvent_DutyRecovered] / iDays);
+    printf("  evaluations saved      : %lu a day (%.1f%%)\n", (tick.ulRuns - event.ulRuns) / iDays,
+           (tick.ulRuns > 0) ? 100.0 * (tick.ulRuns - event.ulRuns) / tick.ulRuns : 0.0);
+
+    printf("with sensor chatter shorter than the debounce\n");
+    PrintResult("250 ms tick, chatter", &tickChatter, iDays);
+    PrintResult("event driven, chatter", &eventChatter, iDays);
+    bPass = SameTrains("250 ms tick", &tickChatter, &tick);
+    bPass = SameTrains("event driven", &eventChatter, &event) && bPass;
+
+    return bPass ? 0 : 1;
+}
@@ -0,0 +1,520 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// FaultCampaign - host tool
+//
+// A Monte Carlo fault injection campaign.  Each trial is two hours of
+// traffic with one fault picked at random:
+//
+//   none        - the baseline
+//   stuck-high  - the track sensor sticks occupied for a while
+//   stuck-low   - the track sensor sticks vacant for a while (a dead sensor)
+//   chatter     - the track sensor toggles at random for a while
+//   motor-glitch - the motor loses power for a moment, without the controller knowing
+//   reset       - the controller resets (reset button, brown out) at a random time
+//
+// The gate arm is modelled as well, as the controller has no idea where
+// the arm really is: it takes kGateTravelTime of motor power to go from up
+// to down (GateArm.h).  For each trial we measure:
+//
+//   exposure   - seconds a train was on the crossing with the gate not all the way down
+//   lockouts   - how often the motor duty cycle limit locked out the gate
+//   exhausted  - whether the Timer ran out of slots (WarningLightTimerStart() returned -1)
+//
+// The trials are spread over worker processes (SimWorkers.h).  Every
+// trial is a CSV row as soon as it finishes, and the summary at the end
+// gives each fault's mean and 95% confidence interval.  A trial's random
+// numbers only depend on the seed and the trial number, so the results do
+// not depend on the number of workers.
+//
+//     g++ -std=gnu++11 -O3 -flto -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/GateArm.cpp host/SimWorkers.cpp host/FaultCampaign.cpp -o faults
+//
+//     ./faults [-n trials] [-j workers] [-r seed] [-o trials.csv] [-s summary.csv]
+//
+// ****************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SimKernel.h"
+#include "GateArm.h"
+#include "SimWorkers.h"
+
+const unsigned long kTrialTime = 2UL * 60UL * 60UL * 1000UL;
+
+enum
+{
+    kFault_None = 0,
+    kFault_StuckHigh,
+    kFault_StuckLow,
+    kFault_Chatter,
+    kFault_MotorGlitch,
+    kFault_Reset,
+    kFault_Count
+};
+
+static const char *gkFaultNames[kFault_Count] =
+{
+    "none", "stuck-high", "stuck-low", "chatter", "motor-glitch", "reset"
+};
+
+typedef struct
+{
+    uint32_t uiTrial;
+    uint8_t  uiFault;
+    uint8_t  uiExhausted;
+    uint16_t uiLockouts;
+    float    fFaultStart;
+    float    fFaultLength;
+    float    fExposure;
+    float    fMotorSeconds;
+} TrialResult_t;
+
+typedef struct
+{
+    unsigned long ulStart;
+    unsigned long ulEnd;
+} Interval_t;
+
+// ***************************************************
+//
+// TrialRandom_t
+//
+// A small xorshift generator, one per trial.
+//
+// ****************************************************
+typedef struct
+{
+    uint64_t uiState;
+} TrialRandom_t;
+
+static void RandomSeed(TrialRandom_t *pRandom, uint32_t uiSeed, uint32_t uiTrial)
+{
+    pRandom->uiState = ((uint64_t)uiSeed << 32) ^ (uiTrial * 0x9E3779B97F4A7C15ULL) ^ 0x2545F4914F6CDD1DULL;
+    if (pRandom->uiState == 0)
+    {
+        pRandom->uiState = 1;
+    }
+}
+
+static uint32_t RandomNext(TrialRandom_t *pRandom)
+{
+    pRandom->uiState ^= pRandom->uiState >> 12;
+    pRandom->uiState ^= pRandom->uiState << 25;
+    pRandom->uiState ^= pRandom->uiState >> 27;
+    return (uint32_t)((pRandom->uiState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// a whole number from ulLow up to (not including) ulHigh
+static unsigned long RandomRange(TrialRandom_t *pRandom, unsigned long ulLow, unsigned long ulHigh)
+{
+    return ulLow + (RandomNext(pRandom) % (ulHigh - ulLow));
+}
+
+// ***************************************************
+//
+// The simulated world, for the trial in progress
+//
+// ****************************************************
+static SimKernel gKernel;
+static GateArm gArm;
+static std::vector<Interval_t> gOccupied;
+static double gdExposure;
+static uint16_t guiLockouts;
+static bool gbLockedOut;
+static bool gbExhausted;
+
+static unsigned long Overlap(unsigned long ulStart, unsigned long ulEnd, const Interval_t &interval)
+{
+    unsigned long ulFrom = (ulStart > interval.ulStart) ? ulStart : interval.ulStart;
+    unsigned long ulTo = (ulEnd < interval.ulEnd) ? ulEnd : interval.ulEnd;
+
+    return (ulTo > ulFrom) ? (ulTo - ulFrom) : 0;
+}
+
+// ***************************************************
+//
+// UpdateWorld()
+//
+// Adds up the time a train was on the crossing with the gate not down since
+// the last update, and moves the gate arm.  The controller steps at least
+// every 250 ms while anything is moving, which is the resolution of the
+// exposure figure.
+//
+// ****************************************************
+static void UpdateWorld(void)
+{
+    unsigned long ulNow = gKernel.now();
+    size_t i;
+
+    if ((ulNow > gArm.lastUpdate()) && !gArm.isDown())
+    {
+        unsigned long ulOccupied = 0;
+
+        for (i = 0; i < gOccupied.size(); i++)
+        {
+            ulOccupied += Overlap(gArm.lastUpdate(), ulNow, gOccupied[i]);
+        }
+        gdExposure += ulOccupied / 1000.0;
+    }
+
+    gArm.update(ulNow);
+}
+
+static void WatchPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    if ((uiPin == kPinAddrGateArmControlMotorPower) || (uiPin == kPinAddrGateArmControlMotorDirection))
+    {
+        UpdateWorld();
+        gArm.pinWrite(gKernel.now(), uiPin, uiValue);
+    }
+}
+
+static void WatchStep(void)
+{
+    UpdateWorld();
+
+    if (gCrossingState.bDutyCycleExceededFlag && !gbLockedOut)
+    {
+        guiLockouts++;
+    }
+    gbLockedOut = gCrossingState.bDutyCycleExceededFlag;
+
+    if ((gCrossingState.iWarningLightTimerRightID == -1) || (gCrossingState.iWarningLightTimerLeftID == -1) ||
+        (gCrossingState.iWarningLightRightTimerID == -1) || (gCrossingState.iWarningLightLeftTimerID == -1))
+    {
+        gbExhausted = true;
+    }
+}
+
+// ***************************************************
+//
+// ScheduleSensor()
+//
+// Works out what the sensor shows for the trains in gOccupied, with a
+// little chatter as each train arrives and leaves, then lays the fault (if
+// it is a sensor fault) over the top, and schedules the result.
+//
+// ****************************************************
+static void ScheduleSensor(TrialRandom_t *pRandom, int iFault, const Interval_t &fault)
+{
+    std::vector<std::pair<unsigned long, uint8_t> > edges;
+    uint8_t uiLevel = LOW;
+    size_t i;
+
+    for (i = 0; i < gOccupied.size(); i++)
+    {
+        const Interval_t &train = gOccupied[i];
+        unsigned long t;
+
+        for (t = train.ulStart; t < train.ulStart + 300; t += RandomRange(pRandom, 20, 100))
+        {
+            edges.push_back(std::make_pair(t, (uint8_t)(((t - train.ulStart) / 50) & 1 ? LOW : HIGH)));
+        }
+        edges.push_back(std::make_pair(train.ulStart + 300, (uint8_t)HIGH));
+        edges.push_back(std::make_pair(train.ulEnd, (uint8_t)LOW));
+        edges.push_back(std::make_pair(train.ulEnd + RandomRange(pRandom, 50, 200), (uint8_t)HIGH));
+        edges.push_back(std::make_pair(train.ulEnd + 300, (uint8_t)LOW));
+    }
+
+    for (i = 0; i < edges.size(); i++)
+    {
+        unsigned long t = edges[i].first;
+
+        // a stuck sensor hides every edge in the fault, and shows the real level again after it
+        if (((iFault == kFault_StuckHigh) || (iFault == kFault_StuckLow)) && (t >= fault.ulStart) && (t < fault.ulEnd))
+        {
+            uiLevel = edges[i].second;
+            continue;
+        }
+        if (((iFault == kFault_StuckHigh) || (iFault == kFault_StuckLow)) && (t >= fault.ulEnd) && (i > 0) && (edges[i - 1].first < fault.ulEnd))
+        {
+            gKernel.scheduleInput(fault.ulEnd, kPinAddrGateTrackSensor, uiLevel);
+        }
+        gKernel.scheduleInput(t, kPinAddrGateTrackSensor, edges[i].second);
+        uiLevel = edges[i].second;
+    }
+
+    if (iFault == kFault_StuckHigh)
+    {
+        gKernel.scheduleInput(fault.ulStart, kPinAddrGateTrackSensor, HIGH);
+    }
+    else if (iFault == kFault_StuckLow)
+    {
+        gKernel.scheduleInput(fault.ulStart, kPinAddrGateTrackSensor, LOW);
+    }
+    else if (iFault == kFault_Chatter)
+    {
+        unsigned long t;
+        uint8_t uiChatter = HIGH;
+
+        for (t = fault.ulStart; t < fault.ulEnd; t += RandomRange(pRandom, 20, 400))
+        {
+            gKernel.scheduleInput(t, kPinAddrGateTrackSensor, uiChatter);
+            uiChatter = !uiChatter;
+        }
+    }
+}
+
+// ***************************************************
+//
+// RunTrial()
+//
+// ****************************************************
+static TrialResult_t RunTrial(uint32_t uiSeed, uint32_t uiTrial)
+{
+    TrialRandom_t random;
+    TrialResult_t result;
+    Interval_t fault;
+    unsigned long ulTime;
+    int iFault;
+
+    RandomSeed(&random, uiSeed, uiTrial);
+    iFault = (int)RandomRange(&random, 0, kFault_Count);
+
+    // a train every 10 to 30 minutes, each one on the crossing for 30 seconds to 3 minutes
+    gOccupied.clear();
+    ulTime = RandomRange(&random, 60000UL, 600000UL);
+    while (ulTime < kTrialTime - 600000UL)
+    {
+        Interval_t train;
+
+        train.ulStart = ulTime;
+        train.ulEnd = ulTime + RandomRange(&random, 30000UL, 180000UL);
+        gOccupied.push_back(train);
+        ulTime = train.ulEnd + RandomRange(&random, 600000UL, 1800000UL);
+    }
+
+    // the fault hits around one of the trains, when it can do some harm
+    {
+        const Interval_t &train = gOccupied[RandomRange(&random, 0, gOccupied.size())];
+
+        fault.ulStart = train.ulStart - 30000UL + RandomRange(&random, 0, 90000UL);
+        if (iFault == kFault_MotorGlitch)
+        {
+            fault.ulStart = train.ulStart + RandomRange(&random, 0, 30000UL);
+            fault.ulEnd = fault.ulStart + RandomRange(&random, 50, 3000);
+        }
+        else if (iFault == kFault_Reset)
+        {
+            fault.ulEnd = fault.ulStart;
+        }
+        else
+        {
+            fault.ulEnd = fault.ulStart + RandomRange(&random, 1000, 300000UL);
+        }
+    }
+
+    gArm.reset(0);
+    if (iFault == kFault_MotorGlitch)
+    {
+        gArm.setPowerCut(fault.ulStart, fault.ulEnd);
+    }
+
+    gdExposure = 0.0;
+    guiLockouts = 0;
+    gbLockedOut = false;
+    gbExhausted = false;
+
+    gKernel.reset();
+    ScheduleSensor(&random, iFault, fault);
+    gKernel.boot();
+
+    if (iFault == kFault_Reset)
+    {
+        gKernel.runUntil(fault.ulStart);
+        UpdateWorld();
+        gArm.powerLost(gKernel.now());
+        gKernel.restart();
+    }
+    gKernel.runUntil(kTrialTime);
+    UpdateWorld();
+
+    result.uiTrial = uiTrial;
+    result.uiFault = (uint8_t)iFault;
+    result.uiExhausted = gbExhausted ? 1 : 0;
+    result.uiLockouts = guiLockouts;
+    result.fFaultStart = (iFault == kFault_None) ? 0.0f : fault.ulStart / 1000.0f;
+    result.fFaultLength = (iFault == kFault_None) ? 0.0f : (fault.ulEnd - fault.ulStart) / 1000.0f;
+    result.fExposure = (float)gdExposure;
+    result.fMotorSeconds = (float)gArm.motorSeconds();
+
+    return result;
+}
+
+// ***************************************************
+//
+// Summary
+//
+// ****************************************************
+typedef struct
+{
+    unsigned long ulTrials;
+    double dExposureSum;
+    double dExposureSquares;
+    unsigned long ulLockedOut;
+    unsigned long ulExhausted;
+} FaultSummary_t;
+
+// the 95% Wilson score interval for a proportion
+static void WilsonInterval(unsigned long ulHits, unsigned long ulTrials, double *pdLow, double *pdHigh)
+{
+    const double z = 1.96;
+    double n = (double)ulTrials;
+    double p = (n > 0) ? ulHits / n : 0.0;
+    double dCentre = (p + z * z / (2 * n)) / (1 + z * z / n);
+    double dHalf = (z / (1 + z * z / n)) * sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+
+    *pdLow = ((n > 0) && (dCentre - dHalf > 0.0)) ? dCentre - dHalf : 0.0;
+    *pdHigh = ((n > 0) && (dCentre + dHalf < 1.0)) ? dCentre + dHalf : 1.0;
+}
+
+static void WriteSummary(FILE *pFile, const FaultSummary_t *pSummary)
+{
+    int iFault;
+
+    fprintf(pFile, "fault,trials,exposure_mean_s,exposure_ci_low_s,exposure_ci_high_s,"
+                   "lockout_rate,lockout_ci_low,lockout_ci_high,exhausted_rate,exhausted_ci_low,exhausted_ci_high\n");
+
+    for (iFault = 0; iFault < kFault_Count; iFault++)
+    {
+        const FaultSummary_t *p = &pSummary[iFault];
+        double n = (double)p->ulTrials;
+        double dMean = (n > 0) ? p->dExposureSum / n : 0.0;
+        double dVariance = (n > 1) ? (p->dExposureSquares - n * dMean * dMean) / (n - 1) : 0.0;
+        double dHalf = (n > 1) ? 1.96 * sqrt((dVariance > 0) ? dVariance / n : 0.0) : 0.0;
+        double dLockLow, dLockHigh, dExhaustLow, dExhaustHigh;
+
+        WilsonInterval(p->ulLockedOut, p->ulTrials, &dLockLow, &dLockHigh);
+        WilsonInterval(p->ulExhausted, p->ulTrials, &dExhaustLow, &dExhaustHigh);
+
+        fprintf(pFile, "%s,%lu,%.2f,%.2f,%.2f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                gkFaultNames[iFault], p->ulTrials, dMean, dMean - dHalf, dMean + dHalf,
+                (n > 0) ? p->ulLockedOut / n : 0.0, dLockLow, dLockHigh,
+                (n > 0) ? p->ulExhausted / n : 0.0, dExhaustLow, dExhaustHigh);
+    }
+}
+
+// ***************************************************
+//
+// RunWorker()
+//
+// Runs every iWorkers'th trial, and sends the results back.
+//
+// ****************************************************
+static uint32_t guiTrials = 3000;
+static uint32_t guiSeed = 1;
+static FaultSummary_t gSummary[kFault_Count];
+static FILE *gpTrials = NULL;
+
+static void RunWorker(int iWorker, int iWorkers)
+{
+    uint32_t uiTrial;
+
+    HostSetPinWriteHook(WatchPinWrite);
+    gKernel.setStepHook(WatchStep);
+
+    for (uiTrial = iWorker; uiTrial < guiTrials; uiTrial += iWorkers)
+    {
+        TrialResult_t result = RunTrial(guiSeed, uiTrial);
+
+        SimWorkerSend(&result);
+    }
+}
+
+static void ReceiveResult(const void *pRecord)
+{
+    const TrialResult_t *pResult = (const TrialResult_t *)pRecord;
+    FaultSummary_t *p = &gSummary[pResult->uiFault];
+
+    p->ulTrials++;
+    p->dExposureSum += pResult->fExposure;
+    p->dExposureSquares += (double)pResult->fExposure * pResult->fExposure;
+    p->ulLockedOut += (pResult->uiLockouts > 0) ? 1 : 0;
+    p->ulExhausted += pResult->uiExhausted;
+
+    if (gpTrials != NULL)
+    {
+        fprintf(gpTrials, "%u,%s,%.3f,%.3f,%.2f,%u,%u,%.1f\n", pResult->uiTrial, gkFaultNames[pResult->uiFault],
+                pResult->fFaultStart, pResult->fFaultLength, pResult->fExposure, pResult->uiLockouts,
+                pResult->uiExhausted, pResult->fMotorSeconds);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *pszSummary = NULL;
+    int iWorkers = SimWorkersDefault();
+    long lDone;
+    int i;
+
+    for (i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-n") == 0)
+        {
+            guiTrials = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-j") == 0)
+        {
+            iWorkers = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            guiSeed = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-o") == 0)
+        {
+            gpTrials = fopen(argv[i + 1], "w");
+            if (gpTrials == NULL)
+            {
+                perror(argv[i + 1]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            pszSummary = argv[i + 1];
+        }
+    }
+
+    memset(gSummary, 0, sizeof(gSummary));
+    if (gpTrials != NULL)
+    {
+        fprintf(gpTrials, "trial,fault,fault_start_s,fault_length_s,exposure_s,lockouts,timer_exhausted,motor_s\n");
+    }
+
+    lDone = SimWorkersRun(iWorkers, sizeof(TrialResult_t), RunWorker, ReceiveResult);
+
+    if (gpTrials != NULL)
+    {
+        fclose(gpTrials);
+    }
+
+    if (lDone != (long)guiTrials)
+    {
+        fprintf(stderr, "faults: only %ld of %u trials came back\n", lDone, guiTrials);
+    }
+
+    WriteSummary(stdout, gSummary);
+    if (pszSummary != NULL)
+    {
+        FILE *pFile = fopen(pszSummary, "w");
+
+        if (pFile == NULL)
+        {
+            perror(pszSummary);
+            return 2;
+        }
+        WriteSummary(pFile, gSummary);
+        fclose(pFile);
+    }
+
+    return (lDone == (long)guiTrials) ? 0 : 1;
+}
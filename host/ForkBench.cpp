@@ -0,0 +1,166 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// ForkBench - host tool
+//
+// "What if a second train turns up at time T?"  The first train arrives,
+// the gate comes down, and the controller is saved (SimKernel::save())
+// part way through.  Each branch restores that snapshot and runs on with
+// a second train arriving at a different time.  The same branches are
+// then run again from boot, to check the branches came out the same
+// (output pins and final controller state), and to compare the speed.
+//
+//     g++ -std=gnu++11 -O2 -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/ForkBench.cpp -o forkbench
+//
+//     ./forkbench [branches]
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SimKernel.h"
+
+const unsigned long kFirstTrainArrives = 20000;
+const unsigned long kFirstTrainLeaves = 80000;
+const unsigned long kSnapshotTime = 50000;
+const unsigned long kSecondTrainSpread = 60000;
+const unsigned long kSecondTrainOnCrossing = 40000;
+const unsigned long kBranchRunTime = 30000;
+const unsigned long kRestoreCount = 1000000;
+
+static SimKernel gKernel;
+static unsigned long gulPinDigest;
+
+// the output pin changes after the snapshot go into a digest, such that a branch and its run from boot can be compared
+static void DigestPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    if (gKernel.now() > kSnapshotTime)
+    {
+        gulPinDigest = (gulPinDigest * 31UL) ^ (gKernel.now() * 7UL + uiPin * 2UL + uiValue);
+    }
+}
+
+static unsigned long SecondTrainArrives(unsigned long ulBranch)
+{
+    return kSnapshotTime + 1000UL + ((ulBranch * 997UL) % kSecondTrainSpread);
+}
+
+// the first train's edges, from ulFrom on
+static void ScheduleFirstTrain(unsigned long ulFrom)
+{
+    if (kFirstTrainArrives >= ulFrom)
+    {
+        gKernel.scheduleInput(kFirstTrainArrives, kPinAddrGateTrackSensor, HIGH);
+    }
+    gKernel.scheduleInput(kFirstTrainLeaves, kPinAddrGateTrackSensor, LOW);
+}
+
+static void ScheduleSecondTrain(unsigned long ulBranch)
+{
+    unsigned long ulArrive = SecondTrainArrives(ulBranch);
+
+    gKernel.scheduleInput(ulArrive, kPinAddrGateTrackSensor, HIGH);
+    gKernel.scheduleInput(ulArrive + 120UL, kPinAddrGateTrackSensor, LOW);
+    gKernel.scheduleInput(ulArrive + 300UL, kPinAddrGateTrackSensor, HIGH);
+    gKernel.scheduleInput(ulArrive + kSecondTrainOnCrossing, kPinAddrGateTrackSensor, LOW);
+}
+
+static double CpuSeconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+    static SimSnapshot_t snapshot;
+    unsigned long ulBranches = (argc > 1) ? strtoul(argv[1], NULL, 0) : 5000;
+    unsigned long *pulForkDigest = (unsigned long *)calloc(ulBranches, sizeof(unsigned long));
+    CrossingState_t *pForkState = (CrossingState_t *)calloc(ulBranches, sizeof(CrossingState_t));
+    unsigned long ulMismatches = 0;
+    unsigned long ulSteps = 0;
+    unsigned long ulBootSteps = 0;
+    unsigned long ulBranch;
+    unsigned long i;
+    double dRestoreSeconds;
+    double dForkSeconds;
+    double dBootSeconds;
+    clock_t start;
+
+    HostSetPinWriteHook(DigestPinWrite);
+
+    // the common start: boot, the first train arrives and the gate comes down
+    gKernel.reset();
+    ScheduleFirstTrain(0);
+    gKernel.boot();
+    gKernel.runUntil(kSnapshotTime);
+    gKernel.save(&snapshot);
+
+    // restore() on its own
+    start = clock();
+    for (i = 0; i < kRestoreCount; i++)
+    {
+        gKernel.restore(&snapshot);
+    }
+    dRestoreSeconds = CpuSeconds(start);
+
+    // every branch from the snapshot
+    start = clock();
+    for (ulBranch = 0; ulBranch < ulBranches; ulBranch++)
+    {
+        unsigned long ulSnapshotSteps;
+
+        gKernel.restore(&snapshot);
+        ulSnapshotSteps = gKernel.steps();
+        ScheduleFirstTrain(kSnapshotTime);
+        ScheduleSecondTrain(ulBranch);
+
+        gulPinDigest = 0;
+        gKernel.runUntil(SecondTrainArrives(ulBranch) + kBranchRunTime);
+        ulSteps += gKernel.steps() - ulSnapshotSteps;
+
+        pulForkDigest[ulBranch] = gulPinDigest;
+        pForkState[ulBranch] = gCrossingState;
+    }
+    dForkSeconds = CpuSeconds(start);
+
+    // and again from boot
+    start = clock();
+    for (ulBranch = 0; ulBranch < ulBranches; ulBranch++)
+    {
+        gKernel.reset();
+        EEPROM.erase();
+        ScheduleFirstTrain(0);
+        ScheduleSecondTrain(ulBranch);
+
+        gulPinDigest = 0;
+        gKernel.boot();
+        gKernel.runUntil(SecondTrainArrives(ulBranch) + kBranchRunTime);
+        ulBootSteps += gKernel.steps();
+
+        if ((gulPinDigest != pulForkDigest[ulBranch]) ||
+            (memcmp(&gCrossingState, &pForkState[ulBranch], sizeof(gCrossingState)) != 0))
+        {
+            ulMismatches++;
+        }
+    }
+    dBootSeconds = CpuSeconds(start);
+
+    printf("snapshot         : %lu bytes\n", (unsigned long)sizeof(SimSnapshot_t));
+    printf("restore only     : %10.0f forks/s\n", kRestoreCount / dRestoreSeconds);
+    printf("branch from fork : %10.0f branches/s  (%lu steps each)\n", ulBranches / dForkSeconds, ulSteps / ulBranches);
+    printf("branch from boot : %10.0f branches/s  (%lu steps each)\n", ulBranches / dBootSeconds, ulBootSteps / ulBranches);
+    printf("speedup          : %.1fx\n", dBootSeconds / dForkSeconds);
+    printf("%s (%lu of %lu branches differ)\n", (ulMismatches == 0) ? "branches match" : "BRANCHES DIFFER", ulMismatches, ulBranches);
+
+    free(pulForkDigest);
+    free(pForkState);
+
+    return (ulMismatches == 0) ? 0 : 1;
+}
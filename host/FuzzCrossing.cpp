@@ -0,0 +1,408 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// FuzzCrossing - host tool
+//
+// Drives the controller with track sensor sequences made up from fuzzer
+// input bytes, and checks the safety rules on every step:
+//
+//   - the motor direction relay never changes while the motor has power
+//     (that would drive the motor one way and then the other)
+//   - the warning lights are flashing whenever the gate is down or moving
+//   - the motor never runs for longer than kMaxMotorOnTime at a time
+//
+// Each input byte is one sensor edge: bit 7 is the new sensor level and
+// bits 0-6 the time since the previous edge (see EdgeGap()).  Every input
+// starts from a power cycle, so the gate initialization is covered too.
+//
+// Built with the native compiler, the tool is its own small fuzzer: it
+// mutates a corpus of inputs, and keeps the ones that reach a state machine
+// transition (from the black box) it has not seen before.
+//
+//     g++ -std=gnu++11 -O3 -flto -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/FuzzCrossing.cpp -o fuzz
+//
+//     ./fuzz [-t seconds] [-r seed]     fuzz, stop at the first failure (written to crash-<n>)
+//     ./fuzz crash-<n>                  run one input, with the serial output and pin timeline
+//
+// -flto lets millis() and digitalRead() inline into the state machine,
+// which is worth about half the run time.  With clang, the same file
+// builds as a libFuzzer target:
+//
+//     clang++ -std=gnu++11 -O2 -g -fsanitize=fuzzer -DFUZZ_WITH_LIBFUZZER -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/FuzzCrossing.cpp -o fuzz
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_BlackBox.h"
+#include "SimKernel.h"
+
+// the longest input we use, and how long we let the controller settle after the last edge
+const size_t kMaxInputSize = 24;
+const unsigned long kSettleTime = 25000;
+
+// the longest motor run is 13 seconds, we allow one more main loop tick
+const unsigned long kMaxMotorOnTime = kThirteenSeconds + 250;
+
+static SimKernel gKernel;
+static const char *gpszViolation = NULL;
+static unsigned long gulViolationTime = 0;
+static unsigned long gulMotorOnTime = 0;
+static bool gbMotorOn = false;
+static bool gbTrace = false;
+
+// the state machine transitions we have seen, one bit per (previous state, state) pair
+static uint8_t gCoverage[256 * 256 / 8];
+static uint8_t guiBlackBoxHead = 0;
+static bool gbNewCoverage = false;
+
+// ***************************************************
+//
+// EdgeGap()
+//
+// The time from the previous edge, most of the range goes to the short gaps
+// where the debounce and the state machine delays are.
+//
+// ****************************************************
+static unsigned long EdgeGap(uint8_t uiByte)
+{
+    uint8_t uiGap = uiByte & 0x7F;
+
+    if (uiGap < 32)
+    {
+        return uiGap * 20UL;                  // 0 to 0.6 seconds, sensor chatter and the debounce
+    }
+    if (uiGap < 112)
+    {
+        return (uiGap - 32) * 250UL;          // 0 to 20 seconds in main loop ticks, the gate sequences and time limit
+    }
+    return (uiGap - 112) * 8000UL;            // 0 to 2 minutes, the motor duty cycle
+}
+
+static void Violation(const char *pszMessage)
+{
+    if (gpszViolation == NULL)
+    {
+        gpszViolation = pszMessage;
+        gulViolationTime = millis();
+    }
+}
+
+static void CheckPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    if (gbTrace)
+    {
+        printf("%10lu pin %2u = %u\n", millis(), uiPin, uiValue);
+    }
+
+    if ((uiPin == kPinAddrGateArmControlMotorDirection) && gbMotorOn)
+    {
+        Violation("motor direction changed while the motor has power");
+    }
+
+    if (uiPin == kPinAddrGateArmControlMotorPower)
+    {
+        gbMotorOn = (uiValue == kGateArmControlMotorOn);
+        gulMotorOnTime = millis();
+    }
+}
+
+static void CheckStep(void)
+{
+    bool bLightsOn = (digitalRead(kPinAddrGateLightsControlLeft) == kWarningLightsOn) ||
+                     (digitalRead(kPinAddrGateLightsControlRight) == kWarningLightsOn);
+
+    if ((gbMotorOn || (gCrossingState.bGateState == kGateInDownPosition)) && !bLightsOn)
+    {
+        Violation("warning lights off while the gate is down or moving");
+    }
+
+    if (gbMotorOn && ((millis() - gulMotorOnTime) > kMaxMotorOnTime))
+    {
+        Violation("motor on for too long");
+    }
+
+    // note any state machine transition we have not seen before
+    while (guiBlackBoxHead != gBlackBox.uiHead)
+    {
+        BlackBoxRecord_t *pRecord = &gBlackBox.records[guiBlackBoxHead];
+        unsigned int uiBit = (pRecord->uiPreviousState << 8) | pRecord->uiState;
+
+        if ((gCoverage[uiBit >> 3] & (1 << (uiBit & 7))) == 0)
+        {
+            gCoverage[uiBit >> 3] |= (1 << (uiBit & 7));
+            gbNewCoverage = true;
+        }
+        guiBlackBoxHead = (guiBlackBoxHead + 1) & (kBlackBoxRecordCount - 1);
+    }
+}
+
+static bool IsSettled(void)
+{
+    return (gCrossingState.iTrackOcupationState == kTrackVacant) &&
+           (gCrossingState.bGateState == kGateInTheUpPosition) &&
+           (gCrossingState.ulSensorChangeStartTime == 0) &&
+           (digitalRead(kPinAddrGateTrackSensor) == LOW) &&
+           !gbMotorOn;
+}
+
+// ***************************************************
+//
+// RunInput()
+//
+// Power cycles the controller, runs one input and returns the violation
+// (or NULL if all was well).
+//
+// ****************************************************
+static const char *RunInput(const uint8_t *pData, size_t size)
+{
+    unsigned long ulTime = 0;
+    size_t i;
+
+    if (size > kMaxInputSize)
+    {
+        size = kMaxInputSize;
+    }
+
+    gpszViolation = NULL;
+    gbMotorOn = false;
+    gulMotorOnTime = 0;
+    gbNewCoverage = false;
+
+    gKernel.reset();
+    for (i = 0; i < size; i++)
+    {
+        ulTime += EdgeGap(pData[i]);
+        gKernel.scheduleInput(ulTime, kPinAddrGateTrackSensor, (pData[i] & 0x80) ? HIGH : LOW);
+    }
+
+    gKernel.boot();
+    guiBlackBoxHead = gBlackBox.uiHead;
+
+    // once the inputs are used up and the gate is back up on a quiet track, nothing
+    // can move the motor again, so we stop there rather than run out the settle time
+    ulTime += kSettleTime;
+    while ((gpszViolation == NULL) && gKernel.step(ulTime))
+    {
+        if (!gKernel.inputsPending() && IsSettled())
+        {
+            break;
+        }
+    }
+
+    return gpszViolation;
+}
+
+#if defined(FUZZ_WITH_LIBFUZZER)
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *pData, size_t size)
+{
+    static bool bHooked = false;
+
+    if (!bHooked)
+    {
+        HostSetPinWriteHook(CheckPinWrite);
+        gKernel.setStepHook(CheckStep);
+        bHooked = true;
+    }
+
+    if (RunInput(pData, size) != NULL)
+    {
+        fprintf(stderr, "violation at %lu ms: %s\n", gulViolationTime, gpszViolation);
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+typedef std::vector<uint8_t> FuzzInput_t;
+
+// ***************************************************
+//
+// MutateInput()
+//
+// One of a few simple mutations, picked at random.
+//
+// ****************************************************
+static void MutateInput(FuzzInput_t *pInput, const std::vector<FuzzInput_t> &corpus)
+{
+    switch (rand() % 6)
+    {
+        case 0:     // a new random byte
+            if (!pInput->empty())
+            {
+                (*pInput)[rand() % pInput->size()] = (uint8_t)rand();
+            }
+            break;
+
+        case 1:     // flip a bit
+            if (!pInput->empty())
+            {
+                (*pInput)[rand() % pInput->size()] ^= (uint8_t)(1 << (rand() % 8));
+            }
+            break;
+
+        case 2:     // insert a byte
+            if (pInput->size() < kMaxInputSize)
+            {
+                pInput->insert(pInput->begin() + (rand() % (pInput->size() + 1)), (uint8_t)rand());
+            }
+            break;
+
+        case 3:     // remove a byte
+            if (pInput->size() > 1)
+            {
+                pInput->erase(pInput->begin() + (rand() % pInput->size()));
+            }
+            break;
+
+        case 4:     // nudge a gap
+            if (!pInput->empty())
+            {
+                uint8_t *p = &(*pInput)[rand() % pInput->size()];
+                *p = (*p & 0x80) | ((*p + ((rand() & 1) ? 1 : 0x7F)) & 0x7F);
+            }
+            break;
+
+        default:    // splice in the tail of another input
+        {
+            const FuzzInput_t &other = corpus[rand() % corpus.size()];
+            size_t uiCut = rand() % (pInput->size() + 1);
+
+            pInput->resize(uiCut);
+            pInput->insert(pInput->end(), other.begin() + (rand() % (other.size() + 1)), other.end());
+            if (pInput->size() > kMaxInputSize)
+            {
+                pInput->resize(kMaxInputSize);
+            }
+            break;
+        }
+    }
+}
+
+static int ReplayFile(const char *pszFile)
+{
+    FILE *pFile = fopen(pszFile, "rb");
+    uint8_t data[kMaxInputSize];
+    size_t size;
+
+    if (pFile == NULL)
+    {
+        perror(pszFile);
+        return 2;
+    }
+    size = fread(data, 1, sizeof(data), pFile);
+    fclose(pFile);
+
+    gbTrace = true;
+    Serial.setOutput(stdout, true);
+    if (RunInput(data, size) != NULL)
+    {
+        printf("violation at %lu ms: %s\n", gulViolationTime, gpszViolation);
+        return 1;
+    }
+    printf("no violation\n");
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<FuzzInput_t> corpus;
+    double dSeconds = 60.0;
+    unsigned int uiSeed = (unsigned int)time(NULL);
+    unsigned long ulRuns = 0;
+    clock_t start;
+    int iArg;
+
+    HostSetPinWriteHook(CheckPinWrite);
+    gKernel.setStepHook(CheckStep);
+
+    for (iArg = 1; iArg < argc; iArg++)
+    {
+        if ((strcmp(argv[iArg], "-t") == 0) && (iArg + 1 < argc))
+        {
+            dSeconds = atof(argv[++iArg]);
+        }
+        else if ((strcmp(argv[iArg], "-r") == 0) && (iArg + 1 < argc))
+        {
+            uiSeed = (unsigned int)strtoul(argv[++iArg], NULL, 0);
+        }
+        else
+        {
+            return ReplayFile(argv[iArg]);
+        }
+    }
+
+    srand(uiSeed);
+
+    // start with one ordinary train: chatter on arrival, a minute on the crossing, chatter as it leaves
+    {
+        static const uint8_t kOneTrain[] = { 0x80 | 48, 3, 0x80 | 3, 3, 0x80 | 3, 112 + 8, 0x80 | 10, 5 };
+        corpus.push_back(FuzzInput_t(kOneTrain, kOneTrain + sizeof(kOneTrain)));
+    }
+
+    start = clock();
+    while ((double)(clock() - start) / CLOCKS_PER_SEC < dSeconds)
+    {
+        FuzzInput_t input = corpus[rand() % corpus.size()];
+        int iMutations = 1 + (rand() % 4);
+
+        while (iMutations-- > 0)
+        {
+            MutateInput(&input, corpus);
+        }
+        if (input.empty())
+        {
+            continue;
+        }
+
+        ulRuns++;
+        if (RunInput(&input[0], input.size()) != NULL)
+        {
+            char szFile[32];
+            FILE *pFile;
+
+            snprintf(szFile, sizeof(szFile), "crash-%lu", ulRuns);
+            pFile = fopen(szFile, "wb");
+            if (pFile != NULL)
+            {
+                fwrite(&input[0], 1, input.size(), pFile);
+                fclose(pFile);
+            }
+            printf("violation at %lu ms after %lu runs: %s\n", gulViolationTime, ulRuns, gpszViolation);
+            printf("input written to %s (seed %u)\n", szFile, uiSeed);
+            return 1;
+        }
+
+        if (gbNewCoverage)
+        {
+            corpus.push_back(input);
+        }
+    }
+
+    {
+        double dElapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+        unsigned int uiTransitions = 0;
+        size_t i;
+
+        for (i = 0; i < sizeof(gCoverage); i++)
+        {
+            uiTransitions += __builtin_popcount(gCoverage[i]);
+        }
+        printf("%lu sequences in %.1f s, %.0f per minute\n", ulRuns, dElapsed, ulRuns * 60.0 / dElapsed);
+        printf("%u state transitions seen, %u inputs in the corpus\n", uiTransitions, (unsigned int)corpus.size());
+    }
+
+    return 0;
+}
+
+#endif
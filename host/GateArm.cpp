@@ -0,0 +1,93 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// GateArm - a model of the gate arm (host only)
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "SRMcrossGate_types.h"
+#include "GateArm.h"
+
+GateArm::GateArm(void)
+{
+    _ulTravelTime = kGateArmTravelTime;
+    reset(0);
+}
+
+// the arm starts out up, with the motor off
+void GateArm::reset(unsigned long ulNow)
+{
+    _ulLastUpdate = ulNow;
+    _ulPowerCutStart = 0;
+    _ulPowerCutEnd = 0;
+    _fPosition = 0.0f;
+    _bMotorPower = false;
+    _bMotorDown = false;
+    _dMotorSeconds = 0.0;
+}
+
+void GateArm::setPowerCut(unsigned long ulStart, unsigned long ulEnd)
+{
+    _ulPowerCutStart = ulStart;
+    _ulPowerCutEnd = ulEnd;
+}
+
+// ***************************************************
+//
+// update()
+//
+// Moves the arm for the time since the last update.
+//
+// ****************************************************
+void GateArm::update(unsigned long ulNow)
+{
+    if (ulNow <= _ulLastUpdate)
+    {
+        return;
+    }
+
+    if (_bMotorPower)
+    {
+        unsigned long ulFrom = (_ulLastUpdate > _ulPowerCutStart) ? _ulLastUpdate : _ulPowerCutStart;
+        unsigned long ulTo = (ulNow < _ulPowerCutEnd) ? ulNow : _ulPowerCutEnd;
+        unsigned long ulPowered = (ulNow - _ulLastUpdate) - ((ulTo > ulFrom) ? (ulTo - ulFrom) : 0);
+        float fTravel = (float)ulPowered / _ulTravelTime;
+
+        _dMotorSeconds += ulPowered / 1000.0;
+        _fPosition += _bMotorDown ? fTravel : -fTravel;
+        _fPosition = (_fPosition < 0.0f) ? 0.0f : ((_fPosition > 1.0f) ? 1.0f : _fPosition);
+    }
+
+    _ulLastUpdate = ulNow;
+}
+
+// ***************************************************
+//
+// pinWrite()
+//
+// Picks up uiValue written to one of the motor relays.  The arm moves as
+// it was up to ulNow, then as the relays are from now on.
+//
+// ****************************************************
+void GateArm::pinWrite(unsigned long ulNow, uint8_t uiPin, uint8_t uiValue)
+{
+    if (uiPin == kPinAddrGateArmControlMotorPower)
+    {
+        update(ulNow);
+        _bMotorPower = (uiValue == kGateArmControlMotorOn);
+    }
+    else if (uiPin == kPinAddrGateArmControlMotorDirection)
+    {
+        update(ulNow);
+        _bMotorDown = (uiValue == kGateArmControlMotorDown);
+    }
+}
+
+// the relays drop out when the controller resets, without a pin write
+void GateArm::powerLost(unsigned long ulNow)
+{
+    update(ulNow);
+    _bMotorPower = false;
+}
@@ -0,0 +1,58 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// GateArm - a model of the gate arm (host only)
+//
+// The controller never finds out where the gate arm is, it just runs the
+// motor for a while.  This follows the motor power and direction relays
+// and moves the arm: kGateArmTravelTime of motor power takes it from all
+// the way up to all the way down.  A power cut (a motor fault the
+// controller does not see) stops the arm for a while.
+//
+// Call pinWrite() from the host pin write hook, and update() before
+// looking at the arm.
+//
+// ****************************************************
+
+#ifndef GateArm_h
+#define GateArm_h
+
+#include <inttypes.h>
+
+const unsigned long kGateArmTravelTime = 12000;
+
+class GateArm
+{
+
+public:
+  GateArm(void);
+
+  void reset(unsigned long ulNow);
+  void setTravelTime(unsigned long ulTravelTime) { _ulTravelTime = ulTravelTime; }
+  void setPowerCut(unsigned long ulStart, unsigned long ulEnd);
+  void update(unsigned long ulNow);
+  void pinWrite(unsigned long ulNow, uint8_t uiPin, uint8_t uiValue);
+  void powerLost(unsigned long ulNow);
+
+  float position(void) { return _fPosition; }
+  bool isDown(void) { return _fPosition >= 1.0f; }
+  bool isUp(void) { return _fPosition <= 0.0f; }
+  bool isMotorOn(void) { return _bMotorPower; }
+  bool isMotorDown(void) { return _bMotorDown; }
+  unsigned long lastUpdate(void) { return _ulLastUpdate; }
+  double motorSeconds(void) { return _dMotorSeconds; }
+
+protected:
+  unsigned long _ulTravelTime;
+  unsigned long _ulLastUpdate;
+  unsigned long _ulPowerCutStart;
+  unsigned long _ulPowerCutEnd;
+  float _fPosition;                     // 0 is up, 1 is down
+  bool _bMotorPower;
+  bool _bMotorDown;
+  double _dMotorSeconds;
+
+};
+
+#endif
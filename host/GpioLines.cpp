@@ -0,0 +1,415 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// GpioLines - the controller's pins on Linux (host only)
+//
+// ****************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/gpio.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include "GpioLines.h"
+
+const unsigned long long kNsPerMs = 1000000ULL;
+
+unsigned long long GpioNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+// ***************************************************
+//
+// GpioChardevLines
+//
+// ****************************************************
+GpioChardevLines::GpioChardevLines(void)
+{
+    _iInputFd = -1;
+    _iOutputFd = -1;
+    _uiInputPin = 0;
+    for (int i = 0; i < kGpioMaxPins; i++)
+    {
+        _iOutputIndex[i] = -1;
+    }
+}
+
+GpioChardevLines::~GpioChardevLines(void)
+{
+    if (_iInputFd >= 0)
+    {
+        close(_iInputFd);
+    }
+    if (_iOutputFd >= 0)
+    {
+        close(_iOutputFd);
+    }
+}
+
+// ***************************************************
+//
+// open()
+//
+// Asks the chip for the input line, with both edges reported, and for
+// every other mapped pin as an output, starting low (as the Uno's pins
+// do until setup() writes them).
+//
+// ****************************************************
+bool GpioChardevLines::open(const char *pszChip, uint8_t uiInputPin, const GpioPinMap_t *pMap, int iMapCount)
+{
+    struct gpio_v2_line_request input;
+    struct gpio_v2_line_request output;
+    int iChipFd = ::open(pszChip, O_RDWR | O_CLOEXEC);
+    bool bFoundInput = false;
+
+    if (iChipFd < 0)
+    {
+        perror(pszChip);
+        return false;
+    }
+
+    memset(&input, 0, sizeof(input));
+    memset(&output, 0, sizeof(output));
+    snprintf(input.consumer, sizeof(input.consumer), "SRMcrossGate");
+    snprintf(output.consumer, sizeof(output.consumer), "SRMcrossGate");
+    input.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    input.event_buffer_size = kGpioMaxEdges;
+    output.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+
+    _uiInputPin = uiInputPin;
+    for (int i = 0; i < iMapCount; i++)
+    {
+        if (pMap[i].uiPin >= kGpioMaxPins)
+        {
+            continue;
+        }
+
+        if (pMap[i].uiPin == uiInputPin)
+        {
+            input.offsets[0] = pMap[i].uiLine;
+            input.num_lines = 1;
+            bFoundInput = true;
+        }
+        else if (output.num_lines < GPIO_V2_LINES_MAX)
+        {
+            _iOutputIndex[pMap[i].uiPin] = output.num_lines;
+            output.offsets[output.num_lines++] = pMap[i].uiLine;
+        }
+    }
+
+    // the outputs start low: the values attribute is left at zero
+    output.config.num_attrs = 1;
+    output.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    output.config.attrs[0].mask = (output.num_lines >= 64) ? ~0ULL : ((1ULL << output.num_lines) - 1);
+
+    if (!bFoundInput || (ioctl(iChipFd, GPIO_V2_GET_LINE_IOCTL, &input) < 0) ||
+        ((output.num_lines > 0) && (ioctl(iChipFd, GPIO_V2_GET_LINE_IOCTL, &output) < 0)))
+    {
+        fprintf(stderr, "%s: cannot get the lines: %s\n", pszChip, bFoundInput ? strerror(errno) : "no line for the input pin");
+        close(iChipFd);
+        return false;
+    }
+
+    _iInputFd = input.fd;
+    _iOutputFd = (output.num_lines > 0) ? output.fd : -1;
+    close(iChipFd);
+
+    return true;
+}
+
+int GpioChardevLines::readLevel(uint8_t uiPin)
+{
+    struct gpio_v2_line_values values;
+
+    if ((uiPin != _uiInputPin) || (_iInputFd < 0))
+    {
+        return 0;
+    }
+
+    values.bits = 0;
+    values.mask = 1;
+    if (ioctl(_iInputFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0)
+    {
+        return 0;
+    }
+
+    return (int)(values.bits & 1);
+}
+
+// each edge carries the kernel's time stamp, taken in the interrupt
+int GpioChardevLines::readEdges(GpioEdge_t *pEdges, int iMax)
+{
+    struct gpio_v2_line_event events[kGpioMaxEdges];
+    ssize_t lBytes;
+    int iCount;
+
+    iMax = (iMax > kGpioMaxEdges) ? kGpioMaxEdges : iMax;
+    lBytes = read(_iInputFd, events, iMax * sizeof(events[0]));
+    if (lBytes < 0)
+    {
+        return (errno == EAGAIN) ? 0 : -1;
+    }
+
+    iCount = (int)(lBytes / sizeof(events[0]));
+    for (int i = 0; i < iCount; i++)
+    {
+        pEdges[i].uiPin = _uiInputPin;
+        pEdges[i].uiLevel = (events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 0;
+        pEdges[i].ullTime = events[i].timestamp_ns;
+    }
+
+    return iCount;
+}
+
+void GpioChardevLines::write(uint8_t uiPin, uint8_t uiLevel)
+{
+    struct gpio_v2_line_values values;
+
+    if ((uiPin >= kGpioMaxPins) || (_iOutputIndex[uiPin] < 0))
+    {
+        return;
+    }
+
+    values.mask = 1ULL << _iOutputIndex[uiPin];
+    values.bits = uiLevel ? values.mask : 0;
+    ioctl(_iOutputFd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values);
+}
+
+// ***************************************************
+//
+// GpioPipeLines
+//
+// ****************************************************
+GpioPipeLines::GpioPipeLines(void)
+{
+    _iEpollFd = -1;
+    _iInputFd = -1;
+    _iKeepOpenFd = -1;
+    _iTimerFd = -1;
+    _uiSensorPin = 0;
+    _pOutput = NULL;
+    _ullStart = 0;
+    _uiLineLength = 0;
+    memset(_uiLevel, 0, sizeof(_uiLevel));
+}
+
+GpioPipeLines::~GpioPipeLines(void)
+{
+    int fds[4] = { _iEpollFd, _iInputFd, _iKeepOpenFd, _iTimerFd };
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+}
+
+// ***************************************************
+//
+// open()
+//
+// pszInput is "-" for stdin, a pipe or FIFO, or a trace file.  A trace
+// file is read in one go (regular files cannot be waited on), and its
+// edges come due on a timerfd.  Times in the input are milliseconds
+// after ullStart.
+//
+// ****************************************************
+bool GpioPipeLines::open(const char *pszInput, uint8_t uiSensorPin, FILE *pOutput, unsigned long long ullStart)
+{
+    struct epoll_event event;
+    struct stat info;
+
+    _uiSensorPin = uiSensorPin;
+    _pOutput = pOutput;
+    _ullStart = ullStart;
+
+    _iInputFd = (strcmp(pszInput, "-") == 0) ? dup(STDIN_FILENO) : ::open(pszInput, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if ((_iInputFd < 0) || (fstat(_iInputFd, &info) != 0))
+    {
+        perror(pszInput);
+        return false;
+    }
+    fcntl(_iInputFd, F_SETFL, fcntl(_iInputFd, F_GETFL) | O_NONBLOCK);
+
+    _iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    _iTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if ((_iEpollFd < 0) || (_iTimerFd < 0))
+    {
+        perror("epoll");
+        return false;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = _iTimerFd;
+    epoll_ctl(_iEpollFd, EPOLL_CTL_ADD, _iTimerFd, &event);
+
+    if (S_ISREG(info.st_mode))
+    {
+        // a trace: take it all now
+        readInput(ullStart);
+        armNextEdge();
+        return true;
+    }
+
+    // a FIFO reads as the end of the file whenever nobody has it open for
+    // writing, so hold it open ourselves, and the writers can come and go
+    if (S_ISFIFO(info.st_mode) && (strcmp(pszInput, "-") != 0))
+    {
+        _iKeepOpenFd = ::open(pszInput, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+
+    event.data.fd = _iInputFd;
+    epoll_ctl(_iEpollFd, EPOLL_CTL_ADD, _iInputFd, &event);
+
+    return true;
+}
+
+int GpioPipeLines::readLevel(uint8_t uiPin)
+{
+    return (uiPin < kGpioMaxPins) ? _uiLevel[uiPin] : 0;
+}
+
+// ***************************************************
+//
+// readEdges()
+//
+// Reads whatever the pipe has, then hands back the edges that are due.
+// Returns -1 once the input has ended and every edge has been given out.
+//
+// ****************************************************
+int GpioPipeLines::readEdges(GpioEdge_t *pEdges, int iMax)
+{
+    unsigned long long ullNow = GpioNow();
+    unsigned long long ullExpirations;
+    int iCount = 0;
+
+    if (read(_iTimerFd, &ullExpirations, sizeof(ullExpirations)) < 0)
+    {
+        ullExpirations = 0;
+    }
+
+    if (_iInputFd >= 0)
+    {
+        readInput(ullNow);
+    }
+
+    while (!_edges.empty() && (_edges.top().ullTime <= ullNow) && (iCount < iMax))
+    {
+        pEdges[iCount] = _edges.top();
+        _edges.pop();
+
+        if (pEdges[iCount].uiPin < kGpioMaxPins)
+        {
+            _uiLevel[pEdges[iCount].uiPin] = pEdges[iCount].uiLevel;
+        }
+        iCount++;
+    }
+
+    armNextEdge();
+
+    return ((iCount == 0) && (_iInputFd < 0) && _edges.empty()) ? -1 : iCount;
+}
+
+void GpioPipeLines::write(uint8_t uiPin, uint8_t uiLevel)
+{
+    if (_pOutput != NULL)
+    {
+        fprintf(_pOutput, "OUT %llu %u %u\n", (GpioNow() - _ullStart) / kNsPerMs, uiPin, uiLevel);
+    }
+}
+
+void GpioPipeLines::readInput(unsigned long long ullNow)
+{
+    char szBuffer[4096];
+    ssize_t lBytes;
+
+    while ((lBytes = read(_iInputFd, szBuffer, sizeof(szBuffer))) > 0)
+    {
+        for (ssize_t i = 0; i < lBytes; i++)
+        {
+            if (szBuffer[i] == '\n')
+            {
+                _szLine[_uiLineLength] = '\0';
+                parseLine(_szLine, ullNow);
+                _uiLineLength = 0;
+            }
+            else if (_uiLineLength + 1 < sizeof(_szLine))
+            {
+                _szLine[_uiLineLength++] = szBuffer[i];
+            }
+        }
+    }
+
+    // the writer has gone (and it is not a FIFO we hold open)
+    if (lBytes == 0)
+    {
+        if (_uiLineLength > 0)
+        {
+            _szLine[_uiLineLength] = '\0';
+            parseLine(_szLine, ullNow);
+            _uiLineLength = 0;
+        }
+        epoll_ctl(_iEpollFd, EPOLL_CTL_DEL, _iInputFd, NULL);
+        close(_iInputFd);
+        _iInputFd = -1;
+    }
+}
+
+// "<pin> <level>" now, or "TS <millis> <level>" for the sensor at a time
+void GpioPipeLines::parseLine(const char *pszLine, unsigned long long ullNow)
+{
+    GpioEdge_t edge;
+    unsigned long ulTime;
+    unsigned int uiPin;
+    unsigned int uiLevel;
+
+    if (sscanf(pszLine, "TS %lu %u", &ulTime, &uiLevel) == 2)
+    {
+        edge.uiPin = _uiSensorPin;
+        edge.ullTime = _ullStart + (ulTime * kNsPerMs);
+    }
+    else if (sscanf(pszLine, "%u %u", &uiPin, &uiLevel) == 2)
+    {
+        edge.uiPin = (uint8_t)uiPin;
+        edge.ullTime = ullNow;
+    }
+    else
+    {
+        return;
+    }
+
+    edge.uiLevel = (uiLevel != 0) ? 1 : 0;
+    _edges.push(edge);
+}
+
+void GpioPipeLines::armNextEdge(void)
+{
+    struct itimerspec spec;
+
+    memset(&spec, 0, sizeof(spec));
+    if (!_edges.empty())
+    {
+        // a time in the past fires straight away, but zero would disarm it
+        unsigned long long ullTime = (_edges.top().ullTime == 0) ? 1 : _edges.top().ullTime;
+
+        spec.it_value.tv_sec = (time_t)(ullTime / 1000000000ULL);
+        spec.it_value.tv_nsec = (long)(ullTime % 1000000000ULL);
+    }
+
+    timerfd_settime(_iTimerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
@@ -0,0 +1,124 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// GpioLines - the controller's pins on Linux (host only)
+//
+// The Linux runtime (LinuxRuntime.h) reads the track sensor edges and
+// drives the outputs through a GpioLines.  Each one gives a file
+// descriptor to wait on, which is readable when there are input edges.
+//
+// GpioChardevLines - the GPIO character device (/dev/gpiochipN), with the
+//                    kernel time stamping each edge.  Each Arduino pin is
+//                    mapped to a line of the chip.
+// GpioPipeLines    - a stand in, for testing without the hardware.  Edges
+//                    come in as text on a pipe, a FIFO or stdin ("2 1" sets
+//                    pin 2 high, "TS <millis> <level>" sets the track sensor
+//                    at that time), or from a trace file, replayed in real
+//                    time.  The outputs are written out as "OUT <millis>
+//                    <pin> <level>" lines.
+//
+// All times are CLOCK_MONOTONIC nanoseconds.
+//
+// ****************************************************
+
+#ifndef GpioLines_h
+#define GpioLines_h
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <queue>
+#include <vector>
+
+typedef struct
+{
+    uint8_t uiPin;
+    uint8_t uiLevel;
+    unsigned long long ullTime;
+} GpioEdge_t;
+
+typedef struct
+{
+    uint8_t uiPin;
+    unsigned int uiLine;
+} GpioPinMap_t;
+
+const int kGpioMaxPins = 20;
+const int kGpioMaxEdges = 16;
+
+class GpioLines
+{
+
+public:
+  virtual ~GpioLines(void) {}
+
+  virtual int fd(void) = 0;
+  virtual int readLevel(uint8_t uiPin) = 0;
+  virtual int readEdges(GpioEdge_t *pEdges, int iMax) = 0;
+  virtual void write(uint8_t uiPin, uint8_t uiLevel) = 0;
+
+};
+
+class GpioChardevLines : public GpioLines
+{
+
+public:
+  GpioChardevLines(void);
+  ~GpioChardevLines(void);
+
+  bool open(const char *pszChip, uint8_t uiInputPin, const GpioPinMap_t *pMap, int iMapCount);
+
+  int fd(void) { return _iInputFd; }
+  int readLevel(uint8_t uiPin);
+  int readEdges(GpioEdge_t *pEdges, int iMax);
+  void write(uint8_t uiPin, uint8_t uiLevel);
+
+protected:
+  int _iInputFd;
+  int _iOutputFd;
+  uint8_t _uiInputPin;
+  int _iOutputIndex[kGpioMaxPins];
+
+};
+
+class GpioPipeLines : public GpioLines
+{
+
+public:
+  GpioPipeLines(void);
+  ~GpioPipeLines(void);
+
+  bool open(const char *pszInput, uint8_t uiSensorPin, FILE *pOutput, unsigned long long ullStart);
+
+  int fd(void) { return _iEpollFd; }
+  int readLevel(uint8_t uiPin);
+  int readEdges(GpioEdge_t *pEdges, int iMax);
+  void write(uint8_t uiPin, uint8_t uiLevel);
+
+protected:
+  struct EdgeLater
+  {
+      bool operator()(const GpioEdge_t &a, const GpioEdge_t &b) const { return a.ullTime > b.ullTime; }
+  };
+
+  void readInput(unsigned long long ullNow);
+  void parseLine(const char *pszLine, unsigned long long ullNow);
+  void armNextEdge(void);
+
+  int _iEpollFd;
+  int _iInputFd;
+  int _iKeepOpenFd;
+  int _iTimerFd;
+  uint8_t _uiSensorPin;
+  FILE *_pOutput;
+  unsigned long long _ullStart;
+  uint8_t _uiLevel[kGpioMaxPins];
+  char _szLine[128];
+  size_t _uiLineLength;
+  std::priority_queue<GpioEdge_t, std::vector<GpioEdge_t>, EdgeLater> _edges;
+
+};
+
+unsigned long long GpioNow(void);
+
+#endif
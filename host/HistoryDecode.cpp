@@ -0,0 +1,202 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// This software was developed to operate on an Arduino Uno
+// microprocessor board.  It operates a crossing guard
+// program for the Southeastern Railway Musuem.
+//
+// HistoryDecode - host tool
+//
+// Reads a serial capture of the "H" history dump on stdin, and prints
+// the crossing events stored in the EEPROM, oldest first.
+//
+//     g++ -O2 -I. host/HistoryDecode.cpp -o HistoryDecode
+//     ./HistoryDecode < capture.txt
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include "SRMcrossGate_History.h"
+
+static const char *HistoryEventName(uint8_t uiEvent)
+{
+    switch (uiEvent)
+    {
+        case kHistoryEvent_Boot:            return "Boot";
+        case kHistoryEvent_OccupancyStart:  return "Occupancy Start";
+        case kHistoryEvent_OccupancyEnd:    return "Occupancy End (s)";
+        case kHistoryEvent_GateDown:        return "Gate Down Latency (s)";
+        case kHistoryEvent_MotorRun:        return "Motor Run (s)";
+        case kHistoryEvent_DutyCycleTrip:   return "Duty Cycle Trip, Motor Total (s)";
+        default:                            return "?";
+    }
+}
+
+// ***************************************************
+//
+// ReadVarint()
+//
+// Reads a varint out of the image.  Returns false if it runs past the end.
+//
+// ****************************************************
+static bool ReadVarint(const std::vector<uint8_t> &image, int *piAddress, int iEnd, unsigned long *pulValue)
+{
+    unsigned long ulValue = 0;
+    int iShift = 0;
+
+    while (*piAddress < iEnd)
+    {
+        uint8_t uiByte = image[(*piAddress)++];
+
+        ulValue |= (unsigned long)(uiByte & 0x7F) << iShift;
+        iShift += 7;
+
+        if ((uiByte & 0x80) == 0)
+        {
+            *pulValue = ulValue;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int BlockAddress(int iBlock)
+{
+    return kHistorySignatureSize + (iBlock * kHistoryBlockSize);
+}
+
+int main(void)
+{
+    const int kImageSize = kHistorySignatureSize + (kHistoryBlockCount * kHistoryBlockSize);
+    std::vector<uint8_t> image;
+    char szLine[512];
+    int iHead = -1;
+    int iBlock;
+    int iBoot = 0;
+    int iEvents = 0;
+    int iBytesUsed = 0;
+    int iHexByte;
+
+    // collect the "HX" lines, ignoring everything else in the capture
+    while (fgets(szLine, sizeof(szLine), stdin) != NULL)
+    {
+        if (strncmp(szLine, "HX ", 3) != 0)
+        {
+            continue;
+        }
+
+        for (char *p = szLine + 3; (p[0] != '\0') && (p[1] != '\0') && (sscanf(p, "%2x", &iHexByte) == 1); p += 2)
+        {
+            image.push_back((uint8_t)iHexByte);
+        }
+    }
+
+    if ((int)image.size() < kImageSize)
+    {
+        fprintf(stderr, "HistoryDecode: expected %d bytes, found %d\n", kImageSize, (int)image.size());
+        return 1;
+    }
+
+    if ((image[0] != kHistorySignature0) || (image[1] != kHistorySignature1))
+    {
+        fprintf(stderr, "HistoryDecode: no history signature\n");
+        return 1;
+    }
+
+    // find the newest block, the same way the controller does
+    for (iBlock = 0; iBlock < kHistoryBlockCount; iBlock++)
+    {
+        uint8_t uiSequence = image[BlockAddress(iBlock)];
+        uint8_t uiNextSequence = image[BlockAddress((iBlock + 1) % kHistoryBlockCount)];
+
+        if ((uiSequence != kHistoryBlockErased) && (uiNextSequence != ((uiSequence + 1) % kHistorySequenceModulus)))
+        {
+            iHead = iBlock;
+            break;
+        }
+    }
+
+    if (iHead < 0)
+    {
+        printf("History is empty\n");
+        return 0;
+    }
+
+    // walk the blocks from the oldest to the newest
+    for (int i = 1; i <= kHistoryBlockCount; i++)
+    {
+        int iThisBlock = (iHead + i) % kHistoryBlockCount;
+        int iAddress = BlockAddress(iThisBlock);
+        int iEnd = iAddress + kHistoryBlockSize;
+        unsigned long ulTime;
+        unsigned long ulDelta;
+        unsigned long ulValue;
+
+        if (image[iAddress] == kHistoryBlockErased)
+        {
+            continue;
+        }
+
+        iAddress++;
+        if (ReadVarint(image, &iAddress, iEnd, &ulTime) == false)
+        {
+            continue;
+        }
+
+        while (iAddress < iEnd)
+        {
+            uint8_t uiTag = image[iAddress];
+
+            if ((uiTag == kHistoryBlockErased) || (uiTag == 0) || (uiTag > kHistoryEvent_Last))
+            {
+                break;
+            }
+            iAddress++;
+
+            ulValue = 0;
+            if (uiTag == kHistoryEvent_Boot)
+            {
+                iBoot++;
+                ulTime = 0;
+            }
+            else
+            {
+                if (ReadVarint(image, &iAddress, iEnd, &ulDelta) == false)
+                {
+                    break;
+                }
+                ulTime += ulDelta;
+
+                if ((uiTag != kHistoryEvent_OccupancyStart) && (ReadVarint(image, &iAddress, iEnd, &ulValue) == false))
+                {
+                    break;
+                }
+            }
+
+            printf("boot %-3d %4lu:%02lu:%02lu  %-34s", iBoot, ulTime / 3600, (ulTime / 60) % 60, ulTime % 60, HistoryEventName(uiTag));
+
+            if ((uiTag == kHistoryEvent_GateDown) || (uiTag == kHistoryEvent_MotorRun) || (uiTag == kHistoryEvent_DutyCycleTrip))
+            {
+                printf(" %lu.%lu", ulValue / 10, ulValue % 10);
+            }
+            else if (uiTag == kHistoryEvent_OccupancyEnd)
+            {
+                printf(" %lu", ulValue);
+            }
+            printf("\n");
+
+            iEvents++;
+        }
+
+        iBytesUsed += iAddress - BlockAddress(iThisBlock);
+    }
+
+    printf("\n%d events in %d bytes, %.0f events per KB\n", iEvents, iBytesUsed, (iBytesUsed > 0) ? (iEvents * 1024.0 / iBytesUsed) : 0.0);
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// Host build of the Arduino API.
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+HostArduinoState_t gHostArduino;
+HostSerial Serial;
+HostEEPROM EEPROM;
+
+static void (*gpHostPinWriteHook)(uint8_t uiPin, uint8_t uiValue) = NULL;
+
+unsigned long millis(void)
+{
+    return gHostArduino.ulMillis;
+}
+
+unsigned long micros(void)
+{
+    return gHostArduino.ulMillis * 1000UL + gHostArduino.ulMicros;
+}
+
+void pinMode(uint8_t uiPin, uint8_t uiMode)
+{
+    gHostArduino.uiPinMode[uiPin] = uiMode;
+}
+
+void digitalWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    uiValue = (uiValue != LOW) ? HIGH : LOW;
+
+    if (gHostArduino.uiPinLevel[uiPin] != uiValue)
+    {
+        gHostArduino.uiPinLevel[uiPin] = uiValue;
+
+        if (gpHostPinWriteHook != NULL)
+        {
+            (*gpHostPinWriteHook)(uiPin, uiValue);
+        }
+    }
+}
+
+int digitalRead(uint8_t uiPin)
+{
+    return gHostArduino.uiPinLevel[uiPin];
+}
+
+void HostReset(void)
+{
+    memset(&gHostArduino, 0, sizeof(gHostArduino));
+}
+
+void HostSetMillis(unsigned long ulMillis)
+{
+    gHostArduino.ulMillis = ulMillis;
+    gHostArduino.ulMicros = 0;
+}
+
+void HostSetMicros(unsigned long ulMicros)
+{
+    gHostArduino.ulMillis = ulMicros / 1000UL;
+    gHostArduino.ulMicros = ulMicros % 1000UL;
+}
+
+void HostSetPinLevel(uint8_t uiPin, uint8_t uiValue)
+{
+    gHostArduino.uiPinLevel[uiPin] = (uiValue != LOW) ? HIGH : LOW;
+}
+
+void HostSetPinWriteHook(void (*pHook)(uint8_t uiPin, uint8_t uiValue))
+{
+    gpHostPinWriteHook = pHook;
+}
+
+// ***************************************************
+//
+// HostSerial
+//
+// ****************************************************
+HostSerial::HostSerial(void)
+{
+    _pOutput = NULL;
+    _bTimestamp = false;
+    _bLineStart = true;
+    _uiInputHead = 0;
+    _uiInputCount = 0;
+}
+
+void HostSerial::begin(unsigned long ulBaud)
+{
+}
+
+void HostSerial::setOutput(FILE *pFile, bool bTimestamp)
+{
+    _pOutput = pFile;
+    _bTimestamp = bTimestamp;
+    _bLineStart = true;
+}
+
+int HostSerial::available(void)
+{
+    return _uiInputCount;
+}
+
+int HostSerial::read(void)
+{
+    int iValue;
+
+    if (_uiInputCount == 0)
+    {
+        return -1;
+    }
+
+    iValue = (uint8_t)_szInput[_uiInputHead];
+    _uiInputHead = (_uiInputHead + 1) % sizeof(_szInput);
+    _uiInputCount--;
+
+    return iValue;
+}
+
+void HostSerial::queueInput(const char *pszInput)
+{
+    while ((*pszInput != '\0') && (_uiInputCount < sizeof(_szInput)))
+    {
+        _szInput[(_uiInputHead + _uiInputCount) % sizeof(_szInput)] = *pszInput++;
+        _uiInputCount++;
+    }
+}
+
+int HostSerial::availableForWrite(void)
+{
+    // the Uno has a 64 byte transmit buffer, the host never fills it
+    return 63;
+}
+
+void HostSerial::flush(void)
+{
+    if (_pOutput != NULL)
+    {
+        fflush(_pOutput);
+    }
+}
+
+void HostSerial::write(const char *pszText)
+{
+    if (_pOutput == NULL)
+    {
+        return;
+    }
+
+    while (*pszText != '\0')
+    {
+        if (_bLineStart && _bTimestamp)
+        {
+            fprintf(_pOutput, "%10lu serial: ", gHostArduino.ulMillis);
+        }
+
+        _bLineStart = (*pszText == '\n');
+        fputc(*pszText++, _pOutput);
+    }
+}
+
+void HostSerial::print(const char *pszText)
+{
+    write(pszText);
+}
+
+void HostSerial::print(const __FlashStringHelper *pszText)
+{
+    write(reinterpret_cast<const char *>(pszText));
+}
+
+void HostSerial::print(char cValue)
+{
+    char szText[2] = { cValue, '\0' };
+    write(szText);
+}
+
+void HostSerial::print(unsigned long ulValue, int iBase)
+{
+    char szText[16];
+
+    if (_pOutput == NULL)
+    {
+        return;
+    }
+
+    snprintf(szText, sizeof(szText), (iBase == HEX) ? "%lX" : "%lu", ulValue);
+    write(szText);
+}
+
+void HostSerial::print(long lValue, int iBase)
+{
+    char szText[16];
+
+    if (_pOutput == NULL)
+    {
+        return;
+    }
+
+    if (iBase == HEX)
+    {
+        snprintf(szText, sizeof(szText), "%lX", (unsigned long)lValue);
+    }
+    else
+    {
+        snprintf(szText, sizeof(szText), "%ld", lValue);
+    }
+    write(szText);
+}
+
+void HostSerial::print(unsigned char uiValue, int iBase) { print((unsigned long)uiValue, iBase); }
+void HostSerial::print(int iValue, int iBase)            { print((long)iValue, iBase); }
+void HostSerial::print(unsigned int uiValue, int iBase)  { print((unsigned long)uiValue, iBase); }
+
+void HostSerial::println(void)                                  { write("\n"); }
+void HostSerial::println(const char *pszText)                   { print(pszText); println(); }
+void HostSerial::println(const __FlashStringHelper *pszText)    { print(pszText); println(); }
+void HostSerial::println(char cValue)                           { print(cValue); println(); }
+void HostSerial::println(unsigned char uiValue, int iBase)      { print(uiValue, iBase); println(); }
+void HostSerial::println(int iValue, int iBase)                 { print(iValue, iBase); println(); }
+void HostSerial::println(unsigned int uiValue, int iBase)       { print(uiValue, iBase); println(); }
+void HostSerial::println(long lValue, int iBase)                { print(lValue, iBase); println(); }
+void HostSerial::println(unsigned long ulValue, int iBase)      { print(ulValue, iBase); println(); }
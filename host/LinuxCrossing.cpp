@@ -0,0 +1,194 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// LinuxCrossing - the controller on a Linux board
+//
+// Runs the sketch on a Linux single board computer, in place of the Uno,
+// on the epoll and timerfd runtime in LinuxRuntime.h.  The pins are either
+// the lines of a GPIO chip, or the pipe stand in for testing (GpioLines.h).
+// The serial messages go to stdout, each line with its millis().
+//
+//     g++ -std=gnu++11 -O2 -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/GpioLines.cpp host/LinuxRuntime.cpp host/StatusShm.cpp host/LinuxCrossing.cpp -lrt -o crossing
+//
+//     ./crossing -g /dev/gpiochip0 [-p pin=line ...] [-e eeprom.bin] [-m name] [-s]
+//     ./crossing [-i input] [-o outputs.txt] [-e eeprom.bin] [-m name] [-s] [-t seconds]
+//
+//   -g  the GPIO chip.  The Arduino pins map to the chip's lines as in
+//       gDefaultPinMap (a Raspberry Pi header), -p moves one.
+//   -i  the stand in's input: "-" (stdin, the default), a FIFO, or a
+//       trace file ("TS <millis> <level>" lines) replayed in real time
+//   -o  where the stand in writes the outputs (stdout by default)
+//   -e  the EEPROM image, loaded at start and saved when it changes
+//   -m  publish the status to shared memory /dev/shm/<name> (StatusShm.h),
+//       for host/StatusRead.cpp or a monitoring agent
+//   -s  serial commands from stdin (not with -i -)
+//   -t  stop after this many seconds; SIGINT or SIGTERM stop it anyway
+//
+// The CPU use and latencies are printed on stderr at the end.
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SRMcrossGate_types.h"
+#include "GpioLines.h"
+#include "LinuxRuntime.h"
+#include "StatusShm.h"
+
+// Arduino pin to line, for a Raspberry Pi (BCM numbering)
+static GpioPinMap_t gDefaultPinMap[] =
+{
+    { kPinAddrGateTrackSensor, 17 },
+    { kPinAddrGateStatusLED, 27 },
+    { kPinAddrGateArmControlMotorPower, 22 },
+    { kPinAddrGateArmControlMotorDirection, 23 },
+    { kPinAddrGateLightsControlLeft, 24 },
+    { kPinAddrGateLightsControlRight, 25 },
+    { kPinAddrGateBellControl, 5 },
+};
+
+const int kPinMapCount = (int)(sizeof(gDefaultPinMap) / sizeof(gDefaultPinMap[0]));
+
+static bool MovePin(const char *pszMapping)
+{
+    unsigned int uiPin;
+    unsigned int uiLine;
+
+    if (sscanf(pszMapping, "%u=%u", &uiPin, &uiLine) != 2)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < kPinMapCount; i++)
+    {
+        if (gDefaultPinMap[i].uiPin == uiPin)
+        {
+            gDefaultPinMap[i].uiLine = uiLine;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    GpioChardevLines chardev;
+    GpioPipeLines pipe;
+    GpioLines *pLines;
+    LinuxRuntime runtime;
+    StatusPublisher publisher;
+    const char *pszChip = NULL;
+    const char *pszInput = "-";
+    const char *pszEeprom = NULL;
+    const char *pszStatus = NULL;
+    FILE *pOutputs = stdout;
+    unsigned long ulSeconds = 0;
+    bool bSerialInput = false;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0)
+        {
+            bSerialInput = true;
+        }
+        else if (i + 1 >= argc)
+        {
+            break;
+        }
+        else if (strcmp(argv[i], "-g") == 0)
+        {
+            pszChip = argv[++i];
+        }
+        else if (strcmp(argv[i], "-p") == 0)
+        {
+            if (!MovePin(argv[++i]))
+            {
+                fprintf(stderr, "crossing: -p %s is not pin=line for a controller pin\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "-i") == 0)
+        {
+            pszInput = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0)
+        {
+            pOutputs = fopen(argv[++i], "w");
+            if (pOutputs == NULL)
+            {
+                perror(argv[i]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "-e") == 0)
+        {
+            pszEeprom = argv[++i];
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            pszStatus = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0)
+        {
+            ulSeconds = strtoul(argv[++i], NULL, 0);
+        }
+    }
+
+    if (bSerialInput && (pszChip == NULL) && (strcmp(pszInput, "-") == 0))
+    {
+        fprintf(stderr, "crossing: stdin cannot be both the serial port and the pins, use -i\n");
+        return 2;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    Serial.setOutput(stdout, true);
+
+    if (pszChip != NULL)
+    {
+        if (!chardev.open(pszChip, kPinAddrGateTrackSensor, gDefaultPinMap, kPinMapCount))
+        {
+            return 2;
+        }
+        pLines = &chardev;
+    }
+    else
+    {
+        // the stand in's times count from now, which is about when setup() runs
+        if (!pipe.open(pszInput, kPinAddrGateTrackSensor, pOutputs, GpioNow()))
+        {
+            return 2;
+        }
+        setvbuf(pOutputs, NULL, _IOLBF, 0);
+        pLines = &pipe;
+    }
+
+    if (pszStatus != NULL)
+    {
+        if (!publisher.open(pszStatus))
+        {
+            return 2;
+        }
+        runtime.setStatusPublisher(&publisher);
+    }
+
+    if (!runtime.open(pLines, bSerialInput, pszEeprom))
+    {
+        return 2;
+    }
+
+    runtime.run(ulSeconds);
+    runtime.printStats(stderr);
+    publisher.close(true);
+
+    if (pOutputs != stdout)
+    {
+        fclose(pOutputs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,510 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// LinuxRuntime - runs the controller on a Linux board (host only)
+//
+// ****************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "LinuxRuntime.h"
+
+void setup();
+void loop();
+extern Timer gCrossingGateTimer;
+extern bool gbIdleSleepAllowed;
+
+const unsigned long long kNsPerMs = 1000000ULL;
+const unsigned long long kNsPerSecond = 1000000000ULL;
+const unsigned long long kNotArmed = 0;
+const int kMaxReady = MAX_NUMBER_OF_EVENTS + 4;
+
+// epoll data for the descriptors that are not Timer slots
+enum
+{
+    kReady_Lines = MAX_NUMBER_OF_EVENTS,
+    kReady_Serial,
+    kReady_Signal,
+};
+
+static LinuxRuntime *gpLinuxRuntime = NULL;
+
+static void LinuxPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    gpLinuxRuntime->outputWritten(uiPin, uiValue);
+}
+
+static void SetTimerFd(int iFd, unsigned long long ullTime)
+{
+    struct itimerspec spec;
+
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = (time_t)(ullTime / kNsPerSecond);
+    spec.it_value.tv_nsec = (long)(ullTime % kNsPerSecond);
+    timerfd_settime(iFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static void AddToEpoll(int iEpollFd, int iFd, uint64_t ullData)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = ullData;
+    epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iFd, &event);
+}
+
+void LinuxLatency::print(FILE *pFile, const char *pszName)
+{
+    unsigned long long ullTotal = 0;
+    size_t uiCount = _samples.size();
+
+    if (uiCount == 0)
+    {
+        fprintf(pFile, "%-14s: none\n", pszName);
+        return;
+    }
+
+    std::sort(_samples.begin(), _samples.end());
+    for (size_t i = 0; i < uiCount; i++)
+    {
+        ullTotal += _samples[i];
+    }
+
+    fprintf(pFile, "%-14s: %7lu, mean %6.0f us, median %6u us, 99%% %6u us, worst %6u us\n", pszName, (unsigned long)uiCount,
+            (double)ullTotal / uiCount, _samples[uiCount / 2], _samples[(uiCount * 99) / 100], _samples[uiCount - 1]);
+}
+
+LinuxRuntime::LinuxRuntime(void)
+{
+    _pLines = NULL;
+    _iEpollFd = -1;
+    _iSignalFd = -1;
+    _iSerialFd = -1;
+    _ullStart = 0;
+    _ullCause = 0;
+    _bIdle = false;
+    _pszEepromFile = NULL;
+    _pSavedEeprom = NULL;
+    _pPublisher = NULL;
+    memset(&_status, 0, sizeof(_status));
+    _ulWakeUps = 0;
+    _ulLoops = 0;
+    _ulIdleSkips = 0;
+
+    for (int i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        _iTimerFd[i] = -1;
+        _ullArmed[i] = kNotArmed;
+    }
+}
+
+LinuxRuntime::~LinuxRuntime(void)
+{
+    for (int i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        if (_iTimerFd[i] >= 0)
+        {
+            close(_iTimerFd[i]);
+        }
+    }
+    if (_iSignalFd >= 0)
+    {
+        close(_iSignalFd);
+    }
+    if (_iEpollFd >= 0)
+    {
+        close(_iEpollFd);
+    }
+    free(_pSavedEeprom);
+}
+
+// ***************************************************
+//
+// open()
+//
+// Sets up the descriptors, and boots the controller: the EEPROM comes
+// from pszEepromFile (if there is one), the sensor's level is read, and
+// setup() runs with millis() at zero.
+//
+// ****************************************************
+bool LinuxRuntime::open(GpioLines *pLines, bool bSerialInput, const char *pszEepromFile)
+{
+    sigset_t signals;
+    int iFd;
+
+    _pLines = pLines;
+    _pszEepromFile = pszEepromFile;
+    gpLinuxRuntime = this;
+
+    _iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (_iEpollFd < 0)
+    {
+        perror("epoll_create1");
+        return false;
+    }
+
+    for (int i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        _iTimerFd[i] = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (_iTimerFd[i] < 0)
+        {
+            perror("timerfd_create");
+            return false;
+        }
+        AddToEpoll(_iEpollFd, _iTimerFd[i], i);
+    }
+
+    AddToEpoll(_iEpollFd, _pLines->fd(), kReady_Lines);
+
+    // SIGINT and SIGTERM come in as a descriptor, such that we stop between loop()s
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    _iSignalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    AddToEpoll(_iEpollFd, _iSignalFd, kReady_Signal);
+
+    if (bSerialInput)
+    {
+        _iSerialFd = STDIN_FILENO;
+        fcntl(_iSerialFd, F_SETFL, fcntl(_iSerialFd, F_GETFL) | O_NONBLOCK);
+        AddToEpoll(_iEpollFd, _iSerialFd, kReady_Serial);
+    }
+
+    HostReset();
+    gCrossingGateTimer = Timer();
+    if (_pszEepromFile != NULL)
+    {
+        iFd = ::open(_pszEepromFile, O_RDONLY | O_CLOEXEC);
+        if (iFd >= 0)
+        {
+            if (read(iFd, EEPROM._uiData, sizeof(EEPROM._uiData)) != (ssize_t)sizeof(EEPROM._uiData))
+            {
+                EEPROM.erase();
+            }
+            close(iFd);
+        }
+        _pSavedEeprom = (uint8_t *)malloc(sizeof(EEPROM._uiData));
+        memcpy(_pSavedEeprom, EEPROM._uiData, sizeof(EEPROM._uiData));
+    }
+
+    _ullStart = GpioNow();
+    HostSetPinLevel(kPinAddrGateTrackSensor, (uint8_t)_pLines->readLevel(kPinAddrGateTrackSensor));
+    HostSetPinWriteHook(LinuxPinWrite);
+    _ullCause = _ullStart;
+    setup();
+
+    return true;
+}
+
+void LinuxRuntime::outputWritten(uint8_t uiPin, uint8_t uiLevel)
+{
+    _pLines->write(uiPin, uiLevel);
+    _output.add(GpioNow() - _ullCause);
+}
+
+// ***************************************************
+//
+// armTimers()
+//
+// Points each slot's timerfd at its deadline.  Only the slots whose
+// deadline moved cost a system call, which on a tick is the one that
+// fired.  While idle, every slot is disarmed.
+//
+// ****************************************************
+void LinuxRuntime::armTimers(bool bIdle)
+{
+    unsigned long long ullMillisTime = _ullStart + ((unsigned long long)millis() * kNsPerMs);
+
+    for (int i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        unsigned long ulRemaining = gCrossingGateTimer.timeToSlot(i);
+        unsigned long long ullDeadline = kNotArmed;
+
+        if (!bIdle && (ulRemaining != TIMER_NO_EVENT))
+        {
+            // millis() is whole milliseconds, so the deadline is measured from the last one
+            ullDeadline = ullMillisTime + ((unsigned long long)ulRemaining * kNsPerMs);
+        }
+
+        if (ullDeadline != _ullArmed[i])
+        {
+            SetTimerFd(_iTimerFd[i], ullDeadline);
+            _ullArmed[i] = ullDeadline;
+        }
+    }
+}
+
+void LinuxRuntime::handleTimer(int iSlot, unsigned long long ullNow)
+{
+    unsigned long long ullExpirations;
+
+    if (read(_iTimerFd[iSlot], &ullExpirations, sizeof(ullExpirations)) < 0)
+    {
+        return;
+    }
+
+    if (_ullArmed[iSlot] != kNotArmed)
+    {
+        _timerLate.add(ullNow - _ullArmed[iSlot]);
+        _ullCause = std::min(_ullCause, _ullArmed[iSlot]);
+    }
+
+    // a one shot timerfd is disarmed once it fires
+    _ullArmed[iSlot] = kNotArmed;
+}
+
+// returns false once the input has ended
+bool LinuxRuntime::handleEdges(void)
+{
+    GpioEdge_t edges[kGpioMaxEdges];
+    int iCount = _pLines->readEdges(edges, kGpioMaxEdges);
+
+    for (int i = 0; i < iCount; i++)
+    {
+        HostSetPinLevel(edges[i].uiPin, edges[i].uiLevel);
+        _ullCause = std::min(_ullCause, edges[i].ullTime);
+    }
+
+    return iCount >= 0;
+}
+
+void LinuxRuntime::handleSerialInput(void)
+{
+    char szInput[64];
+    ssize_t lBytes = read(_iSerialFd, szInput, sizeof(szInput) - 1);
+
+    if (lBytes > 0)
+    {
+        szInput[lBytes] = '\0';
+        Serial.queueInput(szInput);
+    }
+    else if (lBytes == 0)
+    {
+        epoll_ctl(_iEpollFd, EPOLL_CTL_DEL, _iSerialFd, NULL);
+        _iSerialFd = -1;
+    }
+}
+
+// the EEPROM image is written back whenever the controller changes it
+void LinuxRuntime::saveEeprom(void)
+{
+    int iFd;
+
+    if ((_pszEepromFile == NULL) || (memcmp(_pSavedEeprom, EEPROM._uiData, sizeof(EEPROM._uiData)) == 0))
+    {
+        return;
+    }
+
+    iFd = ::open(_pszEepromFile, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if ((iFd < 0) || (pwrite(iFd, EEPROM._uiData, sizeof(EEPROM._uiData), 0) != (ssize_t)sizeof(EEPROM._uiData)))
+    {
+        perror(_pszEepromFile);
+    }
+    else
+    {
+        memcpy(_pSavedEeprom, EEPROM._uiData, sizeof(EEPROM._uiData));
+    }
+
+    if (iFd >= 0)
+    {
+        close(iFd);
+    }
+}
+
+// ***************************************************
+//
+// run()
+//
+// The main loop, until a signal, or for ulSeconds if that is not zero.
+// The pipe stand in ending does not stop it, the crossing carries on.
+//
+// ****************************************************
+void LinuxRuntime::run(unsigned long ulSeconds)
+{
+    unsigned long long ullEnd = (ulSeconds == 0) ? 0 : (_ullStart + (ulSeconds * kNsPerSecond));
+    bool bLinesOpen = true;
+
+    for (;;)
+    {
+        struct epoll_event ready[kMaxReady];
+        unsigned long long ullNow;
+        bool bStop = false;
+        bool bBusy;
+        int iTimeout = -1;
+        int iReady;
+
+        // a history dump, or serial input, keeps loop() going, as on the Uno
+        bBusy = (gCrossingState.iHistoryDumpOffset >= 0) || (Serial.available() > 0);
+        _bIdle = !bBusy && (gbIdleSleepAllowed == true) && (digitalRead(kPinAddrGateTrackSensor) != kTrackOccupied);
+        armTimers(_bIdle);
+
+        if (bBusy)
+        {
+            iTimeout = 0;
+        }
+        else if (ullEnd != 0)
+        {
+            ullNow = GpioNow();
+            iTimeout = (ullNow >= ullEnd) ? 0 : (int)((ullEnd - ullNow + kNsPerMs - 1) / kNsPerMs);
+        }
+
+        iReady = epoll_wait(_iEpollFd, ready, kMaxReady, iTimeout);
+        if ((iReady < 0) && (errno != EINTR))
+        {
+            perror("epoll_wait");
+            return;
+        }
+
+        ullNow = GpioNow();
+        _ulWakeUps++;
+        _ullCause = ullNow;
+
+        for (int i = 0; i < iReady; i++)
+        {
+            uint64_t ullData = ready[i].data.u64;
+
+            if (ullData < (uint64_t)MAX_NUMBER_OF_EVENTS)
+            {
+                handleTimer((int)ullData, ullNow);
+            }
+            else if (ullData == kReady_Lines)
+            {
+                if (!handleEdges() && bLinesOpen)
+                {
+                    epoll_ctl(_iEpollFd, EPOLL_CTL_DEL, _pLines->fd(), NULL);
+                    bLinesOpen = false;
+                }
+            }
+            else if (ullData == kReady_Serial)
+            {
+                handleSerialInput();
+            }
+            else if (ullData == kReady_Signal)
+            {
+                bStop = true;
+            }
+        }
+
+        if (bStop || ((ullEnd != 0) && (ullNow >= ullEnd)))
+        {
+            break;
+        }
+
+        HostSetMillis((unsigned long)((ullNow - _ullStart) / kNsPerMs));
+        if (_bIdle)
+        {
+            // the ticks we slept through would have found nothing to do
+            gCrossingGateTimer.skipMissed();
+            _ulIdleSkips++;
+        }
+
+        loop();
+        _ulLoops++;
+        Serial.flush();
+
+        if (_ullCause < ullNow)
+        {
+            _eventHandled.add(GpioNow() - _ullCause);
+        }
+        saveEeprom();
+        publishStatus();
+    }
+}
+
+// ***************************************************
+//
+// publishStatus()
+//
+// The counters count the changes seen from one loop() to the next; the
+// state machine holds each state for at least a tick, so none are missed.
+//
+// ****************************************************
+void LinuxRuntime::publishStatus(void)
+{
+    CrossingStatus_t previous = _status;
+    uint32_t ulOutputs = 0;
+
+    if (_pPublisher == NULL)
+    {
+        return;
+    }
+
+    _status.ulPublished++;
+    _status.ulMillis = (uint32_t)millis();
+    _status.ulTrackState = (uint32_t)gCrossingState.iTrackOcupationState;
+    _status.ulInitializeState = (uint32_t)gCrossingState.iGateInitializationState;
+    _status.ulDownState = (uint32_t)gCrossingState.iGateMovingDown_State;
+    _status.ulUpState = (uint32_t)gCrossingState.iGateMovingUp_State;
+    _status.ulGateState = gCrossingState.bGateState;
+    _status.ulMotorRunning = gCrossingState.bMotorRunning;
+    _status.ulMotorOn = gCrossingState.bMotorOnFlag;
+    _status.ulMotorDirection = gCrossingState.bMotorDirectionFlag;
+    _status.ulDutyCycleExceeded = gCrossingState.bDutyCycleExceededFlag;
+    _status.ulMotorRunningTotalSeconds = (uint32_t)gCrossingState.ulMotorRunningTotalSeconds;
+    _status.ulSensorLevel = (uint32_t)digitalRead(kPinAddrGateTrackSensor);
+    _status.ulIdle = _bIdle;
+
+    for (uint8_t uiPin = 0; uiPin < kHostPinCount; uiPin++)
+    {
+        if ((gHostArduino.uiPinMode[uiPin] == OUTPUT) && (gHostArduino.uiPinLevel[uiPin] != LOW))
+        {
+            ulOutputs |= 1UL << uiPin;
+        }
+    }
+    _status.ulOutputPins = ulOutputs;
+
+    _status.ulTimerSlotsUsed = 0;
+    _status.ulTimerSlotMask = 0;
+    for (int i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        if (gCrossingGateTimer.timeToSlot(i) != TIMER_NO_EVENT)
+        {
+            _status.ulTimerSlotsUsed++;
+            _status.ulTimerSlotMask |= 1UL << i;
+        }
+    }
+
+    _status.ulOccupancies += ((_status.ulTrackState == kTrackOccupied) && (previous.ulTrackState != kTrackOccupied)) ? 1 : 0;
+    _status.ulGateDowns += ((_status.ulGateState == kGateInDownPosition) && (previous.ulGateState != kGateInDownPosition)) ? 1 : 0;
+    _status.ulDutyCycleTrips += (_status.ulDutyCycleExceeded && !previous.ulDutyCycleExceeded) ? 1 : 0;
+    _status.ulWakeUps = (uint32_t)_ulWakeUps;
+    _status.ulLoops = (uint32_t)_ulLoops;
+    _status.ulIdleSkips = (uint32_t)_ulIdleSkips;
+    _status.ulHistoryQueued = gCrossingState.uiHistoryQueueCount;
+    _status.ulHistoryDropped = gCrossingState.uiHistoryDroppedCount;
+
+    _pPublisher->publish(&_status);
+}
+
+void LinuxRuntime::printStats(FILE *pFile)
+{
+    struct rusage usage;
+    double dWallSeconds = (GpioNow() - _ullStart) / 1e9;
+    double dCpuSeconds;
+
+    getrusage(RUSAGE_SELF, &usage);
+    dCpuSeconds = usage.ru_utime.tv_sec + (usage.ru_utime.tv_usec / 1e6) + usage.ru_stime.tv_sec + (usage.ru_stime.tv_usec / 1e6);
+
+    fprintf(pFile, "ran            : %.1f s, %lu wake ups, %lu loop()s, %lu idle skips\n", dWallSeconds, _ulWakeUps, _ulLoops, _ulIdleSkips);
+    fprintf(pFile, "cpu            : %.3f s, %.3f%% of one core\n", dCpuSeconds, (dWallSeconds > 0) ? (dCpuSeconds * 100.0 / dWallSeconds) : 0.0);
+    _timerLate.print(pFile, "timer late");
+    _eventHandled.print(pFile, "event handled");
+    _output.print(pFile, "output");
+}
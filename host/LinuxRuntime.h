@@ -0,0 +1,100 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// LinuxRuntime - runs the controller on a Linux board (host only)
+//
+// The Uno spins in loop(), calling Timer::update() as fast as it can.
+// Here each Timer slot has a timerfd, armed for that slot's deadline, and
+// the runtime sleeps in epoll_wait() on them, the GPIO input edges
+// (GpioLines.h), the serial input (stdin) and the signals.  When anything
+// is ready, millis() is brought up to CLOCK_MONOTONIC and loop() runs
+// once; the timerfds whose deadlines moved are armed again.
+//
+// While the controller is idle (the test IdleSleepIfAllowed() makes) the
+// timerfds are disarmed altogether, as the ticks would find nothing to
+// do, and the Timer skips the deadlines it slept through when the next
+// edge comes (see SimKernel.h).  So an idle crossing costs no CPU at all.
+//
+// With a StatusPublisher, the state is published to shared memory after
+// every loop() (StatusShm.h).
+//
+// The runtime keeps the latencies, in microseconds:
+//
+//   timer late     - a deadline to the wake up for it
+//   event handled  - a deadline or an input edge (the kernel's time stamp)
+//                    to the end of the loop() that saw it
+//   output         - the edge or deadline that started a loop() to each
+//                    output pin write in it
+//
+// ****************************************************
+
+#ifndef LinuxRuntime_h
+#define LinuxRuntime_h
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <vector>
+#include "Timer.h"
+#include "GpioLines.h"
+#include "StatusShm.h"
+
+class LinuxLatency
+{
+
+public:
+  void add(unsigned long long ullNs) { _samples.push_back((unsigned int)((ullNs + 500) / 1000)); }
+  void print(FILE *pFile, const char *pszName);
+
+protected:
+  std::vector<unsigned int> _samples;
+
+};
+
+class LinuxRuntime
+{
+
+public:
+  LinuxRuntime(void);
+  ~LinuxRuntime(void);
+
+  bool open(GpioLines *pLines, bool bSerialInput, const char *pszEepromFile);
+  void run(unsigned long ulSeconds);
+  void printStats(FILE *pFile);
+
+  unsigned long long start(void) { return _ullStart; }
+  void outputWritten(uint8_t uiPin, uint8_t uiLevel);
+  void setStatusPublisher(StatusPublisher *pPublisher) { _pPublisher = pPublisher; }
+
+protected:
+  void armTimers(bool bIdle);
+  void handleTimer(int iSlot, unsigned long long ullNow);
+  bool handleEdges(void);
+  void handleSerialInput(void);
+  void saveEeprom(void);
+  void publishStatus(void);
+
+  GpioLines *_pLines;
+  int _iEpollFd;
+  int _iTimerFd[MAX_NUMBER_OF_EVENTS];
+  unsigned long long _ullArmed[MAX_NUMBER_OF_EVENTS];
+  int _iSignalFd;
+  int _iSerialFd;
+  unsigned long long _ullStart;
+  unsigned long long _ullCause;
+  bool _bIdle;
+  const char *_pszEepromFile;
+  uint8_t *_pSavedEeprom;
+  StatusPublisher *_pPublisher;
+  CrossingStatus_t _status;
+
+  unsigned long _ulWakeUps;
+  unsigned long _ulLoops;
+  unsigned long _ulIdleSkips;
+  LinuxLatency _timerLate;
+  LinuxLatency _eventHandled;
+  LinuxLatency _output;
+
+};
+
+#endif
@@ -0,0 +1,829 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// LogAnalyze - host tool
+//
+// Reads archived serial logs from the controllers ("Track Sensor:
+// Detected", "Motor: On", "Total Motor Run Time: N" and so on), and
+// prints each crossing's statistics: closures per day, motor run time,
+// duty cycle trips, resets and Timer errors.
+//
+// Each file is a crossing, named after the file (main_st.log is
+// "main_st"), or give the name as name=path.  Several files with the same
+// name are one timeline, in the order given.  Lines are dated by the
+// capture tool's "YYYY-MM-DD HH:MM:SS[.mmm]" prefix (ts '%F %T' from
+// moreutils, for one), optionally in [brackets]; a line without one has
+// the time of the line before it.  Undated logs still give the counts,
+// but not the durations or the days.
+//
+// The files are memory mapped and cut into chunks at line ends.  Threads
+// take the chunks, find the line ends 16 bytes at a time (SSE2, where the
+// compiler has it) and turn the known messages into events.  The events
+// are then walked in order, one crossing at a time, to rebuild the
+// closures and motor runs, which is cheap next to the scan.
+//
+//     g++ -std=gnu++11 -O2 -pthread host/LogAnalyze.cpp -o loganalyze
+//
+//     ./loganalyze [-j threads] [-d] [-t] [name=]file ...
+//
+//   -d  prints a row per day for each crossing
+//   -t  prints every closure (the timeline)
+//
+// ****************************************************
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const size_t kChunkSize = 32UL << 20;
+const int kMaxThreads = 64;
+const long long kUndated = -1;
+const long long kMsPerDay = 24LL * 60 * 60 * 1000;
+
+enum
+{
+    kLogEvent_Boot = 0,
+    kLogEvent_TrackDetected,
+    kLogEvent_TrackCleared,
+    kLogEvent_LightsOn,
+    kLogEvent_LightsOff,
+    kLogEvent_MotorOn,
+    kLogEvent_MotorOff,
+    kLogEvent_GateDown,
+    kLogEvent_GateUp,
+    kLogEvent_DutyCycleTrip,
+    kLogEvent_MotorTotal,
+    kLogEvent_DutyCycleReset,
+    kLogEvent_TimerError,
+    kLogEvent_WakeToLights,
+    kLogEvent_Count
+};
+
+// the messages we know, and the event each one becomes.  A value, where
+// there is one, follows the text.
+struct LogMessage_t
+{
+    const char *pszText;
+    size_t uiLength;
+    uint8_t uiEvent;
+};
+
+#define LOG_MESSAGE(text, event) { text, sizeof(text) - 1, event }
+
+static const LogMessage_t gMessages[] =
+{
+    LOG_MESSAGE("Track Sensor: Detected", kLogEvent_TrackDetected),
+    LOG_MESSAGE("Track Sensor: Cleared", kLogEvent_TrackCleared),
+    LOG_MESSAGE("Motor: On", kLogEvent_MotorOn),
+    LOG_MESSAGE("Motor: Off", kLogEvent_MotorOff),
+    LOG_MESSAGE("Motor Max Duty Cycle, Ignoring Motor On Cmd: ", kLogEvent_DutyCycleTrip),
+    LOG_MESSAGE("Lights & Bells: On", kLogEvent_LightsOn),
+    LOG_MESSAGE("Bell/Lights: Off", kLogEvent_LightsOff),
+    LOG_MESSAGE("Gate is Down", kLogEvent_GateDown),
+    LOG_MESSAGE("Gate is Up", kLogEvent_GateUp),
+    LOG_MESSAGE("Gate Is Up", kLogEvent_GateUp),
+    LOG_MESSAGE("Total Motor Run Time: ", kLogEvent_MotorTotal),
+    LOG_MESSAGE("RESET -- Motor Running Seconds", kLogEvent_DutyCycleReset),
+    LOG_MESSAGE("Timer Error, Pin: ", kLogEvent_TimerError),
+    LOG_MESSAGE("Timer Stop Error: ", kLogEvent_TimerError),
+    LOG_MESSAGE("Wake To Lights (ms): ", kLogEvent_WakeToLights),
+    LOG_MESSAGE("Crossing Guard Controller - Ver", kLogEvent_Boot),
+};
+
+const int kMessageCount = (int)(sizeof(gMessages) / sizeof(gMessages[0]));
+
+// 16 bytes, a multi-GB log gives a few hundred MB of these
+struct LogEvent_t
+{
+    long long llTime;
+    uint32_t ulValue;
+    uint8_t uiEvent;
+};
+
+struct LogFile_t
+{
+    std::string name;
+    const char *pszPath;
+    const char *pData;
+    size_t uiSize;
+};
+
+struct LogChunk_t
+{
+    int iFile;
+    size_t uiBegin;
+    size_t uiEnd;
+    unsigned long long ullLines;
+    std::vector<LogEvent_t> events;
+};
+
+// a closure is the lights coming on to the lights going off
+struct Closure_t
+{
+    long long llStart;
+    long long llEnd;
+    int iMotorRuns;
+    long long llMotorMs;
+    bool bTrip;
+    bool bCutByBoot;
+};
+
+struct DayStats_t
+{
+    int iClosures;
+    long long llClosedMs;
+    int iMotorRuns;
+    long long llMotorMs;
+    int iTrips;
+    int iBoots;
+};
+
+struct CrossingStats_t
+{
+    unsigned long long ullLines;
+    unsigned long long ullBytes;
+    int iFiles;
+    int iBoots;
+    int iClosures;
+    int iClosuresCut;
+    int iTimedClosures;
+    long long llClosedMs;
+    long long llLongestClosureMs;
+    int iMotorRuns;
+    int iTimedMotorRuns;
+    long long llMotorMs;
+    int iTrips;
+    int iDutyCycleResets;
+    int iTimerErrors;
+    int iSensorDetections;
+    unsigned long ulPeakMotorTotal;
+    int iWakes;
+    unsigned long ulWakeTotalMs;
+    unsigned long ulWakeWorstMs;
+    std::map<long long, DayStats_t> days;
+};
+
+static std::vector<LogFile_t> gFiles;
+static std::vector<LogChunk_t> gChunks;
+static std::atomic<size_t> guiNextChunk(0);
+
+// ***************************************************
+//
+// FindNewline()
+//
+// Returns the first '\n' in [p, pEnd), or pEnd.  Sixteen bytes are
+// compared at once, the mask says which of them matched.
+//
+// ****************************************************
+static const char *FindNewline(const char *p, const char *pEnd)
+{
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    while (p + 16 <= pEnd)
+    {
+        int iMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), newline));
+
+        if (iMask != 0)
+        {
+            return p + __builtin_ctz(iMask);
+        }
+        p += 16;
+    }
+#endif
+
+    const char *pFound = (const char *)memchr(p, '\n', pEnd - p);
+
+    return (pFound != NULL) ? pFound : pEnd;
+}
+
+static bool ReadDigits(const char *p, int iCount, int *piValue)
+{
+    int iValue = 0;
+
+    for (int i = 0; i < iCount; i++)
+    {
+        if ((p[i] < '0') || (p[i] > '9'))
+        {
+            return false;
+        }
+        iValue = (iValue * 10) + (p[i] - '0');
+    }
+
+    *piValue = iValue;
+    return true;
+}
+
+// days from 1970-01-01 of a civil date, without the C library's time zones
+static long long DaysFromCivil(int iYear, int iMonth, int iDay)
+{
+    int iEra;
+    int iYearOfEra;
+    int iDayOfYear;
+    int iDayOfEra;
+
+    iYear -= (iMonth <= 2) ? 1 : 0;
+    iEra = ((iYear >= 0) ? iYear : (iYear - 399)) / 400;
+    iYearOfEra = iYear - (iEra * 400);
+    iDayOfYear = ((153 * (iMonth + ((iMonth > 2) ? -3 : 9))) + 2) / 5 + iDay - 1;
+    iDayOfEra = (iYearOfEra * 365) + (iYearOfEra / 4) - (iYearOfEra / 100) + iDayOfYear;
+
+    return ((long long)iEra * 146097) + iDayOfEra - 719468;
+}
+
+// ***************************************************
+//
+// ReadTimestamp()
+//
+// Reads a "YYYY-MM-DD HH:MM:SS[.mmm]" prefix (or 'T' between the date
+// and time, and in brackets or not) into milliseconds since 1970.
+// Returns the start of the message, or NULL if there is no timestamp.
+//
+// ****************************************************
+static const char *ReadTimestamp(const char *p, const char *pEnd, long long *pllTime)
+{
+    int iYear, iMonth, iDay, iHour, iMinute, iSecond, iMillis = 0;
+
+    if ((p < pEnd) && (*p == '['))
+    {
+        p++;
+    }
+
+    if ((pEnd - p < 19) || (p[4] != '-') || (p[7] != '-') || ((p[10] != ' ') && (p[10] != 'T')) ||
+        (p[13] != ':') || (p[16] != ':') ||
+        !ReadDigits(p, 4, &iYear) || !ReadDigits(p + 5, 2, &iMonth) || !ReadDigits(p + 8, 2, &iDay) ||
+        !ReadDigits(p + 11, 2, &iHour) || !ReadDigits(p + 14, 2, &iMinute) || !ReadDigits(p + 17, 2, &iSecond))
+    {
+        return NULL;
+    }
+    p += 19;
+
+    if ((pEnd - p >= 4) && ((*p == '.') || (*p == ',')) && ReadDigits(p + 1, 3, &iMillis))
+    {
+        p += 4;
+    }
+
+    // the rest of the digits, then whatever separates the stamp from the message
+    while ((p < pEnd) && (*p >= '0') && (*p <= '9'))
+    {
+        p++;
+    }
+    while ((p < pEnd) && ((*p == ']') || (*p == ' ') || (*p == '\t') || (*p == '-') || (*p == '>') || (*p == ':')))
+    {
+        p++;
+    }
+
+    *pllTime = (((DaysFromCivil(iYear, iMonth, iDay) * 24 + iHour) * 60 + iMinute) * 60 + iSecond) * 1000LL + iMillis;
+    return p;
+}
+
+// ***************************************************
+//
+// ParseChunk()
+//
+// Turns one chunk's lines into events.  Lines before the chunk's first
+// timestamp are left kUndated; the walk fills them in from the chunk
+// before.
+//
+// ****************************************************
+static void ParseChunk(LogChunk_t *pChunk)
+{
+    const LogFile_t &file = gFiles[pChunk->iFile];
+    const char *p = file.pData + pChunk->uiBegin;
+    const char *pChunkEnd = file.pData + pChunk->uiEnd;
+    long long llTime = kUndated;
+    unsigned long long ullLines = 0;
+
+    pChunk->events.reserve((pChunk->uiEnd - pChunk->uiBegin) / 64);
+
+    while (p < pChunkEnd)
+    {
+        const char *pLineEnd = FindNewline(p, pChunkEnd);
+        const char *pMessage;
+        long long llLineTime;
+        size_t uiLength;
+
+        ullLines++;
+
+        pMessage = ReadTimestamp(p, pLineEnd, &llLineTime);
+        if (pMessage != NULL)
+        {
+            llTime = llLineTime;
+        }
+        else
+        {
+            pMessage = p;
+        }
+
+        uiLength = pLineEnd - pMessage;
+        if ((uiLength > 0) && (pMessage[uiLength - 1] == '\r'))
+        {
+            uiLength--;
+        }
+
+        for (int i = 0; i < kMessageCount; i++)
+        {
+            const LogMessage_t &message = gMessages[i];
+
+            if ((uiLength >= message.uiLength) && (pMessage[0] == message.pszText[0]) &&
+                (memcmp(pMessage, message.pszText, message.uiLength) == 0))
+            {
+                LogEvent_t event;
+                unsigned long ulValue = 0;
+
+                for (size_t j = message.uiLength; (j < uiLength) && (pMessage[j] >= '0') && (pMessage[j] <= '9'); j++)
+                {
+                    ulValue = (ulValue * 10) + (pMessage[j] - '0');
+                }
+
+                event.llTime = llTime;
+                event.ulValue = (uint32_t)ulValue;
+                event.uiEvent = message.uiEvent;
+                pChunk->events.push_back(event);
+                break;
+            }
+        }
+
+        p = pLineEnd + 1;
+    }
+
+    pChunk->ullLines = ullLines;
+}
+
+static void ParseThread(void)
+{
+    for (;;)
+    {
+        size_t uiChunk = guiNextChunk++;
+
+        if (uiChunk >= gChunks.size())
+        {
+            return;
+        }
+        ParseChunk(&gChunks[uiChunk]);
+    }
+}
+
+static bool MapFile(LogFile_t *pFile)
+{
+    struct stat info;
+    int iFd = open(pFile->pszPath, O_RDONLY);
+
+    if ((iFd < 0) || (fstat(iFd, &info) != 0))
+    {
+        perror(pFile->pszPath);
+        return false;
+    }
+
+    pFile->uiSize = (size_t)info.st_size;
+    pFile->pData = NULL;
+    if (pFile->uiSize > 0)
+    {
+        void *pMap = mmap(NULL, pFile->uiSize, PROT_READ, MAP_PRIVATE, iFd, 0);
+
+        if (pMap == MAP_FAILED)
+        {
+            perror(pFile->pszPath);
+            close(iFd);
+            return false;
+        }
+        madvise(pMap, pFile->uiSize, MADV_SEQUENTIAL);
+        pFile->pData = (const char *)pMap;
+    }
+
+    close(iFd);
+    return true;
+}
+
+// cuts a file into chunks of about kChunkSize, each one ending after a '\n'
+static void AddChunks(int iFile)
+{
+    const LogFile_t &file = gFiles[iFile];
+    size_t uiBegin = 0;
+
+    while (uiBegin < file.uiSize)
+    {
+        LogChunk_t chunk;
+        size_t uiEnd = uiBegin + kChunkSize;
+
+        if (uiEnd >= file.uiSize)
+        {
+            uiEnd = file.uiSize;
+        }
+        else
+        {
+            uiEnd = FindNewline(file.pData + uiEnd, file.pData + file.uiSize) - file.pData;
+            uiEnd = (uiEnd < file.uiSize) ? (uiEnd + 1) : uiEnd;
+        }
+
+        chunk.iFile = iFile;
+        chunk.uiBegin = uiBegin;
+        chunk.uiEnd = uiEnd;
+        chunk.ullLines = 0;
+        gChunks.push_back(chunk);
+
+        uiBegin = uiEnd;
+    }
+}
+
+static long long DayOf(long long llTime)
+{
+    return (llTime == kUndated) ? kUndated : (llTime / kMsPerDay);
+}
+
+static void FormatTime(long long llTime, char *pszText, size_t uiSize)
+{
+    if (llTime == kUndated)
+    {
+        snprintf(pszText, uiSize, "%-19s", "undated");
+    }
+    else
+    {
+        time_t seconds = (time_t)(llTime / 1000);
+        struct tm parts;
+
+        gmtime_r(&seconds, &parts);
+        strftime(pszText, uiSize, "%Y-%m-%d %H:%M:%S", &parts);
+    }
+}
+
+static void PrintClosure(const std::string &name, const Closure_t &closure)
+{
+    char szStart[32];
+
+    FormatTime(closure.llStart, szStart, sizeof(szStart));
+    printf("%-12s %s  ", name.c_str(), szStart);
+    if ((closure.llStart != kUndated) && (closure.llEnd != kUndated))
+    {
+        printf("closed %7.1f s", (closure.llEnd - closure.llStart) / 1000.0);
+    }
+    else
+    {
+        printf("closed       ? s");
+    }
+    printf("  motor %d runs %6.1f s%s%s\n", closure.iMotorRuns, closure.llMotorMs / 1000.0,
+           closure.bTrip ? "  duty cycle trip" : "", closure.bCutByBoot ? "  cut by reset" : "");
+}
+
+// ***************************************************
+//
+// WalkCrossing()
+//
+// Rebuilds one crossing's closures and motor runs from its events, in
+// file and chunk order.
+//
+// ****************************************************
+static void WalkCrossing(const std::string &name, CrossingStats_t *pStats, bool bTimeline)
+{
+    Closure_t closure;
+    bool bClosureOpen = false;
+    long long llMotorStart = kUndated;
+    bool bMotorOn = false;
+    long long llTime = kUndated;
+    int iLastFile = -1;
+
+    for (size_t c = 0; c < gChunks.size(); c++)
+    {
+        const LogChunk_t &chunk = gChunks[c];
+
+        if (gFiles[chunk.iFile].name != name)
+        {
+            continue;
+        }
+
+        if (chunk.iFile != iLastFile)
+        {
+            pStats->iFiles++;
+            pStats->ullBytes += gFiles[chunk.iFile].uiSize;
+            iLastFile = chunk.iFile;
+        }
+        pStats->ullLines += chunk.ullLines;
+
+        for (size_t e = 0; e < chunk.events.size(); e++)
+        {
+            const LogEvent_t &event = chunk.events[e];
+            DayStats_t *pDay;
+
+            llTime = (event.llTime != kUndated) ? event.llTime : llTime;
+            pDay = &pStats->days[DayOf(llTime)];
+
+            switch (event.uiEvent)
+            {
+                case kLogEvent_Boot:
+                    pStats->iBoots++;
+                    pDay->iBoots++;
+                    if (bClosureOpen)
+                    {
+                        closure.bCutByBoot = true;
+                        closure.llEnd = llTime;
+                        pStats->iClosuresCut++;
+                        if (bTimeline)
+                        {
+                            PrintClosure(name, closure);
+                        }
+                    }
+                    bClosureOpen = false;
+                    bMotorOn = false;
+                    break;
+
+                case kLogEvent_TrackDetected:
+                    pStats->iSensorDetections++;
+                    break;
+
+                case kLogEvent_LightsOn:
+                    if (!bClosureOpen)
+                    {
+                        memset(&closure, 0, sizeof(closure));
+                        closure.llStart = llTime;
+                        closure.llEnd = kUndated;
+                        bClosureOpen = true;
+                        pStats->iClosures++;
+                        pStats->days[DayOf(llTime)].iClosures++;
+                    }
+                    break;
+
+                case kLogEvent_LightsOff:
+                    if (bClosureOpen)
+                    {
+                        closure.llEnd = llTime;
+                        if ((closure.llStart != kUndated) && (llTime != kUndated))
+                        {
+                            long long llClosedMs = llTime - closure.llStart;
+
+                            pStats->iTimedClosures++;
+                            pStats->llClosedMs += llClosedMs;
+                            pStats->days[DayOf(closure.llStart)].llClosedMs += llClosedMs;
+                            pStats->llLongestClosureMs = (llClosedMs > pStats->llLongestClosureMs) ? llClosedMs : pStats->llLongestClosureMs;
+                        }
+                        if (bTimeline)
+                        {
+                            PrintClosure(name, closure);
+                        }
+                        bClosureOpen = false;
+                    }
+                    break;
+
+                case kLogEvent_MotorOn:
+                    pStats->iMotorRuns++;
+                    pDay->iMotorRuns++;
+                    closure.iMotorRuns += bClosureOpen ? 1 : 0;
+                    llMotorStart = llTime;
+                    bMotorOn = true;
+                    break;
+
+                case kLogEvent_MotorOff:
+                    if (bMotorOn && (llMotorStart != kUndated) && (llTime != kUndated))
+                    {
+                        long long llMotorMs = llTime - llMotorStart;
+
+                        pStats->iTimedMotorRuns++;
+                        pStats->llMotorMs += llMotorMs;
+                        pStats->days[DayOf(llMotorStart)].llMotorMs += llMotorMs;
+                        closure.llMotorMs += bClosureOpen ? llMotorMs : 0;
+                    }
+                    bMotorOn = false;
+                    break;
+
+                case kLogEvent_DutyCycleTrip:
+                    pStats->iTrips++;
+                    pDay->iTrips++;
+                    closure.bTrip = closure.bTrip || bClosureOpen;
+                    break;
+
+                case kLogEvent_MotorTotal:
+                    pStats->ulPeakMotorTotal = (event.ulValue > pStats->ulPeakMotorTotal) ? event.ulValue : pStats->ulPeakMotorTotal;
+                    break;
+
+                case kLogEvent_DutyCycleReset:
+                    pStats->iDutyCycleResets++;
+                    break;
+
+                case kLogEvent_TimerError:
+                    pStats->iTimerErrors++;
+                    break;
+
+                case kLogEvent_WakeToLights:
+                    pStats->iWakes++;
+                    pStats->ulWakeTotalMs += event.ulValue;
+                    pStats->ulWakeWorstMs = (event.ulValue > pStats->ulWakeWorstMs) ? event.ulValue : pStats->ulWakeWorstMs;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    // a closure still open at the end of the log is counted, without a length
+    if (bClosureOpen && bTimeline)
+    {
+        PrintClosure(name, closure);
+    }
+}
+
+static void PrintCrossing(const std::string &name, const CrossingStats_t &stats, bool bDays)
+{
+    long long llBusiestDay = kUndated;
+    int iBusiest = 0;
+    int iDatedDays = 0;
+    int iDatedClosures = 0;
+    char szDay[32];
+    std::map<long long, DayStats_t>::const_iterator it;
+
+    for (it = stats.days.begin(); it != stats.days.end(); ++it)
+    {
+        if (it->first == kUndated)
+        {
+            continue;
+        }
+        iDatedDays++;
+        iDatedClosures += it->second.iClosures;
+        if (it->second.iClosures > iBusiest)
+        {
+            iBusiest = it->second.iClosures;
+            llBusiestDay = it->first;
+        }
+    }
+
+    printf("%s: %d file%s, %llu lines, %.1f MB\n", name.c_str(), stats.iFiles, (stats.iFiles == 1) ? "" : "s",
+           stats.ullLines, stats.ullBytes / 1e6);
+    printf("  boots            : %d\n", stats.iBoots);
+    printf("  sensor detections: %d\n", stats.iSensorDetections);
+    printf("  closures         : %d", stats.iClosures);
+    if (stats.iTimedClosures > 0)
+    {
+        printf("  (mean %.1f s, longest %.1f s)", stats.llClosedMs / 1000.0 / stats.iTimedClosures, stats.llLongestClosureMs / 1000.0);
+    }
+    if (stats.iClosuresCut > 0)
+    {
+        printf("  %d cut by a reset", stats.iClosuresCut);
+    }
+    printf("\n");
+
+    if (iDatedDays > 0)
+    {
+        FormatTime(llBusiestDay * kMsPerDay, szDay, sizeof(szDay));
+        szDay[10] = '\0';
+        printf("  closures per day : %.1f over %d days, busiest %s (%d)\n", (double)iDatedClosures / iDatedDays, iDatedDays, szDay, iBusiest);
+    }
+
+    printf("  motor runs       : %d", stats.iMotorRuns);
+    if (stats.iTimedMotorRuns > 0)
+    {
+        printf("  (%.1f s in all, mean %.1f s)", stats.llMotorMs / 1000.0, stats.llMotorMs / 1000.0 / stats.iTimedMotorRuns);
+    }
+    printf("\n");
+    printf("  duty cycle       : %d trips, %d resets, peak total %.1f s\n", stats.iTrips, stats.iDutyCycleResets, stats.ulPeakMotorTotal / 1000.0);
+    printf("  timer errors     : %d\n", stats.iTimerErrors);
+    if (stats.iWakes > 0)
+    {
+        printf("  wake to lights   : mean %lu ms, worst %lu ms\n", stats.ulWakeTotalMs / stats.iWakes, stats.ulWakeWorstMs);
+    }
+
+    if (bDays)
+    {
+        printf("  %-10s %8s %10s %6s %10s %5s %5s\n", "day", "closures", "closed_s", "motor", "motor_s", "trips", "boots");
+        for (it = stats.days.begin(); it != stats.days.end(); ++it)
+        {
+            const DayStats_t &day = it->second;
+
+            FormatTime((it->first == kUndated) ? kUndated : (it->first * kMsPerDay), szDay, sizeof(szDay));
+            szDay[10] = '\0';
+            printf("  %-10s %8d %10.1f %6d %10.1f %5d %5d\n", szDay, day.iClosures, day.llClosedMs / 1000.0,
+                   day.iMotorRuns, day.llMotorMs / 1000.0, day.iTrips, day.iBoots);
+        }
+    }
+    printf("\n");
+}
+
+static std::string CrossingName(const char *pszArgument, const char **ppszPath)
+{
+    const char *pszEquals = strchr(pszArgument, '=');
+    const char *pszBase;
+    const char *pszDot;
+
+    if (pszEquals != NULL)
+    {
+        *ppszPath = pszEquals + 1;
+        return std::string(pszArgument, pszEquals - pszArgument);
+    }
+
+    *ppszPath = pszArgument;
+    pszBase = strrchr(pszArgument, '/');
+    pszBase = (pszBase != NULL) ? (pszBase + 1) : pszArgument;
+    pszDot = strchr(pszBase, '.');
+
+    return (pszDot != NULL) ? std::string(pszBase, pszDot - pszBase) : std::string(pszBase);
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> names;
+    std::vector<std::thread> threads;
+    unsigned long long ullBytes = 0;
+    int iThreads = (int)std::thread::hardware_concurrency();
+    bool bDays = false;
+    bool bTimeline = false;
+    struct timespec start, end;
+    double dSeconds;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-j") == 0) && (i + 1 < argc))
+        {
+            iThreads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0)
+        {
+            bDays = true;
+        }
+        else if (strcmp(argv[i], "-t") == 0)
+        {
+            bTimeline = true;
+        }
+        else
+        {
+            LogFile_t file;
+
+            file.name = CrossingName(argv[i], &file.pszPath);
+            gFiles.push_back(file);
+        }
+    }
+
+    if (gFiles.empty())
+    {
+        fprintf(stderr, "usage: loganalyze [-j threads] [-d] [-t] [name=]file ...\n");
+        return 2;
+    }
+    iThreads = (iThreads < 1) ? 1 : ((iThreads > kMaxThreads) ? kMaxThreads : iThreads);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < (int)gFiles.size(); i++)
+    {
+        if (!MapFile(&gFiles[i]))
+        {
+            return 2;
+        }
+        AddChunks(i);
+        ullBytes += gFiles[i].uiSize;
+
+        if (std::find(names.begin(), names.end(), gFiles[i].name) == names.end())
+        {
+            names.push_back(gFiles[i].name);
+        }
+    }
+
+    for (i = 0; i < iThreads; i++)
+    {
+        threads.push_back(std::thread(ParseThread));
+    }
+    for (i = 0; i < iThreads; i++)
+    {
+        threads[i].join();
+    }
+
+    for (size_t n = 0; n < names.size(); n++)
+    {
+        CrossingStats_t stats = CrossingStats_t();
+
+        WalkCrossing(names[n], &stats, bTimeline);
+        if (bTimeline)
+        {
+            printf("\n");
+        }
+        PrintCrossing(names[n], stats, bDays);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    dSeconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "loganalyze: %.1f MB in %.3f s (%.0f MB/s), %d threads, %d chunks\n",
+            ullBytes / 1e6, dSeconds, ullBytes / 1e6 / dSeconds, iThreads, (int)gChunks.size());
+
+    for (i = 0; i < (int)gFiles.size(); i++)
+    {
+        if (gFiles[i].pData != NULL)
+        {
+            munmap((void *)gFiles[i].pData, gFiles[i].uiSize);
+        }
+    }
+
+    return 0;
+}
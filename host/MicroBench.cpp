@@ -0,0 +1,292 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// MicroBench - host tool
+//
+// How late a microsecond event (everyMicros(), Timer.h) runs, beside the
+// crossing's millisecond events.  The clock is virtual and moves to the
+// microsecond: each callback moves it on by the time it is said to take,
+// and so does each pass of loop() outside the Timer.  The events are the
+// crossing's, with their periods, classes and budgets:
+//
+//     the controller tick   every 250 ms, control, kMainLoopBudget
+//     the two flashers      every 500 ms, safety, kWarningLightBudget a toggle
+//     the history flush     every 1000 ms, housekeeping, kHistoryFlushBudget
+//     the statistics flush  every 1000 ms, housekeeping, kStatsFlushBudget
+//
+// and a 2 kHz sampler of a track sensor that bounces for 3 ms at each
+// edge, debounced by counting 8 equal samples in a row.  The clock starts
+// 30 s before micros() wraps on the Uno, so the sampler runs across it.
+//
+//     g++ -std=gnu++11 -O2 -DARDUINO=100 -Ihost -I. Timer.cpp Event.cpp host/HostArduino.cpp host/MicroBench.cpp -o microbench
+//     g++ -std=gnu++11 -O2 -DARDUINO=100 -DTIMER_WHEEL -Ihost -I. Timer.cpp Event.cpp host/HostArduino.cpp host/MicroBench.cpp -o microbench_wheel
+//
+//     ./microbench [-m minutes] [-p period] [-l loop] [-u sample]
+//
+// (the period of the sampler, the time a loop() pass and a sample take,
+// in microseconds; 500, 100 and 20 by default).  It runs the crossing
+// twice: with every callback taking its whole budget, the worst the
+// budgets allow, and with the flushes finding nothing to write, as on a
+// quiet day.  For each it prints the sampler's lateness (p50, p99 and the
+// worst), the samples dropped, and the debounce time, from the sensor
+// settling to the debounced level changing.
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_Controller.h"
+
+const unsigned long long kWrapStart = 0x100000000ULL - 30000000ULL;
+const unsigned long kSensorEdgeTime = 30000317UL;     // not a whole number of ms, so the edges fall all over the ticks
+const unsigned long kSensorBounceTime = 3000UL;
+const uint8_t kSensorPin = 2;
+const uint8_t kDebounceSamples = 8;
+const unsigned int kLateBuckets = 10000;    // 10 us each, up to 100 ms
+
+typedef struct
+{
+    unsigned long ulTick;
+    unsigned long ulFlasher;
+    unsigned long ulHistoryFlush;
+    unsigned long ulStatsFlush;
+} MicroCosts_t;
+
+static MicroCosts_t gCosts;
+static unsigned long gulLoopCost = 100;
+static unsigned long gulSampleCost = 20;
+static unsigned long gulPeriod = 500;
+
+static unsigned long long gullNow;
+
+// the sampler's view: its own copy of the deadline, moved on as MicroEvent moves it
+static uint32_t gulExpected;
+static unsigned long gulLate[kLateBuckets];
+static unsigned long gulSamples;
+static unsigned long gulDropped;
+static uint32_t gulWorstLate;
+
+// the counter debounce
+static uint8_t guiDebounced;
+static uint8_t guiCandidate;
+static uint8_t guiSameSamples;
+static uint32_t gulWorstDebounce;
+static uint32_t gulBestDebounce;
+static unsigned long gulDebounced;
+
+static void Spend(unsigned long ulMicros)
+{
+    gullNow += ulMicros;
+    HostSetMicros((unsigned long)gullNow);
+}
+
+// high for about 30 s, low for about 30 s, bouncing for the first 3 ms of each
+static uint8_t SensorLevel(uint32_t ulSinceStart)
+{
+    uint32_t ulInEdge = ulSinceStart % kSensorEdgeTime;
+    uint8_t uiLevel = (uint8_t)((ulSinceStart / kSensorEdgeTime) & 1);
+
+    if (ulInEdge < kSensorBounceTime)
+    {
+        return ((ulInEdge / 170) & 1) ? uiLevel : !uiLevel;
+    }
+    return uiLevel;
+}
+
+static void Sample(void)
+{
+    uint32_t now = (uint32_t)micros();
+    uint32_t ulSinceStart = (uint32_t)(gullNow - kWrapStart);
+    int32_t late = (int32_t)(now - gulExpected);
+    uint8_t uiLevel;
+
+    gulSamples++;
+    if ((uint32_t)late > gulWorstLate)
+    {
+        gulWorstLate = (uint32_t)late;
+    }
+    gulLate[((uint32_t)late / 10 < kLateBuckets) ? (uint32_t)late / 10 : kLateBuckets - 1]++;
+    if ((uint32_t)late >= gulPeriod)
+    {
+        gulDropped += (uint32_t)late / gulPeriod;
+        gulExpected = now;
+    }
+    gulExpected += gulPeriod;
+
+    HostSetPinLevel(kSensorPin, SensorLevel(ulSinceStart));
+
+    uiLevel = (uint8_t)digitalRead(kSensorPin);
+    if (uiLevel != guiCandidate)
+    {
+        guiCandidate = uiLevel;
+        guiSameSamples = 0;
+    }
+    if (guiCandidate != guiDebounced && ++guiSameSamples >= kDebounceSamples)
+    {
+        // from the end of the bounce of the last edge
+        uint32_t ulDebounce = (ulSinceStart % kSensorEdgeTime) - kSensorBounceTime;
+
+        guiDebounced = guiCandidate;
+        gulWorstDebounce = (ulDebounce > gulWorstDebounce) ? ulDebounce : gulWorstDebounce;
+        gulBestDebounce = (ulDebounce < gulBestDebounce) ? ulDebounce : gulBestDebounce;
+        gulDebounced++;
+    }
+
+    Spend(gulSampleCost);
+}
+
+static void Tick(void)
+{
+    Spend(gCosts.ulTick);
+}
+
+static void HistoryFlush(void)
+{
+    Spend(gCosts.ulHistoryFlush);
+}
+
+static void StatsFlush(void)
+{
+    Spend(gCosts.ulStatsFlush);
+}
+
+static void FlasherToggle(uint8_t uiPin, uint8_t uiValue)
+{
+    (void)uiValue;
+    if (uiPin != kSensorPin)
+    {
+        Spend(gCosts.ulFlasher);
+    }
+}
+
+static unsigned long Percentile(double dFraction)
+{
+    unsigned long ulWant = (unsigned long)(gulSamples * dFraction);
+    unsigned long ulSeen = 0;
+
+    for (unsigned int i = 0; i < kLateBuckets; i++)
+    {
+        ulSeen += gulLate[i];
+        if (ulSeen > ulWant)
+        {
+            return i * 10;
+        }
+    }
+    return kLateBuckets * 10;
+}
+
+static void Run(const char *pszName, unsigned long ulMinutes)
+{
+    static Timer timer;
+    TimerHandle sampler;
+    TimerHandle handle;
+    unsigned long long ullEnd;
+
+    timer = Timer();
+    memset(gulLate, 0, sizeof(gulLate));
+    gulSamples = 0;
+    gulDropped = 0;
+    gulWorstLate = 0;
+    guiDebounced = 0;
+    guiCandidate = 0;
+    guiSameSamples = 0;
+    gulWorstDebounce = 0;
+    gulBestDebounce = 0xFFFFFFFFUL;
+    gulDebounced = 0;
+
+    HostReset();
+    gullNow = kWrapStart;
+    HostSetMicros((unsigned long)gullNow);
+    HostSetPinWriteHook(FlasherToggle);
+
+    handle = timer.every(kControllerStepTime, Tick);
+    timer.setBudget(handle, kMainLoopBudget);
+    handle = timer.oscillate(kPinAddrGateLightsControlRight, 500, HIGH);
+    timer.setBudget(handle, kWarningLightBudget);
+    handle = timer.oscillate(kPinAddrGateLightsControlLeft, 500, LOW);
+    timer.setBudget(handle, kWarningLightBudget);
+    handle = timer.every(1000, HistoryFlush);
+    timer.setPriority(handle, TIMER_PRIORITY_HOUSEKEEPING);
+    timer.setBudget(handle, kHistoryFlushBudget);
+    handle = timer.every(1000, StatsFlush);
+    timer.setPriority(handle, TIMER_PRIORITY_HOUSEKEEPING);
+    timer.setBudget(handle, kStatsFlushBudget);
+
+    gulExpected = (uint32_t)gullNow + gulPeriod;
+    sampler = timer.everyMicros(gulPeriod, Sample);
+    if (sampler == -1)
+    {
+        fprintf(stderr, "microbench: no microsecond event\n");
+        exit(2);
+    }
+
+    ullEnd = gullNow + ulMinutes * 60000000ULL;
+    while (gullNow < ullEnd)
+    {
+        timer.update();
+        Spend(gulLoopCost);
+    }
+
+    printf("  %-22s late p50 %5lu us, p99 %5lu us, worst %6lu us; %lu samples, %lu dropped; debounce %.1f to %.1f ms (%lu edges)\n",
+           pszName, Percentile(0.50), Percentile(0.99), (unsigned long)gulWorstLate, gulSamples, gulDropped,
+           gulBestDebounce / 1000.0, gulWorstDebounce / 1000.0, gulDebounced);
+
+    Serial.setOutput(stdout, false);
+    timer.printBudgets();
+    Serial.setOutput(NULL, false);
+    timer.stopMicros(sampler);
+    HostSetPinWriteHook(NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long ulMinutes = 10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((i + 1 < argc) && (strcmp(argv[i], "-m") == 0))
+        {
+            ulMinutes = strtoul(argv[++i], NULL, 0);
+        }
+        else if ((i + 1 < argc) && (strcmp(argv[i], "-p") == 0))
+        {
+            gulPeriod = strtoul(argv[++i], NULL, 0);
+        }
+        else if ((i + 1 < argc) && (strcmp(argv[i], "-l") == 0))
+        {
+            gulLoopCost = strtoul(argv[++i], NULL, 0);
+        }
+        else if ((i + 1 < argc) && (strcmp(argv[i], "-u") == 0))
+        {
+            gulSampleCost = strtoul(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: microbench [-m minutes] [-p period] [-l loop] [-u sample]\n");
+            return 2;
+        }
+    }
+
+#if defined(TIMER_WHEEL)
+    printf("timing wheel, %lu us sampler, %lu us a loop() pass, %lu us a sample\n", gulPeriod, gulLoopCost, gulSampleCost);
+#else
+    printf("Timer, %lu us sampler, %lu us a loop() pass, %lu us a sample\n", gulPeriod, gulLoopCost, gulSampleCost);
+#endif
+
+    gCosts.ulTick = kMainLoopBudget;
+    gCosts.ulFlasher = kWarningLightBudget;
+    gCosts.ulHistoryFlush = kHistoryFlushBudget;
+    gCosts.ulStatsFlush = kStatsFlushBudget;
+    Run("at their budgets", ulMinutes);
+
+    gCosts.ulHistoryFlush = 0;
+    gCosts.ulStatsFlush = 0;
+    Run("nothing to flush", ulMinutes);
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// ReplaySensorTrace - host tool
+//
+// Feeds a recorded track sensor trace through the controller, and prints
+// the resulting output pin timeline and state machine transitions.
+//
+// The trace is a text file of "TS <millis> <level>" lines, which is what the
+// controller prints when kRecordSensorTrace is set, so a serial capture can
+// be used as is.  Plain "<millis> <level>" lines work as well, and anything
+// else in the file is ignored.
+//
+// The trace runs on SimKernel, so virtual time jumps straight to the next
+// sensor edge or Timer deadline, and a trace runs as fast as the host allows.
+//
+// Build from the top of the sketch directory:
+//
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/SimVcd.cpp host/ReplaySensorTrace.cpp -o replay
+//
+//     ./replay [-s] [-l] [-u <until ms>] [-v <out.vcd>] trace.txt
+//
+//     -s  include the controller's serial output
+//     -l  leave out the warning light flashes
+//     -u  stop at this time (default: 60 seconds after the last edge)
+//     -v  also write the pins and state variables to a VCD file, for GTKWave
+//
+// ****************************************************
+
+#include <stdlib.h>
+#include <time.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_BlackBox.h"
+#include "SimKernel.h"
+#include "SimVcd.h"
+
+static bool gbShowLights = true;
+static CrossingVcd gVcd;
+static uint8_t guiBlackBoxHead = 0;
+
+// ***************************************************
+//
+// ReadSensorTrace()
+//
+// Schedules each sensor level in the trace, and returns the time of the last one.
+//
+// ****************************************************
+static unsigned long ReadSensorTrace(FILE *pFile, SimKernel *pKernel)
+{
+    char szLine[256];
+    unsigned long ulTime;
+    unsigned long ulLastTime = 0;
+    int iLevel;
+
+    while (fgets(szLine, sizeof(szLine), pFile) != NULL)
+    {
+        const char *p = szLine;
+
+        if (strncmp(p, "TS ", 3) == 0)
+        {
+            p += 3;
+        }
+
+        if (sscanf(p, "%lu %d", &ulTime, &iLevel) != 2)
+        {
+            continue;
+        }
+
+        pKernel->scheduleInput(ulTime, kPinAddrGateTrackSensor, (iLevel != 0) ? HIGH : LOW);
+        ulLastTime = ulTime;
+    }
+
+    return ulLastTime;
+}
+
+// ***************************************************
+//
+// PinName()
+//
+// ****************************************************
+static const char *PinName(uint8_t uiPin)
+{
+    switch (uiPin)
+    {
+        case kPinAddrGateBellControl:              return "Bell";
+        case kPinAddrGateLightsControlRight:       return "LightsRight";
+        case kPinAddrGateLightsControlLeft:        return "LightsLeft";
+        case kPinAddrGateArmControlMotorDirection: return "MotorDirection";
+        case kPinAddrGateArmControlMotorPower:     return "MotorPower";
+        case kPinAddrGateStatusLED:                return "StatusLED";
+        case kPinAddrGateTrackSensor:              return "TrackSensor";
+        default:                                   return "?";
+    }
+}
+
+static void PrintPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    if (gVcd.isOpen())
+    {
+        gVcd.pinWrite(millis(), uiPin, uiValue);
+    }
+
+    if ((gbShowLights == false) && ((uiPin == kPinAddrGateLightsControlRight) || (uiPin == kPinAddrGateLightsControlLeft)))
+    {
+        return;
+    }
+
+    printf("%10lu pin     %-15s %d\n", millis(), PinName(uiPin), uiValue);
+}
+
+// ***************************************************
+//
+// StateName()
+//
+// Turns a packed black box state back into words.
+//
+// ****************************************************
+static void StateName(uint8_t uiState, char *pszName, size_t size)
+{
+    static const char *szTrack[] = { "Initializing", "Occupied", "Vacant", "?" };
+    static const char *szInitialize[] = { "LightsBellsAndDirection", "MotorDirectionDelay", "MotorOn", "MotorOff", "?", "?", "?", "?" };
+    static const char *szDown[] = { "LightsAndBells", "LightsAndBellsDelay", "MotorDirection", "MotorOn", "MotorOnDelay", "MotorOff", "?", "?" };
+    static const char *szUp[] = { "Debounce", "MotorDirection", "MotorDirectionDelay", "MotorOn", "MotorOnDelay", "MotorOff", "?", "?" };
+    int iTrack = uiState & 0x03;
+    int iSub = (uiState >> 3) & 0x07;
+    const char *pszSub = (iTrack == kInitializing) ? szInitialize[iSub] : (iTrack == kTrackOccupied) ? szDown[iSub] : szUp[iSub];
+
+    snprintf(pszName, size, "%s/%s/%s", szTrack[iTrack], (uiState & 0x04) ? "Down" : "Up", pszSub);
+}
+
+// ***************************************************
+//
+// PrintNewTransitions()
+//
+// The black box already records every state transition, so we just
+// print whatever it has added since we last looked.
+//
+// ****************************************************
+static void PrintNewTransitions(void)
+{
+    char szFrom[64];
+    char szTo[64];
+
+    if (gVcd.isOpen())
+    {
+        gVcd.step(millis());
+    }
+
+    while (guiBlackBoxHead != gBlackBox.uiHead)
+    {
+        BlackBoxRecord_t *pRecord = &gBlackBox.records[guiBlackBoxHead];
+
+        StateName(pRecord->uiPreviousState, szFrom, sizeof(szFrom));
+        StateName(pRecord->uiState, szTo, sizeof(szTo));
+        printf("%10lu state   %s -> %s  sensor=%d motor=%d direction=%d duty=%d\n", millis(), szFrom, szTo,
+               (pRecord->uiFlags & kBlackBoxFlagSensor) ? 1 : 0,
+               (pRecord->uiFlags & kBlackBoxFlagMotorRunning) ? 1 : 0,
+               (pRecord->uiFlags & kBlackBoxFlagMotorDirection) ? 1 : 0,
+               (pRecord->uiFlags & kBlackBoxFlagDutyCycle) ? 1 : 0);
+
+        guiBlackBoxHead = (guiBlackBoxHead + 1) & (kBlackBoxRecordCount - 1);
+    }
+}
+
+static void PrintSensorEdge(uint8_t uiPin, uint8_t uiLevel)
+{
+    if (gVcd.isOpen())
+    {
+        gVcd.input(millis(), uiPin, uiLevel);
+    }
+
+    printf("%10lu sensor  %d\n", millis(), uiLevel);
+}
+
+int main(int argc, char *argv[])
+{
+    SimKernel kernel;
+    FILE *pTrace = stdin;
+    const char *pszVcd = NULL;
+    unsigned long ulUntil = 0;
+    unsigned long ulLastEdge;
+    clock_t start;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0)
+        {
+            Serial.setOutput(stdout, true);
+        }
+        else if (strcmp(argv[i], "-l") == 0)
+        {
+            gbShowLights = false;
+        }
+        else if ((strcmp(argv[i], "-u") == 0) && (i + 1 < argc))
+        {
+            ulUntil = strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "-v") == 0) && (i + 1 < argc))
+        {
+            pszVcd = argv[++i];
+        }
+        else if ((pTrace = fopen(argv[i], "r")) == NULL)
+        {
+            fprintf(stderr, "replay: cannot open %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    kernel.reset();
+    ulLastEdge = ReadSensorTrace(pTrace, &kernel);
+
+    if (ulUntil == 0)
+    {
+        ulUntil = ulLastEdge + 60000UL;
+    }
+
+    if ((pszVcd != NULL) && !gVcd.open(pszVcd))
+    {
+        return 1;
+    }
+
+    HostSetPinWriteHook(PrintPinWrite);
+    kernel.setInputHook(PrintSensorEdge);
+    kernel.setStepHook(PrintNewTransitions);
+    kernel.boot();
+
+    start = clock();
+    kernel.runUntil(ulUntil);
+
+    fprintf(stderr, "replay: %lu ms simulated in %lu steps, %.3f s cpu\n", kernel.now(), kernel.steps(),
+            (double)(clock() - start) / CLOCKS_PER_SEC);
+
+    gVcd.close();
+
+    return 0;
+}
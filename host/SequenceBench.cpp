@@ -0,0 +1,232 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SequenceBench - host tool
+//
+// Compares the two builds of the gate sequences (SRMcrossGate_Sequences.h):
+// the hand-written states, and the stackless coroutines of
+// -DGATE_COROUTINES.  Build it both ways and run each:
+//
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/SimVcd.cpp host/SequenceBench.cpp -o seqbench
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -DGATE_COROUTINES -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/SimVcd.cpp host/SequenceBench.cpp -o seqbench_co
+//
+//     ./seqbench [cycles]
+//
+// It prints:
+//
+//   - a digest of the output pins over a day of the SimBench trains, on the
+//     250 ms tick and event driven; the two builds should print the same
+//     digests, as the coroutines yield where the states took a run
+//   - the runs of CrossingSignalMain() that day
+//   - the time per call of GateDownSequence() and GateUpSequence(), over
+//     whole cycles of the gate, down and up, one call each 250 ms
+//   - the SRAM the sequences keep on the Uno
+//
+// The flash comes from avr-size on the two images, the second built with
+// --build-property compiler.cpp.extra_flags=-DGATE_COROUTINES.
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Sequences.h"
+#include "SimKernel.h"
+
+const unsigned long kOneDay = 24UL * 60UL * 60UL * 1000UL;
+
+typedef struct
+{
+    unsigned long ulPinWrites;
+    unsigned long ulPinDigest;
+    unsigned long ulRuns;
+} SequenceDay_t;
+
+static SequenceDay_t gDay;
+
+static void DigestPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    gDay.ulPinWrites++;
+    gDay.ulPinDigest = (gDay.ulPinDigest * 31UL) ^ (millis() * 7UL + uiPin * 2UL + uiValue);
+}
+
+// ***************************************************
+//
+// ScheduleDayOfTrains()
+//
+// The same trains as SimBench.  The same seed gives the same days.
+//
+// ****************************************************
+static void ScheduleDayOfTrains(SimKernel *pKernel, int iTrains, unsigned int uiSeed)
+{
+    unsigned long ulTime = 60000UL;
+    unsigned long ulGap = kOneDay / (iTrains + 1);
+
+    srand(uiSeed);
+
+    for (int i = 0; i < iTrains; i++)
+    {
+        unsigned long ulArrive = ulTime + (rand() % (ulGap / 2));
+        unsigned long ulLeave = ulArrive + 30000UL + (rand() % 120000UL);
+
+        for (int iBounce = 0; iBounce < 3; iBounce++)
+        {
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL, kPinAddrGateTrackSensor, HIGH);
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL + 60UL, kPinAddrGateTrackSensor, LOW);
+        }
+        pKernel->scheduleInput(ulArrive + 600UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave, kPinAddrGateTrackSensor, LOW);
+        pKernel->scheduleInput(ulLeave + 200UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave + 300UL, kPinAddrGateTrackSensor, LOW);
+
+        ulTime += ulGap;
+    }
+}
+
+// ***************************************************
+//
+// RunDay()
+//
+// In a child process, such that each run starts from power on.
+//
+// ****************************************************
+static SequenceDay_t RunDay(bool bEventDriven)
+{
+    SequenceDay_t day;
+    int fds[2];
+    pid_t pid;
+
+    memset(&day, 0, sizeof(day));
+
+    if (pipe(fds) != 0)
+    {
+        perror("pipe");
+        exit(2);
+    }
+
+    pid = fork();
+    if (pid == 0)
+    {
+        SimKernel kernel;
+
+        close(fds[0]);
+        gbControllerEventDriven = bEventDriven;
+        HostSetPinWriteHook(DigestPinWrite);
+        kernel.reset();
+        ScheduleDayOfTrains(&kernel, 24, 1);
+        kernel.boot();
+        kernel.runUntil(kOneDay);
+
+        gDay.ulRuns = gCrossingState.ulControllerRuns;
+        if (write(fds[1], &gDay, sizeof(gDay)) != (ssize_t)sizeof(gDay))
+        {
+            _exit(2);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    if ((pid < 0) || (read(fds[0], &day, sizeof(day)) != (ssize_t)sizeof(day)))
+    {
+        fprintf(stderr, "seqbench: the run failed\n");
+        exit(2);
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+
+    return day;
+}
+
+static double Seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// ***************************************************
+//
+// TimeCycles()
+//
+// Calls the sequences directly, as CrossingSignalMain() would on the
+// tick: down while the track is occupied, up once it is vacant.  The
+// motor's run time is cleared each cycle, so the duty cycle never trips.
+//
+// ****************************************************
+static void TimeCycles(unsigned long ulCycles)
+{
+    unsigned long ulMillis = 0;
+    unsigned long ulCalls = 0;
+    double dStart;
+    double dElapsed;
+
+    HostReset();
+    HostSetPinWriteHook(NULL);
+    CrossingStateReset();
+    gCrossingState.iTrackOcupationState = kTrackOccupied;
+
+    dStart = Seconds();
+    for (unsigned long ulCycle = 0; ulCycle < ulCycles; ulCycle++)
+    {
+        gCrossingState.ulMotorRunningTotalSeconds = 0;
+        gCrossingState.iTrackOcupationState = kTrackOccupied;
+        while (gCrossingState.bGateState == kGateInTheUpPosition)
+        {
+            ulMillis += 250;
+            HostSetMillis(ulMillis);
+            GateDownSequence();
+            ulCalls++;
+        }
+
+        gCrossingState.iTrackOcupationState = kTrackVacant;
+        while (gCrossingState.bGateState == kGateInDownPosition)
+        {
+            ulMillis += 250;
+            HostSetMillis(ulMillis);
+            GateUpSequence();
+            ulCalls++;
+        }
+    }
+    dElapsed = Seconds() - dStart;
+
+    printf("  sequences  : %lu cycles, %lu calls a cycle, %.1f ns a call\n",
+           ulCycles, ulCalls / ulCycles, dElapsed * 1e9 / ulCalls);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long ulCycles = (argc > 1) ? strtoul(argv[1], NULL, 0) : 20000UL;
+    SequenceDay_t tick;
+    SequenceDay_t event;
+
+#if defined(GATE_COROUTINES)
+    // the two steps (int), and a wait start each
+    const unsigned int uiUnoBytes = 2 + 2 + 4 + 4;
+    printf("stackless coroutines (-DGATE_COROUTINES)\n");
+#else
+    // the two states (int), the two delays, and the one start time they share
+    const unsigned int uiUnoBytes = 2 + 2 + 4 + 4 + 4;
+    printf("hand-written states\n");
+#endif
+
+    tick = RunDay(false);
+    event = RunDay(true);
+
+    printf("  250 ms tick: %lu pin writes, digest %08lx, %lu runs\n", tick.ulPinWrites, tick.ulPinDigest & 0xFFFFFFFFUL, tick.ulRuns);
+    printf("  event      : %lu pin writes, digest %08lx, %lu runs\n", event.ulPinWrites, event.ulPinDigest & 0xFFFFFFFFUL, event.ulRuns);
+
+    TimeCycles(ulCycles);
+
+    printf("  Uno SRAM   : %u bytes of sequence state in gCrossingState\n", uiUnoBytes);
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SimBench - host tool
+//
+// Runs the same day of simulated traffic twice: once stepping the clock
+// one millisecond at a time, and once on SimKernel's jump to the next
+// deadline.  It checks both runs drove the output pins the same way,
+// and reports the speedup.  The speedup depends on the traffic: most of
+// the saving is in the idle time between trains.
+//
+// With -v the kernel run is made a third time, writing a VCD file of the
+// pins and state variables (SimVcd.h), to show what the dump costs.
+//
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/SimVcd.cpp host/SimBench.cpp -o simbench
+//
+//     ./simbench [trains per day] [-d days] [-v out.vcd]
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SimKernel.h"
+#include "SimVcd.h"
+
+const unsigned long kOneDay = 24UL * 60UL * 60UL * 1000UL;
+
+static unsigned long gulPinWrites;
+static unsigned long gulPinDigest;
+static CrossingVcd gVcd;
+
+// every output pin change goes into a digest, such that the two runs can be compared
+static void DigestPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    gulPinWrites++;
+    gulPinDigest = (gulPinDigest * 31UL) ^ (millis() * 7UL + uiPin * 2UL + uiValue);
+
+    if (gVcd.isOpen())
+    {
+        gVcd.pinWrite(millis(), uiPin, uiValue);
+    }
+}
+
+static void VcdInput(uint8_t uiPin, uint8_t uiLevel)
+{
+    gVcd.input(millis(), uiPin, uiLevel);
+}
+
+static void VcdStep(void)
+{
+    gVcd.step(millis());
+}
+
+// ***************************************************
+//
+// ScheduleDayOfTrains()
+//
+// A train every so often, each one with a little sensor chatter as it
+// arrives and leaves.  The same seed gives the same days.
+//
+// ****************************************************
+static void ScheduleDayOfTrains(SimKernel *pKernel, int iTrains, int iDays, unsigned int uiSeed)
+{
+    unsigned long ulTime = 60000UL;
+    unsigned long ulGap = kOneDay / (iTrains + 1);
+
+    iTrains *= iDays;
+
+    srand(uiSeed);
+
+    for (int i = 0; i < iTrains; i++)
+    {
+        unsigned long ulArrive = ulTime + (rand() % (ulGap / 2));
+        unsigned long ulLeave = ulArrive + 30000UL + (rand() % 120000UL);
+
+        for (int iBounce = 0; iBounce < 3; iBounce++)
+        {
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL, kPinAddrGateTrackSensor, HIGH);
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL + 60UL, kPinAddrGateTrackSensor, LOW);
+        }
+        pKernel->scheduleInput(ulArrive + 600UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave, kPinAddrGateTrackSensor, LOW);
+        pKernel->scheduleInput(ulLeave + 200UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave + 300UL, kPinAddrGateTrackSensor, LOW);
+
+        ulTime += ulGap;
+    }
+}
+
+typedef struct
+{
+    double dSeconds;
+    unsigned long ulSteps;
+    unsigned long ulIdleSkips;
+    unsigned long ulPinWrites;
+    unsigned long ulPinDigest;
+    unsigned long long ullVcdBytes;
+} DayResult_t;
+
+// ***************************************************
+//
+// RunDay()
+//
+// The controller keeps its state in statics, so each run is made in a
+// child process, such that both start from power on.
+//
+// ****************************************************
+static DayResult_t RunDay(bool bFixedStep, int iTrains, int iDays, const char *pszVcd)
+{
+    DayResult_t result;
+    int fds[2];
+    pid_t pid;
+
+    memset(&result, 0, sizeof(result));
+
+    if (pipe(fds) != 0)
+    {
+        perror("pipe");
+        exit(2);
+    }
+
+    pid = fork();
+    if (pid == 0)
+    {
+        SimKernel kernel;
+        clock_t start;
+
+        close(fds[0]);
+        HostSetPinWriteHook(DigestPinWrite);
+        kernel.reset();
+        kernel.setFixedStep(bFixedStep);
+        ScheduleDayOfTrains(&kernel, iTrains, iDays, 1);
+
+        if (pszVcd != NULL)
+        {
+            if (!gVcd.open(pszVcd))
+            {
+                _exit(2);
+            }
+            kernel.setInputHook(VcdInput);
+            kernel.setStepHook(VcdStep);
+        }
+
+        kernel.boot();
+
+        // the time to finish writing the VCD file counts as well
+        start = clock();
+        kernel.runUntil(kOneDay * iDays);
+        gVcd.close();
+
+        result.dSeconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        result.ulSteps = kernel.steps();
+        result.ulIdleSkips = kernel.idleSkips();
+        result.ulPinWrites = gulPinWrites;
+        result.ulPinDigest = gulPinDigest;
+        result.ullVcdBytes = gVcd.bytes();
+        if (write(fds[1], &result, sizeof(result)) != (ssize_t)sizeof(result))
+        {
+            _exit(2);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    if ((pid < 0) || (read(fds[0], &result, sizeof(result)) != (ssize_t)sizeof(result)))
+    {
+        fprintf(stderr, "simbench: the run failed\n");
+        exit(2);
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *pszVcd = NULL;
+    int iTrains = 24;
+    int iDays = 1;
+    DayResult_t fixed;
+    DayResult_t jump;
+    DayResult_t dump;
+    bool bMatch;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+        {
+            iDays = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-v") == 0) && (i + 1 < argc))
+        {
+            pszVcd = argv[++i];
+        }
+        else
+        {
+            iTrains = atoi(argv[i]);
+        }
+    }
+
+    fixed = RunDay(true, iTrains, iDays, NULL);
+    jump = RunDay(false, iTrains, iDays, NULL);
+    bMatch = (fixed.ulPinWrites == jump.ulPinWrites) && (fixed.ulPinDigest == jump.ulPinDigest);
+
+    printf("%d day%s, %d trains a day\n", iDays, (iDays == 1) ? "" : "s", iTrains);
+    printf("  fixed 1 ms steps : %10lu steps %9.4f s  %lu pin writes\n", fixed.ulSteps, fixed.dSeconds, fixed.ulPinWrites);
+    printf("  next deadline    : %10lu steps %9.4f s  %lu pin writes  (%lu idle skips)\n",
+           jump.ulSteps, jump.dSeconds, jump.ulPinWrites, jump.ulIdleSkips);
+
+    if (pszVcd != NULL)
+    {
+        dump = RunDay(false, iTrains, iDays, pszVcd);
+        bMatch = bMatch && (dump.ulPinDigest == jump.ulPinDigest);
+
+        printf("  with VCD dump    : %10lu steps %9.4f s  %.1f MB, %.0f MB/s\n", dump.ulSteps, dump.dSeconds,
+               dump.ullVcdBytes / 1e6, dump.ullVcdBytes / 1e6 / ((dump.dSeconds > 0) ? dump.dSeconds : 1e-6));
+    }
+
+    printf("  outputs %s\n", bMatch ? "match" : "DIFFER");
+    printf("  speedup          : %.0fx\n", fixed.dSeconds / ((jump.dSeconds > 0) ? jump.dSeconds : 1e-6));
+
+    return bMatch ? 0 : 1;
+}
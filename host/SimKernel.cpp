@@ -0,0 +1,272 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SimKernel - discrete event simulation of the controller (host only)
+//
+// ****************************************************
+
+#include <string.h>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_BlackBox.h"
+#include "SRMcrossGate_State.h"
+#include "SimKernel.h"
+
+void setup();
+void loop();
+extern Timer gCrossingGateTimer;
+extern bool gbIdleSleepAllowed;
+extern int giMainLoopEventTimerID;
+
+SimKernel::SimKernel(void)
+{
+    _ulOrder = 0;
+    _ulSteps = 0;
+    _ulIdleSkips = 0;
+    _ulEpoch = 0;
+    _bFixedStep = false;
+    _bIdle = false;
+    _pInputHook = NULL;
+    _pStepHook = NULL;
+}
+
+// ***************************************************
+//
+// reset()
+//
+// Puts the host Arduino back to power on, and drops any pending inputs.
+// Like a power cycle, this clears the Timer and loses the black box (the
+// state machine itself is reset by setup()).
+//
+// ****************************************************
+void SimKernel::reset(void)
+{
+    HostReset();
+    gCrossingGateTimer = Timer();
+    gBlackBox.uiMagic = 0;
+
+    while (!_inputs.empty())
+    {
+        _inputs.pop();
+    }
+    _ulOrder = 0;
+    _ulSteps = 0;
+    _ulIdleSkips = 0;
+    _ulEpoch = 0;
+}
+
+void SimKernel::boot(void)
+{
+    setup();
+}
+
+// ***************************************************
+//
+// restart()
+//
+// A reset without a power cycle (the reset button, or a brown out).  The
+// outputs drop, millis() starts again from zero, the Timer starts out empty
+// and setup() runs again.  The input levels, the pending inputs and the
+// black box carry on, and now() keeps counting the time since boot().
+//
+// ****************************************************
+void SimKernel::restart(void)
+{
+    HostArduinoState_t inputs = gHostArduino;
+    uint8_t uiPin;
+
+    _ulEpoch += inputs.ulMillis;
+    HostReset();
+    for (uiPin = 0; uiPin < kHostPinCount; uiPin++)
+    {
+        if (inputs.uiPinMode[uiPin] != OUTPUT)
+        {
+            HostSetPinLevel(uiPin, inputs.uiPinLevel[uiPin]);
+        }
+    }
+
+    gCrossingGateTimer = Timer();
+    setup();
+}
+
+// ***************************************************
+//
+// save() / restore()
+//
+// restore() puts the controller back as it was at save(), and drops the
+// pending input edges.  The pin write hook is not called for the outputs
+// it changes, so a tool that follows the outputs has to keep its own
+// copy of what it knew at save().
+//
+// ****************************************************
+void SimKernel::save(SimSnapshot_t *pSnapshot)
+{
+    pSnapshot->crossingState = gCrossingState;
+    pSnapshot->timer = gCrossingGateTimer;
+    pSnapshot->blackBox = gBlackBox;
+    memcpy(pSnapshot->uiEeprom, EEPROM._uiData, sizeof(pSnapshot->uiEeprom));
+    pSnapshot->hostArduino = gHostArduino;
+    pSnapshot->bIdleSleepAllowed = gbIdleSleepAllowed;
+    pSnapshot->iMainLoopEventTimerID = giMainLoopEventTimerID;
+    pSnapshot->ulEpoch = _ulEpoch;
+    pSnapshot->ulSteps = _ulSteps;
+    pSnapshot->ulIdleSkips = _ulIdleSkips;
+}
+
+void SimKernel::restore(const SimSnapshot_t *pSnapshot)
+{
+    gCrossingState = pSnapshot->crossingState;
+    gCrossingGateTimer = pSnapshot->timer;
+    gBlackBox = pSnapshot->blackBox;
+    memcpy(EEPROM._uiData, pSnapshot->uiEeprom, sizeof(pSnapshot->uiEeprom));
+    gHostArduino = pSnapshot->hostArduino;
+    gbIdleSleepAllowed = pSnapshot->bIdleSleepAllowed;
+    giMainLoopEventTimerID = pSnapshot->iMainLoopEventTimerID;
+    _ulEpoch = pSnapshot->ulEpoch;
+    _ulSteps = pSnapshot->ulSteps;
+    _ulIdleSkips = pSnapshot->ulIdleSkips;
+
+    while (!_inputs.empty())
+    {
+        _inputs.pop();
+    }
+}
+
+// ***************************************************
+//
+// scheduleInput()
+//
+// Queues an input pin change, at a time since boot().  Edges at the same
+// time are applied in the order they were scheduled.
+//
+// ****************************************************
+void SimKernel::scheduleInput(unsigned long ulTime, uint8_t uiPin, uint8_t uiLevel)
+{
+    SimInputEdge_t edge;
+
+    edge.ulTime = ulTime;
+    edge.ulOrder = _ulOrder++;
+    edge.uiPin = uiPin;
+    edge.uiLevel = uiLevel;
+    _inputs.push(edge);
+}
+
+// the time since boot(), which unlike millis() carries on through a restart()
+unsigned long SimKernel::now(void)
+{
+    return _ulEpoch + millis();
+}
+
+// ***************************************************
+//
+// nextEventTime()
+//
+// The earliest of the next Timer deadline, the next input edge and ulUntil.
+// While the controller is idle the Timer deadlines are slept through, just
+// as the Uno powers down, so only the next input edge counts.
+//
+// ****************************************************
+unsigned long SimKernel::nextEventTime(unsigned long ulUntil)
+{
+    unsigned long ulNow = now();
+    unsigned long ulNext;
+
+    _bIdle = false;
+    if (_bFixedStep)
+    {
+        ulNext = ulNow + 1;
+    }
+    else if (isIdle())
+    {
+        ulNext = ulUntil;
+    }
+    else
+    {
+        ulNext = gCrossingGateTimer.timeToNextEvent();
+        ulNext = (ulNext == TIMER_NO_EVENT) ? ulUntil : ulNow + ((ulNext == 0) ? 1 : ulNext);
+    }
+
+    // an edge scheduled in the past is applied now
+    if (!_inputs.empty() && (_inputs.top().ulTime < ulNext))
+    {
+        ulNext = (_inputs.top().ulTime > ulNow) ? _inputs.top().ulTime : ulNow;
+    }
+
+    return (ulNext > ulUntil) ? ulUntil : ulNext;
+}
+
+// ***************************************************
+//
+// step()
+//
+// Moves the clock to the next event (but not past ulUntil), applies the
+// input edges that are due and runs loop() once.  Returns false once the
+// clock has reached ulUntil.
+//
+// ****************************************************
+bool SimKernel::step(unsigned long ulUntil)
+{
+    if (now() >= ulUntil)
+    {
+        return false;
+    }
+
+    HostSetMillis(nextEventTime(ulUntil) - _ulEpoch);
+
+    if (_bIdle)
+    {
+        // the ticks we slept through would have found nothing to do
+        gCrossingGateTimer.skipMissed();
+        _ulIdleSkips++;
+    }
+
+    while (!_inputs.empty() && (_inputs.top().ulTime <= now()))
+    {
+        SimInputEdge_t edge = _inputs.top();
+
+        _inputs.pop();
+        HostSetPinLevel(edge.uiPin, edge.uiLevel);
+
+        if (_pInputHook != NULL)
+        {
+            (*_pInputHook)(edge.uiPin, edge.uiLevel);
+        }
+    }
+
+    loop();
+    _ulSteps++;
+
+    if (_pStepHook != NULL)
+    {
+        (*_pStepHook)();
+    }
+
+    return true;
+}
+
+void SimKernel::runUntil(unsigned long ulUntil)
+{
+    while (step(ulUntil))
+    {
+    }
+}
+
+
+// ***************************************************
+//
+// isIdle()
+//
+// The same test IdleSleepIfAllowed() makes before it powers down.  On the
+// Uno the watchdog still wakes the controller for every main loop tick,
+// but while it is idle those ticks have nothing to do.
+//
+// ****************************************************
+bool SimKernel::isIdle(void)
+{
+    _bIdle = (gbIdleSleepAllowed == true) && (digitalRead(kPinAddrGateTrackSensor) != kTrackOccupied);
+
+    return _bIdle;
+}
@@ -0,0 +1,114 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SimKernel - discrete event simulation of the controller (host only)
+//
+// The kernel runs the sketch's setup() and loop() against the host Arduino
+// API.  Rather than stepping the clock one millisecond at a time, it moves
+// the virtual millis() straight to the earliest of the next Timer deadline
+// and the next scheduled input edge, then runs loop() once.  Nothing else in
+// the controller depends on time, so the result is the same as fixed stepping.
+//
+// When the controller says it is idle (the same test IdleSleepIfAllowed()
+// uses to power down), every tick until the next input edge would do
+// nothing, so the kernel moves the clock straight to that edge and lets the
+// Timer skip the deadlines it missed.
+//
+// save() and restore() copy the whole controller, so a search can run a
+// common start once and branch from it as often as it likes.
+//
+// ****************************************************
+
+#ifndef SimKernel_h
+#define SimKernel_h
+
+#include <inttypes.h>
+#include <queue>
+#include <vector>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "Timer.h"
+#include "SRMcrossGate_BlackBox.h"
+#include "SRMcrossGate_State.h"
+
+typedef struct
+{
+    unsigned long ulTime;
+    unsigned long ulOrder;
+    uint8_t uiPin;
+    uint8_t uiLevel;
+} SimInputEdge_t;
+
+struct SimInputEdgeLater
+{
+    bool operator()(const SimInputEdge_t &a, const SimInputEdge_t &b) const
+    {
+        return (a.ulTime != b.ulTime) ? (a.ulTime > b.ulTime) : (a.ulOrder > b.ulOrder);
+    }
+};
+
+// ***************************************************
+//
+// SimSnapshot_t
+//
+// Everything the controller (and the kernel) carry from one step to the
+// next, as plain copies: about 2 KB, most of it the EEPROM.  The pending
+// input edges and the serial input are not in it, a branch schedules its
+// own after restore().
+//
+// ****************************************************
+typedef struct
+{
+    CrossingState_t crossingState;
+    Timer timer;
+    BlackBox_t blackBox;
+    uint8_t uiEeprom[kHostEepromSize];
+    HostArduinoState_t hostArduino;
+    bool bIdleSleepAllowed;
+    int iMainLoopEventTimerID;
+    unsigned long ulEpoch;
+    unsigned long ulSteps;
+    unsigned long ulIdleSkips;
+} SimSnapshot_t;
+
+class SimKernel
+{
+
+public:
+  SimKernel(void);
+
+  void reset(void);
+  void boot(void);
+  void restart(void);
+  void save(SimSnapshot_t *pSnapshot);
+  void restore(const SimSnapshot_t *pSnapshot);
+  void scheduleInput(unsigned long ulTime, uint8_t uiPin, uint8_t uiLevel);
+  bool step(unsigned long ulUntil);
+  void runUntil(unsigned long ulUntil);
+
+  unsigned long now(void);
+  unsigned long nextEventTime(unsigned long ulUntil);
+  unsigned long steps(void) { return _ulSteps; }
+  unsigned long idleSkips(void) { return _ulIdleSkips; }
+  bool inputsPending(void) { return !_inputs.empty(); }
+  bool isIdle(void);
+
+  void setFixedStep(bool bFixedStep) { _bFixedStep = bFixedStep; }
+  void setInputHook(void (*pHook)(uint8_t uiPin, uint8_t uiLevel)) { _pInputHook = pHook; }
+  void setStepHook(void (*pHook)(void)) { _pStepHook = pHook; }
+
+protected:
+  std::priority_queue<SimInputEdge_t, std::vector<SimInputEdge_t>, SimInputEdgeLater> _inputs;
+  unsigned long _ulOrder;
+  unsigned long _ulSteps;
+  unsigned long _ulIdleSkips;
+  unsigned long _ulEpoch;
+  bool _bFixedStep;
+  bool _bIdle;
+  void (*_pInputHook)(uint8_t uiPin, uint8_t uiLevel);
+  void (*_pStepHook)(void);
+
+};
+
+#endif
@@ -0,0 +1,383 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SimVcd - Value Change Dump output (host only)
+//
+// ****************************************************
+
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SimVcd.h"
+
+extern bool gbIdleSleepAllowed;
+
+// the longest change: a timestamp, and a 32 bit vector with its identifier
+const size_t kVcdMaxChangeSize = 64;
+
+VcdWriter::VcdWriter(void)
+{
+    _pFile = NULL;
+    _pFill = NULL;
+    _pPending = NULL;
+    _uiUsed = 0;
+    _uiPending = 0;
+    _ullBytes = 0;
+    _bStarted = false;
+    _bClosing = false;
+    _ulTime = 0;
+    _iSignals = 0;
+}
+
+VcdWriter::~VcdWriter(void)
+{
+    close();
+}
+
+// ***************************************************
+//
+// open()
+//
+// Starts the header.  pszTimescale is the unit of the times given to
+// change(), "1 ms" for instance.
+//
+// ****************************************************
+bool VcdWriter::open(const char *pszPath, const char *pszTimescale)
+{
+    _pFile = fopen(pszPath, "wb");
+    if (_pFile == NULL)
+    {
+        perror(pszPath);
+        return false;
+    }
+
+    _pFill = (char *)malloc(kVcdBufferSize);
+    _pPending = (char *)malloc(kVcdBufferSize);
+    _uiUsed = 0;
+    _uiPending = 0;
+    _ullBytes = 0;
+    _bStarted = false;
+    _bClosing = false;
+    _ulTime = 0;
+    _iSignals = 0;
+
+    put("$version SRMcrossGate host simulation $end\n$timescale ");
+    put(pszTimescale);
+    put(" $end\n");
+
+    _writer = std::thread(&VcdWriter::writerThread, this);
+    return true;
+}
+
+// ***************************************************
+//
+// addSignal()
+//
+// Declares a signal before begin().  Returns the number to pass to
+// change(), or -1 if there are too many.
+//
+// ****************************************************
+int VcdWriter::addSignal(const char *pszScope, const char *pszName, int iWidth, unsigned long ulInitial)
+{
+    if (_bStarted || (_iSignals >= kVcdMaxSignals))
+    {
+        return -1;
+    }
+
+    _iWidth[_iSignals] = iWidth;
+    _ulValue[_iSignals] = ulInitial;
+    snprintf(_szScope[_iSignals], sizeof(_szScope[0]), "%s", pszScope);
+    snprintf(_szName[_iSignals], sizeof(_szName[0]), "%s", pszName);
+
+    return _iSignals++;
+}
+
+// ***************************************************
+//
+// begin()
+//
+// Ends the header, with each scope's signals together, and dumps the
+// initial values at time zero.
+//
+// ****************************************************
+void VcdWriter::begin(void)
+{
+    char szLine[128];
+    int i, j;
+
+    for (i = 0; i < _iSignals; i++)
+    {
+        bool bFirstInScope = true;
+
+        for (j = 0; j < i; j++)
+        {
+            bFirstInScope = bFirstInScope && (strcmp(_szScope[j], _szScope[i]) != 0);
+        }
+        if (!bFirstInScope)
+        {
+            continue;
+        }
+
+        snprintf(szLine, sizeof(szLine), "$scope module %s $end\n", _szScope[i]);
+        put(szLine);
+        for (j = i; j < _iSignals; j++)
+        {
+            if (strcmp(_szScope[j], _szScope[i]) == 0)
+            {
+                snprintf(szLine, sizeof(szLine), "$var %s %d %c %s $end\n", (_iWidth[j] == 1) ? "wire" : "reg",
+                         _iWidth[j], '!' + j, _szName[j]);
+                put(szLine);
+            }
+        }
+        put("$upscope $end\n");
+    }
+
+    put("$enddefinitions $end\n#0\n$dumpvars\n");
+    for (i = 0; i < _iSignals; i++)
+    {
+        putValue(i, _ulValue[i]);
+    }
+    put("$end\n");
+
+    _bStarted = true;
+}
+
+// ***************************************************
+//
+// change()
+//
+// Records a signal's new value.  Times must not go backwards, and a value
+// that has not changed is not written.
+//
+// ****************************************************
+void VcdWriter::change(unsigned long ulTime, int iSignal, unsigned long ulValue)
+{
+    if (!_bStarted || (iSignal < 0) || (_ulValue[iSignal] == ulValue))
+    {
+        return;
+    }
+
+    if (_uiUsed + kVcdMaxChangeSize > kVcdBufferSize)
+    {
+        handOver();
+    }
+
+    if (ulTime != _ulTime)
+    {
+        _pFill[_uiUsed++] = '#';
+        putNumber(ulTime);
+        _pFill[_uiUsed++] = '\n';
+        _ulTime = ulTime;
+    }
+
+    putValue(iSignal, ulValue);
+    _ulValue[iSignal] = ulValue;
+}
+
+void VcdWriter::close(void)
+{
+    if (_pFile == NULL)
+    {
+        return;
+    }
+
+    handOver();
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _bClosing = true;
+        _changed.notify_all();
+    }
+    _writer.join();
+
+    fclose(_pFile);
+    _pFile = NULL;
+    free(_pFill);
+    free(_pPending);
+    _pFill = NULL;
+    _pPending = NULL;
+}
+
+// the header is small, it goes into the buffer like everything else
+void VcdWriter::put(const char *pszText)
+{
+    size_t uiLength = strlen(pszText);
+
+    if (_uiUsed + uiLength > kVcdBufferSize)
+    {
+        handOver();
+    }
+
+    memcpy(_pFill + _uiUsed, pszText, uiLength);
+    _uiUsed += uiLength;
+}
+
+void VcdWriter::putNumber(unsigned long ulValue)
+{
+    char szDigits[24];
+    int iDigits = 0;
+
+    do
+    {
+        szDigits[iDigits++] = (char)('0' + (ulValue % 10));
+        ulValue /= 10;
+    } while (ulValue != 0);
+
+    while (iDigits > 0)
+    {
+        _pFill[_uiUsed++] = szDigits[--iDigits];
+    }
+}
+
+// "0!" for a wire, "b101 !" for a vector (without the leading zeros)
+void VcdWriter::putValue(int iSignal, unsigned long ulValue)
+{
+    if (_iWidth[iSignal] == 1)
+    {
+        _pFill[_uiUsed++] = (ulValue != 0) ? '1' : '0';
+    }
+    else
+    {
+        int iBit = _iWidth[iSignal] - 1;
+
+        while ((iBit > 0) && (((ulValue >> iBit) & 1) == 0))
+        {
+            iBit--;
+        }
+
+        _pFill[_uiUsed++] = 'b';
+        for (; iBit >= 0; iBit--)
+        {
+            _pFill[_uiUsed++] = ((ulValue >> iBit) & 1) ? '1' : '0';
+        }
+        _pFill[_uiUsed++] = ' ';
+    }
+
+    _pFill[_uiUsed++] = (char)('!' + iSignal);
+    _pFill[_uiUsed++] = '\n';
+}
+
+// ***************************************************
+//
+// handOver()
+//
+// Gives the full buffer to the writer thread, and carries on in the
+// other one, once the writer is done with it.
+//
+// ****************************************************
+void VcdWriter::handOver(void)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    char *pEmpty;
+
+    while (_uiPending != 0)
+    {
+        _changed.wait(lock);
+    }
+
+    pEmpty = _pPending;
+    _pPending = _pFill;
+    _uiPending = _uiUsed;
+    _pFill = pEmpty;
+    _ullBytes += _uiUsed;
+    _uiUsed = 0;
+
+    _changed.notify_all();
+}
+
+void VcdWriter::writerThread(void)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    for (;;)
+    {
+        while ((_uiPending == 0) && !_bClosing)
+        {
+            _changed.wait(lock);
+        }
+
+        if (_uiPending == 0)
+        {
+            return;
+        }
+
+        // the simulation only touches the other buffer, so the lock is not needed while writing
+        lock.unlock();
+        fwrite(_pPending, 1, _uiPending, _pFile);
+        lock.lock();
+
+        _uiPending = 0;
+        _changed.notify_all();
+    }
+}
+
+// ***************************************************
+//
+// CrossingVcd
+//
+// ****************************************************
+bool CrossingVcd::open(const char *pszPath)
+{
+    uint8_t uiPin;
+
+    if (!_writer.open(pszPath, "1 ms"))
+    {
+        return false;
+    }
+
+    for (uiPin = 0; uiPin < kHostPinCount; uiPin++)
+    {
+        _iPinSignal[uiPin] = -1;
+    }
+
+    _iPinSignal[kPinAddrGateTrackSensor] = _writer.addSignal("pins", "TrackSensor", 1, gHostArduino.uiPinLevel[kPinAddrGateTrackSensor]);
+    _iPinSignal[kPinAddrGateBellControl] = _writer.addSignal("pins", "Bell", 1, gHostArduino.uiPinLevel[kPinAddrGateBellControl]);
+    _iPinSignal[kPinAddrGateLightsControlRight] = _writer.addSignal("pins", "LightsRight", 1, gHostArduino.uiPinLevel[kPinAddrGateLightsControlRight]);
+    _iPinSignal[kPinAddrGateLightsControlLeft] = _writer.addSignal("pins", "LightsLeft", 1, gHostArduino.uiPinLevel[kPinAddrGateLightsControlLeft]);
+    _iPinSignal[kPinAddrGateArmControlMotorDirection] = _writer.addSignal("pins", "MotorDirection", 1, gHostArduino.uiPinLevel[kPinAddrGateArmControlMotorDirection]);
+    _iPinSignal[kPinAddrGateArmControlMotorPower] = _writer.addSignal("pins", "MotorPower", 1, gHostArduino.uiPinLevel[kPinAddrGateArmControlMotorPower]);
+    _iPinSignal[kPinAddrGateStatusLED] = _writer.addSignal("pins", "StatusLED", 1, gHostArduino.uiPinLevel[kPinAddrGateStatusLED]);
+
+    _iTrackState = _writer.addSignal("state", "iTrackOcupationState", 2, gCrossingState.iTrackOcupationState);
+    _iInitializeState = _writer.addSignal("state", "iGateInitializationState", 3, gCrossingState.iGateInitializationState);
+    _iDownState = _writer.addSignal("state", "iGateMovingDown_State", 3, gCrossingState.iGateMovingDown_State);
+    _iUpState = _writer.addSignal("state", "iGateMovingUp_State", 3, gCrossingState.iGateMovingUp_State);
+    _iGateState = _writer.addSignal("state", "bGateState", 1, gCrossingState.bGateState);
+    _iMotorRunning = _writer.addSignal("state", "bMotorRunning", 1, gCrossingState.bMotorRunning);
+    _iDutyCycleExceeded = _writer.addSignal("state", "bDutyCycleExceededFlag", 1, gCrossingState.bDutyCycleExceededFlag);
+    _iMotorRunningTotal = _writer.addSignal("state", "ulMotorRunningTotalSeconds", 32, gCrossingState.ulMotorRunningTotalSeconds);
+    _iIdleSleepAllowed = _writer.addSignal("state", "gbIdleSleepAllowed", 1, gbIdleSleepAllowed);
+
+    _writer.begin();
+    return true;
+}
+
+void CrossingVcd::pinWrite(unsigned long ulTime, uint8_t uiPin, uint8_t uiValue)
+{
+    if (uiPin < kHostPinCount)
+    {
+        _writer.change(ulTime, _iPinSignal[uiPin], uiValue);
+    }
+}
+
+void CrossingVcd::input(unsigned long ulTime, uint8_t uiPin, uint8_t uiLevel)
+{
+    pinWrite(ulTime, uiPin, uiLevel);
+}
+
+// the state variables are looked at after every step, only the changes are written
+void CrossingVcd::step(unsigned long ulTime)
+{
+    _writer.change(ulTime, _iTrackState, gCrossingState.iTrackOcupationState);
+    _writer.change(ulTime, _iInitializeState, gCrossingState.iGateInitializationState);
+    _writer.change(ulTime, _iDownState, gCrossingState.iGateMovingDown_State);
+    _writer.change(ulTime, _iUpState, gCrossingState.iGateMovingUp_State);
+    _writer.change(ulTime, _iGateState, gCrossingState.bGateState);
+    _writer.change(ulTime, _iMotorRunning, gCrossingState.bMotorRunning);
+    _writer.change(ulTime, _iDutyCycleExceeded, gCrossingState.bDutyCycleExceededFlag);
+    _writer.change(ulTime, _iMotorRunningTotal, gCrossingState.ulMotorRunningTotalSeconds);
+    _writer.change(ulTime, _iIdleSleepAllowed, gbIdleSleepAllowed);
+}
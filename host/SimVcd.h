@@ -0,0 +1,104 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SimVcd - Value Change Dump output (host only)
+//
+// VcdWriter writes a VCD file (IEEE 1364) that GTKWave and the like can
+// open.  The changes are formatted straight into a large buffer; when it
+// fills, a writer thread takes it to the disk while the simulation fills
+// the other one, so the simulation only waits if the disk cannot keep up.
+//
+// CrossingVcd picks the signals: every output pin, the track sensor, and
+// the state machine variables, in milliseconds of simulated time.  Call
+// its pinWrite(), input() and step() from the SimKernel hooks.
+//
+// ****************************************************
+
+#ifndef SimVcd_h
+#define SimVcd_h
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Arduino.h"
+
+const size_t kVcdBufferSize = 1 << 20;
+const int kVcdMaxSignals = 64;
+
+class VcdWriter
+{
+
+public:
+  VcdWriter(void);
+  ~VcdWriter(void);
+
+  bool open(const char *pszPath, const char *pszTimescale);
+  int addSignal(const char *pszScope, const char *pszName, int iWidth, unsigned long ulInitial);
+  void begin(void);
+  void change(unsigned long ulTime, int iSignal, unsigned long ulValue);
+  void close(void);
+
+  bool isOpen(void) { return _pFile != NULL; }
+  unsigned long long bytes(void) { return _ullBytes + _uiUsed; }
+
+protected:
+  void put(const char *pszText);
+  void putNumber(unsigned long ulValue);
+  void putValue(int iSignal, unsigned long ulValue);
+  void handOver(void);
+  void writerThread(void);
+
+  FILE *_pFile;
+  char *_pFill;
+  char *_pPending;
+  size_t _uiUsed;
+  size_t _uiPending;
+  unsigned long long _ullBytes;
+  bool _bStarted;
+  bool _bClosing;
+  unsigned long _ulTime;
+
+  int _iSignals;
+  int _iWidth[kVcdMaxSignals];
+  unsigned long _ulValue[kVcdMaxSignals];
+  char _szScope[kVcdMaxSignals][16];
+  char _szName[kVcdMaxSignals][40];
+
+  std::thread _writer;
+  std::mutex _mutex;
+  std::condition_variable _changed;
+
+};
+
+class CrossingVcd
+{
+
+public:
+  bool open(const char *pszPath);
+  void pinWrite(unsigned long ulTime, uint8_t uiPin, uint8_t uiValue);
+  void input(unsigned long ulTime, uint8_t uiPin, uint8_t uiLevel);
+  void step(unsigned long ulTime);
+  void close(void) { _writer.close(); }
+
+  bool isOpen(void) { return _writer.isOpen(); }
+  unsigned long long bytes(void) { return _writer.bytes(); }
+
+protected:
+  VcdWriter _writer;
+  int _iPinSignal[kHostPinCount];
+  int _iTrackState;
+  int _iInitializeState;
+  int _iDownState;
+  int _iUpState;
+  int _iGateState;
+  int _iMotorRunning;
+  int _iDutyCycleExceeded;
+  int _iMotorRunningTotal;
+  int _iIdleSleepAllowed;
+
+};
+
+#endif
@@ -0,0 +1,119 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SimWorkers - runs simulations in parallel (host only)
+//
+// ****************************************************
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "SimWorkers.h"
+
+static int giWorkerFd = -1;
+static size_t guiWorkerRecordSize = 0;
+
+int SimWorkersDefault(void)
+{
+    long lCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (lCpus < 1) ? 1 : ((lCpus > kSimMaxWorkers) ? kSimMaxWorkers : (int)lCpus);
+}
+
+void SimWorkerSend(const void *pRecord)
+{
+    if (write(giWorkerFd, pRecord, guiWorkerRecordSize) != (ssize_t)guiWorkerRecordSize)
+    {
+        _exit(2);
+    }
+}
+
+long SimWorkersRun(int iWorkers, size_t uiRecordSize,
+                   void (*pWorker)(int iWorker, int iWorkers),
+                   void (*pReceive)(const void *pRecord))
+{
+    struct pollfd fds[kSimMaxWorkers];
+    pid_t pids[kSimMaxWorkers];
+    unsigned char *pRecord;
+    long lReceived = 0;
+    int iOpen;
+    int i;
+
+    iWorkers = (iWorkers < 1) ? 1 : ((iWorkers > kSimMaxWorkers) ? kSimMaxWorkers : iWorkers);
+    pRecord = (unsigned char *)malloc(uiRecordSize);
+
+    // stdio buffers are copied into every child, so empty them first
+    fflush(NULL);
+
+    for (i = 0; i < iWorkers; i++)
+    {
+        int pipefds[2];
+
+        if (pipe(pipefds) != 0)
+        {
+            perror("pipe");
+            return -1;
+        }
+
+        pids[i] = fork();
+        if (pids[i] < 0)
+        {
+            perror("fork");
+            return -1;
+        }
+        if (pids[i] == 0)
+        {
+            close(pipefds[0]);
+            giWorkerFd = pipefds[1];
+            guiWorkerRecordSize = uiRecordSize;
+            (*pWorker)(i, iWorkers);
+            _exit(0);
+        }
+
+        close(pipefds[1]);
+        fds[i].fd = pipefds[0];
+        fds[i].events = POLLIN;
+    }
+
+    // take the records as they come in, from whichever worker has one
+    iOpen = iWorkers;
+    while (iOpen > 0)
+    {
+        if (poll(fds, iWorkers, -1) < 0)
+        {
+            perror("poll");
+            break;
+        }
+
+        for (i = 0; i < iWorkers; i++)
+        {
+            if ((fds[i].fd < 0) || (fds[i].revents == 0))
+            {
+                continue;
+            }
+
+            // a record is much smaller than PIPE_BUF, so it is never split
+            if (read(fds[i].fd, pRecord, uiRecordSize) != (ssize_t)uiRecordSize)
+            {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                iOpen--;
+                continue;
+            }
+
+            (*pReceive)(pRecord);
+            lReceived++;
+        }
+    }
+
+    for (i = 0; i < iWorkers; i++)
+    {
+        waitpid(pids[i], NULL, 0);
+    }
+    free(pRecord);
+
+    return lReceived;
+}
@@ -0,0 +1,40 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SimWorkers - runs simulations in parallel (host only)
+//
+// The controller keeps its state in globals, so two simulations cannot
+// share a process.  SimWorkersRun() forks the workers instead, each with
+// its own copy of the controller, and each sends back fixed size records
+// down a pipe.  The parent takes them as they come in.
+//
+// ****************************************************
+
+#ifndef SimWorkers_h
+#define SimWorkers_h
+
+#include <stddef.h>
+
+// ***************************************************
+//
+// SimWorkersRun()
+//
+// Runs pWorker(iWorker, iWorkers) in iWorkers child processes, and passes
+// every record they send to pReceive() in the parent.  Returns the number
+// of records received, or -1 if the workers could not be started.
+//
+// ****************************************************
+long SimWorkersRun(int iWorkers, size_t uiRecordSize,
+                   void (*pWorker)(int iWorker, int iWorkers),
+                   void (*pReceive)(const void *pRecord));
+
+// called in a worker, sends one record to the parent
+void SimWorkerSend(const void *pRecord);
+
+// one worker per CPU, as many as SimWorkersRun() takes
+int SimWorkersDefault(void);
+
+const int kSimMaxWorkers = 64;
+
+#endif
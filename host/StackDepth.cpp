@@ -0,0 +1,521 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// StackDepth - host tool
+//
+// Replays sensor traces through the controller, built with GCC's
+// -finstrument-functions, and finds the deepest call chain of each state
+// path: each Timer callback, and for CrossingSignalMain() each state it
+// was in when the tick started (that picks the branch of the state
+// machine it runs, and so the calls).  The other things loop() does
+// (the serial commands, the history dump) are paths of their own.
+//
+// The host's frames are not the Uno's, so the host bytes are only good
+// for comparing the paths.  Give it the .su files of an avr-gcc build
+// made with -fstack-usage, and it adds up the Uno's frames along each
+// chain as well (plus the 2 byte return address of each call).  With the
+// Arduino IDE, add -fstack-usage to compiler.cpp.extra_flags; the .su
+// files end up next to the objects in the build directory.  The chains
+// stop at the sketch: the Arduino core below it (digitalWrite(), Serial)
+// and an interrupt on top are not in the numbers.  The S serial command
+// reports the whole stack on the board (SRMcrossGate_Stack.h).
+//
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -Ihost -I. -finstrument-functions -finstrument-functions-exclude-file-list=host/,/usr/ -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/SimVcd.cpp host/StackDepth.cpp -o stackdepth
+//
+//     ./stackdepth [-u file.su|dir ...] [-q commands] [-c] trace.txt ...
+//
+//     -u  avr-gcc stack usage files, or a directory of them
+//     -q  serial commands to send after each trace (HS, say)
+//     -c  print the deepest chain of each path
+//
+// Each trace runs from a fresh boot, until 60 seconds after its last edge.
+//
+// ****************************************************
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SimKernel.h"
+
+#define NO_INSTRUMENT __attribute__ ((no_instrument_function))
+
+const int kMaxChain = 64;
+
+// the return address an AVR call pushes (16 bit program counter)
+const unsigned int kAvrCallBytes = 2;
+
+typedef struct
+{
+    unsigned long ulEntries;
+    size_t maxHostBytes;
+    std::vector<void *> deepest;
+} StackPath_t;
+
+static std::map<std::string, StackPath_t> gPaths;
+
+// the instrumented call chain, and the path each depth belongs to
+static void *gpChain[kMaxChain];
+static StackPath_t *gpChainPath[kMaxChain];
+static int giDepth = 0;
+static char *gpBase = NULL;
+static bool gbRecording = false;
+
+static void *gpLoop;
+static void *gpSetup;
+static void *gpEventUpdate;
+static void *gpCrossingSignalMain;
+
+// function names, from nm, and the Uno's frame sizes from the .su files
+static std::map<uintptr_t, std::string> gNames;
+static std::map<std::string, unsigned int> gAvrFrames;
+
+// ***************************************************
+//
+// StateName()
+//
+// The state CrossingSignalMain() starts a tick in.
+//
+// ****************************************************
+static NO_INSTRUMENT std::string StateName(void)
+{
+    static const char *szTrack[] = { "Initializing", "Occupied", "Vacant" };
+    static const char *szInitialize[] = { "LightsBellsAndDirection", "MotorDirectionDelay", "MotorOn", "MotorOff" };
+    static const char *szDown[] = { "LightsAndBells", "LightsAndBellsDelay", "MotorDirection", "MotorOn", "MotorOnDelay", "MotorOff" };
+    static const char *szUp[] = { "Debounce", "MotorDirection", "MotorDirectionDelay", "MotorOn", "MotorOnDelay", "MotorOff" };
+    int iTrack = gCrossingState.iTrackOcupationState;
+    int iSub;
+    const char *pszSub = "?";
+    char szName[128];
+
+    if (iTrack == kInitializing)
+    {
+        iSub = gCrossingState.iGateInitializationState;
+        pszSub = ((iSub >= 0) && (iSub < 4)) ? szInitialize[iSub] : "?";
+    }
+    else if (iTrack == kTrackOccupied)
+    {
+        iSub = gCrossingState.iGateMovingDown_State;
+        pszSub = ((iSub >= 0) && (iSub < 6)) ? szDown[iSub] : "?";
+    }
+    else
+    {
+        iSub = gCrossingState.iGateMovingUp_State;
+        pszSub = ((iSub >= 0) && (iSub < 6)) ? szUp[iSub] : "?";
+    }
+
+    snprintf(szName, sizeof(szName), "CrossingSignalMain %s/%s/%s%s",
+             ((iTrack >= 0) && (iTrack < 3)) ? szTrack[iTrack] : "?",
+             gCrossingState.bGateState ? "Down" : "Up", pszSub,
+             gCrossingState.bDutyCycleExceededFlag ? " (duty cycle)" : "");
+    return szName;
+}
+
+static NO_INSTRUMENT const char *FunctionName(void *pFunction)
+{
+    std::map<uintptr_t, std::string>::const_iterator it = gNames.find((uintptr_t)pFunction);
+
+    return (it != gNames.end()) ? it->second.c_str() : "?";
+}
+
+// ***************************************************
+//
+// __cyg_profile_func_enter() / __cyg_profile_func_exit()
+//
+// Called by every instrumented function.  A new path starts at setup(),
+// at each function loop() calls, and at each Timer callback.  The depth
+// is measured from loop()'s (or setup()'s) frame.
+//
+// ****************************************************
+extern "C" NO_INSTRUMENT void __cyg_profile_func_enter(void *pFunction, void *pCallSite)
+{
+    char *pFrame = (char *)__builtin_frame_address(0);
+    StackPath_t *pPath = (giDepth > 0) ? gpChainPath[giDepth - 1] : NULL;
+
+    (void)pCallSite;
+
+    if (!gbRecording || (giDepth >= kMaxChain))
+    {
+        giDepth++;
+        return;
+    }
+
+    if (giDepth == 0)
+    {
+        gpBase = pFrame;
+        pPath = (pFunction == gpSetup) ? &gPaths["setup"] : NULL;
+    }
+    else if ((giDepth == 1) && (gpChain[0] == gpLoop) && (pFunction != gpChain[0]))
+    {
+        pPath = &gPaths[FunctionName(pFunction)];
+    }
+
+    if (pFunction == gpCrossingSignalMain)
+    {
+        pPath = &gPaths[StateName()];
+    }
+    else if ((giDepth > 0) && (gpChain[giDepth - 1] == gpEventUpdate))
+    {
+        pPath = &gPaths[FunctionName(pFunction)];
+    }
+
+    gpChain[giDepth] = pFunction;
+    gpChainPath[giDepth] = pPath;
+    giDepth++;
+
+    if (pPath != NULL)
+    {
+        size_t bytes = (size_t)(gpBase - pFrame);
+
+        if ((giDepth == 1) || (gpChainPath[giDepth - 2] != pPath))
+        {
+            pPath->ulEntries++;
+        }
+
+        if (bytes > pPath->maxHostBytes)
+        {
+            pPath->maxHostBytes = bytes;
+            pPath->deepest.assign(gpChain, gpChain + giDepth);
+        }
+    }
+}
+
+extern "C" NO_INSTRUMENT void __cyg_profile_func_exit(void *pFunction, void *pCallSite)
+{
+    (void)pFunction;
+    (void)pCallSite;
+
+    if (giDepth > 0)
+    {
+        giDepth--;
+    }
+}
+
+// "void Timer::every(long unsigned int, void (*)())" to "Timer::every"
+static NO_INSTRUMENT std::string BareName(const std::string &name)
+{
+    std::string bare = name.substr(0, name.find('('));
+    size_t space = bare.rfind(' ');
+
+    return (space == std::string::npos) ? bare : bare.substr(space + 1);
+}
+
+// ***************************************************
+//
+// ReadNames()
+//
+// The symbols of this program, from nm.  It is a position independent
+// executable more often than not, so the addresses are moved by wherever
+// ReadNames() itself ended up.
+//
+// ****************************************************
+static NO_INSTRUMENT bool ReadNames(void)
+{
+    std::map<std::string, uintptr_t> byName;
+    char szPath[512];
+    char szLine[1024];
+    ssize_t length = readlink("/proc/self/exe", szPath, sizeof(szPath) - 1);
+    uintptr_t offset;
+    FILE *pNm;
+
+    if (length <= 0)
+    {
+        return false;
+    }
+    szPath[length] = '\0';
+
+    // the path goes to the shell, so it is quoted
+    snprintf(szLine, sizeof(szLine), "nm -C --defined-only '%s'", szPath);
+    pNm = popen(szLine, "r");
+    if (pNm == NULL)
+    {
+        return false;
+    }
+
+    while (fgets(szLine, sizeof(szLine), pNm) != NULL)
+    {
+        unsigned long long ullAddress;
+        char cType;
+        int iName;
+
+        if ((sscanf(szLine, "%llx %c %n", &ullAddress, &cType, &iName) < 2) || ((cType != 'T') && (cType != 't') && (cType != 'W')))
+        {
+            continue;
+        }
+
+        szLine[strcspn(szLine, "\n")] = '\0';
+
+        // the split off cold parts of functions are not called
+        if (strstr(szLine + iName, "[clone") != NULL)
+        {
+            continue;
+        }
+        byName[BareName(szLine + iName)] = (uintptr_t)ullAddress;
+        gNames[(uintptr_t)ullAddress] = BareName(szLine + iName);
+    }
+    pclose(pNm);
+
+    if (byName.find("ReadNames") == byName.end())
+    {
+        return false;
+    }
+
+    offset = (uintptr_t)&ReadNames - byName["ReadNames"];
+    std::map<uintptr_t, std::string> moved;
+    for (std::map<uintptr_t, std::string>::const_iterator it = gNames.begin(); it != gNames.end(); ++it)
+    {
+        moved[it->first + offset] = it->second;
+    }
+    gNames.swap(moved);
+
+    gpLoop = (void *)(byName["loop"] + offset);
+    gpSetup = (void *)(byName["setup"] + offset);
+    gpEventUpdate = (void *)(byName["Event::update"] + offset);
+    gpCrossingSignalMain = (void *)(byName["CrossingSignalMain"] + offset);
+    return true;
+}
+
+// ***************************************************
+//
+// ReadStackUsage()
+//
+// "file:line:col:name\tbytes\tqualifiers" lines from avr-gcc -fstack-usage.
+// Overloads are rare here, where there are some the biggest is kept.
+//
+// ****************************************************
+static NO_INSTRUMENT void ReadStackUsageFile(const char *pszPath)
+{
+    FILE *pFile = fopen(pszPath, "r");
+    char szLine[1024];
+
+    if (pFile == NULL)
+    {
+        perror(pszPath);
+        return;
+    }
+
+    while (fgets(szLine, sizeof(szLine), pFile) != NULL)
+    {
+        char *pTab = strchr(szLine, '\t');
+        char *pName = szLine;
+        unsigned int uiBytes;
+
+        if (pTab == NULL)
+        {
+            continue;
+        }
+        *pTab = '\0';
+        uiBytes = (unsigned int)strtoul(pTab + 1, NULL, 10);
+
+        // skip the file:line:col: in front
+        for (int iColons = 0; (iColons < 3) && (strchr(pName, ':') != NULL); iColons++)
+        {
+            pName = strchr(pName, ':') + 1;
+        }
+
+        std::string name = BareName(pName);
+        if (uiBytes > gAvrFrames[name])
+        {
+            gAvrFrames[name] = uiBytes;
+        }
+    }
+
+    fclose(pFile);
+}
+
+static NO_INSTRUMENT void ReadStackUsage(const char *pszPath)
+{
+    DIR *pDir = opendir(pszPath);
+    struct dirent *pEntry;
+
+    if (pDir == NULL)
+    {
+        ReadStackUsageFile(pszPath);
+        return;
+    }
+
+    while ((pEntry = readdir(pDir)) != NULL)
+    {
+        size_t length = strlen(pEntry->d_name);
+
+        if ((length > 3) && (strcmp(pEntry->d_name + length - 3, ".su") == 0))
+        {
+            std::string path = std::string(pszPath) + "/" + pEntry->d_name;
+            ReadStackUsageFile(path.c_str());
+        }
+    }
+
+    closedir(pDir);
+}
+
+// the Uno's bytes for a chain, and whether every frame in it was known
+static NO_INSTRUMENT unsigned int AvrBytes(const std::vector<void *> &chain, bool *pbComplete)
+{
+    unsigned int uiBytes = 0;
+
+    *pbComplete = true;
+    for (size_t i = 0; i < chain.size(); i++)
+    {
+        std::map<std::string, unsigned int>::const_iterator it = gAvrFrames.find(FunctionName(chain[i]));
+
+        if (it == gAvrFrames.end())
+        {
+            *pbComplete = false;
+        }
+        else
+        {
+            uiBytes += it->second;
+        }
+        uiBytes += kAvrCallBytes;
+    }
+
+    return uiBytes;
+}
+
+static NO_INSTRUMENT unsigned long RunTrace(const char *pszTrace, const char *pszCommands)
+{
+    SimKernel kernel;
+    FILE *pTrace = fopen(pszTrace, "r");
+    char szLine[256];
+    unsigned long ulLastEdge = 0;
+    unsigned long ulTime;
+    int iLevel;
+
+    if (pTrace == NULL)
+    {
+        perror(pszTrace);
+        exit(1);
+    }
+
+    kernel.reset();
+    while (fgets(szLine, sizeof(szLine), pTrace) != NULL)
+    {
+        const char *p = (strncmp(szLine, "TS ", 3) == 0) ? szLine + 3 : szLine;
+
+        if (sscanf(p, "%lu %d", &ulTime, &iLevel) == 2)
+        {
+            kernel.scheduleInput(ulTime, kPinAddrGateTrackSensor, (iLevel != 0) ? HIGH : LOW);
+            ulLastEdge = ulTime;
+        }
+    }
+    fclose(pTrace);
+
+    gbRecording = true;
+    kernel.boot();
+    kernel.runUntil(ulLastEdge + 60000UL);
+
+    if ((pszCommands != NULL) && (pszCommands[0] != '\0'))
+    {
+        Serial.queueInput(pszCommands);
+        kernel.runUntil(ulLastEdge + 120000UL);
+    }
+    gbRecording = false;
+
+    return kernel.steps();
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::pair<size_t, std::string> > order;
+    const char *pszCommands = NULL;
+    bool bChains = false;
+    int iTraces = 0;
+
+    if (!ReadNames())
+    {
+        fprintf(stderr, "stackdepth: cannot read this program's symbols (is nm installed?)\n");
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-u") == 0) && (i + 1 < argc))
+        {
+            ReadStackUsage(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-q") == 0) && (i + 1 < argc))
+        {
+            pszCommands = argv[++i];
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            bChains = true;
+        }
+        else
+        {
+            unsigned long ulSteps = RunTrace(argv[i], pszCommands);
+
+            fprintf(stderr, "stackdepth: %s, %lu steps\n", argv[i], ulSteps);
+            iTraces++;
+        }
+    }
+
+    if (iTraces == 0)
+    {
+        fprintf(stderr, "usage: stackdepth [-u file.su|dir ...] [-q commands] [-c] trace.txt ...\n");
+        return 2;
+    }
+
+    if (gPaths.empty())
+    {
+        fprintf(stderr, "stackdepth: no calls were seen, build with -finstrument-functions\n");
+        return 1;
+    }
+
+    for (std::map<std::string, StackPath_t>::const_iterator it = gPaths.begin(); it != gPaths.end(); ++it)
+    {
+        order.push_back(std::make_pair(it->second.maxHostBytes, it->first));
+    }
+    std::sort(order.rbegin(), order.rend());
+
+    printf("%-64s %8s %6s %10s %9s\n", "path", "entries", "calls", "host bytes", "avr bytes");
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const StackPath_t &path = gPaths[order[i].second];
+        bool bComplete;
+        unsigned int uiAvr = AvrBytes(path.deepest, &bComplete);
+
+        printf("%-64s %8lu %6u %10u ", order[i].second.c_str(), path.ulEntries,
+               (unsigned int)path.deepest.size(), (unsigned int)path.maxHostBytes);
+        if (gAvrFrames.empty())
+        {
+            printf("%9s\n", "-");
+        }
+        else
+        {
+            printf("%8u%s\n", uiAvr, bComplete ? " " : "?");
+        }
+
+        if (bChains)
+        {
+            for (size_t j = 0; j < path.deepest.size(); j++)
+            {
+                std::map<std::string, unsigned int>::const_iterator it = gAvrFrames.find(FunctionName(path.deepest[j]));
+
+                printf("    %*s%s", (int)(2 * j), "", FunctionName(path.deepest[j]));
+                if (it != gAvrFrames.end())
+                {
+                    printf("  (%u)", it->second);
+                }
+                printf("\n");
+            }
+        }
+    }
+
+    if (!gAvrFrames.empty())
+    {
+        printf("avr bytes: the sketch's frames plus %u per call; a ? has frames missing from the .su files\n", kAvrCallBytes);
+    }
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// StatsCheck - host tool
+//
+// Checks the closure statistics (SRMcrossGate_Stats.h) against times whose
+// percentiles are known.  It boots the controller on SimKernel, records
+// kClosures closures through the StatsRecord...() calls, each time spread
+// evenly over a range the buckets are meant for, and flushes them to the
+// EEPROM as the flush timer would.  Then it reads back what the P serial
+// command prints, twice:
+//
+//   - as recorded
+//   - after SimKernel::restart(), which reads the counts back from the
+//     EEPROM in StatsBegin()
+//
+// Each p50, p95 and p99 has to be within a bucket (and the tenth of a
+// second the report rounds to) of the exact percentile of the times, and
+// the two reports have to be the same.  The exit status is 1 if not.
+//
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/StatsCheck.cpp -o statscheck
+//
+//     ./statscheck
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_Stats.h"
+#include "SRMcrossGate_State.h"
+#include "SimKernel.h"
+
+// fewer than 255, so no count is halved
+const int kClosures = 200;
+const uint8_t kPercents[] = { 50, 95, 99 };
+const int kPercentCount = sizeof(kPercents);
+
+typedef struct
+{
+    const char *pszName;
+    unsigned long ulLow;        // the times are spread evenly from here ...
+    unsigned long ulHigh;       // ... to here, in ms
+    unsigned long ulBucket;     // the widest bucket over that range, in ms
+} StatsRange_t;
+
+// the bucket bounds are in SRMcrossGate_Stats.cpp; these ranges keep to where they are closest
+static const StatsRange_t kRanges[kStatsTimes] =
+{
+    { "Warning",   CrossingProfile::kGateWarningLeadTime - 100, CrossingProfile::kGateWarningLeadTime + 380, 64 },
+    { "Closure",   46000, 88000, 10000 },
+    { "Occupancy", 12000, 58000, 10000 },
+    { "Motor",     2 * CrossingProfile::kGateMotorRunTime - 500, 2 * CrossingProfile::kGateMotorRunTime + 500, 256 }
+};
+
+static unsigned long StatsTime(uint8_t uiStat, int i)
+{
+    const StatsRange_t *pRange = &kRanges[uiStat];
+
+    // every seventh time in turn, so the closures are not in order
+    i = (i * 7) % kClosures;
+    return pRange->ulLow + ((pRange->ulHigh - pRange->ulLow) * i) / (kClosures - 1);
+}
+
+// the same rank StatsPercentile() reads back: the smallest time at or above uiPercent of them
+static unsigned long ExactPercentile(uint8_t uiStat, uint8_t uiPercent)
+{
+    const StatsRange_t *pRange = &kRanges[uiStat];
+    int iRank = ((kClosures * uiPercent) + 99) / 100;
+
+    return pRange->ulLow + ((pRange->ulHigh - pRange->ulLow) * (iRank - 1)) / (kClosures - 1);
+}
+
+// ***************************************************
+//
+// RecordClosures()
+//
+// Each closure: the lights on, the motor down after the warning time, the
+// motor up, and the lights off at the closure time; the occupancy is
+// recorded after it.  The millis() the kernel left is put back at the end.
+//
+// ****************************************************
+static void RecordClosures(void)
+{
+    unsigned long ulSaved = millis();
+    unsigned long ulTime = 1000000UL;
+
+    for (int i = 0; i < kClosures; i++)
+    {
+        unsigned long ulWarning = StatsTime(kStatsTime_Warning, i);
+        unsigned long ulMotor = StatsTime(kStatsTime_Motor, i);
+        unsigned long ulMotorDown = ulMotor / 2;
+        unsigned long ulOccupancy = StatsTime(kStatsTime_Occupancy, i);
+
+        HostSetMillis(ulTime);
+        StatsRecordLightsOn();
+        HostSetMillis(ulTime + ulWarning + ulMotorDown);
+        StatsRecordMotorRun(ulMotorDown);
+        HostSetMillis(ulTime + StatsTime(kStatsTime_Closure, i));
+        StatsRecordMotorRun(ulMotor - ulMotorDown);
+        StatsRecordLightsOff();
+        ulTime += 400000UL;
+
+        HostSetMillis(ulTime);
+        StatsRecordOccupancyStart();
+        HostSetMillis(ulTime + ulOccupancy);
+        StatsRecordOccupancyEnd();
+        ulTime += 400000UL;
+    }
+
+    while (StatsPending())
+    {
+        StatsFlush();
+    }
+
+    HostSetMillis(ulSaved);
+}
+
+// ***************************************************
+//
+// ReadReport()
+//
+// Runs the P command's StatsReport() into a buffer, and reads the
+// percentiles of each time out of it, in ms.
+//
+// ****************************************************
+static bool ReadReport(char *pszReport, size_t uiSize, unsigned long ulPercentiles[kStatsTimes][kPercentCount])
+{
+    FILE *pFile = tmpfile();
+    size_t uiLength;
+    char *pszLine;
+
+    if (pFile == NULL)
+    {
+        perror("tmpfile");
+        exit(2);
+    }
+
+    Serial.setOutput(pFile, false);
+    StatsReport();
+    Serial.setOutput(NULL, false);
+
+    rewind(pFile);
+    uiLength = fread(pszReport, 1, uiSize - 1, pFile);
+    pszReport[uiLength] = '\0';
+    fclose(pFile);
+
+    pszLine = pszReport;
+    for (uint8_t uiStat = 0; uiStat < kStatsTimes; uiStat++)
+    {
+        char szName[16];
+        unsigned int uiCount;
+        double dP[kPercentCount];
+
+        if ((pszLine == NULL) ||
+            (sscanf(pszLine, "Stats %15[^:]: n %u, p50 %lf, p95 %lf, p99 %lf", szName, &uiCount, &dP[0], &dP[1], &dP[2]) != 5) ||
+            (strcmp(szName, kRanges[uiStat].pszName) != 0) || (uiCount != (unsigned int)kClosures))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < kPercentCount; i++)
+        {
+            ulPercentiles[uiStat][i] = (unsigned long)(dP[i] * 1000.0 + 0.5);
+        }
+
+        pszLine = strchr(pszLine, '\n');
+        if (pszLine != NULL)
+        {
+            pszLine++;
+        }
+    }
+
+    return true;
+}
+
+// ***************************************************
+//
+// CheckReport()
+//
+// Prints each percentile against the exact one, and returns false if one
+// is further off than its bucket.
+//
+// ****************************************************
+static bool CheckReport(const char *pszName, char *pszReport, size_t uiSize)
+{
+    unsigned long ulPercentiles[kStatsTimes][kPercentCount];
+    bool bPass = true;
+
+    printf("%s\n", pszName);
+    if (!ReadReport(pszReport, uiSize, ulPercentiles))
+    {
+        printf("  the report could not be read:\n%s", pszReport);
+        return false;
+    }
+
+    for (uint8_t uiStat = 0; uiStat < kStatsTimes; uiStat++)
+    {
+        printf("  %-10s", kRanges[uiStat].pszName);
+        for (int i = 0; i < kPercentCount; i++)
+        {
+            unsigned long ulExact = ExactPercentile(uiStat, kPercents[i]);
+            unsigned long ulRead = ulPercentiles[uiStat][i];
+            unsigned long ulOff = (ulRead > ulExact) ? (ulRead - ulExact) : (ulExact - ulRead);
+            bool bClose = (ulOff <= kRanges[uiStat].ulBucket + 50);
+
+            printf("  p%u %6.1f s (%6.1f)%s", (unsigned int)kPercents[i], ulRead / 1000.0, ulExact / 1000.0, bClose ? "" : " !");
+            bPass = bPass && bClose;
+        }
+        printf("\n");
+    }
+
+    return bPass;
+}
+
+int main(void)
+{
+    SimKernel kernel;
+    char szRecorded[512];
+    char szRestarted[512];
+    bool bPass;
+
+    kernel.reset();
+    kernel.boot();
+    kernel.runUntil(60000UL);
+
+    printf("%d closures, each percentile against the exact one (in brackets)\n", kClosures);
+
+    RecordClosures();
+    bPass = CheckReport("as recorded", szRecorded, sizeof(szRecorded));
+
+    kernel.restart();
+    kernel.runUntil(kernel.now() + 60000UL);
+    bPass = CheckReport("after a restart, from the EEPROM", szRestarted, sizeof(szRestarted)) && bPass;
+
+    if (strcmp(szRecorded, szRestarted) != 0)
+    {
+        printf("  the reports differ\n");
+        bPass = false;
+    }
+
+    printf("%s\n", bPass ? "pass" : "FAIL");
+    return bPass ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// StatusBench - host tool
+//
+// Measures the status seqlock (StatusShm.h) under contention: one writer
+// thread publishes as fast as it can while 0, 1, 2, 4 and 8 reader
+// threads read as fast as they can.  Every word of each status the writer
+// publishes is the same number, so a reader that gets a torn copy (words
+// from two publishes) sees it at once; there should never be one.
+//
+// The controller publishes once a loop() (a few times a second), so
+// this is far past anything it will see; it shows the cost of a publish
+// and of a read.  The writer never waits for a reader, it only loses time
+// to the cache line traffic, or to the readers' share of the cores when
+// there are more threads than cores.
+//
+//     g++ -std=gnu++11 -O2 -pthread -Ihost host/StatusShm.cpp host/StatusBench.cpp -lrt -o statusbench
+//
+//     ./statusbench [-s seconds]
+//
+//   -s  how long each run is (1 s by default)
+//
+// The segment is a real one (/dev/shm/statusbench.<pid>), and each reader
+// maps it for itself, as a separate monitoring process would.
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "StatusShm.h"
+
+typedef struct
+{
+    unsigned long long ullReads;
+    unsigned long long ullRetries;
+    unsigned long long ullTorn;
+    unsigned long long ullStale;
+} ReaderCounts_t;
+
+static std::atomic<bool> gbRunning;
+
+static double Seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void Writer(StatusPublisher *pPublisher, unsigned long long *pullPublishes)
+{
+    CrossingStatus_t status;
+    uint32_t *pulWords = (uint32_t *)&status;
+    uint32_t ulValue = 0;
+
+    while (gbRunning.load(std::memory_order_relaxed))
+    {
+        ulValue++;
+        for (int i = 0; i < kStatusWords; i++)
+        {
+            pulWords[i] = ulValue;
+        }
+        pPublisher->publish(&status);
+    }
+
+    *pullPublishes = ulValue;
+}
+
+static void Reader(const char *pszName, ReaderCounts_t *pCounts)
+{
+    StatusReader reader;
+    CrossingStatus_t status;
+    const uint32_t *pulWords = (const uint32_t *)&status;
+    uint32_t ulLast = 0;
+
+    memset(pCounts, 0, sizeof(*pCounts));
+    if (!reader.open(pszName))
+    {
+        return;
+    }
+
+    while (gbRunning.load(std::memory_order_relaxed))
+    {
+        pCounts->ullRetries += reader.read(&status);
+        pCounts->ullReads++;
+
+        for (int i = 1; i < kStatusWords; i++)
+        {
+            if (pulWords[i] != pulWords[0])
+            {
+                pCounts->ullTorn++;
+                break;
+            }
+        }
+
+        // the publishes only go forward
+        if (pulWords[0] < ulLast)
+        {
+            pCounts->ullStale++;
+        }
+        ulLast = pulWords[0];
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const int kReaderCounts[] = { 0, 1, 2, 4, 8 };
+    StatusPublisher publisher;
+    double dSeconds = 1.0;
+    char szName[64];
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+        {
+            dSeconds = atof(argv[++i]);
+        }
+    }
+
+    snprintf(szName, sizeof(szName), "/statusbench.%d", (int)getpid());
+    if (!publisher.open(szName))
+    {
+        return 1;
+    }
+
+    printf("%u cores, %d words a status, %.1f s a run\n",
+           std::thread::hardware_concurrency(), kStatusWords, dSeconds);
+    printf("%7s %14s %10s %14s %10s %12s %6s %6s\n",
+           "readers", "publishes/s", "ns/publish", "reads/s", "ns/read", "retries/read", "torn", "stale");
+
+    for (unsigned int uiRun = 0; uiRun < sizeof(kReaderCounts) / sizeof(kReaderCounts[0]); uiRun++)
+    {
+        int iReaders = kReaderCounts[uiRun];
+        std::vector<ReaderCounts_t> counts(iReaders);
+        std::vector<std::thread> readers;
+        unsigned long long ullPublishes = 0;
+        ReaderCounts_t total;
+        double dStart;
+        double dElapsed;
+
+        memset(&total, 0, sizeof(total));
+        gbRunning.store(true);
+        dStart = Seconds();
+
+        std::thread writer(Writer, &publisher, &ullPublishes);
+        for (int i = 0; i < iReaders; i++)
+        {
+            readers.push_back(std::thread(Reader, szName, &counts[i]));
+        }
+
+        while (Seconds() - dStart < dSeconds)
+        {
+            struct timespec pause = { 0, 10000000 };
+            nanosleep(&pause, NULL);
+        }
+        gbRunning.store(false);
+
+        writer.join();
+        for (int i = 0; i < iReaders; i++)
+        {
+            readers[i].join();
+            total.ullReads += counts[i].ullReads;
+            total.ullRetries += counts[i].ullRetries;
+            total.ullTorn += counts[i].ullTorn;
+            total.ullStale += counts[i].ullStale;
+        }
+        dElapsed = Seconds() - dStart;
+
+        printf("%7d %14.0f %10.1f", iReaders, ullPublishes / dElapsed, dElapsed * 1e9 / ullPublishes);
+        if (iReaders == 0)
+        {
+            printf(" %14s %10s %12s %6s %6s\n", "-", "-", "-", "-", "-");
+        }
+        else
+        {
+            printf(" %14.0f %10.1f %12.3f %6llu %6llu\n",
+                   total.ullReads / dElapsed, dElapsed * 1e9 * iReaders / total.ullReads,
+                   (double)total.ullRetries / total.ullReads, total.ullTorn, total.ullStale);
+        }
+    }
+
+    publisher.close(true);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// StatusRead - host tool
+//
+// Prints the status a running crossing (host/LinuxCrossing.cpp -m name)
+// publishes in shared memory, a field per line, or with -w a line per
+// read every so many milliseconds for watching it live.  Reading never
+// holds up the controller (StatusShm.h).
+//
+//     g++ -std=gnu++11 -O2 -Ihost host/StatusShm.cpp host/StatusRead.cpp -lrt -o statusread
+//
+//     ./statusread [-n name] [-w ms] [-c count]
+//
+//   -n  the segment's name (/crossing by default)
+//   -w  read again every ms milliseconds
+//   -c  stop after this many reads (with -w)
+//
+// ****************************************************
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "StatusShm.h"
+
+static const char *gpszTrackStates[] = { "Initializing", "Occupied", "Vacant" };
+
+#define STATUS_WORD(field) (int)(offsetof(CrossingStatus_t, field) / sizeof(uint32_t))
+
+static void PrintStatus(const CrossingStatus_t *pStatus, unsigned int uiRetries)
+{
+    const uint32_t *pulWords = (const uint32_t *)pStatus;
+
+    for (int i = 0; i < kStatusWords; i++)
+    {
+        printf("%-20s %lu", gpszStatusFieldNames[i], (unsigned long)pulWords[i]);
+        if ((i == STATUS_WORD(ulTrackState)) && (pulWords[i] < 3))
+        {
+            printf(" (%s)", gpszTrackStates[pulWords[i]]);
+        }
+        else if ((i == STATUS_WORD(ulOutputPins)) || (i == STATUS_WORD(ulTimerSlotMask)))
+        {
+            printf(" (0x%lx)", (unsigned long)pulWords[i]);
+        }
+        printf("\n");
+    }
+    printf("%-20s %u\n", "read_retries", uiRetries);
+}
+
+static void PrintLine(const CrossingStatus_t *pStatus, bool bHeader)
+{
+    if (bHeader)
+    {
+        printf("%10s %5s %4s %4s %4s %4s %5s %5s %8s %5s %6s %5s %6s %8s\n",
+               "millis", "track", "init", "down", "up", "gate", "motor", "duty", "run_ms",
+               "pins", "timers", "occ", "downs", "wakeups");
+    }
+
+    printf("%10lu %5lu %4lu %4lu %4lu %4lu %5lu %5lu %8lu %5lx %6lu %5lu %6lu %8lu\n",
+           (unsigned long)pStatus->ulMillis, (unsigned long)pStatus->ulTrackState,
+           (unsigned long)pStatus->ulInitializeState, (unsigned long)pStatus->ulDownState,
+           (unsigned long)pStatus->ulUpState, (unsigned long)pStatus->ulGateState,
+           (unsigned long)pStatus->ulMotorRunning, (unsigned long)pStatus->ulDutyCycleExceeded,
+           (unsigned long)pStatus->ulMotorRunningTotalSeconds, (unsigned long)pStatus->ulOutputPins,
+           (unsigned long)pStatus->ulTimerSlotsUsed, (unsigned long)pStatus->ulOccupancies,
+           (unsigned long)pStatus->ulGateDowns, (unsigned long)pStatus->ulWakeUps);
+}
+
+int main(int argc, char *argv[])
+{
+    StatusReader reader;
+    CrossingStatus_t status;
+    const char *pszName = "/crossing";
+    unsigned long ulWatchMs = 0;
+    unsigned long ulCount = 0;
+    unsigned int uiRetries;
+    int i;
+
+    for (i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-n") == 0)
+        {
+            pszName = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-w") == 0)
+        {
+            ulWatchMs = strtoul(argv[i + 1], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            ulCount = strtoul(argv[i + 1], NULL, 0);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (i < argc)
+    {
+        fprintf(stderr, "usage: statusread [-n name] [-w ms] [-c count]\n");
+        return 2;
+    }
+
+    if (!reader.open(pszName))
+    {
+        return 1;
+    }
+
+    if (ulWatchMs == 0)
+    {
+        uiRetries = reader.read(&status);
+        PrintStatus(&status, uiRetries);
+        return 0;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    for (unsigned long ulRead = 0; (ulCount == 0) || (ulRead < ulCount); ulRead++)
+    {
+        reader.read(&status);
+        PrintLine(&status, (ulRead % 20) == 0);
+        usleep(ulWatchMs * 1000);
+    }
+
+    return 0;
+}
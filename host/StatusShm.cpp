@@ -0,0 +1,256 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// StatusShm - the crossing's state in POSIX shared memory (host only)
+//
+// ****************************************************
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "StatusShm.h"
+
+const char *gpszStatusFieldNames[kStatusWords] =
+{
+    "published",
+    "millis",
+    "track_state",
+    "initialize_state",
+    "down_state",
+    "up_state",
+    "gate_state",
+    "motor_running",
+    "motor_on",
+    "motor_direction",
+    "duty_cycle_exceeded",
+    "motor_running_total",
+    "sensor_level",
+    "output_pins",
+    "idle",
+    "timer_slots_used",
+    "timer_slot_mask",
+    "occupancies",
+    "gate_downs",
+    "duty_cycle_trips",
+    "wake_ups",
+    "loops",
+    "idle_skips",
+    "history_queued",
+    "history_dropped",
+};
+
+static_assert(sizeof(CrossingStatus_t) == kStatusWords * sizeof(uint32_t), "CrossingStatus_t is only 32 bit words");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the seqlock words have to be lock free to be shared between processes");
+
+StatusPublisher::StatusPublisher(void)
+{
+    _pSegment = NULL;
+    _szName[0] = '\0';
+}
+
+StatusPublisher::~StatusPublisher(void)
+{
+    close(false);
+}
+
+// ***************************************************
+//
+// open()
+//
+// Creates (or takes over) the segment.  The header is written last, so a
+// reader that finds the magic number finds a whole segment.
+//
+// ****************************************************
+bool StatusPublisher::open(const char *pszName)
+{
+    int iFd = shm_open(pszName, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    void *pMap;
+
+    if ((iFd < 0) || (ftruncate(iFd, sizeof(StatusSegment_t)) != 0))
+    {
+        perror(pszName);
+        if (iFd >= 0)
+        {
+            ::close(iFd);
+        }
+        return false;
+    }
+
+    pMap = mmap(NULL, sizeof(StatusSegment_t), PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0);
+    ::close(iFd);
+    if (pMap == MAP_FAILED)
+    {
+        perror(pszName);
+        return false;
+    }
+
+    _pSegment = (StatusSegment_t *)pMap;
+    _pSegment->ulMagic = 0;
+    _pSegment->sequence.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < kStatusWords; i++)
+    {
+        _pSegment->words[i].store(0, std::memory_order_relaxed);
+    }
+    _pSegment->ulVersion = kStatusVersion;
+    _pSegment->ulWords = kStatusWords;
+    _pSegment->ulWriterPid = (uint32_t)getpid();
+    std::atomic_thread_fence(std::memory_order_release);
+    _pSegment->ulMagic = kStatusMagic;
+
+    snprintf(_szName, sizeof(_szName), "%s", pszName);
+    return true;
+}
+
+// no system calls and no waiting: a handful of stores
+void StatusPublisher::publish(const CrossingStatus_t *pStatus)
+{
+    uint32_t ulWords[kStatusWords];
+    uint32_t ulSequence;
+
+    if (_pSegment == NULL)
+    {
+        return;
+    }
+
+    memcpy(ulWords, pStatus, sizeof(ulWords));
+    ulSequence = _pSegment->sequence.load(std::memory_order_relaxed);
+
+    _pSegment->sequence.store(ulSequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < kStatusWords; i++)
+    {
+        _pSegment->words[i].store(ulWords[i], std::memory_order_relaxed);
+    }
+    _pSegment->sequence.store(ulSequence + 2, std::memory_order_release);
+}
+
+void StatusPublisher::close(bool bUnlink)
+{
+    if (_pSegment != NULL)
+    {
+        munmap(_pSegment, sizeof(StatusSegment_t));
+        _pSegment = NULL;
+    }
+    if (bUnlink && (_szName[0] != '\0'))
+    {
+        shm_unlink(_szName);
+    }
+    _szName[0] = '\0';
+}
+
+StatusReader::StatusReader(void)
+{
+    _pSegment = NULL;
+    _bMapped = false;
+}
+
+StatusReader::~StatusReader(void)
+{
+    close();
+}
+
+bool StatusReader::open(const char *pszName)
+{
+    int iFd = shm_open(pszName, O_RDONLY | O_CLOEXEC, 0);
+    struct stat info;
+    void *pMap;
+
+    if ((iFd < 0) || (fstat(iFd, &info) != 0) || ((size_t)info.st_size < sizeof(StatusSegment_t)))
+    {
+        fprintf(stderr, "%s: no crossing status segment\n", pszName);
+        if (iFd >= 0)
+        {
+            ::close(iFd);
+        }
+        return false;
+    }
+
+    pMap = mmap(NULL, sizeof(StatusSegment_t), PROT_READ, MAP_SHARED, iFd, 0);
+    ::close(iFd);
+    if (pMap == MAP_FAILED)
+    {
+        perror(pszName);
+        return false;
+    }
+
+    _bMapped = true;
+    if (!attach((StatusSegment_t *)pMap))
+    {
+        fprintf(stderr, "%s: not a version %u crossing status segment\n", pszName, kStatusVersion);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+// a segment already in this process (the benchmark)
+bool StatusReader::attach(StatusSegment_t *pSegment)
+{
+    _pSegment = pSegment;
+
+    if ((pSegment->ulMagic != kStatusMagic) || (pSegment->ulVersion != kStatusVersion) || (pSegment->ulWords != (uint32_t)kStatusWords))
+    {
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+// ***************************************************
+//
+// read()
+//
+// Copies out a consistent status.  Returns the number of times it had to
+// try again, because the writer was part way through.
+//
+// ****************************************************
+unsigned int StatusReader::read(CrossingStatus_t *pStatus)
+{
+    uint32_t ulWords[kStatusWords];
+    unsigned int uiRetries = 0;
+
+    for (;;)
+    {
+        uint32_t ulBefore = _pSegment->sequence.load(std::memory_order_acquire);
+
+        if ((ulBefore & 1) == 0)
+        {
+            for (int i = 0; i < kStatusWords; i++)
+            {
+                ulWords[i] = _pSegment->words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (_pSegment->sequence.load(std::memory_order_relaxed) == ulBefore)
+            {
+                break;
+            }
+        }
+
+        // on one core the writer may have been preempted part way, let it finish
+        if ((++uiRetries % 64) == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    memcpy(pStatus, ulWords, sizeof(ulWords));
+    return uiRetries;
+}
+
+void StatusReader::close(void)
+{
+    if (_bMapped && (_pSegment != NULL))
+    {
+        munmap(_pSegment, sizeof(StatusSegment_t));
+    }
+    _pSegment = NULL;
+    _bMapped = false;
+}
@@ -0,0 +1,116 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// StatusShm - the crossing's state in POSIX shared memory (host only)
+//
+// The Linux runtime publishes a CrossingStatus_t after every loop() into
+// a shared memory segment (/dev/shm/<name>), and monitoring can read it
+// as often as it likes without a system call, and without ever holding
+// up the controller.
+//
+// The segment is a seqlock: the writer makes the sequence odd, writes the
+// words, and makes it even again.  A reader takes the sequence, copies
+// the words, and takes the sequence again; if it was odd, or moved, the
+// copy may be torn and it tries again.  The writer never waits, and the
+// readers only write to their own memory, so any number of them can
+// poll at once.  The words are relaxed atomics, so the copy is not a data
+// race in the C++ sense, and the fences order them against the sequence.
+//
+// There is one writer per segment.
+//
+// ****************************************************
+
+#ifndef StatusShm_h
+#define StatusShm_h
+
+#include <inttypes.h>
+#include <atomic>
+
+const uint32_t kStatusMagic = 0x53524D47;   // "SRMG"
+const uint32_t kStatusVersion = 1;
+
+// every field is 32 bits, such that the status is a plain array of words
+typedef struct
+{
+    uint32_t ulPublished;
+    uint32_t ulMillis;
+
+    uint32_t ulTrackState;
+    uint32_t ulInitializeState;
+    uint32_t ulDownState;
+    uint32_t ulUpState;
+    uint32_t ulGateState;
+    uint32_t ulMotorRunning;
+    uint32_t ulMotorOn;
+    uint32_t ulMotorDirection;
+    uint32_t ulDutyCycleExceeded;
+    uint32_t ulMotorRunningTotalSeconds;
+    uint32_t ulSensorLevel;
+    uint32_t ulOutputPins;
+    uint32_t ulIdle;
+
+    uint32_t ulTimerSlotsUsed;
+    uint32_t ulTimerSlotMask;
+
+    uint32_t ulOccupancies;
+    uint32_t ulGateDowns;
+    uint32_t ulDutyCycleTrips;
+    uint32_t ulWakeUps;
+    uint32_t ulLoops;
+    uint32_t ulIdleSkips;
+    uint32_t ulHistoryQueued;
+    uint32_t ulHistoryDropped;
+} CrossingStatus_t;
+
+const int kStatusWords = sizeof(CrossingStatus_t) / sizeof(uint32_t);
+
+// the names, in order, for the tools that print a status
+extern const char *gpszStatusFieldNames[kStatusWords];
+
+typedef struct
+{
+    uint32_t ulMagic;
+    uint32_t ulVersion;
+    uint32_t ulWords;
+    uint32_t ulWriterPid;
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[kStatusWords];
+} StatusSegment_t;
+
+class StatusPublisher
+{
+
+public:
+  StatusPublisher(void);
+  ~StatusPublisher(void);
+
+  bool open(const char *pszName);
+  void publish(const CrossingStatus_t *pStatus);
+  void close(bool bUnlink);
+
+protected:
+  StatusSegment_t *_pSegment;
+  char _szName[64];
+
+};
+
+class StatusReader
+{
+
+public:
+  StatusReader(void);
+  ~StatusReader(void);
+
+  bool open(const char *pszName);
+  bool attach(StatusSegment_t *pSegment);
+  unsigned int read(CrossingStatus_t *pStatus);
+  void close(void);
+
+protected:
+  StatusSegment_t *_pSegment;
+  bool _bMapped;
+
+};
+
+#endif
@@ -0,0 +1,699 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// SweepTiming - host tool
+//
+// Tries every combination of the timing values in SRMcrossGate_Timing.h
+// from a grid, against recorded track sensor traces, and reports the
+// combinations that are not beaten on all three of:
+//
+//   motor_s     - seconds the gate motor ran (wear, and the duty cycle)
+//   closure_s   - seconds the road was closed (the bell on)
+//   warning_s   - the shortest time the lights and bell were on before the
+//                 gate arm started down
+//
+// A combination is thrown out if the gate arm model (GateArm.h) ever
+// stops short of all the way up or all the way down, if the arm is not
+// down by the time the train gets from the sensor to the road (-a, 20
+// seconds unless told otherwise), if its warning is
+// shorter than -w, or if the duty cycle limit locks the motor out more
+// than -l times (a locked out gate saves a lot of motor time).  One of the rest is picked (the one nearest the best
+// of all three, or row -c of the frontier) and with -h its values are
+// written out as a crossing profile (SRMcrossGate_Profile.h), named by -n
+// (SweptGateProfile unless told otherwise), with the wiring of the profile
+// the sweep was built with.  Paste it into SRMcrossGate_Profile.h and
+// build with -DSRM_PROFILE=<name>; SRMcrossGate_Timing.h is not touched.
+//
+// The traces are "TS <millis> <level>" captures, as for ReplaySensorTrace.
+// -t adds a made up trace of that many trains close together, which is
+// what the duty cycle limit is there for.  The combinations are spread over
+// worker processes (SimWorkers.h).
+//
+// The whole build has to have SRM_TUNABLE_TIMING defined:
+//
+//     g++ -std=gnu++11 -O3 -flto -DARDUINO=100 -DSRM_TUNABLE_TIMING -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/GateArm.cpp host/SimWorkers.cpp host/SweepTiming.cpp -o sweep
+//
+//     ./sweep [-j workers] [-t trains] [-r seed] [-a approach ms] [-w min warning ms] [-l max lockouts] [-c row] [-o all.csv] [-h profile.h] [-n name] trace ...
+//
+// ****************************************************
+
+// this file holds the timing variables, the rest of the build sees them as extern
+#define SRM_TIMING(name, value) unsigned long name = value
+#include "SRMcrossGate_Timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SimKernel.h"
+#include "GateArm.h"
+#include "SimWorkers.h"
+
+#ifndef SRM_TUNABLE_TIMING
+#error SweepTiming needs the whole build to have SRM_TUNABLE_TIMING defined
+#endif
+
+const int kMaxGridValues = 6;
+const unsigned long kSettleTime = 60000;
+
+typedef struct
+{
+    const char *pszName;
+    unsigned long *pulValue;
+    int iGridCount;
+    unsigned long aulGrid[kMaxGridValues];
+} TimingParameter_t;
+
+// the grid, around the hand picked values
+static TimingParameter_t gParameters[] =
+{
+    { "kGateWarningLeadTime",         &kGateWarningLeadTime,         4, { 2000, 3000, 4000, 5000 } },
+    { "kGateMotorRunTime",            &kGateMotorRunTime,            5, { 11000, 12000, 13000, 14000, 15000 } },
+    { "kMaxGateDownTimelimitReached", &kMaxGateDownTimelimitReached, 4, { 5000, 10000, 20000, 30000 } },
+    { "kTrackSensorDebounceTime",     &kTrackSensorDebounceTime,     4, { 250, 500, 750, 1000 } },
+    { "kMaxDutyCycleLimitReached",    &kMaxDutyCycleLimitReached,    3, { 60000, 80000, 100000 } },
+};
+
+const int kParameterCount = sizeof(gParameters) / sizeof(gParameters[0]);
+
+typedef struct
+{
+    unsigned long ulTime;
+    uint8_t uiLevel;
+} TraceEdge_t;
+
+typedef struct
+{
+    uint32_t uiPoint;
+    uint32_t uiLockouts;
+    uint32_t uiShortStrokes;
+    uint32_t uiLateArms;
+    float fMotorSeconds;
+    float fClosureSeconds;
+    float fMinWarningSeconds;
+} PointResult_t;
+
+static std::vector<std::vector<TraceEdge_t> > gTraces;
+static std::vector<PointResult_t> gResults;
+static unsigned long gulPointCount;
+static unsigned long gulApproachTime = 20000;
+
+// ***************************************************
+//
+// Grid points
+//
+// A point number picks one value of each parameter, the first parameter
+// changing fastest.
+//
+// ****************************************************
+static void SetPoint(uint32_t uiPoint)
+{
+    int i;
+
+    for (i = 0; i < kParameterCount; i++)
+    {
+        *gParameters[i].pulValue = gParameters[i].aulGrid[uiPoint % gParameters[i].iGridCount];
+        uiPoint /= gParameters[i].iGridCount;
+    }
+}
+
+static unsigned long PointValue(uint32_t uiPoint, int iParameter)
+{
+    int i;
+
+    for (i = 0; i < iParameter; i++)
+    {
+        uiPoint /= gParameters[i].iGridCount;
+    }
+
+    return gParameters[iParameter].aulGrid[uiPoint % gParameters[iParameter].iGridCount];
+}
+
+// ***************************************************
+//
+// Traces
+//
+// ****************************************************
+static bool ReadTrace(const char *pszPath)
+{
+    std::vector<TraceEdge_t> trace;
+    char szLine[256];
+    FILE *pFile = fopen(pszPath, "r");
+
+    if (pFile == NULL)
+    {
+        perror(pszPath);
+        return false;
+    }
+
+    while (fgets(szLine, sizeof(szLine), pFile) != NULL)
+    {
+        const char *p = szLine;
+        TraceEdge_t edge;
+        int iLevel;
+
+        if (strncmp(p, "TS ", 3) == 0)
+        {
+            p += 3;
+        }
+
+        if (sscanf(p, "%lu %d", &edge.ulTime, &iLevel) != 2)
+        {
+            continue;
+        }
+
+        edge.uiLevel = (iLevel != 0) ? HIGH : LOW;
+        trace.push_back(edge);
+    }
+    fclose(pFile);
+
+    gTraces.push_back(trace);
+    return true;
+}
+
+// ***************************************************
+//
+// MakeBusyTrace()
+//
+// iTrains trains two to eight minutes apart, each on the crossing for 20
+// to 90 seconds, with some chatter as they arrive and leave.
+//
+// ****************************************************
+static void MakeBusyTrace(int iTrains, uint32_t uiSeed)
+{
+    std::vector<TraceEdge_t> trace;
+    unsigned long ulTime = 30000;
+    int i;
+
+    srand(uiSeed);
+
+    for (i = 0; i < iTrains; i++)
+    {
+        unsigned long ulLeave = ulTime + 20000UL + (rand() % 70000UL);
+        TraceEdge_t edge;
+
+        edge.ulTime = ulTime;
+        edge.uiLevel = HIGH;
+        trace.push_back(edge);
+        edge.ulTime = ulTime + 80 + (rand() % 150);
+        edge.uiLevel = LOW;
+        trace.push_back(edge);
+        edge.ulTime += 100 + (rand() % 200);
+        edge.uiLevel = HIGH;
+        trace.push_back(edge);
+
+        edge.ulTime = ulLeave;
+        edge.uiLevel = LOW;
+        trace.push_back(edge);
+        edge.ulTime = ulLeave + 100 + (rand() % 300);
+        edge.uiLevel = HIGH;
+        trace.push_back(edge);
+        edge.ulTime += 100 + (rand() % 200);
+        edge.uiLevel = LOW;
+        trace.push_back(edge);
+
+        ulTime = ulLeave + 120000UL + (rand() % 360000UL);
+    }
+
+    gTraces.push_back(trace);
+}
+
+// ***************************************************
+//
+// Running a trace
+//
+// ****************************************************
+static SimKernel gKernel;
+static GateArm gArm;
+static unsigned long gulBellOnTime;
+static unsigned long gulTrainArrivalTime;
+static bool gbTrainApproaching;
+static double gdClosureSeconds;
+static double gdMinWarningSeconds;
+static uint32_t guiLockouts;
+static uint32_t guiShortStrokes;
+static uint32_t guiLateArms;
+static bool gbLockedOut;
+
+// a train trips the sensor while the road is open, the arm has to be down before it gets to the road
+static void WatchInput(uint8_t uiPin, uint8_t uiLevel)
+{
+    if ((uiPin == kPinAddrGateTrackSensor) && (uiLevel == HIGH) && !gbTrainApproaching && (digitalRead(kPinAddrGateBellControl) != kWarningBellOn))
+    {
+        gulTrainArrivalTime = gKernel.now();
+        gbTrainApproaching = true;
+    }
+}
+
+static void WatchPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    unsigned long ulNow = gKernel.now();
+
+    if (uiPin == kPinAddrGateBellControl)
+    {
+        if (uiValue == kWarningBellOn)
+        {
+            gulBellOnTime = ulNow;
+        }
+        else
+        {
+            gdClosureSeconds += (ulNow - gulBellOnTime) / 1000.0;
+            gbTrainApproaching = false;
+        }
+    }
+    else if ((uiPin == kPinAddrGateArmControlMotorPower) || (uiPin == kPinAddrGateArmControlMotorDirection))
+    {
+        bool bWasOn = gArm.isMotorOn();
+        bool bWasDown = gArm.isMotorDown();
+
+        gArm.pinWrite(ulNow, uiPin, uiValue);
+
+        // the arm starts down, how long have the lights and bell been on?
+        if (!bWasOn && gArm.isMotorOn() && gArm.isMotorDown())
+        {
+            double dWarning = (digitalRead(kPinAddrGateBellControl) == kWarningBellOn) ? (ulNow - gulBellOnTime) / 1000.0 : 0.0;
+
+            gdMinWarningSeconds = (dWarning < gdMinWarningSeconds) ? dWarning : gdMinWarningSeconds;
+        }
+
+        // the motor stops, did the arm get all the way?
+        if (bWasOn && !gArm.isMotorOn() && (bWasDown ? !gArm.isDown() : !gArm.isUp()))
+        {
+            guiShortStrokes++;
+        }
+    }
+}
+
+static void WatchStep(void)
+{
+    gArm.update(gKernel.now());
+    if (gbTrainApproaching && gArm.isDown())
+    {
+        guiLateArms += ((gKernel.now() - gulTrainArrivalTime) > gulApproachTime) ? 1 : 0;
+        gbTrainApproaching = false;
+    }
+
+    if (gCrossingState.bDutyCycleExceededFlag && !gbLockedOut)
+    {
+        guiLockouts++;
+    }
+    gbLockedOut = gCrossingState.bDutyCycleExceededFlag;
+}
+
+static void RunTrace(const std::vector<TraceEdge_t> &trace)
+{
+    unsigned long ulEnd = 0;
+    size_t i;
+
+    gKernel.reset();
+    gArm.reset(0);
+    gulBellOnTime = 0;
+    gbTrainApproaching = false;
+    gbLockedOut = false;
+
+    for (i = 0; i < trace.size(); i++)
+    {
+        gKernel.scheduleInput(trace[i].ulTime, kPinAddrGateTrackSensor, trace[i].uiLevel);
+        ulEnd = (trace[i].ulTime > ulEnd) ? trace[i].ulTime : ulEnd;
+    }
+
+    // long enough after the last edge for the gate to come back up
+    ulEnd += kMaxGateDownTimelimitReached + 2 * kGateMotorRunTime + kSettleTime;
+
+    gKernel.boot();
+    gKernel.runUntil(ulEnd);
+
+    if (digitalRead(kPinAddrGateBellControl) == kWarningBellOn)
+    {
+        gdClosureSeconds += (ulEnd - gulBellOnTime) / 1000.0;
+    }
+    gArm.update(ulEnd);
+}
+
+static void RunWorker(int iWorker, int iWorkers)
+{
+    uint32_t uiPoint;
+    size_t i;
+
+    HostSetPinWriteHook(WatchPinWrite);
+    gKernel.setInputHook(WatchInput);
+    gKernel.setStepHook(WatchStep);
+
+    for (uiPoint = iWorker; uiPoint < gulPointCount; uiPoint += iWorkers)
+    {
+        PointResult_t result;
+
+        SetPoint(uiPoint);
+        gdClosureSeconds = 0.0;
+        gdMinWarningSeconds = 1e9;
+        guiLockouts = 0;
+        guiShortStrokes = 0;
+        guiLateArms = 0;
+
+        result.fMotorSeconds = 0.0f;
+        for (i = 0; i < gTraces.size(); i++)
+        {
+            RunTrace(gTraces[i]);
+            result.fMotorSeconds += (float)gArm.motorSeconds();
+        }
+
+        result.uiPoint = uiPoint;
+        result.uiLockouts = guiLockouts;
+        result.uiShortStrokes = guiShortStrokes;
+        result.uiLateArms = guiLateArms;
+        result.fClosureSeconds = (float)gdClosureSeconds;
+        result.fMinWarningSeconds = (gdMinWarningSeconds > 1e8) ? 0.0f : (float)gdMinWarningSeconds;
+
+        SimWorkerSend(&result);
+    }
+}
+
+static void ReceiveResult(const void *pRecord)
+{
+    gResults.push_back(*(const PointResult_t *)pRecord);
+}
+
+// ***************************************************
+//
+// The Pareto frontier
+//
+// ****************************************************
+
+// a is at least as good as b on everything, and better on something
+static bool Dominates(const PointResult_t &a, const PointResult_t &b)
+{
+    bool bNoWorse = (a.fMotorSeconds <= b.fMotorSeconds) && (a.fClosureSeconds <= b.fClosureSeconds) &&
+                    (a.fMinWarningSeconds >= b.fMinWarningSeconds);
+    bool bBetter = (a.fMotorSeconds < b.fMotorSeconds) || (a.fClosureSeconds < b.fClosureSeconds) ||
+                   (a.fMinWarningSeconds > b.fMinWarningSeconds);
+
+    return bNoWorse && bBetter;
+}
+
+static bool Acceptable(const PointResult_t &result, unsigned long ulMinWarning, unsigned long ulMaxLockouts)
+{
+    return (result.uiShortStrokes == 0) && (result.uiLateArms == 0) && (result.fMinWarningSeconds * 1000.0f >= ulMinWarning) &&
+           (result.uiLockouts <= ulMaxLockouts);
+}
+
+static bool ClosureFirst(const PointResult_t &a, const PointResult_t &b)
+{
+    if (a.fClosureSeconds != b.fClosureSeconds)
+    {
+        return a.fClosureSeconds < b.fClosureSeconds;
+    }
+    return a.uiPoint < b.uiPoint;
+}
+
+// ***************************************************
+//
+// PickKnee()
+//
+// The frontier point nearest the best of all three, with each measure
+// scaled to its range on the frontier.
+//
+// ****************************************************
+static size_t PickKnee(const std::vector<PointResult_t> &frontier)
+{
+    float fMin[3] = { 1e30f, 1e30f, 1e30f };
+    float fMax[3] = { -1e30f, -1e30f, -1e30f };
+    float fBest = 1e30f;
+    size_t iBest = 0;
+    size_t i;
+    int j;
+
+    for (i = 0; i < frontier.size(); i++)
+    {
+        float f[3] = { frontier[i].fMotorSeconds, frontier[i].fClosureSeconds, -frontier[i].fMinWarningSeconds };
+
+        for (j = 0; j < 3; j++)
+        {
+            fMin[j] = (f[j] < fMin[j]) ? f[j] : fMin[j];
+            fMax[j] = (f[j] > fMax[j]) ? f[j] : fMax[j];
+        }
+    }
+
+    for (i = 0; i < frontier.size(); i++)
+    {
+        float f[3] = { frontier[i].fMotorSeconds, frontier[i].fClosureSeconds, -frontier[i].fMinWarningSeconds };
+        float fDistance = 0.0f;
+
+        for (j = 0; j < 3; j++)
+        {
+            float fScaled = (fMax[j] > fMin[j]) ? (f[j] - fMin[j]) / (fMax[j] - fMin[j]) : 0.0f;
+
+            fDistance += fScaled * fScaled;
+        }
+
+        if (fDistance < fBest)
+        {
+            fBest = fDistance;
+            iBest = i;
+        }
+    }
+
+    return iBest;
+}
+
+static void WriteRow(FILE *pFile, const char *pszLabel, const PointResult_t &result)
+{
+    int i;
+
+    fprintf(pFile, "%s", pszLabel);
+    for (i = 0; i < kParameterCount; i++)
+    {
+        fprintf(pFile, ",%lu", PointValue(result.uiPoint, i));
+    }
+    fprintf(pFile, ",%.1f,%.1f,%.2f,%u,%u,%u\n", result.fMotorSeconds, result.fClosureSeconds,
+            result.fMinWarningSeconds, result.uiLockouts, result.uiShortStrokes, result.uiLateArms);
+}
+
+static void WriteHeading(FILE *pFile, const char *pszLabel)
+{
+    int i;
+
+    fprintf(pFile, "%s", pszLabel);
+    for (i = 0; i < kParameterCount; i++)
+    {
+        fprintf(pFile, ",%s", gParameters[i].pszName);
+    }
+    fprintf(pFile, ",motor_s,closure_s,warning_s,lockouts,short_strokes,late_arms\n");
+}
+
+// ***************************************************
+//
+// WriteProfile()
+//
+// Writes a profile (SRMcrossGate_Profile.h) named pszName, with the
+// point's timings and the wiring and relay levels of the profile the
+// sweep was built with, to paste into SRMcrossGate_Profile.h beside the
+// others.  The values in the image stay in the profiles; nothing here
+// writes SRMcrossGate_Timing.h.
+//
+// ****************************************************
+static bool WriteProfile(const char *pszOutput, const char *pszName, const PointResult_t &result)
+{
+    FILE *pFile = fopen(pszOutput, "w");
+    int i;
+
+    if (pFile == NULL)
+    {
+        perror(pszOutput);
+        return false;
+    }
+
+    fprintf(pFile, "// %s, with the timings host/SweepTiming.cpp picked against %u trace%s:\n",
+            CrossingProfile::kName, (unsigned)gTraces.size(), (gTraces.size() == 1) ? "" : "s");
+    fprintf(pFile, "// motor %.1f s, closure %.1f s, shortest warning %.2f s\n",
+            result.fMotorSeconds, result.fClosureSeconds, result.fMinWarningSeconds);
+    fprintf(pFile, "struct %s\n{\n", pszName);
+    fprintf(pFile, "    static constexpr const char *kName = \"%s, swept\";\n\n", CrossingProfile::kName);
+
+    for (i = 0; i < kParameterCount; i++)
+    {
+        fprintf(pFile, "    static constexpr unsigned long %s = %lu;\n", gParameters[i].pszName, PointValue(result.uiPoint, i));
+    }
+    fprintf(pFile, "\n");
+
+#define SWEEP_PROFILE_BOOL(name) fprintf(pFile, "    static constexpr bool " #name " = %d;\n", (int)CrossingProfile::name)
+#define SWEEP_PROFILE_PIN(name) fprintf(pFile, "    static constexpr int " #name " = %d;\n", CrossingProfile::name)
+    SWEEP_PROFILE_BOOL(kWarningBellOn);
+    SWEEP_PROFILE_BOOL(kWarningLightsOn);
+    SWEEP_PROFILE_BOOL(kGateArmControlMotorOn);
+    SWEEP_PROFILE_BOOL(kGateArmControlMotorUp);
+    SWEEP_PROFILE_BOOL(kStatusLEDon);
+    fprintf(pFile, "\n");
+    SWEEP_PROFILE_PIN(kPinAddrGateBellControl);
+    SWEEP_PROFILE_PIN(kPinAddrGateLightsControlRight);
+    SWEEP_PROFILE_PIN(kPinAddrGateLightsControlLeft);
+    SWEEP_PROFILE_PIN(kPinAddrGateArmControlMotorDirection);
+    SWEEP_PROFILE_PIN(kPinAddrGateArmControlMotorPower);
+    SWEEP_PROFILE_PIN(kPinAddrGateStatusLED);
+    SWEEP_PROFILE_PIN(kPinAddrGateTrackSensor);
+#undef SWEEP_PROFILE_BOOL
+#undef SWEEP_PROFILE_PIN
+
+    fprintf(pFile, "};\n\n");
+    fprintf(pFile, "static_assert(CrossingProfileCheck<%s>::kPassed, \"%s\");\n", pszName, pszName);
+
+    fclose(pFile);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<PointResult_t> frontier;
+    const char *pszAll = NULL;
+    const char *pszProfile = NULL;
+    const char *pszProfileName = "SweptGateProfile";
+    unsigned long ulShipped = 0;
+    unsigned long ulMinWarning = 0;
+    unsigned long ulMaxLockouts = 0;
+    uint32_t uiSeed = 1;
+    int iWorkers = SimWorkersDefault();
+    int iChoice = -1;
+    int iBusyTrains = 0;
+    size_t iChosen;
+    size_t i, j;
+    long lDone;
+
+    for (i = 1; i < (size_t)argc; i++)
+    {
+        if ((argv[i][0] == '-') && (i + 1 < (size_t)argc))
+        {
+            const char *pszValue = argv[++i];
+
+            switch (argv[i - 1][1])
+            {
+                case 'j': iWorkers = atoi(pszValue); break;
+                case 't': iBusyTrains = atoi(pszValue); break;
+                case 'r': uiSeed = (uint32_t)strtoul(pszValue, NULL, 0); break;
+                case 'a': gulApproachTime = strtoul(pszValue, NULL, 0); break;
+                case 'w': ulMinWarning = strtoul(pszValue, NULL, 0); break;
+                case 'l': ulMaxLockouts = strtoul(pszValue, NULL, 0); break;
+                case 'c': iChoice = atoi(pszValue); break;
+                case 'o': pszAll = pszValue; break;
+                case 'h': pszProfile = pszValue; break;
+                case 'n': pszProfileName = pszValue; break;
+                default:
+                    fprintf(stderr, "sweep: unknown option %s\n", argv[i - 1]);
+                    return 2;
+            }
+        }
+        else if (!ReadTrace(argv[i]))
+        {
+            return 2;
+        }
+    }
+
+    if (iBusyTrains > 0)
+    {
+        MakeBusyTrace(iBusyTrains, uiSeed);
+    }
+
+    if (gTraces.empty())
+    {
+        fprintf(stderr, "usage: sweep [-j workers] [-t trains] [-r seed] [-a approach ms] [-w min warning ms] [-l max lockouts] [-c row] [-o all.csv] [-h profile.h] [-n name] trace ...\n");
+        return 2;
+    }
+
+    // the point number of the values in SRMcrossGate_Timing.h, if they are on the grid
+    gulPointCount = 1;
+    for (i = 0; i < (size_t)kParameterCount; i++)
+    {
+        for (j = 0; j < (size_t)gParameters[i].iGridCount; j++)
+        {
+            if (gParameters[i].aulGrid[j] == *gParameters[i].pulValue)
+            {
+                ulShipped += j * gulPointCount;
+            }
+        }
+        gulPointCount *= gParameters[i].iGridCount;
+    }
+
+    lDone = SimWorkersRun(iWorkers, sizeof(PointResult_t), RunWorker, ReceiveResult);
+    if (lDone != (long)gulPointCount)
+    {
+        fprintf(stderr, "sweep: only %ld of %lu points came back\n", lDone, gulPointCount);
+        return 1;
+    }
+
+    if (pszAll != NULL)
+    {
+        FILE *pFile = fopen(pszAll, "w");
+
+        if (pFile == NULL)
+        {
+            perror(pszAll);
+            return 2;
+        }
+        WriteHeading(pFile, "point");
+        for (i = 0; i < gResults.size(); i++)
+        {
+            char szLabel[16];
+
+            snprintf(szLabel, sizeof(szLabel), "%u", gResults[i].uiPoint);
+            WriteRow(pFile, szLabel, gResults[i]);
+        }
+        fclose(pFile);
+    }
+
+    // the frontier, out of the points that keep the arm moving all the way and down in time, warn long enough and do not lock out
+    for (i = 0; i < gResults.size(); i++)
+    {
+        bool bDominated = false;
+
+        if (!Acceptable(gResults[i], ulMinWarning, ulMaxLockouts))
+        {
+            continue;
+        }
+
+        for (j = 0; (j < gResults.size()) && !bDominated; j++)
+        {
+            bDominated = Acceptable(gResults[j], ulMinWarning, ulMaxLockouts) && Dominates(gResults[j], gResults[i]);
+        }
+
+        if (!bDominated)
+        {
+            frontier.push_back(gResults[i]);
+        }
+    }
+
+    if (frontier.empty())
+    {
+        fprintf(stderr, "sweep: no point keeps the arm moving all the way and down in time, with that much warning and no more lockouts\n");
+        return 1;
+    }
+
+    std::sort(frontier.begin(), frontier.end(), ClosureFirst);
+    iChosen = ((iChoice >= 0) && ((size_t)iChoice < frontier.size())) ? (size_t)iChoice : PickKnee(frontier);
+
+    WriteHeading(stdout, "row");
+    for (i = 0; i < frontier.size(); i++)
+    {
+        char szLabel[16];
+
+        snprintf(szLabel, sizeof(szLabel), "%u%s", (unsigned)i, (i == iChosen) ? "*" : "");
+        WriteRow(stdout, szLabel, frontier[i]);
+    }
+    for (i = 0; i < gResults.size(); i++)
+    {
+        if (gResults[i].uiPoint == ulShipped)
+        {
+            WriteRow(stdout, "shipped", gResults[i]);
+        }
+    }
+
+    if ((pszProfile != NULL) && !WriteProfile(pszProfile, pszProfileName, frontier[iChosen]))
+    {
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// TimerBench - host tool
+//
+// Measures what a Timer event costs to dispatch, for each kind of
+// callback: a plain function (each controller's state in its own
+// globals, as the sketch does it), a function with a context pointer,
+// and a member function bound with TimerMember.  Every slot holds an
+// event that is due on every update(), so each update() dispatches all
+// of them.  The three should come out the same, give or take the noise.
+//
+// Then it sweeps 10 to 1000 live events, with periods from 10 ms to 5 s,
+// over a minute of millis() in 1 ms steps (the Uno calls update() at least
+// that often), and prints the time per update() for the Timer's array walk
+// (Event::update() on each slot, as Timer::update() does, only with more
+// slots than its 10) and for the timing wheel (TimerWheel.h), and the
+// wheel's SRAM on the Uno.
+//
+//     g++ -std=gnu++11 -O2 -DARDUINO=100 -Ihost -I. Timer.cpp Event.cpp host/HostArduino.cpp host/TimerBench.cpp -o timerbench
+//
+//     ./timerbench [updates]
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "TimerWheel.h"
+
+// a stand in for a controller: a few ticks' worth of state
+class BenchController
+{
+
+public:
+  BenchController(void) { _ulTicks = 0; _ulSum = 0; }
+  void tick(void) { _ulTicks++; _ulSum += _ulTicks ^ 0x5A; }
+  unsigned long ticks(void) { return _ulTicks; }
+
+protected:
+  unsigned long _ulTicks;
+  unsigned long _ulSum;
+
+};
+
+static BenchController gControllers[MAX_NUMBER_OF_EVENTS];
+
+// the plain callbacks need a function per controller
+template <int N>
+static void PlainTick(void)
+{
+    gControllers[N].tick();
+}
+
+static void (*const gPlainTicks[MAX_NUMBER_OF_EVENTS])(void) =
+{
+    PlainTick<0>, PlainTick<1>, PlainTick<2>, PlainTick<3>, PlainTick<4>,
+    PlainTick<5>, PlainTick<6>, PlainTick<7>, PlainTick<8>, PlainTick<9>,
+};
+
+static void ContextTick(void *context)
+{
+    static_cast<BenchController *>(context)->tick();
+}
+
+static double Seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void Run(const char *pszName, int iKind, unsigned long ulUpdates)
+{
+    Timer timer;
+    unsigned long ulTicks = 0;
+    double dStart;
+    double dElapsed;
+
+    for (int i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        gControllers[i] = BenchController();
+
+        // a period of 0 is due on every update()
+        switch (iKind)
+        {
+            case 0:  timer.every(0, gPlainTicks[i]); break;
+            case 1:  timer.every(0, ContextTick, &gControllers[i]); break;
+            default: timer.every<BenchController, &BenchController::tick>(0, &gControllers[i]); break;
+        }
+    }
+
+    dStart = Seconds();
+    for (unsigned long ulUpdate = 0; ulUpdate < ulUpdates; ulUpdate++)
+    {
+        timer.update();
+    }
+    dElapsed = Seconds() - dStart;
+
+    for (int i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        ulTicks += gControllers[i].ticks();
+    }
+
+    printf("%-10s %12lu dispatches %8.2f ns each%s\n", pszName, ulTicks, dElapsed * 1e9 / ulTicks,
+           (ulTicks == ulUpdates * MAX_NUMBER_OF_EVENTS) ? "" : "  (dispatches missing!)");
+}
+
+// ***************************************************
+//
+// The sweep
+//
+// ****************************************************
+const int kSweepMaxEvents = 1024;
+const int kSweepBuckets = 256;
+const unsigned long kSweepMillis = 60000UL;
+
+static const unsigned long gSweepPeriods[] = { 10, 25, 50, 100, 250, 500, 1000, 5000 };
+
+static unsigned long gSweepTicks;
+
+static void SweepTick(void *context)
+{
+    (void)context;
+    gSweepTicks++;
+}
+
+static unsigned long SweepPeriod(int i)
+{
+    // the same mix for both, spread so the deadlines do not all line up
+    return gSweepPeriods[(i * 7 + i / 8) % 8] + (i % 5);
+}
+
+static double SweepArray(int iEvents, unsigned long *pulTicks)
+{
+    static Event events[kSweepMaxEvents];
+    double dStart;
+
+    for (int i = 0; i < iEvents; i++)
+    {
+        events[i].eventType = EVENT_EVERY_CONTEXT;
+        events[i].contextCallback = SweepTick;
+        events[i].context = NULL;
+        events[i].period = SweepPeriod(i);
+        events[i].repeatCount = -1;
+        events[i].lastEventTime = 0;
+        events[i].count = 0;
+    }
+
+    gSweepTicks = 0;
+    dStart = Seconds();
+    for (unsigned long ulMillis = 1; ulMillis <= kSweepMillis; ulMillis++)
+    {
+        HostSetMillis(ulMillis);
+        for (int i = 0; i < iEvents; i++)
+        {
+            if (events[i].eventType != EVENT_NONE)
+            {
+                events[i].update();
+            }
+        }
+    }
+    *pulTicks = gSweepTicks;
+    return (Seconds() - dStart) * 1e9 / kSweepMillis;
+}
+
+static double SweepWheel(int iEvents, unsigned long *pulTicks)
+{
+    static TimerWheel<kSweepMaxEvents, kSweepBuckets> wheel;
+    double dStart;
+
+    HostSetMillis(0);
+    wheel = TimerWheel<kSweepMaxEvents, kSweepBuckets>();
+    for (int i = 0; i < iEvents; i++)
+    {
+        wheel.every(SweepPeriod(i), SweepTick, NULL);
+    }
+
+    gSweepTicks = 0;
+    dStart = Seconds();
+    for (unsigned long ulMillis = 1; ulMillis <= kSweepMillis; ulMillis++)
+    {
+        HostSetMillis(ulMillis);
+        wheel.update();
+    }
+    *pulTicks = gSweepTicks;
+    return (Seconds() - dStart) * 1e9 / kSweepMillis;
+}
+
+static void Sweep(void)
+{
+    static const int iCounts[] = { 10, 30, 100, 300, 1000 };
+
+    printf("\n%6s %14s %14s %12s\n", "events", "array ns/upd", "wheel ns/upd", "dispatches");
+    for (unsigned int n = 0; n < sizeof(iCounts) / sizeof(iCounts[0]); n++)
+    {
+        unsigned long ulArrayTicks;
+        unsigned long ulWheelTicks;
+        double dArray = SweepArray(iCounts[n], &ulArrayTicks);
+        double dWheel = SweepWheel(iCounts[n], &ulWheelTicks);
+
+        printf("%6d %14.1f %14.1f %12lu%s\n", iCounts[n], dArray, dWheel, ulWheelTicks,
+               (ulArrayTicks == ulWheelTicks) ? "" : "  (the two disagree!)");
+    }
+}
+
+// the microsecond events both keep (TimerMicros in Timer.h), 17 bytes each and a count
+const unsigned int kAvrMicroBytes = TIMER_MICRO_EVENTS * 17 + 1;
+
+// the wheel's SRAM on the Uno: pointers and int 2 bytes, no padding
+static unsigned int AvrWheelBytes(unsigned int uiEvents, unsigned int uiBuckets)
+{
+    unsigned int uiIndex = (uiEvents < 255) ? 1 : 2;
+
+    return uiEvents * (30 + 2 * uiIndex) + uiBuckets * uiIndex + 2 * uiIndex + 7 + kAvrMicroBytes;
+}
+
+static void PrintAvrSram(void)
+{
+    static const unsigned int uiSizes[][2] =
+    {
+        { 10, 32 }, { 16, 64 }, { 32, 64 }, { 48, 128 }, { 300, 256 }, { 1000, 256 },
+    };
+
+    printf("\nUno SRAM (2048 bytes): a Timer's 10 slots are %u bytes\n", 10 * 28 + 2 + kAvrMicroBytes);
+    printf("%6s %8s %8s\n", "slots", "buckets", "bytes");
+    for (unsigned int n = 0; n < sizeof(uiSizes) / sizeof(uiSizes[0]); n++)
+    {
+        unsigned int uiBytes = AvrWheelBytes(uiSizes[n][0], uiSizes[n][1]);
+
+        printf("%6u %8u %8u%s\n", uiSizes[n][0], uiSizes[n][1], uiBytes,
+               (uiBytes > 2048) ? "  (does not fit)" : "");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long ulUpdates = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000000UL;
+
+    HostReset();
+
+    // the first run warms the caches up
+    Run("plain", 0, ulUpdates / 10);
+    Run("plain", 0, ulUpdates);
+    Run("context", 1, ulUpdates);
+    Run("member", 2, ulUpdates);
+
+    Sweep();
+    PrintAvrSram();
+
+    return 0;
+}
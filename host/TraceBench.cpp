@@ -0,0 +1,199 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// TraceBench - host tool
+//
+// Runs the controller under each trace sink (SRMcrossGate_Trace.h) and
+// without one.  Build it once per sink:
+//
+//     g++ -std=gnu++11 -O2 -pthread -DARDUINO=100 -Ihost -I. -x c++ SRMcrossGateV8.ino -x none *.cpp host/HostArduino.cpp host/SimKernel.cpp host/SimVcd.cpp host/TraceVcd.cpp host/TraceBench.cpp -o tracebench
+//     g++ ... -DSRM_TRACE=TraceCounters ... -o tracebench_counters
+//     g++ ... -DSRM_TRACE=TraceRing ... -o tracebench_ring
+//     g++ ... -DSRM_TRACE=TraceVcd ... -o tracebench_vcd
+//
+//     ./tracebench [-d days] [-v out.vcd]
+//
+// It prints:
+//
+//   - a digest of the output pins over the days of the SimBench trains,
+//     which is the same for every sink, as tracing changes nothing the
+//     controller does
+//   - the runs of CrossingSignalMain() and the time per run, against the
+//     build without a sink
+//   - what the sink holds at the end, as the X serial command prints it;
+//     -v names the VCD file of the TraceVcd build (only the builds with a
+//     sink take it)
+//
+// Without a sink, every trace point is an empty inline function.  That the
+// release image is unchanged is checked on the objects, not timed: build
+// each source with and without the trace points and compare the code,
+//
+//     for f in *.cpp; do g++ -std=gnu++11 -Os -ffunction-sections -fdata-sections -DARDUINO=100 -Ihost -I. -c $f -o /tmp/new/${f%.cpp}.o; done
+//     for o in /tmp/new/*.o; do cmp <(objdump -dr $o | tail -n +3) <(objdump -dr /tmp/old/${o##*/} | tail -n +3); done
+//
+// and on the Uno, avr-size gives the same flash and SRAM for the two
+// images.
+//
+// ****************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Trace.h"
+#include "SimKernel.h"
+
+const unsigned long kOneDay = 24UL * 60UL * 60UL * 1000UL;
+
+#define TRACE_STRING(x) TRACE_STRING2(x)
+#define TRACE_STRING2(x) #x
+
+#if defined(SRM_TRACE)
+static const char *const kSinkName = TRACE_STRING(SRM_TRACE);
+
+// only the VCD sink has a file, to open before boot and close at the end
+template <class Sink>
+struct TraceFile
+{
+    static bool open(const char *) { return true; }
+    static void close(const char *) {}
+};
+
+template <>
+struct TraceFile<TraceVcd>
+{
+    static bool open(const char *pszPath)
+    {
+        return TraceVcd::open(pszPath);
+    }
+
+    static void close(const char *pszPath)
+    {
+        TraceVcd::close();
+        printf("  vcd    : %s\n", pszPath);
+    }
+};
+#endif
+
+static unsigned long gulPinWrites;
+static unsigned long gulPinDigest;
+
+static void DigestPinWrite(uint8_t uiPin, uint8_t uiValue)
+{
+    gulPinWrites++;
+    gulPinDigest = (gulPinDigest * 31UL) ^ (millis() * 7UL + uiPin * 2UL + uiValue);
+}
+
+// ***************************************************
+//
+// ScheduleDayOfTrains()
+//
+// The same trains as SimBench.  The same seed gives the same days.
+//
+// ****************************************************
+static void ScheduleDayOfTrains(SimKernel *pKernel, unsigned long ulDayStart, int iTrains, unsigned int uiSeed)
+{
+    unsigned long ulTime = ulDayStart + 60000UL;
+    unsigned long ulGap = kOneDay / (iTrains + 1);
+
+    srand(uiSeed);
+
+    for (int i = 0; i < iTrains; i++)
+    {
+        unsigned long ulArrive = ulTime + (rand() % (ulGap / 2));
+        unsigned long ulLeave = ulArrive + 30000UL + (rand() % 120000UL);
+
+        for (int iBounce = 0; iBounce < 3; iBounce++)
+        {
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL, kPinAddrGateTrackSensor, HIGH);
+            pKernel->scheduleInput(ulArrive + iBounce * 150UL + 60UL, kPinAddrGateTrackSensor, LOW);
+        }
+        pKernel->scheduleInput(ulArrive + 600UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave, kPinAddrGateTrackSensor, LOW);
+        pKernel->scheduleInput(ulLeave + 200UL, kPinAddrGateTrackSensor, HIGH);
+        pKernel->scheduleInput(ulLeave + 300UL, kPinAddrGateTrackSensor, LOW);
+
+        ulTime += ulGap;
+    }
+}
+
+static double Seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    SimKernel kernel;
+    int iDays = 1;
+#if defined(SRM_TRACE)
+    const char *pszVcd = "trace.vcd";
+#endif
+    double dStart;
+    double dElapsed;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+        {
+            iDays = atoi(argv[++i]);
+        }
+#if defined(SRM_TRACE)
+        else if ((strcmp(argv[i], "-v") == 0) && (i + 1 < argc))
+        {
+            pszVcd = argv[++i];
+        }
+#endif
+        else
+        {
+            fprintf(stderr, "usage: tracebench [-d days] [-v out.vcd]\n");
+            return 2;
+        }
+    }
+
+#if defined(SRM_TRACE)
+    printf("trace sink %s\n", kSinkName);
+#else
+    printf("no trace sink\n");
+#endif
+
+    kernel.reset();
+    HostSetPinWriteHook(DigestPinWrite);
+    for (int iDay = 0; iDay < iDays; iDay++)
+    {
+        ScheduleDayOfTrains(&kernel, iDay * kOneDay, 24, 1 + iDay);
+    }
+
+#if defined(SRM_TRACE)
+    if (!TraceFile<SRM_TRACE>::open(pszVcd))
+    {
+        fprintf(stderr, "tracebench: can not write %s\n", pszVcd);
+        return 2;
+    }
+#endif
+
+    dStart = Seconds();
+    kernel.boot();
+    kernel.runUntil(kOneDay * iDays);
+    dElapsed = Seconds() - dStart;
+
+    printf("  pins   : %lu writes, digest %08lx\n", gulPinWrites, gulPinDigest & 0xFFFFFFFFUL);
+    printf("  runs   : %lu, %.1f ns a run\n", gCrossingState.ulControllerRuns, dElapsed * 1e9 / gCrossingState.ulControllerRuns);
+
+    Serial.setOutput(stdout, false);
+    CrossingTrace::report();
+
+#if defined(SRM_TRACE)
+    TraceFile<SRM_TRACE>::close(pszVcd);
+#endif
+
+    return 0;
+}
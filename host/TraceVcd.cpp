@@ -0,0 +1,119 @@
+// ***************************************************
+//
+// Crossing Gate Controller Program
+//
+// TraceVcd - the VCD trace sink (host only)
+//
+// The sink of -DSRM_TRACE=TraceVcd (SRMcrossGate_Trace.h).  Each state
+// machine, output pin and Timer slot is a signal; a slot's signal counts
+// the times it has run, so every run is a change; the counts are kept in
+// gCrossingState, with the controller.  Open the file with TraceVcd::open()
+// before boot, and close it at the end.
+//
+// Unlike CrossingVcd (SimVcd.h), which looks at the pins and variables
+// from outside after each step, this is told of each change as the
+// controller makes it.
+//
+// ****************************************************
+
+#include "Arduino.h"
+#include "Timer.h"
+#include "SRMcrossGate_types.h"
+#include "SRMcrossGate_State.h"
+#include "SRMcrossGate_Trace.h"
+#include "SimVcd.h"
+
+// only the builds with a trace sink have anywhere to keep the counts
+#if defined(SRM_TRACE)
+
+static VcdWriter gTraceVcd;
+static int giTraceVcdMachine[kTraceMachines];
+static int giTraceVcdPin[kHostPinCount];
+static int giTraceVcdSlot[MAX_NUMBER_OF_EVENTS];
+
+bool TraceVcd::open(const char *pszPath)
+{
+    static const char *const kMachineNames[kTraceMachines] =
+        { "iTrackOcupationState", "iGateInitializationState", "bGateState", "iGateMovingDown_State", "iGateMovingUp_State" };
+    char szName[16];
+
+    if (!gTraceVcd.open(pszPath, "1 ms"))
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < kTraceMachines; i++)
+    {
+        giTraceVcdMachine[i] = gTraceVcd.addSignal("state", kMachineNames[i], 3, 0);
+    }
+
+    for (uint8_t i = 0; i < kHostPinCount; i++)
+    {
+        giTraceVcdPin[i] = -1;
+    }
+    giTraceVcdPin[kPinAddrGateBellControl] = gTraceVcd.addSignal("pins", "Bell", 1, 0);
+    giTraceVcdPin[kPinAddrGateLightsControlRight] = gTraceVcd.addSignal("pins", "LightsRight", 1, 0);
+    giTraceVcdPin[kPinAddrGateLightsControlLeft] = gTraceVcd.addSignal("pins", "LightsLeft", 1, 0);
+    giTraceVcdPin[kPinAddrGateArmControlMotorDirection] = gTraceVcd.addSignal("pins", "MotorDirection", 1, 0);
+    giTraceVcdPin[kPinAddrGateArmControlMotorPower] = gTraceVcd.addSignal("pins", "MotorPower", 1, 0);
+    giTraceVcdPin[kPinAddrGateStatusLED] = gTraceVcd.addSignal("pins", "StatusLED", 1, 0);
+
+    for (uint8_t i = 0; i < MAX_NUMBER_OF_EVENTS; i++)
+    {
+        snprintf(szName, sizeof(szName), "slot%u", (unsigned int)i);
+        giTraceVcdSlot[i] = gTraceVcd.addSignal("timer", szName, 32, 0);
+    }
+
+    gTraceVcd.begin();
+    return true;
+}
+
+void TraceVcd::close(void)
+{
+    gTraceVcd.close();
+}
+
+void TraceVcd::point(uint8_t uiPoint, uint8_t uiId, uint8_t uiValue)
+{
+    unsigned long ulTime = millis();
+
+    switch (uiPoint)
+    {
+        case kTracePoint_StateEnter:
+
+            if (uiId < kTraceMachines)
+            {
+                gTraceVcd.change(ulTime, giTraceVcdMachine[uiId], uiValue);
+            }
+            break;
+
+        case kTracePoint_PinWrite:
+
+            if (uiId < kHostPinCount)
+            {
+                gTraceVcd.change(ulTime, giTraceVcdPin[uiId], uiValue);
+            }
+            break;
+
+        case kTracePoint_TimerDispatch:
+
+            if (uiId < MAX_NUMBER_OF_EVENTS)
+            {
+                gTraceVcd.change(ulTime, giTraceVcdSlot[uiId], ++gCrossingState.TraceData.Vcd.ulRuns[uiId]);
+            }
+            break;
+
+        default:
+
+            break;
+    }
+}
+
+void TraceVcd::report(void)
+{
+    Serial.print("Trace VCD: ");
+    Serial.print((unsigned long)gTraceVcd.bytes());
+    Serial.println(" bytes");
+}
+
+#endif